@@ -80,6 +80,7 @@
 %token ASSIGNMENT
 %token INT LONG VOID DOUBLE
 %token RETURN IF ELSE DO WHILE FOR BREAK CONTINUE
+%token SWITCH CASE DEFAULT
 %token <std::string> ID
 %token <int> INT_NUMBER
 %token <long> LONG_NUMBER
@@ -88,6 +89,7 @@
 %token <double> DOUBLE_NUMBER
 %token SIGNED UNSIGNED
 %token STATIC EXTERN
+%token INLINE ATTRIBUTE
 
 %nonassoc LOWER_THAN_ELSE
 %nonassoc ELSE
@@ -102,6 +104,10 @@
 %type <TypeSpecifierSet> type_specifier_list
 %type <TypeSpecifierSet::Specifier> type_specifier
 %type <StorageClassSpecifierSet::Specifier> storage_class_specifier
+%type <FunctionSpecifierSet::Specifier> function_specifier
+%type <std::vector<FunctionSpecifierSet::Specifier>> attribute_specifier
+%type <std::vector<FunctionSpecifierSet::Specifier>> attribute_list
+%type <FunctionSpecifierSet::Specifier> attribute
 %type <std::unique_ptr<Declarator>> declarator
 %type <std::unique_ptr<Declarator>> init_declarator
 %type <std::unique_ptr<Declaration>> declaration
@@ -111,7 +117,8 @@
 %type <std::unique_ptr<Statement>> statement
 %type <std::unique_ptr<ReturnStatement>> return_statement
 %type <std::unique_ptr<ExpressionStatement>> expression_statement
-%type <std::unique_ptr<SelectionStatement>> selection_statement
+%type <std::unique_ptr<Statement>> selection_statement
+%type <std::unique_ptr<Statement>> labeled_statement
 %type <std::unique_ptr<Expression>> initializer
 %type <std::unique_ptr<Expression>> expression
 %type <std::unique_ptr<Expression>> primary_expression
@@ -144,7 +151,7 @@ start:
     translation_unit END { driver.SetTranslationUnit(std::move($1)); };
 
 translation_unit:
-    external_declaration { $$ = std::make_unique<TranslationUnit>(); $$->AddExternalDeclaration(std::move($1)); }
+    external_declaration { $$ = MakeNode<TranslationUnit>(driver.GetAstArena()); $$->AddExternalDeclaration(std::move($1)); }
     | translation_unit external_declaration { $1->AddExternalDeclaration(std::move($2)); $$ = std::move($1); };
 
 external_declaration:
@@ -152,14 +159,19 @@ external_declaration:
     | declaration { $$ = std::move($1); };
 
 function_definition:
-    declaration_specifiers declarator compound_statement { $$ = std::make_unique<FunctionDefinition>(std::move($1), std::move($2), std::move($3)); };
+    declaration_specifiers declarator compound_statement { $$ = MakeNode<FunctionDefinition>(driver.GetAstArena(), std::move($1), std::move($2), std::move($3)); };
 
 declaration_specifiers:
-    declaration_specifier_set { $$ = std::make_unique<DeclarationSpecifiers>($1); };
+    declaration_specifier_set {
+        AstArena& arena = driver.GetAstArena();
+        $$ = MakeNode<DeclarationSpecifiers>(arena, arena, $1);
+    };
 
 declaration_specifier_set:
     storage_class_specifier declaration_specifier_set_opt { $$ = $2; $$.Add($1); }
-    | type_specifier declaration_specifier_set_opt { $$ = $2; $$.Add($1); };
+    | type_specifier declaration_specifier_set_opt { $$ = $2; $$.Add($1); }
+    | function_specifier declaration_specifier_set_opt { $$ = $2; $$.Add($1); }
+    | attribute_specifier declaration_specifier_set_opt { $$ = $2; for (auto spec : $1) { $$.Add(spec); } };
 
 declaration_specifier_set_opt:
     %empty { $$ = DeclarationSpecifierSet{}; }
@@ -173,6 +185,25 @@ storage_class_specifier:
     STATIC { $$ = StorageClassSpecifierSet::Specifier::Static; }
     | EXTERN { $$ = StorageClassSpecifierSet::Specifier::Extern; };
 
+function_specifier:
+    INLINE { $$ = FunctionSpecifierSet::Specifier::Inline; };
+
+attribute_specifier:
+    ATTRIBUTE LPAREN LPAREN attribute_list RPAREN RPAREN { $$ = std::move($4); };
+
+attribute_list:
+    attribute { $$ = {$1}; }
+    | attribute_list COMMA attribute { $1.push_back($3); $$ = std::move($1); };
+
+attribute:
+    ID {
+        auto spec = FunctionSpecifierSet::FromAttribute($1);
+        if (!spec) {
+            throw yy::parser::syntax_error(@1, "unknown attribute '" + $1 + "'");
+        }
+        $$ = *spec;
+    };
+
 type_specifier:
     INT { $$ = TypeSpecifierSet::Specifier::Int; }
     | LONG { $$ = TypeSpecifierSet::Specifier::Long; }
@@ -181,13 +212,13 @@ type_specifier:
     | DOUBLE { $$ = TypeSpecifierSet::Specifier::Double; };
 
 declarator:
-    ID { $$ = std::make_unique<IdentifierDeclarator>($1); }
-    | declarator LPAREN RPAREN { $$ = std::make_unique<FunctionDeclarator>(std::move($1)); }
-    | declarator LPAREN VOID RPAREN { $$ = std::make_unique<FunctionDeclarator>(std::move($1)); }
-    | declarator LPAREN parameter_list RPAREN { $$ = std::make_unique<FunctionDeclarator>(std::move($1), std::move($3)); };
+    ID { $$ = MakeNode<IdentifierDeclarator>(driver.GetAstArena(), $1); }
+    | declarator LPAREN RPAREN { $$ = MakeNode<FunctionDeclarator>(driver.GetAstArena(), std::move($1)); }
+    | declarator LPAREN VOID RPAREN { $$ = MakeNode<FunctionDeclarator>(driver.GetAstArena(), std::move($1)); }
+    | declarator LPAREN parameter_list RPAREN { $$ = MakeNode<FunctionDeclarator>(driver.GetAstArena(), std::move($1), std::move($3)); };
 
 declaration:
-    declaration_specifiers init_declarator SEMI { $$ = std::make_unique<Declaration>(std::move($1), std::move($2)); };
+    declaration_specifiers init_declarator SEMI { $$ = MakeNode<Declaration>(driver.GetAstArena(), std::move($1), std::move($2)); };
 
 init_declarator:
     declarator { $$ = std::move($1); }
@@ -197,17 +228,17 @@ initializer:
     assignment_expression { $$ = std::move($1); };
 
 parameter_list:
-    parameter_declaration { $$ = std::make_unique<ParameterList>(); $$->AddParameter(std::move($1)); }
+    parameter_declaration { $$ = MakeNode<ParameterList>(driver.GetAstArena()); $$->AddParameter(std::move($1)); }
     | parameter_list COMMA parameter_declaration { $1->AddParameter(std::move($3)); $$ = std::move($1); };
 
 parameter_declaration:
-    declaration_specifiers declarator { $$ = std::make_unique<ParameterDeclaration>(std::move($1), std::move($2)); };
+    declaration_specifiers declarator { $$ = MakeNode<ParameterDeclaration>(driver.GetAstArena(), std::move($1), std::move($2)); };
 
 compound_statement:
-    LBRACE item_list RBRACE { $$ = std::make_unique<CompoundStatement>(std::move($2)); };
+    LBRACE item_list RBRACE { $$ = MakeNode<CompoundStatement>(driver.GetAstArena(), std::move($2)); };
 
 item_list:
-    %empty { $$ = std::make_unique<ItemList>(); }
+    %empty { $$ = MakeNode<ItemList>(driver.GetAstArena()); }
     | item_list item { $1->AddItem(std::move($2)); $$ = std::move($1); };
 
 item:
@@ -220,34 +251,40 @@ statement:
     | compound_statement { $$ = std::move($1); }
     | return_statement { $$ = std::move($1); }
     | jump_statement { $$ = std::move($1); }
-    | iteration_statement { $$ = std::move($1); };
+    | iteration_statement { $$ = std::move($1); }
+    | labeled_statement { $$ = std::move($1); };
 
 selection_statement:
-    IF LPAREN expression RPAREN statement %prec LOWER_THAN_ELSE { $$ = std::make_unique<SelectionStatement>(std::move($3), std::move($5)); }
-    | IF LPAREN expression RPAREN statement ELSE statement { $$ = std::make_unique<SelectionStatement>(std::move($3), std::move($5), std::move($7)); };
+    IF LPAREN expression RPAREN statement %prec LOWER_THAN_ELSE { $$ = MakeNode<SelectionStatement>(driver.GetAstArena(), std::move($3), std::move($5)); }
+    | IF LPAREN expression RPAREN statement ELSE statement { $$ = MakeNode<SelectionStatement>(driver.GetAstArena(), std::move($3), std::move($5), std::move($7)); }
+    | SWITCH LPAREN expression RPAREN statement { $$ = MakeNode<SwitchStatement>(driver.GetAstArena(), std::move($3), std::move($5)); };
+
+labeled_statement:
+    CASE conditional_expression COLON statement { $$ = MakeNode<CaseStatement>(driver.GetAstArena(), std::move($2), std::move($4)); }
+    | DEFAULT COLON statement { $$ = MakeNode<DefaultStatement>(driver.GetAstArena(), std::move($3)); };
 
 expression_statement:
-    SEMI { $$ = std::make_unique<ExpressionStatement>(); }
-    | expression SEMI { $$ = std::make_unique<ExpressionStatement>(std::move($1)); };
+    SEMI { $$ = MakeNode<ExpressionStatement>(driver.GetAstArena()); }
+    | expression SEMI { $$ = MakeNode<ExpressionStatement>(driver.GetAstArena(), std::move($1)); };
 
 return_statement:
-    RETURN expression SEMI { $$ = std::make_unique<ReturnStatement>(std::move($2)); };
+    RETURN expression SEMI { $$ = MakeNode<ReturnStatement>(driver.GetAstArena(), std::move($2)); };
 
 jump_statement:
-    BREAK SEMI { $$ = std::make_unique<JumpStatement>(JumpStatement::JumpType::Break); }
-    | CONTINUE SEMI { $$ = std::make_unique<JumpStatement>(JumpStatement::JumpType::Continue); };
+    BREAK SEMI { $$ = MakeNode<JumpStatement>(driver.GetAstArena(), JumpStatement::JumpType::Break); }
+    | CONTINUE SEMI { $$ = MakeNode<JumpStatement>(driver.GetAstArena(), JumpStatement::JumpType::Continue); };
 
 iteration_statement:
-    WHILE LPAREN expression RPAREN statement { $$ = std::make_unique<WhileStatement>(WhileStatement::LoopType::While, std::move($3), std::move($5)); }
-    | DO statement WHILE LPAREN expression RPAREN SEMI { $$ = std::make_unique<WhileStatement>(WhileStatement::LoopType::DoWhile, std::move($5), std::move($2)); }
-    | FOR LPAREN for_init expression_opt SEMI expression_opt RPAREN statement { $$ = std::make_unique<ForStatement>(std::move($3), std::move($4), std::move($6), std::move($8)); };
+    WHILE LPAREN expression RPAREN statement { $$ = MakeNode<WhileStatement>(driver.GetAstArena(), WhileStatement::LoopType::While, std::move($3), std::move($5)); }
+    | DO statement WHILE LPAREN expression RPAREN SEMI { $$ = MakeNode<WhileStatement>(driver.GetAstArena(), WhileStatement::LoopType::DoWhile, std::move($5), std::move($2)); }
+    | FOR LPAREN for_init expression_opt SEMI expression_opt RPAREN statement { $$ = MakeNode<ForStatement>(driver.GetAstArena(), std::move($3), std::move($4), std::move($6), std::move($8)); };
 
 for_init:
     declaration { $$ = std::move($1); }
     | expression_opt SEMI { $$ = std::move($1); };
 
 expression_opt:
-    %empty { $$ = std::make_unique<Expression>(); }
+    %empty { $$ = MakeNode<Expression>(driver.GetAstArena()); }
     | expression { $$ = std::move($1); };
 
 expression:
@@ -255,91 +292,91 @@ expression:
 
 assignment_expression:
     conditional_expression { $$ = std::move($1); }
-    | unary_expression ASSIGNMENT assignment_expression { $$ = std::make_unique<AssignmentExpression>(std::move($1), std::move($3)); };
+    | unary_expression ASSIGNMENT assignment_expression { $$ = MakeNode<AssignmentExpression>(driver.GetAstArena(), std::move($1), std::move($3)); };
 
 conditional_expression:
     logical_or_expression { $$ = std::move($1); }
-    | logical_or_expression QUESTION expression COLON conditional_expression { $$ = std::make_unique<ConditionalExpression>(std::move($1), std::move($3), std::move($5)); };
+    | logical_or_expression QUESTION expression COLON conditional_expression { $$ = MakeNode<ConditionalExpression>(driver.GetAstArena(), std::move($1), std::move($3), std::move($5)); };
 
 logical_or_expression:
     logical_and_expression { $$ = std::move($1); }
-    | logical_or_expression OR logical_and_expression { $$ = std::make_unique<BinaryExpression>(BinaryExpression::BinaryOperator::Or, std::move($1), std::move($3)); };
+    | logical_or_expression OR logical_and_expression { $$ = MakeNode<BinaryExpression>(driver.GetAstArena(), BinaryExpression::BinaryOperator::Or, std::move($1), std::move($3)); };
 
 logical_and_expression:
     inclusive_or_expression { $$ = std::move($1); }
-    | logical_and_expression AND inclusive_or_expression { $$ = std::make_unique<BinaryExpression>(BinaryExpression::BinaryOperator::And, std::move($1), std::move($3)); };
+    | logical_and_expression AND inclusive_or_expression { $$ = MakeNode<BinaryExpression>(driver.GetAstArena(), BinaryExpression::BinaryOperator::And, std::move($1), std::move($3)); };
 
 inclusive_or_expression:
     exclusive_or_expression { $$ = std::move($1); }
-    | inclusive_or_expression BIT_OR exclusive_or_expression { $$ = std::make_unique<BinaryExpression>(BinaryExpression::BinaryOperator::BitwiseOr, std::move($1), std::move($3)); };
+    | inclusive_or_expression BIT_OR exclusive_or_expression { $$ = MakeNode<BinaryExpression>(driver.GetAstArena(), BinaryExpression::BinaryOperator::BitwiseOr, std::move($1), std::move($3)); };
 
 exclusive_or_expression:
     and_expression { $$ = std::move($1); } 
-    | exclusive_or_expression BIT_XOR and_expression { $$ = std::make_unique<BinaryExpression>(BinaryExpression::BinaryOperator::BitwiseXor, std::move($1), std::move($3)); };
+    | exclusive_or_expression BIT_XOR and_expression { $$ = MakeNode<BinaryExpression>(driver.GetAstArena(), BinaryExpression::BinaryOperator::BitwiseXor, std::move($1), std::move($3)); };
 
 and_expression:
     equality_expression { $$ = std::move($1); }
-    | and_expression BIT_AND equality_expression { $$ = std::make_unique<BinaryExpression>(BinaryExpression::BinaryOperator::BitwiseAnd, std::move($1), std::move($3)); };
+    | and_expression BIT_AND equality_expression { $$ = MakeNode<BinaryExpression>(driver.GetAstArena(), BinaryExpression::BinaryOperator::BitwiseAnd, std::move($1), std::move($3)); };
 
 equality_expression:
     relation_expression { $$ = std::move($1); }
-    | equality_expression EQ relation_expression { $$ = std::make_unique<BinaryExpression>(BinaryExpression::BinaryOperator::Equal, std::move($1), std::move($3)); }
-    | equality_expression NOT_EQ relation_expression { $$ = std::make_unique<BinaryExpression>(BinaryExpression::BinaryOperator::NotEqual, std::move($1), std::move($3)); };
+    | equality_expression EQ relation_expression { $$ = MakeNode<BinaryExpression>(driver.GetAstArena(), BinaryExpression::BinaryOperator::Equal, std::move($1), std::move($3)); }
+    | equality_expression NOT_EQ relation_expression { $$ = MakeNode<BinaryExpression>(driver.GetAstArena(), BinaryExpression::BinaryOperator::NotEqual, std::move($1), std::move($3)); };
 
 relation_expression:
     shift_expression { $$ = std::move($1); }
-    | relation_expression LE shift_expression { $$ = std::make_unique<BinaryExpression>(BinaryExpression::BinaryOperator::Less, std::move($1), std::move($3)); }
-    | relation_expression GE shift_expression { $$ = std::make_unique<BinaryExpression>(BinaryExpression::BinaryOperator::Greater, std::move($1), std::move($3)); }
-    | relation_expression LEQ shift_expression { $$ = std::make_unique<BinaryExpression>(BinaryExpression::BinaryOperator::LessEqual, std::move($1), std::move($3)); }
-    | relation_expression GEQ shift_expression { $$ = std::make_unique<BinaryExpression>(BinaryExpression::BinaryOperator::GreaterEqual, std::move($1), std::move($3)); };
+    | relation_expression LE shift_expression { $$ = MakeNode<BinaryExpression>(driver.GetAstArena(), BinaryExpression::BinaryOperator::Less, std::move($1), std::move($3)); }
+    | relation_expression GE shift_expression { $$ = MakeNode<BinaryExpression>(driver.GetAstArena(), BinaryExpression::BinaryOperator::Greater, std::move($1), std::move($3)); }
+    | relation_expression LEQ shift_expression { $$ = MakeNode<BinaryExpression>(driver.GetAstArena(), BinaryExpression::BinaryOperator::LessEqual, std::move($1), std::move($3)); }
+    | relation_expression GEQ shift_expression { $$ = MakeNode<BinaryExpression>(driver.GetAstArena(), BinaryExpression::BinaryOperator::GreaterEqual, std::move($1), std::move($3)); };
 
 shift_expression:
     additive_expression { $$ = std::move($1); }
-    | shift_expression BIT_LSHIFT additive_expression { $$ = std::make_unique<BinaryExpression>(BinaryExpression::BinaryOperator::LeftShift, std::move($1), std::move($3)); }
-    | shift_expression BIT_RSHIFT additive_expression { $$ = std::make_unique<BinaryExpression>(BinaryExpression::BinaryOperator::RightShift, std::move($1), std::move($3)); };
+    | shift_expression BIT_LSHIFT additive_expression { $$ = MakeNode<BinaryExpression>(driver.GetAstArena(), BinaryExpression::BinaryOperator::LeftShift, std::move($1), std::move($3)); }
+    | shift_expression BIT_RSHIFT additive_expression { $$ = MakeNode<BinaryExpression>(driver.GetAstArena(), BinaryExpression::BinaryOperator::RightShift, std::move($1), std::move($3)); };
 
 additive_expression:
     multiplicative_expression { $$ = std::move($1); }
-    | additive_expression PLUS multiplicative_expression { $$ = std::make_unique<BinaryExpression>(BinaryExpression::BinaryOperator::Plus, std::move($1), std::move($3)); }
-    | additive_expression MINUS multiplicative_expression { $$ = std::make_unique<BinaryExpression>(BinaryExpression::BinaryOperator::Minus, std::move($1), std::move($3)); };
+    | additive_expression PLUS multiplicative_expression { $$ = MakeNode<BinaryExpression>(driver.GetAstArena(), BinaryExpression::BinaryOperator::Plus, std::move($1), std::move($3)); }
+    | additive_expression MINUS multiplicative_expression { $$ = MakeNode<BinaryExpression>(driver.GetAstArena(), BinaryExpression::BinaryOperator::Minus, std::move($1), std::move($3)); };
 
 multiplicative_expression:
     cast_expression { $$ = std::move($1); }
-    | multiplicative_expression STAR cast_expression { $$ = std::make_unique<BinaryExpression>(BinaryExpression::BinaryOperator::Mul, std::move($1), std::move($3)); }
-    | multiplicative_expression SLASH cast_expression { $$ = std::make_unique<BinaryExpression>(BinaryExpression::BinaryOperator::Div, std::move($1), std::move($3)); }
-    | multiplicative_expression MOD cast_expression { $$ = std::make_unique<BinaryExpression>(BinaryExpression::BinaryOperator::Mod, std::move($1), std::move($3)); };
+    | multiplicative_expression STAR cast_expression { $$ = MakeNode<BinaryExpression>(driver.GetAstArena(), BinaryExpression::BinaryOperator::Mul, std::move($1), std::move($3)); }
+    | multiplicative_expression SLASH cast_expression { $$ = MakeNode<BinaryExpression>(driver.GetAstArena(), BinaryExpression::BinaryOperator::Div, std::move($1), std::move($3)); }
+    | multiplicative_expression MOD cast_expression { $$ = MakeNode<BinaryExpression>(driver.GetAstArena(), BinaryExpression::BinaryOperator::Mod, std::move($1), std::move($3)); };
 
 cast_expression:
     unary_expression { $$ = std::move($1); }
-    | LPAREN type_specifier_list RPAREN cast_expression { $$ = std::make_unique<CastExpression>(std::make_unique<TypeSpecification>($2), std::move($4)); };
+    | LPAREN type_specifier_list RPAREN cast_expression { $$ = MakeNode<CastExpression>(driver.GetAstArena(), MakeNode<TypeSpecification>(driver.GetAstArena(), $2), std::move($4)); };
 
 unary_expression:
     postfix_expression { $$ = std::move($1); }
-    | PLUS unary_expression { $$ = std::make_unique<UnaryExpression>(UnaryExpression::UnaryOperator::Plus, std::move($2)); }
-    | MINUS unary_expression { $$ = std::make_unique<UnaryExpression>(UnaryExpression::UnaryOperator::Minus, std::move($2)); }
-    | BIT_NOT unary_expression { $$ = std::make_unique<UnaryExpression>(UnaryExpression::UnaryOperator::BinaryNot, std::move($2)); }
-    | NOT unary_expression { $$ = std::make_unique<UnaryExpression>(UnaryExpression::UnaryOperator::Not, std::move($2)); };
+    | PLUS unary_expression { $$ = MakeNode<UnaryExpression>(driver.GetAstArena(), UnaryExpression::UnaryOperator::Plus, std::move($2)); }
+    | MINUS unary_expression { $$ = MakeNode<UnaryExpression>(driver.GetAstArena(), UnaryExpression::UnaryOperator::Minus, std::move($2)); }
+    | BIT_NOT unary_expression { $$ = MakeNode<UnaryExpression>(driver.GetAstArena(), UnaryExpression::UnaryOperator::BinaryNot, std::move($2)); }
+    | NOT unary_expression { $$ = MakeNode<UnaryExpression>(driver.GetAstArena(), UnaryExpression::UnaryOperator::Not, std::move($2)); };
 
 postfix_expression:
     primary_expression { $$ = std::move($1); }
-    | postfix_expression LPAREN RPAREN { $$ = std::make_unique<FunctionCallExpression>(std::move($1)); }
-    | postfix_expression LPAREN argument_expression_list RPAREN { $$ = std::make_unique<FunctionCallExpression>(std::move($1), std::move($3)); };
+    | postfix_expression LPAREN RPAREN { $$ = MakeNode<FunctionCallExpression>(driver.GetAstArena(), std::move($1)); }
+    | postfix_expression LPAREN argument_expression_list RPAREN { $$ = MakeNode<FunctionCallExpression>(driver.GetAstArena(), std::move($1), std::move($3)); };
 
 primary_expression:
-    ID { $$ = std::make_unique<IdExpression>($1); }
-    | INT_NUMBER { $$ = std::make_unique<PrimaryExpression>($1); }
-    | LONG_NUMBER { $$ = std::make_unique<PrimaryExpression>($1); }
-    | UINT_NUMBER { $$ = std::make_unique<PrimaryExpression>($1); }
-    | ULONG_NUMBER { $$ = std::make_unique<PrimaryExpression>($1); }
-    | DOUBLE_NUMBER { $$ = std::make_unique<PrimaryExpression>($1); }
+    ID { $$ = MakeNode<IdExpression>(driver.GetAstArena(), $1); }
+    | INT_NUMBER { $$ = MakeNode<PrimaryExpression>(driver.GetAstArena(), $1); }
+    | LONG_NUMBER { $$ = MakeNode<PrimaryExpression>(driver.GetAstArena(), $1); }
+    | UINT_NUMBER { $$ = MakeNode<PrimaryExpression>(driver.GetAstArena(), $1); }
+    | ULONG_NUMBER { $$ = MakeNode<PrimaryExpression>(driver.GetAstArena(), $1); }
+    | DOUBLE_NUMBER { $$ = MakeNode<PrimaryExpression>(driver.GetAstArena(), $1); }
     | LPAREN expression RPAREN { $$ = std::move($2); };
 
 argument_expression_list:
-    assignment_expression { $$ = std::make_unique<ArgumentExpressionList>(); $$->AddArgument(std::move($1)); }
+    assignment_expression { $$ = MakeNode<ArgumentExpressionList>(driver.GetAstArena()); $$->AddArgument(std::move($1)); }
     | argument_expression_list COMMA assignment_expression { $1->AddArgument(std::move($3)); $$ = std::move($1); };
 
 %%
 
 void yy::parser::error(const location_type& l, const std::string& m) {
-  std::cerr << "Parsing error at line " << l.begin.line << ", column " << l.begin.column << ": " << m << std::endl;
+  *driver.error_stream << "Parsing error at line " << l.begin.line << ", column " << l.begin.column << ": " << m << std::endl;
 }
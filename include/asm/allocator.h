@@ -3,12 +3,20 @@
 #include <set>
 #include <string>
 #include <unordered_map>
+#include <vector>
 
 #include "operands.h"
 
+struct StackSlotInterval {
+    InternedString name;
+    int size;
+    int start;
+    int end;
+};
+
 struct Frame {
     int current_offset = 0;
-    std::unordered_map<std::string, int> offsets;
+    std::unordered_map<InternedString, int> offsets;
     int alignment = 16;
 };
 
@@ -19,8 +27,9 @@ public:
     void PushFrame();
     void PopFrame();
 
-    int GetLocalOffset(const std::string& name, int size);
-    int GetArgumentOffset(std::string name, int size) const;
+    int GetLocalOffset(InternedString name, int size);
+    void AssignSharedSlots(std::vector<StackSlotInterval> intervals);
+    int GetArgumentOffset(int stack_index) const;
     int GetArgumentOffsetForCaller(int index, int size = 8) const;
 
     int ReserveStackArguments(size_t arg_count);
@@ -29,6 +38,8 @@ public:
 
 private:
     std::vector<Frame> frames_;
+
+    static int AlignOffset(int offset, int alignment);
 };
 
 ///////////////////////////////////////////////
@@ -37,9 +48,11 @@ class TempRegisterAllocator {
 public:
     TempRegisterAllocator();
 
-    std::shared_ptr<Register> Allocate(ASMOperand::Size size = ASMOperand::Size::Byte4);
-    void Free(const std::shared_ptr<Register>& reg);
+    Register Allocate(ASMOperand::Size size = ASMOperand::Size::Byte4,
+                      bool is_floating_point = false);
+    void Free(const Register& reg);
 
 private:
     std::set<int> available_regs_;
+    std::set<int> available_fp_regs_;
 };
\ No newline at end of file
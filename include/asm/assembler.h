@@ -0,0 +1,89 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+// Collects encoded AArch64 code and data into sections and writes them out as an ELF64
+// relocatable object. References to labels are recorded as fixups: ones that stay
+// within a section are patched in place, everything else becomes a relocation.
+//
+// Symbols follow the Mach-O spelling used by the textual output, so the leading
+// underscore of "_name" is dropped in the object file. Labels without one are
+// assembler-local and get no symbol of their own.
+class Assembler {
+public:
+    enum class Section { Text, ColdText, Data, Literal };
+    enum class SymbolType { Label, Function, Object };
+    enum class Fixup {
+        Branch26,      // b
+        Call26,        // bl
+        CondBranch19,  // b.cond
+        Adr21,         // adr
+        AdrPage21,     // adrp
+        PageOffset32,  // ldr/str of a 32-bit value at :lo12:
+        PageOffset64,  // ldr/str of a 64-bit value at :lo12:
+        Relative32,    // .long symbol - .
+    };
+
+    Assembler();
+
+    void SwitchSection(Section section);
+    // Pads the current section to 2^log2_alignment bytes, with nops in code.
+    void Align(int log2_alignment);
+
+    void EmitWord(uint32_t word);
+    void EmitQuad(uint64_t value);
+    // Emits word and records that its immediate field refers to symbol + addend.
+    void EmitWord(uint32_t word, Fixup fixup, const std::string& symbol,
+                  int64_t addend = 0);
+
+    void DefineLabel(const std::string& name, SymbolType type = SymbolType::Label,
+                     uint64_t size = 0);
+    void DeclareGlobal(const std::string& name);
+
+    // Offset of the next byte in the current section.
+    uint64_t GetOffset() const;
+
+    // Resolves the fixups and writes the object file. Returns false and sets the
+    // error if a fixup is out of range or the file cannot be written.
+    bool WriteObject(const std::string& filename);
+    const std::string& GetError() const;
+
+private:
+    struct SectionData {
+        std::vector<uint8_t> bytes;
+        int log2_alignment = 0;
+    };
+    struct Definition {
+        Section section;
+        uint64_t offset;
+        SymbolType type;
+        uint64_t size;
+    };
+    struct PendingFixup {
+        Section section;
+        uint64_t offset;
+        Fixup fixup;
+        std::string symbol;
+        int64_t addend;
+    };
+    struct Relocation {
+        uint64_t offset;
+        uint32_t symbol;  // index into the symbol table
+        uint32_t type;
+        int64_t addend;
+    };
+
+    SectionData& Current();
+    bool Patch(const PendingFixup& fixup, int64_t delta);
+
+    std::vector<SectionData> sections_;
+    Section current_section_;
+    std::unordered_map<std::string, Definition> labels_;
+    std::unordered_set<std::string> globals_;
+    std::vector<PendingFixup> fixups_;
+    std::string error_;
+};
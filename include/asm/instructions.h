@@ -1,17 +1,45 @@
 #pragma once
 
-#include <memory>
+#include <array>
+#include <span>
 #include <string>
+#include <type_traits>
+#include <variant>
 #include <vector>
 
 #include "include/types/numeric_constant.h"
 #include "operands.h"
 
-enum class BinaryOp { Add, Sub, Mul, SDiv, UDiv, And, Orr, Eor, Lsl, Asr, Lsr };
-enum class UnaryOp { Neg, Mvn };
+class Assembler;
+
+enum class BinaryOp {
+    Add,
+    Sub,
+    Mul,
+    SDiv,
+    UDiv,
+    And,
+    Orr,
+    Eor,
+    Lsl,
+    Asr,
+    Lsr,
+    FAdd,
+    FSub,
+    FMul,
+    FDiv
+};
+enum class UnaryOp { Neg, Mvn, FNeg, Clz, Rbit, Rev };
+// dst = addend + lhs * rhs, addend - lhs * rhs, lhs * rhs - addend
+enum class FusedOp { FMAdd, FMSub, FNMSub };
+enum class ConvertOp { FCvtZS, FCvtZU, SCvtF, UCvtF };
+
+// Extended-register form of the last operand: "add x0, x1, w2, sxtw".
+enum class OperandExtend { None, Sxtw, Uxtw };
 // Signed: Lt, Le, Gt, Ge
 // Unsigned: Lo, Ls, Hi, Hs
-enum class Condition { Eq, Ne, Lt, Le, Gt, Ge, Lo, Ls, Hi, Hs };
+// Ordered floating-point less than: Mi
+enum class Condition { Eq, Ne, Lt, Le, Gt, Ge, Lo, Ls, Hi, Hs, Mi };
 
 inline std::string ConditionToStr(Condition cond) {
     switch (cond) {
@@ -35,36 +63,91 @@ inline std::string ConditionToStr(Condition cond) {
             return "hi";
         case Condition::Hs:
             return "hs";
+        case Condition::Mi:
+            return "mi";
     }
 }
 enum class BranchType { Unconditional, Conditional, Call };
 
-class ASMInstruction {
+enum class Opcode {
+    Label,
+    Global,
+    Mov,
+    Movz,
+    Movk,
+    Movn,
+    Binary,
+    Unary,
+    FusedMultiply,
+    Convert,
+    PopCount,
+    Compare,
+    CSet,
+    Branch,
+    Ret,
+    IndirectBranch,
+    Load,
+    LoadIndexed,
+    LoadPair,
+    Store,
+    StorePair,
+    AllocateStack,
+    DeallocateStack,
+    Extend,
+    Truncate,
+    TextSection,
+    ColdTextSection,
+    DataSection,
+    LiteralSection,
+    Literal,
+    JumpTable,
+    StaticVariable,
+    Adrp,
+    Adr,
+    LoadGlobal,
+    StoreGlobal,
+};
+
+// Inline storage for the operands that operand resolution rewrites, destination first.
+template <size_t N>
+class InstructionOperands {
 public:
-    virtual std::string ToString() const = 0;
+    std::span<ASMOperand> GetOperands() { return operands_; }
+    std::span<const ASMOperand> GetOperands() const { return operands_; }
 
-    virtual std::vector<std::shared_ptr<ASMOperand>> GetOperands() const;
+protected:
+    template <typename... Operands>
+    explicit InstructionOperands(Operands... operands)
+        : operands_{std::move(operands)...} {}
 
-    virtual void SetOperands(
-        const std::vector<std::shared_ptr<ASMOperand>>& new_operands);
+    std::array<ASMOperand, N> operands_;
 };
 
 ///////////////////////////////////////////////
 
-class LabelInstruction : public ASMInstruction {
+class LabelInstruction {
 public:
-    explicit LabelInstruction(const std::string& label);
-    std::string ToString() const override;
+    static constexpr Opcode kOpcode = Opcode::Label;
+
+    explicit LabelInstruction(const std::string& label, int alignment = 0);
+    std::string ToString() const;
+    void Write(OutputBuffer& out) const;
+    void Encode(Assembler& out) const;
     bool IsFunction() const;
+    const std::string& GetLabel() const;
 
 private:
     std::string label_;
+    int alignment_;  // log2 of the byte alignment, 0 for none
 };
 
-class GlobalDirective : public ASMInstruction {
+class GlobalDirective {
 public:
+    static constexpr Opcode kOpcode = Opcode::Global;
+
     explicit GlobalDirective(const std::string& name);
-    std::string ToString() const override;
+    std::string ToString() const;
+    void Encode(Assembler& out) const;
 
 private:
     std::string name_;
@@ -72,116 +155,156 @@ private:
 
 ///////////////////////////////////////////////
 
-class MovInstruction : public ASMInstruction {
+class MovInstruction : public InstructionOperands<2> {
+public:
+    static constexpr Opcode kOpcode = Opcode::Mov;
+
+    MovInstruction(ASMOperand dst, ASMOperand src);
+    std::string ToString() const;
+    void Write(OutputBuffer& out) const;
+    void Encode(Assembler& out) const;
+};
+
+class MovzInstruction : public InstructionOperands<1> {
 public:
-    MovInstruction(std::shared_ptr<ASMOperand> dst, std::shared_ptr<ASMOperand> src);
-    std::string ToString() const override;
+    static constexpr Opcode kOpcode = Opcode::Movz;
 
-    virtual std::vector<std::shared_ptr<ASMOperand>> GetOperands() const override;
-    virtual void SetOperands(
-        const std::vector<std::shared_ptr<ASMOperand>>& new_operands) override;
+    MovzInstruction(ASMOperand dst, uint16_t imm16, int shift);
+    std::string ToString() const;
+    void Encode(Assembler& out) const;
 
 private:
-    std::shared_ptr<ASMOperand> dst_;
-    std::shared_ptr<ASMOperand> src_;
+    uint16_t imm16_;
+    int shift_;
 };
 
-class MovzInstruction : public ASMInstruction {
+class MovkInstruction : public InstructionOperands<1> {
 public:
-    MovzInstruction(std::shared_ptr<ASMOperand> dst, uint16_t imm16, int shift);
+    static constexpr Opcode kOpcode = Opcode::Movk;
 
-    std::vector<std::shared_ptr<ASMOperand>> GetOperands() const override;
-    void SetOperands(
-        const std::vector<std::shared_ptr<ASMOperand>>& new_operands) override;
-    std::string ToString() const override;
+    MovkInstruction(ASMOperand dst, uint16_t imm16, int shift);
+    std::string ToString() const;
+    void Encode(Assembler& out) const;
 
 private:
-    std::shared_ptr<ASMOperand> dst_;
     uint16_t imm16_;
     int shift_;
 };
 
-class MovkInstruction : public ASMInstruction {
+class MovnInstruction : public InstructionOperands<1> {
 public:
-    MovkInstruction(std::shared_ptr<ASMOperand> dst, uint16_t imm16, int shift);
+    static constexpr Opcode kOpcode = Opcode::Movn;
 
-    std::vector<std::shared_ptr<ASMOperand>> GetOperands() const override;
-    void SetOperands(
-        const std::vector<std::shared_ptr<ASMOperand>>& new_operands) override;
-    std::string ToString() const override;
+    MovnInstruction(ASMOperand dst, uint16_t imm16, int shift);
+    std::string ToString() const;
+    void Encode(Assembler& out) const;
 
 private:
-    std::shared_ptr<ASMOperand> dst_;
     uint16_t imm16_;
     int shift_;
 };
 
 ///////////////////////////////////////////////
 
-class BinaryInstruction : public ASMInstruction {
+class BinaryInstruction : public InstructionOperands<3> {
 public:
-    BinaryInstruction(BinaryOp op, std::shared_ptr<ASMOperand> dst,
-                      std::shared_ptr<ASMOperand> lhs, std::shared_ptr<ASMOperand> rhs);
-    std::string ToString() const override;
+    static constexpr Opcode kOpcode = Opcode::Binary;
 
-    virtual std::vector<std::shared_ptr<ASMOperand>> GetOperands() const override;
-    virtual void SetOperands(
-        const std::vector<std::shared_ptr<ASMOperand>>& new_operands) override;
+    BinaryInstruction(BinaryOp op, ASMOperand dst, ASMOperand lhs, ASMOperand rhs,
+                      OperandExtend extend = OperandExtend::None);
+    std::string ToString() const;
+    void Write(OutputBuffer& out) const;
+    void Encode(Assembler& out) const;
 
 private:
     BinaryOp op_;
-    std::shared_ptr<ASMOperand> dst_, lhs_, rhs_;
+    OperandExtend extend_;
 };
 
-class UnaryInstruction : public ASMInstruction {
+class UnaryInstruction : public InstructionOperands<2> {
 public:
-    UnaryInstruction(UnaryOp op, std::shared_ptr<ASMOperand> dst,
-                     std::shared_ptr<ASMOperand> operand);
-    std::string ToString() const override;
+    static constexpr Opcode kOpcode = Opcode::Unary;
 
-    virtual std::vector<std::shared_ptr<ASMOperand>> GetOperands() const override;
-    virtual void SetOperands(
-        const std::vector<std::shared_ptr<ASMOperand>>& new_operands) override;
+    UnaryInstruction(UnaryOp op, ASMOperand dst, ASMOperand operand);
+    std::string ToString() const;
+    void Encode(Assembler& out) const;
 
 private:
     UnaryOp op_;
-    std::shared_ptr<ASMOperand> dst_, operand_;
 };
 
-///////////////////////////////////////////////
+class FusedMultiplyInstruction : public InstructionOperands<4> {
+public:
+    static constexpr Opcode kOpcode = Opcode::FusedMultiply;
 
-class CompareInstruction : public ASMInstruction {
+    FusedMultiplyInstruction(FusedOp op, ASMOperand dst, ASMOperand lhs, ASMOperand rhs,
+                             ASMOperand addend);
+    std::string ToString() const;
+    void Encode(Assembler& out) const;
+
+private:
+    FusedOp op_;
+};
+
+class ConvertInstruction : public InstructionOperands<2> {
 public:
-    CompareInstruction(std::shared_ptr<ASMOperand> lhs, std::shared_ptr<ASMOperand> rhs);
-    std::string ToString() const override;
+    static constexpr Opcode kOpcode = Opcode::Convert;
 
-    virtual std::vector<std::shared_ptr<ASMOperand>> GetOperands() const override;
-    virtual void SetOperands(
-        const std::vector<std::shared_ptr<ASMOperand>>& new_operands) override;
+    ConvertInstruction(ConvertOp op, ASMOperand dst, ASMOperand src);
+    std::string ToString() const;
+    void Encode(Assembler& out) const;
 
 private:
-    std::shared_ptr<ASMOperand> lhs_, rhs_;
+    ConvertOp op_;
 };
 
-class CSetInstruction : public ASMInstruction {
+// Counts the set bits of src with the NEON cnt and addv, going through v31, which no
+// temporary uses. dst has the width of src.
+class PopCountInstruction : public InstructionOperands<2> {
 public:
-    CSetInstruction(std::shared_ptr<ASMOperand> dst, Condition cond);
-    std::string ToString() const override;
+    static constexpr Opcode kOpcode = Opcode::PopCount;
 
-    virtual std::vector<std::shared_ptr<ASMOperand>> GetOperands() const override;
-    virtual void SetOperands(
-        const std::vector<std::shared_ptr<ASMOperand>>& new_operands) override;
+    PopCountInstruction(ASMOperand dst, ASMOperand src);
+    std::string ToString() const;
+    void Encode(Assembler& out) const;
+};
+
+///////////////////////////////////////////////
+
+class CompareInstruction : public InstructionOperands<2> {
+public:
+    static constexpr Opcode kOpcode = Opcode::Compare;
+
+    CompareInstruction(ASMOperand lhs, ASMOperand rhs);
+    std::string ToString() const;
+    void Write(OutputBuffer& out) const;
+    void Encode(Assembler& out) const;
+};
+
+class CSetInstruction : public InstructionOperands<1> {
+public:
+    static constexpr Opcode kOpcode = Opcode::CSet;
+
+    CSetInstruction(ASMOperand dst, Condition cond);
+    std::string ToString() const;
+    void Encode(Assembler& out) const;
 
 private:
-    std::shared_ptr<ASMOperand> dst_;
     Condition cond_;
 };
 
-class BranchInstruction : public ASMInstruction {
+class BranchInstruction {
 public:
+    static constexpr Opcode kOpcode = Opcode::Branch;
+
     BranchInstruction(BranchType type, const std::string& label,
                       Condition cond = Condition::Eq);
-    std::string ToString() const override;
+    std::string ToString() const;
+    void Write(OutputBuffer& out) const;
+    void Encode(Assembler& out) const;
+
+    BranchType GetType() const;
+    const std::string& GetLabel() const;
 
 private:
     BranchType type_;
@@ -189,144 +312,222 @@ private:
     Condition cond_;
 };
 
-class RetInstruction : public ASMInstruction {
+class RetInstruction {
+public:
+    static constexpr Opcode kOpcode = Opcode::Ret;
+
+    std::string ToString() const;
+    void Encode(Assembler& out) const;
+};
+
+// "br xN" through a jump table; the targets are the labels the table may select.
+class IndirectBranchInstruction : public InstructionOperands<1> {
 public:
-    RetInstruction();
-    std::string ToString() const override;
+    static constexpr Opcode kOpcode = Opcode::IndirectBranch;
+
+    IndirectBranchInstruction(ASMOperand address, std::vector<std::string> targets);
+    std::string ToString() const;
+    void Encode(Assembler& out) const;
+    const std::vector<std::string>& GetTargets() const;
+
+private:
+    std::vector<std::string> targets_;
 };
 
 ///////////////////////////////////////////////
 
-class LoadInstruction : public ASMInstruction {
+class LoadInstruction : public InstructionOperands<2> {
 public:
-    LoadInstruction(std::shared_ptr<ASMOperand> dst, std::shared_ptr<ASMOperand> address);
-    std::string ToString() const override;
+    static constexpr Opcode kOpcode = Opcode::Load;
 
-    virtual std::vector<std::shared_ptr<ASMOperand>> GetOperands() const override;
-    virtual void SetOperands(
-        const std::vector<std::shared_ptr<ASMOperand>>& new_operands) override;
+    LoadInstruction(ASMOperand dst, ASMOperand address, bool sign_extend = false);
+    std::string ToString() const;
+    void Write(OutputBuffer& out) const;
+    void Encode(Assembler& out) const;
 
 private:
-    std::shared_ptr<ASMOperand> dst_, address_;
+    bool sign_extend_;
 };
 
-class LoadPairInstruction : public ASMInstruction {
+// Register-offset load: "ldr dst, [base, index, lsl #shift]".
+class LoadIndexedInstruction : public InstructionOperands<3> {
 public:
-    LoadPairInstruction(std::shared_ptr<ASMOperand> dst1,
-                        std::shared_ptr<ASMOperand> dst2,
-                        std::shared_ptr<ASMOperand> address);
+    static constexpr Opcode kOpcode = Opcode::LoadIndexed;
 
-    std::string ToString() const override;
+    LoadIndexedInstruction(ASMOperand dst, ASMOperand base, ASMOperand index, int shift,
+                           bool sign_extend = false);
+    std::string ToString() const;
+    void Encode(Assembler& out) const;
 
 private:
-    std::shared_ptr<ASMOperand> dst1_;
-    std::shared_ptr<ASMOperand> dst2_;
-    std::shared_ptr<ASMOperand> address_;
+    int shift_;
+    bool sign_extend_;
 };
 
-class StoreInstruction : public ASMInstruction {
+// The pairs only appear in the prologue and epilogue, on physical registers, so their
+// operands are not exposed for resolution.
+class LoadPairInstruction {
 public:
-    StoreInstruction(std::shared_ptr<ASMOperand> src,
-                     std::shared_ptr<ASMOperand> address);
-    std::string ToString() const override;
+    static constexpr Opcode kOpcode = Opcode::LoadPair;
 
-    virtual std::vector<std::shared_ptr<ASMOperand>> GetOperands() const override;
-    virtual void SetOperands(
-        const std::vector<std::shared_ptr<ASMOperand>>& new_operands) override;
+    LoadPairInstruction(ASMOperand dst1, ASMOperand dst2, ASMOperand address);
+    std::string ToString() const;
+    void Encode(Assembler& out) const;
 
 private:
-    std::shared_ptr<ASMOperand> src_, address_;
+    ASMOperand dst1_;
+    ASMOperand dst2_;
+    ASMOperand address_;
 };
 
-class StorePairInstruction : public ASMInstruction {
+class StoreInstruction : public InstructionOperands<2> {
 public:
-    StorePairInstruction(std::shared_ptr<ASMOperand> src1,
-                         std::shared_ptr<ASMOperand> src2,
-                         std::shared_ptr<ASMOperand> address);
+    static constexpr Opcode kOpcode = Opcode::Store;
 
-    std::string ToString() const override;
+    StoreInstruction(ASMOperand src, ASMOperand address);
+    std::string ToString() const;
+    void Write(OutputBuffer& out) const;
+    void Encode(Assembler& out) const;
+};
+
+class StorePairInstruction {
+public:
+    static constexpr Opcode kOpcode = Opcode::StorePair;
+
+    StorePairInstruction(ASMOperand src1, ASMOperand src2, ASMOperand address);
+    std::string ToString() const;
+    void Encode(Assembler& out) const;
 
 private:
-    std::shared_ptr<ASMOperand> src1_;
-    std::shared_ptr<ASMOperand> src2_;
-    std::shared_ptr<ASMOperand> address_;
+    ASMOperand src1_;
+    ASMOperand src2_;
+    ASMOperand address_;
 };
 
 ///////////////////////////////////////////////
 
-class AllocateStackInstruction : public ASMInstruction {
+class AllocateStackInstruction {
 public:
-    explicit AllocateStackInstruction(std::shared_ptr<ASMOperand> size,
-                                      bool final_size = false);
-    std::string ToString() const override;
-    void ChangeSize(std::shared_ptr<ASMOperand> size);
+    static constexpr Opcode kOpcode = Opcode::AllocateStack;
+
+    explicit AllocateStackInstruction(Immediate size, bool final_size = false);
+    std::string ToString() const;
+    void Encode(Assembler& out) const;
+    void ChangeSize(Immediate size);
 
 private:
-    std::shared_ptr<ASMOperand> size_;
+    Immediate size_;
     bool final_size_;
 };
 
-class DeallocateStackInstruction : public ASMInstruction {
+class DeallocateStackInstruction {
 public:
-    explicit DeallocateStackInstruction(std::shared_ptr<ASMOperand> size,
-                                        bool final_size = false);
-    std::string ToString() const override;
-    void ChangeSize(std::shared_ptr<ASMOperand> size);
+    static constexpr Opcode kOpcode = Opcode::DeallocateStack;
+
+    explicit DeallocateStackInstruction(Immediate size, bool final_size = false);
+    std::string ToString() const;
+    void Encode(Assembler& out) const;
+    void ChangeSize(Immediate size);
 
 private:
-    std::shared_ptr<ASMOperand> size_;
+    Immediate size_;
     bool final_size_;
 };
 
 ///////////////////////////////////////////////
 
-class ExtendInstruction : public ASMInstruction {
+class ExtendInstruction : public InstructionOperands<2> {
 public:
-    ExtendInstruction(std::shared_ptr<ASMOperand> dst, std::shared_ptr<ASMOperand> src,
-                      bool is_signed);
-    std::string ToString() const override;
+    static constexpr Opcode kOpcode = Opcode::Extend;
 
-    std::vector<std::shared_ptr<ASMOperand>> GetOperands() const override;
-    void SetOperands(
-        const std::vector<std::shared_ptr<ASMOperand>>& new_operands) override;
+    ExtendInstruction(ASMOperand dst, ASMOperand src, bool is_signed);
+    std::string ToString() const;
+    void Encode(Assembler& out) const;
+    bool IsSigned() const;
 
 private:
-    std::shared_ptr<ASMOperand> dst_, src_;
     bool is_signed_;
 };
 
-class TruncateInstruction : public ASMInstruction {
+class TruncateInstruction : public InstructionOperands<2> {
 public:
-    TruncateInstruction(std::shared_ptr<ASMOperand> dst, std::shared_ptr<ASMOperand> src);
-    std::string ToString() const override;
+    static constexpr Opcode kOpcode = Opcode::Truncate;
 
-    std::vector<std::shared_ptr<ASMOperand>> GetOperands() const override;
-    void SetOperands(
-        const std::vector<std::shared_ptr<ASMOperand>>& new_operands) override;
-
-private:
-    std::shared_ptr<ASMOperand> dst_, src_;
+    TruncateInstruction(ASMOperand dst, ASMOperand src);
+    std::string ToString() const;
+    void Encode(Assembler& out) const;
 };
 
 ///////////////////////////////////////////////
 
-class TextSectionDirective : public ASMInstruction {
+class TextSectionDirective {
+public:
+    static constexpr Opcode kOpcode = Opcode::TextSection;
+
+    std::string ToString() const;
+    void Encode(Assembler& out) const;
+};
+
+// Code that rarely runs, kept away from the rest in __TEXT,__text_cold.
+class ColdTextSectionDirective {
 public:
-    TextSectionDirective() = default;
-    std::string ToString() const override;
+    static constexpr Opcode kOpcode = Opcode::ColdTextSection;
+
+    std::string ToString() const;
+    void Encode(Assembler& out) const;
+};
+
+class DataSectionDirective {
+public:
+    static constexpr Opcode kOpcode = Opcode::DataSection;
+
+    std::string ToString() const;
+    void Encode(Assembler& out) const;
 };
 
-class DataSectionDirective : public ASMInstruction {
+class LiteralSectionDirective {
 public:
-    DataSectionDirective() = default;
-    std::string ToString() const override;
+    static constexpr Opcode kOpcode = Opcode::LiteralSection;
+
+    std::string ToString() const;
+    void Encode(Assembler& out) const;
 };
 
-class StaticVariableDirective : public ASMInstruction {
+class LiteralDirective {
 public:
+    static constexpr Opcode kOpcode = Opcode::Literal;
+
+    LiteralDirective(const std::string& label, uint64_t bits);
+    std::string ToString() const;
+    void Encode(Assembler& out) const;
+
+private:
+    std::string label_;
+    uint64_t bits_;
+};
+
+// Table of 32-bit offsets of the targets from the table itself.
+class JumpTableDirective {
+public:
+    static constexpr Opcode kOpcode = Opcode::JumpTable;
+
+    JumpTableDirective(const std::string& label, std::vector<std::string> targets);
+    std::string ToString() const;
+    void Encode(Assembler& out) const;
+
+private:
+    std::string label_;
+    std::vector<std::string> targets_;
+};
+
+class StaticVariableDirective {
+public:
+    static constexpr Opcode kOpcode = Opcode::StaticVariable;
+
     StaticVariableDirective(const std::string& name, NumericConstant value, int size,
                             bool is_global);
-    std::string ToString() const override;
+    std::string ToString() const;
+    void Encode(Assembler& out) const;
 
 private:
     std::string name_;
@@ -337,50 +538,103 @@ private:
 
 ///////////////////////////////////////////////
 
-class AdrpInstruction : public ASMInstruction {
+class AdrpInstruction : public InstructionOperands<1> {
 public:
-    AdrpInstruction(std::shared_ptr<ASMOperand> dst, const std::string& symbol);
-    std::string ToString() const override;
+    static constexpr Opcode kOpcode = Opcode::Adrp;
 
-    std::vector<std::shared_ptr<ASMOperand>> GetOperands() const override;
-    void SetOperands(
-        const std::vector<std::shared_ptr<ASMOperand>>& new_operands) override;
+    AdrpInstruction(ASMOperand dst, const std::string& symbol);
+    std::string ToString() const;
+    void Encode(Assembler& out) const;
 
 private:
-    std::shared_ptr<ASMOperand> dst_;
     std::string symbol_;
 };
 
-class LoadGlobalInstruction : public ASMInstruction {
+class AdrInstruction : public InstructionOperands<1> {
+public:
+    static constexpr Opcode kOpcode = Opcode::Adr;
+
+    AdrInstruction(ASMOperand dst, const std::string& label);
+    std::string ToString() const;
+    void Encode(Assembler& out) const;
+
+private:
+    std::string label_;
+};
+
+class LoadGlobalInstruction : public InstructionOperands<2> {
 public:
-    LoadGlobalInstruction(std::shared_ptr<ASMOperand> dst,
-                          std::shared_ptr<ASMOperand> base, const std::string& symbol);
-    std::string ToString() const override;
+    static constexpr Opcode kOpcode = Opcode::LoadGlobal;
 
-    std::vector<std::shared_ptr<ASMOperand>> GetOperands() const override;
-    void SetOperands(
-        const std::vector<std::shared_ptr<ASMOperand>>& new_operands) override;
+    LoadGlobalInstruction(ASMOperand dst, ASMOperand base, const std::string& symbol);
+    std::string ToString() const;
+    void Encode(Assembler& out) const;
 
 private:
-    std::shared_ptr<ASMOperand> dst_;
-    std::shared_ptr<ASMOperand> base_;
     std::string symbol_;
 };
 
-class StoreGlobalInstruction : public ASMInstruction {
+class StoreGlobalInstruction : public InstructionOperands<2> {
 public:
-    StoreGlobalInstruction(std::shared_ptr<ASMOperand> src,
-                           std::shared_ptr<ASMOperand> base, const std::string& symbol);
-    std::string ToString() const override;
+    static constexpr Opcode kOpcode = Opcode::StoreGlobal;
 
-    std::vector<std::shared_ptr<ASMOperand>> GetOperands() const override;
-    void SetOperands(
-        const std::vector<std::shared_ptr<ASMOperand>>& new_operands) override;
+    StoreGlobalInstruction(ASMOperand src, ASMOperand base, const std::string& symbol);
+    std::string ToString() const;
+    void Encode(Assembler& out) const;
 
 private:
-    std::shared_ptr<ASMOperand> src_;
-    std::shared_ptr<ASMOperand> base_;
     std::string symbol_;
 };
 
-///////////////////////////////////////////////
\ No newline at end of file
+///////////////////////////////////////////////
+
+// Any one of the instructions above, by value, so a function body is a single
+// contiguous vector. The alternatives are in Opcode order.
+class ASMInstruction {
+public:
+    using Storage =
+        std::variant<LabelInstruction, GlobalDirective, MovInstruction, MovzInstruction,
+                     MovkInstruction, MovnInstruction, BinaryInstruction,
+                     UnaryInstruction, FusedMultiplyInstruction, ConvertInstruction,
+                     PopCountInstruction, CompareInstruction, CSetInstruction,
+                     BranchInstruction, RetInstruction, IndirectBranchInstruction,
+                     LoadInstruction, LoadIndexedInstruction, LoadPairInstruction,
+                     StoreInstruction, StorePairInstruction, AllocateStackInstruction,
+                     DeallocateStackInstruction, ExtendInstruction, TruncateInstruction,
+                     TextSectionDirective, ColdTextSectionDirective, DataSectionDirective,
+                     LiteralSectionDirective, LiteralDirective, JumpTableDirective,
+                     StaticVariableDirective, AdrpInstruction, AdrInstruction,
+                     LoadGlobalInstruction, StoreGlobalInstruction>;
+
+    template <typename T>
+        requires std::is_constructible_v<Storage, T&&>
+    ASMInstruction(T&& instr) : instr_(std::forward<T>(instr)) {}
+
+    std::string ToString() const;
+    // Same text as ToString, formatted straight into the output.
+    void Write(OutputBuffer& out) const;
+    // Appends the machine code, or for directives the data and symbols, to out.
+    void Encode(Assembler& out) const;
+
+    // The operands in place; empty for instructions without resolvable operands.
+    std::span<ASMOperand> GetOperands();
+    std::span<const ASMOperand> GetOperands() const;
+
+    Opcode GetOpcode() const;
+    Storage& GetStorage();
+    const Storage& GetStorage() const;
+
+private:
+    Storage instr_;
+};
+
+// The instruction as a T, or nullptr if it is another one.
+template <typename T>
+T* InstructionCast(ASMInstruction* instr) {
+    return instr ? std::get_if<T>(&instr->GetStorage()) : nullptr;
+}
+
+template <typename T>
+const T* InstructionCast(const ASMInstruction* instr) {
+    return instr ? std::get_if<T>(&instr->GetStorage()) : nullptr;
+}
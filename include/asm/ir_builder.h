@@ -1,9 +1,12 @@
 #pragma once
 
+#include <optional>
 #include <queue>
+#include <unordered_map>
 #include <vector>
 
 #include "allocator.h"
+#include "assembler.h"
 #include "include/optimizer/asm_optimizer.h"
 #include "include/semantic/symbol_table.h"
 #include "include/tac/instruction.h"
@@ -17,12 +20,17 @@ public:
         SymbolTable& symbol_table);
 
     void Build();
-    void Print(std::ostream& out) const;
+    void Print(OutputBuffer& out) const;
+    // Encodes the built instructions into out. Throws std::runtime_error for an
+    // instruction that has no machine encoding.
+    void Assemble(Assembler& out) const;
+
+    void EnableFPContraction(bool enable);
 
 private:
     std::vector<std::vector<TACInstruction>> tac_instructions_;
-    std::vector<std::vector<std::shared_ptr<ASMInstruction>>> asm_instructions_;
-    std::queue<std::shared_ptr<ASMOperand>> pending_args_;
+    std::vector<std::vector<ASMInstruction>> asm_instructions_;
+    std::queue<ASMOperand> pending_args_;
     FrameStackAllocator stack_allocator_;
     TempRegisterAllocator reg_allocator_;
     ASMOptimizer optimizer_;
@@ -30,29 +38,42 @@ private:
 
     std::string exit_label_ = "exit";
     std::string current_function_name_;
+    // Past the ColdLabel of the current function, whose epilogue is already emitted.
+    bool in_cold_part_ = false;
     int param_index_ = 0;
     int current_param_count_ = 0;
+    bool fp_contract_ = false;
+    std::vector<uint64_t> literal_pool_;
+    std::unordered_map<uint64_t, size_t> literal_indices_;
+    std::vector<ASMInstruction> jump_tables_;
+    size_t jump_table_count_ = 0;
 
     void LowerInstruction(const TACInstruction& instr);
     void ResolveOperands();
-    std::shared_ptr<MemoryOperand> MaterializeLargeStackOffset(
-        const std::shared_ptr<MemoryOperand>& memory,
-        std::vector<std::shared_ptr<ASMInstruction>>& before,
-        std::vector<std::shared_ptr<Register>>& temps);
+    MemoryOperand MaterializeLargeStackOffset(const MemoryOperand& memory,
+                                              std::vector<ASMInstruction>& before,
+                                              std::vector<Register>& temps);
     bool CanEncodeUnscaledImm9(int offset) const;
+    bool CanEncodeArithmeticImm12(unsigned long value) const;
+    bool CanEncodeFloatImm8(double value) const;
 
     void LowerAssign(const TACInstruction& instr);
     void LowerUnaryOp(const TACInstruction& instr);
     void LowerBinaryOp(const TACInstruction& instr);
     void LowerMod(const TACInstruction& instr);
     void LowerComparison(const TACInstruction& instr);
+    Condition EmitCompare(const TACInstruction& instr);
+    static Condition InvertCondition(Condition cond);
     void LowerBranch(const TACInstruction& instr);
+    void LowerJumpTable(const TACInstruction& instr);
     void LowerControl(const TACInstruction& instr);
     void LowerParam(const TACInstruction& instr);
     void LowerCall(const TACInstruction& instr);
     void LowerFunction(const TACInstruction& instr);
     void LowerExtend(const TACInstruction& instr, bool is_signed);
     void LowerTruncate(const TACInstruction& instr);
+    void LowerConvert(const TACInstruction& instr);
+    void LowerBitOp(const TACInstruction& instr);
     void LowerStaticVariable(const TACInstruction& instr);
 
     void AddFunctionPrologue();
@@ -62,15 +83,42 @@ private:
     void SaveCallerRegisters() const;
     void LoadCallerRegisters() const;
     void MaterializeFormalParameters();
+    std::optional<Register> NextArgumentRegister(ASMOperand::Size size,
+                                                 bool is_floating_point, int& gp_index,
+                                                 int& fp_index) const;
+
+    std::unordered_map<std::string, int> CountOperandUses(
+        const std::vector<TACInstruction>& instructions) const;
+    bool TryFoldExtendIntoOperand(const std::vector<TACInstruction>& instructions,
+                                  size_t index,
+                                  const std::unordered_map<std::string, int>& use_counts);
+    bool IsCompareAndBranch(const std::vector<TACInstruction>& instructions,
+                            size_t index) const;
+    std::unordered_map<std::string, int> CountCompareBranchUses(
+        const std::vector<TACInstruction>& instructions) const;
+    bool TryFuseCompareAndBranch(const std::vector<TACInstruction>& instructions,
+                                 size_t index,
+                                 const std::unordered_map<std::string, int>& use_counts,
+                                 const std::unordered_map<std::string, int>& branch_uses);
+    bool TryContractMultiplyAdd(const std::vector<TACInstruction>& instructions,
+                                size_t index,
+                                const std::unordered_map<std::string, int>& use_counts);
 
-    std::shared_ptr<ASMOperand> MakeOperand(const TACOperand& value);
-    void Emit(std::shared_ptr<ASMInstruction> instr);
+    ASMOperand MakeOperand(const TACOperand& value);
+    ASMOperand MakeZeroOperand(const ASMOperand& operand);
+    BinaryOp GetFloatingPointOp(TACInstruction::OpCode op) const;
+    void Emit(ASMInstruction instr);
 
     bool IsSignedOperand(const TACOperand& operand) const;
-    bool IsPureInputInstruction(const std::shared_ptr<ASMInstruction>& instr);
+    bool IsPureInputInstruction(const ASMInstruction& instr);
     std::string GetCurrentExitLabel() const;
-    std::shared_ptr<Register> GetReturnRegister() const;
+    Register GetReturnRegister() const;
 
-    std::vector<std::shared_ptr<ASMInstruction>> MakeLoadImmediateInstrs(
-        std::shared_ptr<ASMOperand> dst, const NumericConstant& value);
+    std::vector<ASMInstruction> MakeLoadImmediateInstrs(const ASMOperand& dst,
+                                                        const NumericConstant& value);
+    std::vector<ASMInstruction> MakeLoadLiteralInstrs(const Register& dst,
+                                                      const Register& addr,
+                                                      uint64_t bits);
+    std::string GetLiteralLabel(uint64_t bits);
+    void EmitLiteralPool();
 };
\ No newline at end of file
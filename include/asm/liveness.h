@@ -0,0 +1,12 @@
+#pragma once
+
+#include <vector>
+
+#include "allocator.h"
+#include "instructions.h"
+
+// Live ranges of pseudo registers over one function, in instruction order.
+// Each range is the convex hull of the points where the pseudo is live, so two
+// pseudos whose ranges do not overlap can share a stack slot.
+std::vector<StackSlotInterval> ComputeStackSlotIntervals(
+    const std::vector<ASMInstruction>& instructions);
@@ -1,46 +1,68 @@
 #pragma once
 
-#include <memory>
+#include <cstdint>
 #include <string>
+#include <string_view>
+#include <variant>
 
+#include "include/support/interned_string.h"
+#include "include/support/output_buffer.h"
 #include "include/types/numeric_constant.h"
 
-class ASMOperand {
-public:
-    enum class Size {
+// Operands are small values stored inline in the instructions that use them.
+struct OperandBase {
+    enum class Size : uint8_t {
         Byte1 = 1,
         Byte2 = 2,
         Byte4 = 4,
         Byte8 = 8,
     };
-
-    explicit ASMOperand(Size size);
-    virtual ~ASMOperand() = default;
-
-    virtual std::string ToString() const = 0;
-    virtual Size GetSize() const;
-
-protected:
-    Size size_;
+    enum class Kind : uint8_t { Register, Immediate, Pseudo, Memory, Data };
 };
 
 ///////////////////////////////////////////////
 
-class Register : public ASMOperand {
+class Register : public OperandBase {
 public:
-    explicit Register(std::string name);
-    std::string ToString() const override;
+    static constexpr Kind kKind = Kind::Register;
+
+    // Throws std::invalid_argument for a name that is not an AArch64 register.
+    static Register Get(std::string_view name);
+    // xN or wN by size, or dN for floating point.
+    static Register Get(int number, Size size, bool is_floating_point);
+
+    std::string ToString() const;
+    void Write(OutputBuffer& out) const;
+    Size GetSize() const;
+    bool IsFloatingPoint() const;
+    // -1 for sp, xzr and wzr.
+    int GetNumber() const;
+    // Both sp and the zero registers are encoded as 31.
+    uint32_t GetEncoding() const;
+    bool IsStackPointer() const;
+
+    bool operator==(const Register& other) const;
 
 private:
-    std::string name_;
+    enum class Bank : uint8_t { X, W, D, Sp, Xzr, Wzr };
+
+    Register(Bank bank, int number);
+
+    Bank bank_;
+    int8_t number_;
 };
 
 ///////////////////////////////////////////////
 
-class Immediate : public ASMOperand {
+class Immediate : public OperandBase {
 public:
+    static constexpr Kind kKind = Kind::Immediate;
+
     explicit Immediate(NumericConstant constant);
-    std::string ToString() const override;
+    std::string ToString() const;
+    void Write(OutputBuffer& out) const;
+    Size GetSize() const;
+    bool IsFloatingPoint() const;
     NumericConstant GetValue() const;
 
 private:
@@ -49,46 +71,97 @@ private:
 
 ///////////////////////////////////////////////
 
-class Pseudo : public ASMOperand {
+class Pseudo : public OperandBase {
 public:
-    Pseudo(const std::string& name, Size size);
-    std::string ToString() const override;
+    static constexpr Kind kKind = Kind::Pseudo;
+
+    Pseudo(InternedString name, Size size, bool is_floating_point = false);
+    std::string ToString() const;
+    void Write(OutputBuffer& out) const;
+    Size GetSize() const;
+    bool IsFloatingPoint() const;
 
-    const std::string& GetName() const;
+    InternedString GetName() const;
 
 private:
-    std::string name_;
+    InternedString name_;
+    Size size_;
+    bool is_floating_point_;
 };
 
 ///////////////////////////////////////////////
 
-class MemoryOperand : public ASMOperand {
+class MemoryOperand : public OperandBase {
 public:
-    enum class Mode { Offset, PreIndexed, PostIndexed };
+    static constexpr Kind kKind = Kind::Memory;
+    enum class Mode : uint8_t { Offset, PreIndexed, PostIndexed };
 
-    MemoryOperand(std::shared_ptr<Register> base, int offset, Size size,
-                  Mode mode = Mode::Offset);
+    MemoryOperand(Register base, int offset, Size size, Mode mode = Mode::Offset,
+                  bool is_floating_point = false);
 
-    std::string ToString() const override;
-    const std::shared_ptr<Register>& GetBase() const;
+    std::string ToString() const;
+    void Write(OutputBuffer& out) const;
+    Size GetSize() const;
+    bool IsFloatingPoint() const;
+    const Register& GetBase() const;
     int GetOffset() const;
     Mode GetMode() const;
 
 private:
-    std::shared_ptr<Register> base_;
-    int offset_;
+    Register base_;
+    Size size_;
     Mode mode_;
+    bool is_floating_point_;
+    int offset_;
 };
 
 ///////////////////////////////////////////////
 
-class DataOperand : public ASMOperand {
+class DataOperand : public OperandBase {
 public:
-    DataOperand(const std::string& name, Size size);
-    std::string ToString() const override;
+    static constexpr Kind kKind = Kind::Data;
+
+    DataOperand(InternedString name, Size size, bool is_floating_point = false);
+    std::string ToString() const;
+    void Write(OutputBuffer& out) const;
+    Size GetSize() const;
+    bool IsFloatingPoint() const;
 
-    const std::string& GetName() const;
+    InternedString GetName() const;
 
 private:
-    std::string name_;
-};
\ No newline at end of file
+    InternedString name_;
+    Size size_;
+    bool is_floating_point_;
+};
+
+///////////////////////////////////////////////
+
+// Any one of the operands above, by value. The alternatives are in Kind order.
+class ASMOperand : public OperandBase {
+public:
+    using Storage = std::variant<Register, Immediate, Pseudo, MemoryOperand, DataOperand>;
+
+    ASMOperand(Register operand);
+    ASMOperand(Immediate operand);
+    ASMOperand(Pseudo operand);
+    ASMOperand(MemoryOperand operand);
+    ASMOperand(DataOperand operand);
+
+    std::string ToString() const;
+    void Write(OutputBuffer& out) const;
+    Size GetSize() const;
+    bool IsFloatingPoint() const;
+    Kind GetKind() const;
+
+    const Storage& GetStorage() const;
+
+private:
+    Storage operand_;
+};
+
+// The operand as a T, or nullptr if it holds another kind.
+template <typename T>
+const T* OperandCast(const ASMOperand& operand) {
+    return std::get_if<T>(&operand.GetStorage());
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+// Bump allocator for the AST nodes of one translation unit. Nodes are created in it
+// explicitly with MakeNode. Deleting a node only runs its destructor and, under ASan,
+// poisons its memory so that later accesses are still reported; the memory is released
+// in bulk when the arena is destroyed, which must happen after all its nodes are gone.
+class AstArena {
+public:
+    AstArena() = default;
+    ~AstArena();
+    AstArena(const AstArena&) = delete;
+    AstArena& operator=(const AstArena&) = delete;
+
+    void* Allocate(size_t size);
+    // Called when the node at pointer, of the given size, is deleted.
+    static void Release(void* pointer, size_t size);
+
+private:
+    static constexpr size_t kBlockSize = 64 * 1024;
+
+    struct Block {
+        std::unique_ptr<std::byte[]> data;
+        size_t size;
+    };
+
+    std::vector<Block> blocks_;
+    std::byte* next_ = nullptr;
+    std::byte* end_ = nullptr;
+};
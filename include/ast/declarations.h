@@ -3,6 +3,7 @@
 
 #include "include/ast/statements.h"
 #include "include/ast/translation_unit.h"
+#include "include/support/interned_string.h"
 
 class Visitor;
 
@@ -13,7 +14,7 @@ public:
     explicit Declarator();
     virtual ~Declarator() = default;
     virtual void Accept(Visitor* visitor) = 0;
-    virtual std::string GetId() const = 0;
+    virtual const std::string& GetId() const = 0;
     virtual void SetId(const std::string& id) = 0;
     virtual void SetInitializer(std::unique_ptr<Expression> initializer) = 0;
     virtual Expression* GetInitializer() const = 0;
@@ -27,7 +28,7 @@ public:
     explicit IdentifierDeclarator(std::string id);
     virtual ~IdentifierDeclarator() = default;
     void Accept(Visitor* visitor) override;
-    std::string GetId() const override;
+    const std::string& GetId() const override;
     void SetId(const std::string& id) override;
     void SetInitializer(std::unique_ptr<Expression> initializer) override;
     Expression* GetInitializer() const override;
@@ -35,7 +36,7 @@ public:
     std::unique_ptr<Expression> ExtractInitializer();
 
 private:
-    std::string id_;
+    InternedString id_;
     std::optional<std::unique_ptr<Expression>> initializer_;
 };
 
@@ -53,7 +54,7 @@ public:
     Declarator* GetDeclarator() const;
     ParameterList* GetParameters() const;
     bool HasParameters() const;
-    std::string GetId() const override;
+    const std::string& GetId() const override;
     void SetId(const std::string& id) override;
     void SetInitializer(std::unique_ptr<Expression> initializer) override;
     Expression* GetInitializer() const override;
@@ -99,15 +100,57 @@ struct StorageClassSpecifierSet {
     }
 };
 
+// `inline` and the function attributes written as __attribute__((...)).
+struct FunctionSpecifierSet {
+    enum class Specifier { Inline, Hot, Cold, NoInline, AlwaysInline };
+
+    bool has_inline = false;
+    bool has_hot = false;
+    bool has_cold = false;
+    bool has_noinline = false;
+    bool has_always_inline = false;
+
+    void Add(Specifier spec) {
+        switch (spec) {
+            case Specifier::Inline:
+                has_inline = true;
+                break;
+            case Specifier::Hot:
+                has_hot = true;
+                break;
+            case Specifier::Cold:
+                has_cold = true;
+                break;
+            case Specifier::NoInline:
+                has_noinline = true;
+                break;
+            case Specifier::AlwaysInline:
+                has_always_inline = true;
+                break;
+        }
+    }
+
+    bool Empty() const {
+        return !has_inline && !has_hot && !has_cold && !has_noinline &&
+               !has_always_inline;
+    }
+
+    // Accepts both `cold` and `__cold__`.
+    static std::optional<Specifier> FromAttribute(const std::string& name);
+};
+
 struct DeclarationSpecifierSet {
     TypeSpecifierSet type_specifiers;
     StorageClassSpecifierSet storage_class_specifiers;
+    FunctionSpecifierSet function_specifiers;
 
     void Add(TypeSpecifierSet::Specifier spec) { type_specifiers.Add(spec); }
 
     void Add(StorageClassSpecifierSet::Specifier spec) {
         storage_class_specifiers.Add(spec);
     }
+
+    void Add(FunctionSpecifierSet::Specifier spec) { function_specifiers.Add(spec); }
 };
 
 ///////////////////////////////////////////////
@@ -141,21 +184,26 @@ enum class StorageClass { None, Static, Extern };
 
 class DeclarationSpecifiers : public BaseElement {
 public:
-    explicit DeclarationSpecifiers(const DeclarationSpecifierSet& specifiers);
+    DeclarationSpecifiers(AstArena& arena, const DeclarationSpecifierSet& specifiers);
     virtual ~DeclarationSpecifiers() = default;
     void Accept(Visitor* visitor) override;
 
     TypeSpecification* GetTypeSpecification() const;
     StorageClass GetStorageClass() const;
+    const FunctionSpecifierSet& GetFunctionSpecifiers() const;
     bool HasTypeSpecifier() const;
     bool IsStatic() const;
     bool IsExtern() const;
+    bool IsInline() const;
 
     static StorageClass ResolveStorageClass(const StorageClassSpecifierSet& specifiers);
+    static FunctionSpecifierSet ResolveFunctionSpecifiers(
+        const FunctionSpecifierSet& specifiers);
 
 private:
     std::unique_ptr<TypeSpecification> type_;
     StorageClass storage_class_ = StorageClass::None;
+    FunctionSpecifierSet function_specifiers_;
 };
 
 ///////////////////////////////////////////////
@@ -169,6 +217,7 @@ public:
     void Accept(Visitor* visitor) override;
     DeclarationSpecifiers* GetDeclarationSpecifiers() const;
     TypeSpecification* GetReturnType() const;
+    const FunctionSpecifierSet& GetFunctionSpecifiers() const;
     Declarator* GetDeclarator() const;
     CompoundStatement* GetBody() const;
     int GetNumParameters() const;
@@ -1,7 +1,9 @@
 #pragma once
 #include <memory>
+#include <optional>
 
 #include "include/ast/translation_unit.h"
+#include "include/support/interned_string.h"
 #include "include/types/numeric_constant.h"
 #include "include/types/type.h"
 
@@ -16,7 +18,7 @@ public:
     void SetTypeRef(TypeRef type);
 
 private:
-    TypeRef type_ref_;
+    TypeRef type_ref_ = nullptr;
 };
 
 ///////////////////////////////////////////////
@@ -59,11 +61,11 @@ public:
     explicit IdExpression(std::string id);
     virtual ~IdExpression() = default;
     void Accept(Visitor* visitor) override;
-    std::string GetId() const;
+    const std::string& GetId() const;
     void SetId(const std::string& id);
 
 private:
-    std::string id_;
+    InternedString id_;
 };
 
 ///////////////////////////////////////////////
@@ -1,4 +1,6 @@
 #pragma once
+#include <optional>
+
 #include "include/ast/expressions.h"
 #include "include/ast/translation_unit.h"
 
@@ -145,4 +147,75 @@ private:
     std::unique_ptr<Expression> inc_;
     std::unique_ptr<Statement> body_;
     std::string label_;
-};
\ No newline at end of file
+};
+
+///////////////////////////////////////////////
+
+class CaseStatement;
+class DefaultStatement;
+
+class SwitchStatement : public Statement {
+public:
+    explicit SwitchStatement(std::unique_ptr<Expression> expression,
+                             std::unique_ptr<Statement> body);
+    virtual ~SwitchStatement() = default;
+    void Accept(Visitor* visitor) override;
+    Expression* GetExpression() const;
+    Statement* GetBody() const;
+    void SetLabel(std::string label);
+    std::string GetLabel() const;
+
+    void AddCase(CaseStatement* statement);
+    const std::vector<CaseStatement*>& GetCases() const;
+    void SetDefault(DefaultStatement* statement);
+    bool HasDefault() const;
+    DefaultStatement* GetDefault() const;
+
+private:
+    std::unique_ptr<Expression> expression_;
+    std::unique_ptr<Statement> body_;
+    std::string label_;
+    std::vector<CaseStatement*> cases_;
+    DefaultStatement* default_ = nullptr;
+};
+
+///////////////////////////////////////////////
+
+class CaseStatement : public Statement {
+public:
+    explicit CaseStatement(std::unique_ptr<Expression> expression,
+                           std::unique_ptr<Statement> statement);
+    virtual ~CaseStatement() = default;
+    void Accept(Visitor* visitor) override;
+    Expression* GetExpression() const;
+    Statement* GetStatement() const;
+    void SetLabel(std::string label);
+    std::string GetLabel() const;
+
+    // The case constant converted to the type of the controlling expression.
+    void SetValue(NumericConstant value);
+    bool HasValue() const;
+    const NumericConstant& GetValue() const;
+
+private:
+    std::unique_ptr<Expression> expression_;
+    std::unique_ptr<Statement> statement_;
+    std::string label_;
+    std::optional<NumericConstant> value_;
+};
+
+///////////////////////////////////////////////
+
+class DefaultStatement : public Statement {
+public:
+    explicit DefaultStatement(std::unique_ptr<Statement> statement);
+    virtual ~DefaultStatement() = default;
+    void Accept(Visitor* visitor) override;
+    Statement* GetStatement() const;
+    void SetLabel(std::string label);
+    std::string GetLabel() const;
+
+private:
+    std::unique_ptr<Statement> statement_;
+    std::string label_;
+};
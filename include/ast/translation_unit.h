@@ -1,14 +1,34 @@
 #pragma once
+#include <memory>
+#include <utility>
 #include <vector>
 
+#include "include/ast/arena.h"
+
 class Visitor;
 
+// Nodes live in an AstArena and are created with MakeNode; deleting one never frees
+// memory.
 class BaseElement {
 public:
     virtual void Accept(Visitor* visitor) = 0;
     virtual ~BaseElement() = default;
+
+    static void* operator new(size_t size, AstArena& arena) {
+        return arena.Allocate(size);
+    }
+    // Used if a constructor throws.
+    static void operator delete(void* pointer, AstArena&) {}
+    static void operator delete(void* pointer, size_t size) {
+        AstArena::Release(pointer, size);
+    }
 };
 
+template <typename T, typename... Args>
+std::unique_ptr<T> MakeNode(AstArena& arena, Args&&... args) {
+    return std::unique_ptr<T>(new (arena) T(std::forward<Args>(args)...));
+}
+
 ///////////////////////////////////////////////
 
 class TranslationUnit : public BaseElement {
@@ -1,38 +1,66 @@
 #pragma once
 
 #include <fstream>
+#include <iostream>
 #include <memory>
+#include <sstream>
 #include <string>
 
 #include "include/ast/translation_unit.h"
 #include "include/semantic/symbol_table.h"
 #include "include/tac/instruction.h"
+#include "include/tac/operand_pool.h"
 #include "parser.hh"
 #include "scanner.h"
 
+class LinearIRBuilder;
+
 class Driver {
 public:
     Driver();
 
     int CompileFile(const std::string& filename);
+    // Compiles preprocessed source held in memory; filename names it in diagnostics.
+    int CompileSource(const std::string& filename, std::string source);
     void SetTranslationUnit(std::unique_ptr<TranslationUnit> unit);
     void SetFileName(const std::string& name);
+    // Where the parser creates the nodes of the tree.
+    AstArena& GetAstArena();
 
     bool debug_parse = false;
     bool debug_scan = false;
     bool print_ast = false;
     bool compile = true;
     bool debug_output = false;
+    // Also write the TAC before and after optimization next to the source.
+    bool keep_tac = false;
+    bool fp_contract_fast = false;
+    bool optimize = false;
+    int unroll_factor = 4;
+    bool inline_functions = true;
+    bool profile_generate = false;
+    std::string profile_use;
+    // Outputs of code generation; an empty path skips that output. The object file
+    // is encoded in-process, so no external assembler is needed for it.
+    std::string asm_file;
+    std::string object_file;
+    // Progress messages and diagnostics, buffered per file when compiling in parallel.
+    std::ostream* message_stream = &std::cout;
+    std::ostream* error_stream = &std::cerr;
 
     friend class Scanner;
 
 private:
+    int Compile();
     bool Scan();
     bool Parse();
     bool AnalyzeSemantics();
     bool GenerateTAC();
     bool OptimizeTAC();
     bool GenerateASM();
+    bool WriteASM(const LinearIRBuilder& builder) const;
+    bool WriteObject(const LinearIRBuilder& builder) const;
+    bool WriteTAC(const std::string& extension) const;
 
     void ScanBegin();
     void ScanEnd();
@@ -43,11 +71,17 @@ private:
     std::string file_;
     std::string original_filename_;
     std::ifstream stream_;
+    std::istringstream source_stream_;
+    bool from_source_ = false;
 
     yy::location location_;
     Scanner scanner_;
     yy::parser parser_;
+    // Declared before the tree so that it outlives the nodes allocated from it.
+    AstArena ast_arena_;
     std::unique_ptr<TranslationUnit> translation_unit_;
     SymbolTable symbol_table_;
+    // Constants and jump tables of the instructions below, cleared per compilation.
+    TACOperandPool tac_pool_;
     std::vector<std::vector<TACInstruction>> tac_instructions_;
 };
@@ -0,0 +1,164 @@
+#pragma once
+
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+class IncludeCache;
+
+// Expands macros, includes and conditionals of a C source file in-process. The result
+// is plain text with "# line "file"" markers wherever the output leaves the line
+// structure of its source, so the scanner can report positions in the original files.
+class Preprocessor {
+public:
+    // Names of the macros whose expansion produced a token; they are not expanded
+    // again within it. Null for tokens read straight from a file.
+    using HideSet = std::shared_ptr<const std::vector<std::string>>;
+
+    struct Token {
+        enum class Kind { Identifier, Number, String, Character, Punctuator, End };
+
+        Kind kind = Kind::End;
+        std::string text;
+        const std::string* file = nullptr;
+        int line = 0;
+        bool at_line_start = false;
+        bool has_space = false;
+        // Comes from a macro body or argument, so it may need a space to stay apart
+        // from its neighbours in the output.
+        bool expanded = false;
+        HideSet hideset;
+
+        bool Is(const char* spelling) const { return text == spelling; }
+    };
+
+    explicit Preprocessor(IncludeCache& cache);
+
+    // Searched in order for <...> includes, and after the including file's directory
+    // for "..." includes.
+    void AddIncludePath(const std::string& path);
+    // Defines a macro from "name" or "name=value", as given to -D. Returns false and
+    // sets the error if the definition is malformed.
+    bool Define(const std::string& definition);
+
+    // Preprocesses filename into output. Returns false and sets the error if the file
+    // cannot be read or contains an invalid directive. Macros persist between runs, so
+    // every translation unit needs a Preprocessor of its own.
+    bool Run(const std::string& filename, std::string& output);
+    const std::string& GetError() const;
+    // Messages of #warning directives from the last run.
+    const std::vector<std::string>& GetWarnings() const;
+
+private:
+    struct Macro {
+        std::vector<std::string> params;
+        std::vector<Token> body;
+        bool function_like = false;
+        bool variadic = false;
+    };
+    struct Frame {
+        const std::string* path;
+        const std::vector<Token>* tokens;
+        size_t next = 0;
+        std::string directory;
+        size_t conditional_depth;
+        // Set by #line: added to the line of every later token, and replaces its file.
+        int line_delta = 0;
+        const std::string* file_name = nullptr;
+    };
+    struct Conditional {
+        enum class Context { Then, Elif, Else };
+
+        Token directive;
+        Context context;
+        bool included;
+    };
+
+    Token NextToken();
+    const Token& PeekToken();
+    void PushBack(Token token);
+    void PushFront(std::vector<Token> tokens);
+    bool AtLineEnd() const;
+    std::vector<Token> ReadLine();
+    void SkipLine();
+
+    void HandleDirective(const Token& hash);
+    Token ReadMacroName(const Token& directive);
+    Token ReadDefineToken(const Token& name);
+    void HandleDefine(const Token& directive);
+    void HandleInclude(const Token& directive);
+    // Reads "name" or <name> from tokens, expanding macros first if they start with
+    // neither. Returns false if they do not form a header name.
+    bool ReadHeaderName(std::vector<Token> tokens, std::string& name, bool& quoted);
+    void HandleLine(const Token& hash);
+    void HandlePragma();
+    void PushFile(const std::string& path, const std::vector<Token>& tokens);
+    void IncludeFile(const std::string& path, const Token& directive);
+    std::string FindInclude(const std::string& name, bool quoted) const;
+    void SkipConditional();
+
+    bool ExpandMacro(const Token& name);
+    std::vector<Token> ExpandTokens(std::vector<Token> tokens);
+    std::vector<std::vector<Token>> ReadArguments(const Token& name, const Macro& macro,
+                                                  Token& rparen);
+    std::vector<Token> Substitute(const Macro& macro,
+                                  const std::vector<std::vector<Token>>& args);
+    Token Paste(const Token& lhs, const Token& rhs) const;
+    Token Stringize(const std::vector<Token>& tokens, const Token& where) const;
+
+    bool IsDefined(const std::string& name) const;
+    // Replaces __has_include(...) starting at tokens[index] with 0 or 1. Returns the
+    // index of its closing parenthesis.
+    size_t ReplaceHasInclude(const Token& directive, const std::vector<Token>& tokens,
+                             size_t index, std::vector<Token>& replaced);
+    bool EvaluateCondition(const Token& directive);
+
+    void Emit(const Token& token);
+    [[noreturn]] void Fail(const Token& where, const std::string& message) const;
+
+    IncludeCache& cache_;
+    std::vector<std::string> include_paths_;
+    std::unordered_map<std::string, Macro> macros_;
+    std::unordered_set<std::string> pragma_once_;
+    // File names introduced by #line, kept alive for the tokens that point to them.
+    std::deque<std::string> line_file_names_;
+
+    std::vector<Frame> frames_;
+    // Tokens read back or produced by macro expansion, next one last.
+    std::vector<Token> pending_;
+    // While positive, only pending_ is read and running out of it is the end of input.
+    int isolated_ = 0;
+    std::vector<Conditional> conditionals_;
+
+    std::string* output_ = nullptr;
+    const std::string* output_file_ = nullptr;
+    int output_line_ = 0;
+    bool output_at_line_start_ = true;
+    bool output_last_expanded_ = false;
+    std::string error_;
+    std::vector<std::string> warnings_;
+};
+
+// Source files tokenized once and shared by every translation unit of an invocation
+// that includes them. Safe to use from several threads at once.
+class IncludeCache {
+public:
+    struct File {
+        std::string path;
+        std::vector<Preprocessor::Token> tokens;
+    };
+
+    // Returns the tokens of path, or nullptr if the file cannot be read.
+    const File* Load(const std::string& path);
+    // Reads path without caching it, for the main file of a translation unit.
+    static std::unique_ptr<File> Read(const std::string& path);
+
+private:
+    std::mutex mutex_;
+    std::unordered_map<std::string, std::unique_ptr<File>> files_;
+};
@@ -0,0 +1,8 @@
+#pragma once
+
+// Profile data file written and read when no other name is given.
+extern const char* const kDefaultProfileFile;
+
+// C source of the runtime linked into programs built with -fprofile-generate. At exit
+// it appends the edge counts to $MLCC_PROFILE_FILE, or to kDefaultProfileFile.
+extern const char* const kProfileRuntimeSource;
@@ -5,7 +5,8 @@
 class ASMOptimizer {
 public:
     // to do:
-    void Optimize(std::vector<std::shared_ptr<ASMInstruction>>& instructions);
+    void Optimize(std::vector<ASMInstruction>& instructions);
 
 private:
-};
\ No newline at end of file
+    void FoldExtendIntoLoad(std::vector<ASMInstruction>& instructions);
+};
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <string>
+#include <unordered_set>
+
+#include "include/optimizer/control_flow_graph.h"
+
+namespace cfg {
+
+// Fills in Block::frequency and Block::edge_frequencies from static branch heuristics:
+// back edges and edges staying in a loop are likely, edges into blocks that return or
+// call a function are not, those calling one of `cold_functions` even less so. A branch
+// carrying a __builtin_expect hint takes the hinted direction instead. Frequencies are
+// relative to one entry into the function.
+void EstimateFrequencies(ControlFlowGraph& cfg,
+                         const std::unordered_set<std::string>& cold_functions = {});
+
+}  // namespace cfg
+
+namespace cfg::transforms {
+
+struct LayoutOptions {
+    // Start the headers of hot loops on a 16-byte boundary.
+    bool align_loops = true;
+    // Move rarely executed chains into the cold part of the function, emitted in a
+    // section of its own (see TACInstruction::ColdLabel).
+    bool split_cold = false;
+};
+
+// Reorders the blocks of a function so that the hottest edges fall through (Pettis and
+// Hansen). Blocks are merged into chains along edges in order of decreasing frequency,
+// each chain is placed after the one it is most strongly connected to, and chains that
+// are rarely executed move to the end, or out of the function when there are enough of
+// them. Uses the frequencies already on the blocks, estimated or from a profile.
+bool PlaceBlocks(ControlFlowGraph& cfg, const LayoutOptions& options = {});
+
+}  // namespace cfg::transforms
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <map>
 #include <optional>
 #include <set>
 #include <unordered_map>
@@ -17,6 +18,10 @@ struct Block {
     bool is_entry = false;
     bool is_exit = false;
     bool alive = false;
+    // Executions per call of the function, of the block and of each outgoing edge by
+    // successor id. Set by EstimateFrequencies.
+    double frequency = 0;
+    std::map<size_t, double> edge_frequencies;
 };
 
 class ControlFlowGraph {
@@ -32,7 +37,7 @@ public:
     const std::set<size_t>& GetSuccessors(size_t id) const;
     const std::set<size_t>& GetPredecessors(size_t id) const;
 
-    std::optional<size_t> FindBlockByLabel(const std::string& label) const;
+    std::optional<size_t> FindBlockByLabel(InternedString label) const;
     void MarkAliveBlocks();
     void RemoveBlocks(const std::unordered_set<size_t>& ids_to_remove);
 
@@ -45,7 +50,7 @@ private:
     std::vector<std::set<size_t>> successors_;
     std::vector<std::set<size_t>> predecessors_;
     std::vector<Block> blocks_;
-    std::unordered_map<std::string, size_t> label_to_block_;
+    std::unordered_map<InternedString, size_t> label_to_block_;
 
     static constexpr size_t entry_index = 0;
     static constexpr size_t exit_index = 1;
@@ -1,10 +1,21 @@
 #pragma once
 
+#include <string>
+
 #include "control_flow_graph.h"
 
 namespace cfg::transforms {
 
+// A label for a block a transform has to name: `label_<kind>_<function>_<count>`, which
+// no other function of the translation unit can define.
+std::string MakeLabel(const ControlFlowGraph& cfg, const std::string& kind,
+                      size_t& count);
+
 void RemoveUnreachableBlocks(ControlFlowGraph& cfg);
+// Retargets jumps past blocks that only jump again, or that re-test a condition whose
+// value is already known on the incoming edge. Up to a few instructions of the skipped
+// blocks are copied onto an edge that ends in an unconditional jump.
+void ThreadJumps(ControlFlowGraph& cfg);
 void RemoveRedundantGotos(ControlFlowGraph& cfg);
 void RemoveRedundantLabels(ControlFlowGraph& cfg);
 void RemoveEmptyBlocks(ControlFlowGraph& cfg);
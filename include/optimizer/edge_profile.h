@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "include/optimizer/control_flow_graph.h"
+#include "include/semantic/symbol_table.h"
+#include "include/tac/instruction.h"
+
+// Edge counts of one function, in counter order.
+struct FunctionProfile {
+    uint64_t checksum = 0;
+    std::vector<uint64_t> counters;
+};
+
+// The file written by a program built with -fprofile-generate. Every run appends a
+// record per function; records of the same function and checksum are summed.
+class ProfileData {
+public:
+    bool Load(const std::string& path);
+    const std::string& GetError() const;
+    const FunctionProfile* Find(const std::string& function) const;
+
+private:
+    std::unordered_map<uint64_t, FunctionProfile> functions_;
+    std::string error_;
+};
+
+namespace cfg {
+
+// Called by the profile runtime at exit; reports every counter of the translation
+// unit through __mlcc_profile_function and __mlcc_profile_counter.
+inline constexpr const char* kProfileDumpFunction = "__mlcc_profile_dump";
+
+struct InstrumentedFunction {
+    std::string name;
+    uint64_t checksum;
+    std::vector<std::string> counters;
+};
+
+uint64_t GetProfileId(const std::string& function);
+// Changes with the shape of the graph, so counts taken on another one are not applied.
+uint64_t ComputeChecksum(const ControlFlowGraph& cfg);
+
+// Counts only the edges off a maximum spanning tree of the graph weighted by
+// Block::edge_frequencies; the counts of the others follow from flow conservation.
+// Each counter is a new static unsigned long, returned in counter order.
+std::vector<std::string> InstrumentEdges(ControlFlowGraph& cfg, SymbolTable& symbol_table,
+                                         const std::string& function);
+
+// Replaces the frequencies of the blocks with the counts of a profile taken on the
+// same graph. Returns false if the profile does not match or the function never ran.
+bool ApplyProfile(ControlFlowGraph& cfg, const FunctionProfile& profile);
+
+std::vector<TACInstruction> MakeProfileDumpFunction(
+    const std::vector<InstrumentedFunction>& functions);
+
+}  // namespace cfg
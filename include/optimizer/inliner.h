@@ -0,0 +1,15 @@
+#pragma once
+
+#include <vector>
+
+#include "include/semantic/symbol_table.h"
+#include "include/tac/instruction.h"
+
+// Replaces calls to functions defined in the translation unit with copies of their
+// bodies. always_inline callees are always inlined, `inline` ones up to a moderate
+// size and the rest only when tiny; noinline and recursive functions never are, and
+// cold code only gets always_inline callees. Callees are processed before their
+// callers, so inlined bodies already contain their own inlined calls. Internal
+// functions left without references are removed. Returns true if anything changed.
+bool InlineCalls(std::vector<std::vector<TACInstruction>>& functions,
+                 SymbolTable& symbol_table);
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <vector>
+
+#include "include/optimizer/control_flow_graph.h"
+#include "include/semantic/symbol_table.h"
+
+namespace cfg {
+
+// A loop in the layout the TAC generator produces: a contiguous run of blocks from the
+// header to the latch, which jumps or branches back to the header. The header is
+// entered only from the preheader right before it and from the latch, the other blocks
+// only from inside the run, and the loop is left only for the exit block or by
+// returning. A loop that only returns uses the block after the latch as its exit.
+struct Loop {
+    size_t preheader;
+    size_t header;
+    size_t latch;
+    size_t exit;
+};
+
+std::vector<Loop> FindLoops(const ControlFlowGraph& cfg);
+
+}  // namespace cfg
+
+namespace cfg::transforms {
+
+// Moves branches on loop-invariant conditions out of innermost loops: the condition is
+// tested once in front of the loop, which is cloned into a copy for each outcome. A
+// loop is cloned only while it and the total growth of the function stay small.
+bool UnswitchLoops(ControlFlowGraph& cfg, SymbolTable& symbol_table);
+
+// Unrolls innermost counted loops: `iv op bound` tested in the header, iv moved by a
+// constant step in the latch and nowhere else, and a bound the loop does not change.
+// Loops with a small constant trip count are replaced by straight-line copies of the
+// body. The others get a main loop running `factor` copies per test, and the original
+// loop stays behind it as the epilogue for the remaining iterations.
+bool UnrollLoops(ControlFlowGraph& cfg, SymbolTable& symbol_table, int factor);
+
+// Turns loops tested at the top into bottom-tested ones. The header test is kept in
+// front of the loop as a guard and repeated in the latch in place of the jump back, so
+// an iteration takes one conditional branch instead of a branch and a jump.
+bool RotateLoops(ControlFlowGraph& cfg);
+
+}  // namespace cfg::transforms
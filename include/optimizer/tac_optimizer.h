@@ -1,27 +1,68 @@
 #pragma once
 
 #include "include/optimizer/control_flow_graph.h"
+#include "include/optimizer/edge_profile.h"
+#include "include/optimizer/value_range.h"
+#include "include/semantic/symbol_table.h"
 #include "include/tac/instruction.h"
 
 class TACOptimizer {
 public:
+    explicit TACOptimizer(SymbolTable& symbol_table);
+
     void Optimize(std::vector<std::vector<TACInstruction>>& instructions);
+    // Copies of the loop body per test in partially unrolled loops; 1 keeps only full
+    // unrolling of short constant loops, 0 disables unrolling.
+    void SetUnrollFactor(int factor);
+    void EnableInlining(bool enable);
+    // Adds edge counters to every function and the dump function the profile runtime
+    // calls, instead of laying out blocks.
+    void EnableInstrumentation(bool enable);
+    // Lays out blocks by the counts of an instrumented run instead of estimates.
+    void SetProfile(const ProfileData* profile);
 
 private:
+    void Simplify(std::vector<std::vector<TACInstruction>>& instructions);
+    bool UnswitchLoops(std::vector<std::vector<TACInstruction>>& instructions);
+    bool UnrollLoops(std::vector<std::vector<TACInstruction>>& instructions);
+    bool RotateLoops(std::vector<std::vector<TACInstruction>>& instructions);
+    void PlaceBlocks(std::vector<std::vector<TACInstruction>>& instructions);
+    void PlaceFunctions(std::vector<std::vector<TACInstruction>>& instructions);
+    FunctionAttributes::Hotness GetHotness(const std::vector<TACInstruction>& function);
     bool FoldConstants(std::vector<std::vector<TACInstruction>>& instructions);
     bool PropagateCopies(std::vector<std::vector<TACInstruction>>& instructions);
     bool EliminateDeadStores(std::vector<std::vector<TACInstruction>>& instructions);
     bool EliminateUnreachableCode(std::vector<std::vector<TACInstruction>>& instructions);
+    bool EliminateRedundantExtensions(
+        std::vector<std::vector<TACInstruction>>& instructions);
+    bool RemoveDeadDefinitions(std::vector<TACInstruction>& instructions);
 
     bool IsConstant(const TACOperand& operand);
-    long long EvaluateBinaryOp(TACInstruction::OpCode op, long long lhs, long long rhs);
-    long long EvaluateUnaryOp(TACInstruction::OpCode op, long long operand);
+    TypeRef GetType(const TACOperand& operand);
+    uint64_t EvaluateBinaryOp(TACInstruction::OpCode op, uint64_t lhs, uint64_t rhs,
+                              bool is_signed);
+    uint64_t EvaluateUnaryOp(TACInstruction::OpCode op, uint64_t operand,
+                             bool is_64_bit);
     bool TryFoldBinary(const TACInstruction& in, TACInstruction& out);
     bool TryFoldUnary(const TACInstruction& in, TACInstruction& out);
     bool TryFoldCondition(const TACInstruction& in, TACInstruction& out, bool& changed);
+    bool TryFoldConversion(const TACInstruction& in, TACInstruction& out);
+
+    bool TrySimplifyExtension(const TACInstruction& in, const ValueRangeAnalysis& ranges,
+                              TACInstruction& out);
+    bool TryNarrowComparison(const TACInstruction& in, const ValueRangeAnalysis& ranges,
+                             TACInstruction& out);
+    std::optional<TACOperand> GetNarrowOperand(const TACOperand& operand,
+                                               TACInstruction::OpCode extend,
+                                               const ValueRangeAnalysis& ranges);
 
     static void BuildControlFlowGraph(std::vector<TACInstruction>& instructions,
                                       cfg::ControlFlowGraph& cfg);
 
+    SymbolTable& symbol_table_;
     std::vector<cfg::ControlFlowGraph> cf_graphs_;
+    int unroll_factor_ = 4;
+    bool inline_ = true;
+    bool instrument_ = false;
+    const ProfileData* profile_ = nullptr;
 };
\ No newline at end of file
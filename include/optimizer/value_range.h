@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "include/semantic/symbol_table.h"
+#include "include/tac/instruction.h"
+
+// Closed interval of the values an integer operand can hold. Unsigned 64-bit values
+// above INT64_MAX do not fit, so operands that may hold them have no range at all.
+struct ValueRange {
+    int64_t min;
+    int64_t max;
+
+    bool IsNonNegative() const { return min >= 0; }
+    bool FitsIn(const ValueRange& other) const {
+        return min >= other.min && max <= other.max;
+    }
+};
+
+// Range and definition facts for one function's TAC. An identifier with exactly one
+// definition (or none, like the incoming arguments) and automatic storage always holds
+// the value computed by that definition, so its range can be derived from the
+// defining instruction. Anything else falls back to the range of its type.
+class ValueRangeAnalysis {
+public:
+    ValueRangeAnalysis(const std::vector<TACInstruction>& instructions,
+                       SymbolTable& symbol_table);
+
+    std::optional<ValueRange> GetRange(const TACOperand& operand) const;
+    TypeRef GetType(const TACOperand& operand) const;
+
+    // nullptr unless the identifier is defined exactly once.
+    const TACInstruction* GetDefinition(const TACOperand& operand) const;
+    // Constants and identifiers that are never redefined after their single definition.
+    bool IsStable(const TACOperand& operand) const;
+    int GetUseCount(const TACOperand& operand) const;
+
+    static std::optional<ValueRange> GetTypeRange(const TypeRef& type);
+
+private:
+    SymbolTable& symbol_table_;
+    std::unordered_map<std::string, const TACInstruction*> definitions_;
+    std::unordered_map<std::string, int> def_counts_;
+    std::unordered_map<std::string, int> use_counts_;
+    std::unordered_map<std::string, ValueRange> ranges_;
+
+    std::optional<ValueRange> ComputeRange(const TACInstruction& instr) const;
+};
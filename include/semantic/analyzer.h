@@ -9,7 +9,8 @@
 
 class SemanticAnalyzer {
 public:
-    explicit SemanticAnalyzer(SymbolTable& symbol_table);
+    // Nodes the analysis adds to the tree, such as implicit casts, are created in arena.
+    SemanticAnalyzer(SymbolTable& symbol_table, AstArena& arena);
     ~SemanticAnalyzer();
     void Analyze(TranslationUnit* translation_unit);
 
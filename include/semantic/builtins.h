@@ -0,0 +1,26 @@
+#pragma once
+
+#include <optional>
+#include <string>
+
+// Functions the compiler provides itself. They need no declaration; TypeChecker checks
+// calls to them and TACVisitor lowers those calls in place.
+enum class Builtin {
+    // long __builtin_expect(long value, long expected): value, which the program
+    // expects to be equal to the constant `expected`.
+    Expect,
+    // int __builtin_clz(unsigned x): the number of leading zero bits of x, undefined
+    // for 0; ctz counts the trailing zero bits instead and popcount the set bits. The
+    // `l` and `ll` variants take an unsigned long.
+    CountLeadingZeros,
+    CountLeadingZerosLong,
+    CountTrailingZeros,
+    CountTrailingZerosLong,
+    PopCount,
+    PopCountLong,
+    // unsigned __builtin_bswap32(unsigned x): x with its bytes in reverse order.
+    ByteSwap32,
+    ByteSwap64,
+};
+
+std::optional<Builtin> FindBuiltin(const std::string& name);
@@ -30,6 +30,9 @@ public:
     void Visit(JumpStatement* statement) override;
     void Visit(WhileStatement* statement) override;
     void Visit(ForStatement* statement) override;
+    void Visit(SwitchStatement* statement) override;
+    void Visit(CaseStatement* statement) override;
+    void Visit(DefaultStatement* statement) override;
     void Visit(ParameterDeclaration* declaration) override;
     void Visit(ParameterList* list) override;
     void Visit(FunctionCallExpression* expression) override;
@@ -41,9 +44,13 @@ public:
 
 private:
     std::vector<std::string> errors_;
-    std::stack<std::string> loop_ids_;
+    std::stack<std::string> break_ids_;
+    std::stack<std::string> continue_ids_;
+    std::stack<SwitchStatement*> switches_;
     size_t loop_id_counter_ = 0;
+    size_t switch_id_counter_ = 0;
     SymbolTable& symbol_table_;
 
     std::string GenerateLoopId();
+    std::string GenerateSwitchId();
 };
\ No newline at end of file
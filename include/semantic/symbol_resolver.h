@@ -30,6 +30,9 @@ public:
     void Visit(JumpStatement* statement) override;
     void Visit(WhileStatement* statement) override;
     void Visit(ForStatement* statement) override;
+    void Visit(SwitchStatement* statement) override;
+    void Visit(CaseStatement* statement) override;
+    void Visit(DefaultStatement* statement) override;
     void Visit(ParameterDeclaration* declaration) override;
     void Visit(ParameterList* list) override;
     void Visit(FunctionCallExpression* expression) override;
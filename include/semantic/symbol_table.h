@@ -1,12 +1,25 @@
 #pragma once
+#include <cstdint>
+#include <deque>
 #include <optional>
 #include <string>
 #include <unordered_map>
 #include <vector>
 
+#include "include/support/interned_string.h"
 #include "include/types/numeric_constant.h"
 #include "include/types/type.h"
 
+// From `inline` and __attribute__((...)) on any of the declarations of a function.
+struct FunctionAttributes {
+    // In increasing strength: `inline`, then always_inline or noinline.
+    enum class Inlining { Default, Hint, Always, Never };
+    enum class Hotness { Default, Hot, Cold };
+
+    Inlining inlining = Inlining::Default;
+    Hotness hotness = Hotness::Default;
+};
+
 struct SymbolInfo {
     enum class LinkageKind { External, Internal, None };
     enum class StorageDuration { Static, Automatic };
@@ -22,6 +35,7 @@ struct SymbolInfo {
 
     TypeRef type = nullptr;
     bool is_defined = false;
+    FunctionAttributes attributes;
 
     bool HasLinkage() const { return linkage != LinkageKind::None; }
     bool HasStaticDuration() const { return duration == StorageDuration::Static; }
@@ -32,6 +46,9 @@ private:
 
 ////////////////////////////////////////////////////////////
 
+// Every symbol is stored once, in declaration order, and found by its unique name with
+// an integer hash. Scopes only bind original names to symbols: entering a scope marks
+// the undo stack and leaving it restores the bindings that the scope shadowed.
 class SymbolTable {
 public:
     void EnterScope();
@@ -42,22 +59,38 @@ public:
 
     void Register(const SymbolInfo& info);
 
-    std::optional<SymbolInfo> Lookup(const std::string& original_name) const;
+    const SymbolInfo* Lookup(InternedString original_name) const;
 
-    bool IsInCurrentScope(const std::string& name) const;
+    bool IsInCurrentScope(InternedString name) const;
 
     std::string GenerateUniqueName(const std::string& base);
 
-    SymbolInfo* FindByOriginalName(const std::string& original_name);
+    SymbolInfo* FindByOriginalName(InternedString original_name);
 
-    SymbolInfo* FindByUniqueName(const std::string& unique_name);
+    SymbolInfo* FindByUniqueName(InternedString unique_name);
 
     bool IsInFileScope() const;
 
-    const std::unordered_map<std::string, SymbolInfo>& GetAllSymbols() const;
+    // Entries keep their address while the table lives.
+    const std::deque<SymbolInfo>& GetAllSymbols() const;
 
 private:
-    std::vector<std::unordered_map<std::string, SymbolInfo>> scopes_;
-    std::unordered_map<std::string, int> name_counters_;
-    std::unordered_map<std::string, SymbolInfo> all_symbols_;
+    struct Binding {
+        uint32_t symbol;
+        uint32_t depth;
+    };
+
+    struct ShadowedBinding {
+        InternedString name;
+        std::optional<Binding> previous;
+    };
+
+    uint32_t Store(const SymbolInfo& info);
+
+    std::deque<SymbolInfo> symbols_;
+    std::unordered_map<InternedString, uint32_t> by_unique_name_;
+    std::unordered_map<InternedString, Binding> bindings_;
+    std::vector<ShadowedBinding> undo_stack_;
+    std::vector<size_t> scope_marks_;
+    std::unordered_map<InternedString, int> name_counters_;
 };
\ No newline at end of file
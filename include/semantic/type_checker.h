@@ -3,12 +3,14 @@
 #include <memory>
 #include <vector>
 
+#include "include/ast/declarations.h"
+#include "include/semantic/builtins.h"
 #include "include/semantic/symbol_table.h"
 #include "include/visitors/visitor.h"
 
 class TypeChecker : public Visitor {
 public:
-    explicit TypeChecker(SymbolTable& symbol_table);
+    TypeChecker(SymbolTable& symbol_table, AstArena& arena);
     ~TypeChecker();
     void Visit(TranslationUnit* translation_unit) override;
     void Visit(ItemList* item_list) override;
@@ -31,6 +33,9 @@ public:
     void Visit(JumpStatement* statement) override;
     void Visit(WhileStatement* statement) override;
     void Visit(ForStatement* statement) override;
+    void Visit(SwitchStatement* statement) override;
+    void Visit(CaseStatement* statement) override;
+    void Visit(DefaultStatement* statement) override;
     void Visit(ParameterDeclaration* declaration) override;
     void Visit(ParameterList* list) override;
     void Visit(FunctionCallExpression* expression) override;
@@ -53,7 +58,12 @@ private:
         std::unique_ptr<Expression> expression, TypeRef target_type);
     bool ProcessFunctionDeclaration(FunctionDeclarator* func_declarator,
                                     TypeSpecification* return_type_spec,
-                                    StorageClass storage_class, bool is_definition);
+                                    StorageClass storage_class,
+                                    const FunctionSpecifierSet& specifiers,
+                                    bool is_definition);
+    bool MergeFunctionAttributes(SymbolInfo& info,
+                                 const FunctionSpecifierSet& specifiers);
+    void CheckBuiltinCall(FunctionCallExpression* expression, Builtin builtin);
     bool ProcessFileScopeVariable(IdentifierDeclarator* id_declarator,
                                   TypeRef declared_type, StorageClass storage_class);
     bool ProcessBlockScopeVariable(IdentifierDeclarator* id_declarator,
@@ -61,6 +71,8 @@ private:
 
     std::vector<std::string> errors_;
     SymbolTable& symbol_table_;
-    TypeRef current_return_type_;
+    AstArena& arena_;
+    TypeRef current_return_type_ = nullptr;
+    std::vector<TypeRef> switch_types_;
     bool in_file_scope_ = true;
 };
\ No newline at end of file
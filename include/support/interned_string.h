@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+
+// An identifier, unique name or label stored once per thread and referred to by a
+// 32-bit id, so copies, comparisons and hashing never touch the characters. Spellings
+// stay alive for the lifetime of the thread; interned strings must not be passed
+// between threads.
+class InternedString {
+public:
+    InternedString() = default;
+    InternedString(std::string_view spelling);
+    InternedString(const std::string& spelling);
+    InternedString(const char* spelling);
+
+    static InternedString FromId(uint32_t id);
+
+    uint32_t GetId() const;
+    bool Empty() const;
+    const std::string& Str() const;
+
+    bool operator==(const InternedString& other) const = default;
+
+private:
+    // Id 0 is the empty string.
+    uint32_t id_ = 0;
+};
+
+template <>
+struct std::hash<InternedString> {
+    size_t operator()(const InternedString& string) const {
+        return std::hash<uint32_t>{}(string.GetId());
+    }
+};
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+
+// Text output collected in a large buffer and handed to the file with a single write
+// whenever the buffer fills up. Integers are formatted in place, two digits at a time.
+class OutputBuffer {
+public:
+    static constexpr size_t kCapacity = 1 << 20;
+
+    OutputBuffer();
+    ~OutputBuffer();
+    OutputBuffer(const OutputBuffer&) = delete;
+    OutputBuffer& operator=(const OutputBuffer&) = delete;
+
+    // Truncates or creates the file. Returns false if it cannot be opened.
+    bool Open(const std::string& filename);
+    // Writes out whatever is buffered. Returns false if any write failed.
+    bool Close();
+
+    void Write(std::string_view text);
+    void Write(char c);
+    void WriteInt(int64_t value);
+    void WriteUInt(uint64_t value);
+
+    OutputBuffer& operator<<(std::string_view text) {
+        Write(text);
+        return *this;
+    }
+    OutputBuffer& operator<<(char c) {
+        Write(c);
+        return *this;
+    }
+
+private:
+    void Flush();
+    // Makes room for at least count more bytes.
+    void Reserve(size_t count) {
+        if (size_ + count > kCapacity) {
+            Flush();
+        }
+    }
+
+    std::unique_ptr<char[]> data_;
+    size_t size_;
+    int fd_;
+    bool failed_;
+};
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <string>
+
+// An empty file in the temporary directory under a name no other process is using,
+// removed again when the object is destroyed.
+class TempFile {
+public:
+    // Creates <tmp>/<prefix>XXXXXX<suffix>. Throws std::runtime_error on failure.
+    TempFile(const std::string& prefix, const std::string& suffix);
+    ~TempFile();
+    TempFile(const TempFile&) = delete;
+    TempFile& operator=(const TempFile&) = delete;
+
+    const std::string& Path() const { return path_; }
+
+private:
+    std::string path_;
+};
@@ -1,14 +1,18 @@
 #pragma once
 
+#include <cstdint>
+#include <functional>
+#include <optional>
 #include <string>
-#include <variant>
+#include <vector>
 
+#include "include/support/interned_string.h"
 #include "include/types/numeric_constant.h"
 
+// A 32-bit handle: the id of an InternedString for identifiers, or of a constant in the
+// current TACOperandPool with the top bit set. Operands compare and hash as integers.
 class TACOperand {
 public:
-    using Storage = std::variant<std::string, NumericConstant>;
-
     TACOperand(const std::string& identifier);
     explicit TACOperand(const NumericConstant& constant);
 
@@ -17,18 +21,30 @@ public:
     bool Empty() const;
 
     const std::string& AsIdentifier() const;
+    InternedString AsName() const;
     const NumericConstant& AsConstant() const;
     std::string ToString() const;
 
+    uint32_t GetHandle() const;
+
     bool operator==(const TACOperand& other) const;
 
 private:
-    Storage storage_;
+    static constexpr uint32_t kConstantBit = 1u << 31;
+
+    uint32_t handle_;
+};
+
+template <>
+struct std::hash<TACOperand> {
+    size_t operator()(const TACOperand& operand) const {
+        return std::hash<uint32_t>{}(operand.GetHandle());
+    }
 };
 
 class TACInstruction {
 public:
-    enum class OpCode {
+    enum class OpCode : uint8_t {
         Label,
         Function,
         StaticVariable,
@@ -52,6 +68,7 @@ public:
         If,
         IfFalse,
         GoTo,
+        JumpTable,
         BitwiseAnd,
         BitwiseXor,
         BitwiseOr,
@@ -66,12 +83,28 @@ public:
         DoubleToUInt,
         IntToDouble,
         UIntToDouble,
+        // Bit operations of the __builtin_clz family, on 32- or 64-bit operands; the
+        // result has the width of the operand.
+        CountLeadingZeros,
+        CountTrailingZeros,
+        PopCount,
+        ByteSwap,
     };
 
-    static TACInstruction Label(const std::string& label);
+    // A label with alignment > 0 starts at a multiple of 2^alignment bytes.
+    static TACInstruction Label(const std::string& label, int alignment = 0);
+    // Starts the cold part of a function: it and everything after it is emitted apart
+    // from the rest of the function, which never falls through into it.
+    static TACInstruction ColdLabel(const std::string& label);
     static TACInstruction GoTo(const std::string& target);
-    static TACInstruction If(const std::string& target, const TACOperand& condition);
-    static TACInstruction IfFalse(const std::string& target, const TACOperand& condition);
+    // `expected` is the value the condition usually has, from __builtin_expect.
+    static TACInstruction If(const std::string& target, const TACOperand& condition,
+                             std::optional<bool> expected = std::nullopt);
+    static TACInstruction IfFalse(const std::string& target, const TACOperand& condition,
+                                  std::optional<bool> expected = std::nullopt);
+    // goto targets[index]; index is an unsigned long already known to be in range.
+    static TACInstruction JumpTable(const TACOperand& index,
+                                    std::vector<std::string> targets);
 
     static TACInstruction Function(const std::string& name, int param_count,
                                    bool is_global);
@@ -105,16 +138,30 @@ public:
     const TACOperand& GetLhs() const;
     const TACOperand& GetRhs() const;
     const std::string& GetLabel() const;
+    InternedString GetLabelName() const;
+    const std::vector<std::string>& GetTargets() const;
+    std::optional<bool> GetExpectedCondition() const;
+    bool StartsColdPart() const;
+
+    void SetDst(const TACOperand& dst);
+    void SetLhs(const TACOperand& lhs);
+    void SetRhs(const TACOperand& rhs);
+    void SetLabel(const std::string& label);
+    void SetTargets(std::vector<std::string> targets);
 
     bool operator==(const TACInstruction& other) const;
 
 private:
     TACInstruction(OpCode op, TACOperand dst, TACOperand lhs, TACOperand rhs,
-                   std::string label);
+                   const std::string& label);
 
     OpCode op_;
     TACOperand dst_;
     TACOperand lhs_;
     TACOperand rhs_;
-    std::string label_;
+    InternedString label_;
+    // Id in the TACOperandPool; equal lists share an id.
+    uint32_t targets_ = 0;
 };
+
+static_assert(sizeof(TACInstruction) <= 24);
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "include/types/numeric_constant.h"
+
+// Interns the constants and jump table target lists TAC instructions refer to, so
+// instructions hold 32-bit ids instead of owning them; identifiers and labels are
+// InternedStrings. Each Driver owns a pool for the translation unit it compiles and
+// makes it current on its thread with a Scope while compiling. Entries stay at a fixed
+// address until the pool is cleared or destroyed.
+class TACOperandPool {
+public:
+    TACOperandPool();
+    TACOperandPool(const TACOperandPool&) = delete;
+    TACOperandPool& operator=(const TACOperandPool&) = delete;
+
+    // Makes a pool the current one on this thread until the scope ends. Scopes nest.
+    class Scope {
+    public:
+        explicit Scope(TACOperandPool& pool);
+        ~Scope();
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+    private:
+        TACOperandPool* pool_;
+        TACOperandPool* previous_;
+    };
+
+    // The current pool of this thread. Throws std::logic_error if there is none.
+    static TACOperandPool& Get();
+
+    // Drops every entry, invalidating all ids handed out so far.
+    void Clear();
+
+    // Equal values get equal ids. Id 0 is always the empty target list.
+    uint32_t InternConstant(const NumericConstant& constant);
+    uint32_t InternTargets(std::vector<std::string> targets);
+
+    const NumericConstant& GetConstant(uint32_t id) const;
+    const std::vector<std::string>& GetTargets(uint32_t id) const;
+
+private:
+    struct ConstantKeyHash {
+        size_t operator()(const std::pair<size_t, uint64_t>& key) const;
+    };
+    struct TargetsHash {
+        size_t operator()(const std::vector<std::string>& targets) const;
+    };
+
+    std::deque<NumericConstant> constants_;
+    // Keyed by the alternative held and its bit pattern, so 0.0 and -0.0 stay apart.
+    std::unordered_map<std::pair<size_t, uint64_t>, uint32_t, ConstantKeyHash>
+        constant_ids_;
+    // Each list is stored once, as a key of target_ids_; targets_ points at it by id.
+    std::unordered_map<std::vector<std::string>, uint32_t, TargetsHash> target_ids_;
+    std::vector<const std::vector<std::string>*> targets_;
+};
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "include/types/numeric_constant.h"
+#include "include/types/type.h"
+
+// Case values are clustered by key: the value mapped to an unsigned integer whose order
+// matches the comparison order of the controlling type. Signed values are biased by
+// 2^63, so the whole analysis works with plain unsigned arithmetic.
+uint64_t ToSwitchKey(const NumericConstant& value, const TypeRef& type);
+NumericConstant FromSwitchKey(uint64_t key, const TypeRef& type);
+// Keys of the smallest and the largest value of the type.
+std::pair<uint64_t, uint64_t> GetSwitchKeyRange(const TypeRef& type);
+
+struct SwitchCase {
+    uint64_t key;
+    std::string target;
+};
+
+// A run of cases with keys in [low, high] that is dispatched as one unit. Values inside
+// the run that no case matches go to the default target.
+struct CaseCluster {
+    enum class Kind {
+        Range,      // every key in [low, high] goes to targets[0]
+        JumpTable,  // targets[key - low], holes filled with the default
+        BitTest,    // targets[i] when bit (key - low) of masks[i] is set
+    };
+
+    Kind kind;
+    uint64_t low;
+    uint64_t high;
+    std::vector<std::string> targets;
+    std::vector<uint64_t> masks;
+};
+
+// Partitions the cases into clusters ordered by key. Dense runs become jump tables, runs
+// of up to three targets within 64 consecutive keys become bit tests, and everything
+// else becomes ranges of consecutive keys with the same target.
+std::vector<CaseCluster> ClusterSwitchCases(std::vector<SwitchCase> cases,
+                                            const std::string& default_target);
@@ -4,8 +4,10 @@
 #include <vector>
 
 #include "include/ast/expressions.h"
+#include "include/semantic/builtins.h"
 #include "include/semantic/symbol_table.h"
 #include "include/tac/instruction.h"
+#include "include/tac/switch_lowering.h"
 #include "include/visitors/visitor.h"
 
 class TACVisitor : public Visitor {
@@ -33,6 +35,9 @@ public:
     void Visit(JumpStatement* statement) override;
     void Visit(WhileStatement* statement) override;
     void Visit(ForStatement* statement) override;
+    void Visit(SwitchStatement* statement) override;
+    void Visit(CaseStatement* statement) override;
+    void Visit(DefaultStatement* statement) override;
     void Visit(ParameterDeclaration* declaration) override;
     void Visit(ParameterList* list) override;
     void Visit(FunctionCallExpression* expression) override;
@@ -58,8 +63,29 @@ private:
     size_t temp_count_ = 0;
     size_t label_id_ = 0;
 
+    // `expected` is the value the condition usually has, from __builtin_expect.
+    void EmitBranchOnBool(Expression* condition, const std::string& target, bool jump_if,
+                          std::optional<bool> expected = std::nullopt);
+    void LowerBuiltinCall(FunctionCallExpression* expression, Builtin builtin);
+    void LowerBitBuiltin(FunctionCallExpression* expression, TACInstruction::OpCode op);
     void ProcessBinaryOr(BinaryExpression* expression);
     void ProcessBinaryAnd(BinaryExpression* expression);
+
+    struct SwitchDispatch {
+        TACOperand value;
+        TypeRef type = nullptr;
+        TypeRef index_type = nullptr;  // unsigned type of the same width
+        std::string default_target;
+    };
+
+    void LowerCaseClusters(const SwitchDispatch& dispatch,
+                           const std::vector<CaseCluster>& clusters, size_t first,
+                           size_t last, uint64_t low, uint64_t high);
+    void LowerCaseCluster(const SwitchDispatch& dispatch, const CaseCluster& cluster,
+                          uint64_t low, uint64_t high, const std::string& miss_target);
+    TACOperand EmitSwitchOffset(const SwitchDispatch& dispatch, uint64_t key);
+    TACOperand EmitSwitchCompare(TACInstruction::OpCode op, const TACOperand& lhs,
+                                 const NumericConstant& rhs);
 };
 
 void PrintTACInstructions(std::ostream& out,
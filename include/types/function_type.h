@@ -5,7 +5,8 @@
 
 class FunctionType : public Type {
 public:
-    explicit FunctionType(TypeRef return_type, std::vector<TypeRef> param_types = {});
+    // The unique function type with this signature.
+    static TypeRef Get(TypeRef return_type, std::vector<TypeRef> param_types = {});
 
     TypeRef GetReturnType() const { return return_type_; }
     const std::vector<TypeRef>& GetParamTypes() const { return param_types_; }
@@ -21,9 +22,9 @@ public:
     std::string ToString() const override;
     bool IsFloatingPoint() const override;
 
-    bool Equals(const TypeRef& other) const override;
-
 private:
+    FunctionType(TypeRef return_type, std::vector<TypeRef> param_types);
+
     TypeRef return_type_;
     std::vector<TypeRef> param_types_;
 };
@@ -5,8 +5,6 @@ class PrimitiveType : public Type {
 public:
     enum class Tag { Int32, Int64, UInt32, UInt64, Double };
 
-    explicit PrimitiveType(Tag tag);
-
     Tag GetTag() const;
 
     static TypeRef GetInt32();
@@ -25,9 +23,9 @@ public:
     bool IsFloatingPoint() const override;
     std::string ToString() const override;
 
-    bool Equals(const TypeRef& other) const override;
-
 private:
-    static TypeRef& GetInstance(Tag tag);
+    explicit PrimitiveType(Tag tag);
+
+    static TypeRef GetInstance(Tag tag);
     Tag tag_;
 };
@@ -1,8 +1,10 @@
 #pragma once
-#include <memory>
+#include <string>
 
 class Type;
-using TypeRef = std::shared_ptr<Type>;
+// Types are interned and never freed, so they are passed as plain pointers and two
+// types are the same exactly when their pointers are equal.
+using TypeRef = const Type*;
 
 class Type {
 public:
@@ -28,7 +30,7 @@ public:
 
     virtual std::string ToString() const = 0;
 
-    virtual bool Equals(const TypeRef& other) const { return this == other.get(); }
+    bool Equals(TypeRef other) const { return this == other; }
 
 private:
     Kind kind_;
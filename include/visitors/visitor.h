@@ -27,6 +27,9 @@ public:
     virtual void Visit(JumpStatement* statement) = 0;
     virtual void Visit(WhileStatement* statement) = 0;
     virtual void Visit(ForStatement* statement) = 0;
+    virtual void Visit(SwitchStatement* statement) = 0;
+    virtual void Visit(CaseStatement* statement) = 0;
+    virtual void Visit(DefaultStatement* statement) = 0;
     virtual void Visit(ParameterDeclaration* declaration) = 0;
     virtual void Visit(ParameterList* list) = 0;
     virtual void Visit(FunctionCallExpression* expression) = 0;
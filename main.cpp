@@ -1,8 +1,30 @@
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <condition_variable>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
 #include <iostream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
 #include <string>
 #include <vector>
 
 #include "include/driver/driver.h"
+#include "include/driver/preprocessor.h"
+#include "include/driver/profile_runtime.h"
+#include "include/support/temp_file.h"
+#include "include/support/thread_pool.h"
+
+// The integrated assembler writes ELF objects, which the Mach-O linker cannot consume.
+#ifdef __APPLE__
+constexpr bool kDefaultIntegratedAs = false;
+#else
+constexpr bool kDefaultIntegratedAs = true;
+#endif
 
 struct Options {
     bool debug_parse = false;
@@ -12,8 +34,22 @@ struct Options {
     bool debug_output = false;
     bool keep_asm = false;
     bool keep_tac = false;
-    bool compile_only = false;  // -c flag: compile to .o, don't link
+    bool compile_only = false;     // -c flag: compile to .o, don't link
+    bool assembly_only = false;    // -S flag: write the .s only
+    bool preprocess_only = false;  // -E flag: print the preprocessed source
+    bool integrated_as = kDefaultIntegratedAs;
+    bool fp_contract_fast = false;
+    bool optimize = false;
+    int unroll_factor = 4;
+    bool inline_functions = true;
+    bool profile_generate = false;
+    std::string profile_use;
     std::string output_file;
+    size_t jobs = 1;  // -j flag: translation units compiled at once
+    std::vector<std::string> include_paths;
+    // The compiler's own headers and the SDK, searched after include_paths.
+    std::vector<std::string> system_include_paths;
+    std::vector<std::string> defines;
     std::vector<std::string> files;
 };
 
@@ -36,8 +72,61 @@ Options ParseCommandLine(int argc, char* argv[]) {
             opts.keep_asm = true;
         } else if (arg == "--keep-tac") {
             opts.keep_tac = true;
+        } else if (arg == "-O") {
+            opts.optimize = true;
+        } else if (arg == "-ffp-contract=fast") {
+            opts.fp_contract_fast = true;
+        } else if (arg == "-ffp-contract=off") {
+            opts.fp_contract_fast = false;
+        } else if (arg.starts_with("-funroll-factor=")) {
+            opts.unroll_factor = std::stoi(arg.substr(arg.find('=') + 1));
+        } else if (arg == "-fno-unroll-loops") {
+            opts.unroll_factor = 0;
+        } else if (arg == "-fno-inline") {
+            opts.inline_functions = false;
+        } else if (arg == "-fprofile-generate") {
+            // Counters are placed on the optimized graph, so profiling implies -O.
+            opts.profile_generate = true;
+            opts.optimize = true;
+        } else if (arg == "-fprofile-use") {
+            opts.profile_use = kDefaultProfileFile;
+            opts.optimize = true;
+        } else if (arg.starts_with("-fprofile-use=")) {
+            opts.profile_use = arg.substr(arg.find('=') + 1);
+            opts.optimize = true;
         } else if (arg == "-c") {
             opts.compile_only = true;
+        } else if (arg == "-S") {
+            opts.assembly_only = true;
+        } else if (arg == "-E") {
+            opts.preprocess_only = true;
+        } else if (arg.starts_with("-I") || arg.starts_with("-D")) {
+            std::vector<std::string>& values =
+                arg[1] == 'I' ? opts.include_paths : opts.defines;
+            if (arg.size() > 2) {
+                values.push_back(arg.substr(2));
+            } else if (i + 1 < argc) {
+                values.push_back(argv[++i]);
+            } else {
+                std::cerr << "Error: " << arg << " requires an argument\n";
+                exit(1);
+            }
+        } else if (arg.starts_with("-j")) {
+            std::string value = arg.size() > 2 ? arg.substr(2) : "";
+            if (value.empty() && i + 1 < argc) {
+                value = argv[++i];
+            }
+            if (value.empty() ||
+                value.find_first_not_of("0123456789") != std::string::npos ||
+                std::stoul(value) == 0) {
+                std::cerr << "Error: -j requires a positive number\n";
+                exit(1);
+            }
+            opts.jobs = std::stoul(value);
+        } else if (arg == "-fintegrated-as") {
+            opts.integrated_as = true;
+        } else if (arg == "-fno-integrated-as") {
+            opts.integrated_as = false;
         } else if (arg == "-o") {
             if (i + 1 < argc) {
                 opts.output_file = argv[++i];
@@ -52,102 +141,315 @@ Options ParseCommandLine(int argc, char* argv[]) {
     return opts;
 }
 
-int RunCompiler(const std::string& original_file, const std::string& preprocessed_file,
-                const Options& opts) {
+int RunCompiler(const std::string& original_file, std::string source,
+                const std::string& asm_file, const std::string& object_file,
+                const Options& opts, std::ostream& out, std::ostream& err) {
     Driver driver;
     driver.debug_parse = opts.debug_parse;
     driver.debug_scan = opts.debug_scan;
     driver.print_ast = opts.print_ast;
     driver.compile = opts.compile;
     driver.debug_output = opts.debug_output;
+    driver.keep_tac = opts.keep_tac;
+    driver.fp_contract_fast = opts.fp_contract_fast;
+    driver.optimize = opts.optimize;
+    driver.unroll_factor = opts.unroll_factor;
+    driver.inline_functions = opts.inline_functions;
+    driver.profile_generate = opts.profile_generate;
+    driver.profile_use = opts.profile_use;
+    driver.asm_file = asm_file;
+    driver.object_file = object_file;
+    driver.message_stream = &out;
+    driver.error_stream = &err;
 
     driver.SetFileName(original_file);
 
     if (opts.debug_output) {
-        std::cout << "Running mlcc compiler: " << std::endl;
+        out << "Running mlcc compiler: " << std::endl;
     }
 
-    int result = driver.CompileFile(preprocessed_file);
+    int result = driver.CompileSource(original_file, std::move(source));
     return result;
 }
 
-std::string RunPreprocessor(const std::string& filename, const Options& opts) {
-    std::string preprocessed_file =
-        std::filesystem::temp_directory_path() / "tmp_preprocessed.c";
-    std::string command = "clang -E " + filename + " -o " + preprocessed_file;
-
+// Preprocesses filename into output in-process. Include files are read through cache,
+// which is shared by all files of the invocation.
+bool RunPreprocessor(const std::string& filename, const Options& opts,
+                     IncludeCache& cache, std::string& output, std::ostream& out,
+                     std::ostream& err) {
     if (opts.debug_output) {
-        std::cout << "Running preprocessor: " << command << std::endl;
+        out << "Running preprocessor: " << filename << std::endl;
     }
 
-    int res = std::system(command.c_str());
-    if (res != 0) {
-        std::cerr << "Preprocessing failed\n";
-        exit(res);
+    Preprocessor preprocessor(cache);
+    for (const auto& path : opts.include_paths) {
+        preprocessor.AddIncludePath(path);
+    }
+    for (const auto& path : opts.system_include_paths) {
+        preprocessor.AddIncludePath(path);
+    }
+    if (opts.optimize) {
+        preprocessor.Define("__OPTIMIZE__=1");
+    }
+    for (const auto& definition : opts.defines) {
+        if (!preprocessor.Define(definition)) {
+            err << "Preprocessing error: " << preprocessor.GetError() << "\n";
+            return false;
+        }
+    }
+    bool ok = preprocessor.Run(filename, output);
+    for (const auto& warning : preprocessor.GetWarnings()) {
+        err << warning << "\n";
+    }
+    if (!ok) {
+        err << "Preprocessing error: " << preprocessor.GetError() << "\n";
+        return false;
     }
+    return true;
+}
 
-    return preprocessed_file;
+// Runs a shell command and copies what it prints to err, so that the output of a job
+// stays together. Returns the status like std::system.
+int RunCommand(const std::string& command, std::ostream& err) {
+    FILE* pipe = popen((command + " 2>&1").c_str(), "r");
+    if (!pipe) {
+        err << "Cannot run: " << command << "\n";
+        return -1;
+    }
+    char buffer[4096];
+    size_t size;
+    while ((size = std::fread(buffer, 1, sizeof(buffer), pipe)) > 0) {
+        err.write(buffer, static_cast<std::streamsize>(size));
+    }
+    return pclose(pipe);
 }
 
-int main(int argc, char* argv[]) {
-    Options opts = ParseCommandLine(argc, argv);
+// The first line a shell command prints, or an empty string if it fails.
+std::string CaptureCommand(const std::string& command) {
+    FILE* pipe = popen((command + " 2>/dev/null").c_str(), "r");
+    if (!pipe) {
+        return "";
+    }
+    std::string line;
+    char buffer[4096];
+    if (std::fgets(buffer, sizeof(buffer), pipe)) {
+        line = buffer;
+    }
+    while (std::fgets(buffer, sizeof(buffer), pipe)) {
+    }
+    if (pclose(pipe) != 0) {
+        return "";
+    }
+    while (!line.empty() && std::isspace(static_cast<unsigned char>(line.back()))) {
+        line.pop_back();
+    }
+    return line;
+}
 
-    if (opts.files.empty()) {
-        std::cerr << "Usage: compiler [-p] [-s] [--print-ast] [--print-ast-only] "
-                     "<source-files>\n";
+// The directories clang searches for <...> before /usr/local/include and
+// /usr/include: its own headers such as stddef.h and, on macOS, the SDK's headers.
+// Directories that cannot be found are left out.
+std::vector<std::string> FindSystemIncludePaths() {
+    std::vector<std::string> paths;
+    std::string resource_dir = CaptureCommand("clang -print-resource-dir");
+    if (!resource_dir.empty()) {
+        paths.push_back(resource_dir + "/include");
+    }
+#ifdef __APPLE__
+    std::string sdk = CaptureCommand("xcrun --show-sdk-path");
+    if (!sdk.empty()) {
+        paths.push_back(sdk + "/usr/include");
+    }
+#endif
+    return paths;
+}
+
+// Compiles one translation unit, writing progress to out and diagnostics to err.
+// runtime_file is the profiling runtime to link with, or empty.
+int CompileJob(const std::string& file, const Options& opts, IncludeCache& cache,
+               const std::string& runtime_file, std::ostream& out, std::ostream& err) {
+    if (opts.debug_output) {
+        out << "==> Processing: " << file << "\n";
+    }
+    std::string preprocessed;
+    if (!RunPreprocessor(file, opts, cache, preprocessed, out, err)) {
         return 1;
     }
+    if (opts.preprocess_only) {
+        if (opts.output_file.empty()) {
+            out << preprocessed;
+        } else {
+            std::ofstream(opts.output_file) << preprocessed;
+        }
+        return 0;
+    }
 
-    int exit_code = 0;
-    for (const auto& file : opts.files) {
-        if (opts.debug_output) {
-            std::cout << "==> Processing: " << file << "\n";
+    // Intermediate files that only feed clang are private temporary files, so that
+    // jobs compiling sources with the same name cannot overwrite each other's. They
+    // are removed on every return.
+    std::filesystem::path path(file);
+    std::string asm_file;
+    std::string object_file;
+    std::string out_file;
+    std::unique_ptr<TempFile> intermediate;
+    if (opts.assembly_only) {
+        asm_file = !opts.output_file.empty() ? opts.output_file
+                                             : path.replace_extension(".s").string();
+    } else {
+        if (!opts.output_file.empty()) {
+            out_file = opts.output_file;
+        } else if (opts.compile_only) {
+            out_file = path.replace_extension(".o").string();
+        } else {
+            out_file = path.replace_extension("").string();
         }
-        std::string preprocessed = RunPreprocessor(file, opts);
-        exit_code = RunCompiler(file, preprocessed, opts);
-        if (exit_code != 0) {
-            return exit_code;
+        try {
+            if (opts.keep_asm) {
+                asm_file = path.replace_extension(".s").string();
+            } else if (!opts.integrated_as && opts.compile) {
+                intermediate = std::make_unique<TempFile>("mlcc_", ".s");
+                asm_file = intermediate->Path();
+            }
+            if (opts.integrated_as && opts.compile_only) {
+                object_file = out_file;
+            } else if (opts.integrated_as && opts.compile) {
+                intermediate = std::make_unique<TempFile>("mlcc_", ".o");
+                object_file = intermediate->Path();
+            }
+        } catch (const std::runtime_error& error) {
+            err << "Error: " << error.what() << "\n";
+            return 1;
         }
+    }
 
-        if (opts.compile) {
-            std::filesystem::path path(file);
-            std::string asm_file = path.replace_extension(".s").string();
+    int exit_code = RunCompiler(file, std::move(preprocessed), asm_file, object_file,
+                                opts, out, err);
+    if (exit_code != 0) {
+        return exit_code;
+    }
 
-            std::string out_file;
-            if (!opts.output_file.empty()) {
-                out_file = opts.output_file;
-            } else if (opts.compile_only) {
-                out_file = path.replace_extension(".o").string();
-            } else {
-                out_file = path.replace_extension("").string();
-            }
+    if (!opts.compile || opts.assembly_only ||
+        (opts.integrated_as && opts.compile_only)) {
+        return 0;
+    }
 
-            std::string clang_cmd = "clang ";
-            if (opts.compile_only) {
-                clang_cmd += "-c ";
-            }
-            clang_cmd += asm_file + " -o " + out_file;
+    // clang assembles the .s without the integrated assembler and links either way.
+    std::string clang_input = opts.integrated_as ? object_file : asm_file;
+    std::string clang_cmd = "clang ";
+    if (opts.compile_only) {
+        clang_cmd += "-c ";
+    }
+    clang_cmd += clang_input + " -o " + out_file;
+    if (!runtime_file.empty()) {
+        clang_cmd += " " + runtime_file;
+    }
 
-            if (opts.debug_output) {
-                std::cout << "Running: " << clang_cmd << std::endl;
-            }
+    if (opts.debug_output) {
+        out << "Running: " << clang_cmd << std::endl;
+    }
 
-            int clang_res = std::system(clang_cmd.c_str());
-            if (clang_res != 0) {
-                std::cerr << "clang failed with exit code " << clang_res << "\n";
-                return clang_res;
-            }
+    int clang_res = RunCommand(clang_cmd, err);
+    if (clang_res != 0) {
+        err << "clang failed with exit code " << clang_res << "\n";
+        return clang_res;
+    }
+    return 0;
+}
 
-            if (opts.compile && !opts.keep_asm) {
-                std::filesystem::remove(asm_file);
-            }
+// Output of a job run on the pool, held back until every earlier file is printed.
+struct JobOutput {
+    std::ostringstream out;
+    std::ostringstream err;
+    int exit_code = 0;
+    bool done = false;
+};
 
-            if (!opts.keep_tac) {
-                std::filesystem::path tac_file = path.replace_extension(".tac.txt");
-                std::filesystem::remove(tac_file);
-                tac_file = path.replace_extension(".tac_optimized.txt");
-                std::filesystem::remove(tac_file);
+// Compiles the files on jobs threads. Each file is compiled by one thread from start
+// to finish, since the interning tables behind a Driver are per thread. Output is
+// printed in the order of the files, and files after the first failing one are
+// skipped as in a sequential run.
+int CompileParallel(const Options& opts, IncludeCache& cache,
+                    const std::string& runtime_file, size_t jobs) {
+    std::vector<JobOutput> results(opts.files.size());
+    std::atomic<size_t> first_failure = results.size();
+    std::mutex mutex;
+    std::condition_variable finished;
+
+    ThreadPool pool(std::min(jobs, results.size()));
+    for (size_t i = 0; i < results.size(); ++i) {
+        pool.Submit([&, i] {
+            JobOutput& result = results[i];
+            if (i < first_failure.load()) {
+                result.exit_code = CompileJob(opts.files[i], opts, cache, runtime_file,
+                                              result.out, result.err);
+            }
+            {
+                std::lock_guard lock(mutex);
+                if (result.exit_code != 0) {
+                    first_failure = std::min(first_failure.load(), i);
+                }
+                result.done = true;
             }
+            finished.notify_one();
+        });
+    }
+
+    for (size_t i = 0; i < results.size(); ++i) {
+        JobOutput& result = results[i];
+        {
+            std::unique_lock lock(mutex);
+            finished.wait(lock, [&] { return result.done; });
+        }
+        std::cout << result.out.str() << std::flush;
+        std::cerr << result.err.str() << std::flush;
+        if (result.exit_code != 0) {
+            return result.exit_code;
+        }
+    }
+    return 0;
+}
+
+int main(int argc, char* argv[]) {
+    Options opts = ParseCommandLine(argc, argv);
+
+    if (opts.files.empty()) {
+        std::cerr << "Usage: compiler [-p] [-s] [--print-ast] [--print-ast-only] "
+                     "[-j N] <source-files>\n";
+        return 1;
+    }
+
+    // Written once up front, as every linked program of the invocation shares it. The
+    // file is private to this process and removed on return.
+    std::unique_ptr<TempFile> runtime;
+    std::string runtime_file;
+    if (opts.profile_generate && opts.compile && !opts.compile_only &&
+        !opts.assembly_only && !opts.preprocess_only) {
+        try {
+            runtime = std::make_unique<TempFile>("mlcc_profile_runtime_", ".c");
+        } catch (const std::runtime_error& error) {
+            std::cerr << "Error: " << error.what() << "\n";
+            return 1;
+        }
+        runtime_file = runtime->Path();
+        std::ofstream stream(runtime_file);
+        stream << kProfileRuntimeSource;
+        if (!stream) {
+            std::cerr << "Error: Cannot write " << runtime_file << "\n";
+            return 1;
+        }
+    }
+
+    opts.system_include_paths = FindSystemIncludePaths();
+
+    IncludeCache include_cache;
+    if (opts.jobs > 1 && opts.files.size() > 1) {
+        return CompileParallel(opts, include_cache, runtime_file, opts.jobs);
+    }
+    for (const auto& file : opts.files) {
+        int exit_code =
+            CompileJob(file, opts, include_cache, runtime_file, std::cout, std::cerr);
+        if (exit_code != 0) {
+            return exit_code;
         }
     }
     return 0;
@@ -1,38 +1,89 @@
 #include "include/asm/allocator.h"
 
+#include <algorithm>
+#include <map>
+#include <queue>
+
 FrameStackAllocator::FrameStackAllocator() {}
 
 void FrameStackAllocator::PushFrame() { frames_.emplace_back(); }
 
 void FrameStackAllocator::PopFrame() { frames_.pop_back(); }
 
-int FrameStackAllocator::GetLocalOffset(const std::string& name, int size) {
+int FrameStackAllocator::GetLocalOffset(InternedString name, int size) {
     auto& frame = frames_.back();
 
-    if (!frame.offsets.contains(name)) {
-        frame.current_offset += size;
-        frame.offsets[name] = frame.current_offset;
+    auto [it, inserted] = frame.offsets.try_emplace(name, 0);
+    if (inserted) {
+        frame.current_offset = AlignOffset(frame.current_offset + size, size);
+        it->second = frame.current_offset;
     }
-    return -frame.offsets.at(name);
+    return -it->second;
 }
 
-int FrameStackAllocator::GetArgumentOffset(std::string name, int size) const {
-    if (name.find("arg..") == std::string::npos) {
-        throw std::runtime_error("Invalid argument name: " + name);
+void FrameStackAllocator::AssignSharedSlots(std::vector<StackSlotInterval> intervals) {
+    std::sort(intervals.begin(), intervals.end(), [](const auto& lhs, const auto& rhs) {
+        if (lhs.start != rhs.start) {
+            return lhs.start < rhs.start;
+        }
+        return lhs.name.Str() < rhs.name.Str();
+    });
+
+    std::vector<int> slot_sizes;
+    std::vector<size_t> interval_slots(intervals.size());
+    std::multimap<int, size_t> free_slots;  // size -> slot
+    using Active = std::pair<int, size_t>;  // end -> slot
+    std::priority_queue<Active, std::vector<Active>, std::greater<Active>> active;
+
+    for (size_t index = 0; index < intervals.size(); ++index) {
+        const auto& interval = intervals[index];
+        while (!active.empty() && active.top().first < interval.start) {
+            size_t slot = active.top().second;
+            free_slots.emplace(slot_sizes[slot], slot);
+            active.pop();
+        }
+
+        auto it = free_slots.lower_bound(interval.size);
+        size_t slot;
+        if (it != free_slots.end()) {
+            slot = it->second;
+            free_slots.erase(it);
+        } else {
+            slot = slot_sizes.size();
+            slot_sizes.push_back(interval.size);
+        }
+        interval_slots[index] = slot;
+        active.emplace(interval.end, slot);
     }
-    name = name.substr(5);
-    int index = 0;
-    try {
-        index = std::stoi(name);
-    } catch (const std::invalid_argument& e) {
-        throw std::runtime_error("Invalid argument name: " + name);
+
+    // Larger slots first: every slot is then naturally aligned without padding.
+    std::vector<size_t> order(slot_sizes.size());
+    for (size_t slot = 0; slot < order.size(); ++slot) {
+        order[slot] = slot;
     }
+    std::stable_sort(order.begin(), order.end(), [&](size_t lhs, size_t rhs) {
+        return slot_sizes[lhs] > slot_sizes[rhs];
+    });
 
-    if (index < 8) {
-        throw std::runtime_error("Argument should be on the stack");
+    auto& frame = frames_.back();
+    std::vector<int> slot_offsets(slot_sizes.size());
+    for (size_t slot : order) {
+        frame.current_offset =
+            AlignOffset(frame.current_offset + slot_sizes[slot], slot_sizes[slot]);
+        slot_offsets[slot] = frame.current_offset;
     }
 
-    return 16 + (index - 8) * 8;  // 16 (FP + LR) + offset
+    for (size_t index = 0; index < intervals.size(); ++index) {
+        frame.offsets[intervals[index].name] = slot_offsets[interval_slots[index]];
+    }
+}
+
+int FrameStackAllocator::AlignOffset(int offset, int alignment) {
+    return (offset + alignment - 1) / alignment * alignment;
+}
+
+int FrameStackAllocator::GetArgumentOffset(int stack_index) const {
+    return 16 + stack_index * 8;  // 16 (FP + LR) + offset
 }
 
 int FrameStackAllocator::GetArgumentOffsetForCaller(int index, int size) const {
@@ -59,26 +110,30 @@ int FrameStackAllocator::ReserveStackArguments(size_t arg_count) {
 
 TempRegisterAllocator::TempRegisterAllocator() {
     available_regs_ = {9, 10, 11, 12, 13, 14, 15};
+    available_fp_regs_ = {16, 17, 18, 19, 20, 21, 22, 23};
 }
 
-std::shared_ptr<Register> TempRegisterAllocator::Allocate(ASMOperand::Size size) {
-    if (available_regs_.empty()) {
+Register TempRegisterAllocator::Allocate(ASMOperand::Size size, bool is_floating_point) {
+    auto& available = is_floating_point ? available_fp_regs_ : available_regs_;
+    if (available.empty()) {
         throw std::runtime_error("Out of temporary registers");
     }
-    auto it = available_regs_.begin();
+    auto it = available.begin();
     int reg_num = *it;
-    available_regs_.erase(it);
+    available.erase(it);
 
-    std::string prefix = (size == ASMOperand::Size::Byte8) ? "x" : "w";
-    return std::make_shared<Register>(prefix + std::to_string(reg_num));
+    return Register::Get(reg_num, size, is_floating_point);
 }
 
-void TempRegisterAllocator::Free(const std::shared_ptr<Register>& reg) {
-    std::string name = reg->ToString();
-    if (name.empty()) {
+void TempRegisterAllocator::Free(const Register& reg) {
+    int reg_num = reg.GetNumber();
+    if (reg_num < 0) {
         return;
     }
 
-    int reg_num = std::stoi(name.substr(1));
-    available_regs_.insert(reg_num);
+    if (reg.IsFloatingPoint()) {
+        available_fp_regs_.insert(reg_num);
+    } else {
+        available_regs_.insert(reg_num);
+    }
 }
\ No newline at end of file
@@ -0,0 +1,459 @@
+#include "include/asm/assembler.h"
+
+#include <algorithm>
+#include <string_view>
+
+#include "include/support/output_buffer.h"
+
+namespace {
+
+constexpr uint32_t kNop = 0xD503201F;
+
+// ELF constants, see the System V ABI and the AArch64 ELF supplement.
+constexpr uint16_t kElfTypeRelocatable = 1;
+constexpr uint16_t kElfMachineAArch64 = 183;
+constexpr uint32_t kSectionProgBits = 1;
+constexpr uint32_t kSectionSymbolTable = 2;
+constexpr uint32_t kSectionStringTable = 3;
+constexpr uint32_t kSectionRela = 4;
+constexpr uint64_t kFlagWrite = 0x1;
+constexpr uint64_t kFlagAlloc = 0x2;
+constexpr uint64_t kFlagExecute = 0x4;
+constexpr uint64_t kFlagInfoLink = 0x40;
+constexpr uint8_t kBindLocal = 0;
+constexpr uint8_t kBindGlobal = 1;
+constexpr uint8_t kTypeNone = 0;
+constexpr uint8_t kTypeObject = 1;
+constexpr uint8_t kTypeFunction = 2;
+constexpr uint8_t kTypeSection = 3;
+
+constexpr uint32_t kRelocPrel32 = 261;
+constexpr uint32_t kRelocAdrPrelLo21 = 274;
+constexpr uint32_t kRelocAdrPrelPgHi21 = 275;
+constexpr uint32_t kRelocCondBr19 = 280;
+constexpr uint32_t kRelocJump26 = 282;
+constexpr uint32_t kRelocCall26 = 283;
+constexpr uint32_t kRelocLdst32AbsLo12 = 285;
+constexpr uint32_t kRelocLdst64AbsLo12 = 286;
+
+constexpr size_t kHeaderSize = 64;
+constexpr size_t kSectionHeaderSize = 64;
+constexpr size_t kSymbolSize = 24;
+constexpr size_t kRelaSize = 24;
+
+struct SectionInfo {
+    const char* name;
+    uint64_t flags;
+};
+
+SectionInfo GetSectionInfo(Assembler::Section section) {
+    switch (section) {
+        case Assembler::Section::Text:
+            return {".text", kFlagAlloc | kFlagExecute};
+        case Assembler::Section::ColdText:
+            return {".text.unlikely", kFlagAlloc | kFlagExecute};
+        case Assembler::Section::Data:
+            return {".data", kFlagAlloc | kFlagWrite};
+        case Assembler::Section::Literal:
+            return {".rodata", kFlagAlloc};
+    }
+    return {"", 0};
+}
+
+bool IsCode(Assembler::Section section) {
+    return section == Assembler::Section::Text ||
+           section == Assembler::Section::ColdText;
+}
+
+uint32_t GetRelocationType(Assembler::Fixup fixup) {
+    switch (fixup) {
+        case Assembler::Fixup::Branch26:
+            return kRelocJump26;
+        case Assembler::Fixup::Call26:
+            return kRelocCall26;
+        case Assembler::Fixup::CondBranch19:
+            return kRelocCondBr19;
+        case Assembler::Fixup::Adr21:
+            return kRelocAdrPrelLo21;
+        case Assembler::Fixup::AdrPage21:
+            return kRelocAdrPrelPgHi21;
+        case Assembler::Fixup::PageOffset32:
+            return kRelocLdst32AbsLo12;
+        case Assembler::Fixup::PageOffset64:
+            return kRelocLdst64AbsLo12;
+        case Assembler::Fixup::Relative32:
+            return kRelocPrel32;
+    }
+    return 0;
+}
+
+// Page-relative fixups depend on where the linker places the section, so they always
+// become relocations.
+bool IsPageFixup(Assembler::Fixup fixup) {
+    return fixup == Assembler::Fixup::AdrPage21 ||
+           fixup == Assembler::Fixup::PageOffset32 ||
+           fixup == Assembler::Fixup::PageOffset64;
+}
+
+std::string GetObjectName(const std::string& name) {
+    return !name.empty() && name[0] == '_' ? name.substr(1) : name;
+}
+
+void Put(std::vector<uint8_t>& out, uint64_t value, int bytes) {
+    for (int index = 0; index < bytes; ++index) {
+        out.push_back(static_cast<uint8_t>(value >> (8 * index)));
+    }
+}
+
+void PadTo(std::vector<uint8_t>& out, size_t alignment) {
+    while (out.size() % alignment != 0) {
+        out.push_back(0);
+    }
+}
+
+class StringTable {
+public:
+    StringTable() : data_(1, '\0') {}
+
+    uint32_t Add(const std::string& string) {
+        if (string.empty()) {
+            return 0;
+        }
+        auto offset = static_cast<uint32_t>(data_.size());
+        data_ += string;
+        data_ += '\0';
+        return offset;
+    }
+
+    const std::string& GetData() const { return data_; }
+
+private:
+    std::string data_;
+};
+
+struct Symbol {
+    std::string name;
+    uint8_t info;
+    uint16_t section_index;
+    uint64_t value;
+    uint64_t size;
+};
+
+}  // namespace
+
+Assembler::Assembler() : sections_(4), current_section_(Section::Text) {}
+
+void Assembler::SwitchSection(Section section) { current_section_ = section; }
+
+Assembler::SectionData& Assembler::Current() {
+    return sections_[static_cast<int>(current_section_)];
+}
+
+void Assembler::Align(int log2_alignment) {
+    auto& section = Current();
+    section.log2_alignment = std::max(section.log2_alignment, log2_alignment);
+    size_t alignment = size_t{1} << log2_alignment;
+    if (IsCode(current_section_)) {
+        while (section.bytes.size() % alignment != 0) {
+            EmitWord(kNop);
+        }
+    } else {
+        PadTo(section.bytes, alignment);
+    }
+}
+
+void Assembler::EmitWord(uint32_t word) { Put(Current().bytes, word, 4); }
+
+void Assembler::EmitQuad(uint64_t value) { Put(Current().bytes, value, 8); }
+
+void Assembler::EmitWord(uint32_t word, Fixup fixup, const std::string& symbol,
+                         int64_t addend) {
+    fixups_.push_back({current_section_, GetOffset(), fixup, symbol, addend});
+    EmitWord(word);
+}
+
+void Assembler::DefineLabel(const std::string& name, SymbolType type, uint64_t size) {
+    labels_[name] = {current_section_, GetOffset(), type, size};
+}
+
+void Assembler::DeclareGlobal(const std::string& name) { globals_.insert(name); }
+
+uint64_t Assembler::GetOffset() const {
+    return sections_[static_cast<int>(current_section_)].bytes.size();
+}
+
+const std::string& Assembler::GetError() const { return error_; }
+
+bool Assembler::Patch(const PendingFixup& fixup, int64_t delta) {
+    auto& bytes = sections_[static_cast<int>(fixup.section)].bytes;
+    uint32_t word = 0;
+    for (int index = 0; index < 4; ++index) {
+        word |= static_cast<uint32_t>(bytes[fixup.offset + index]) << (8 * index);
+    }
+
+    auto in_range = [&](int bits, int shift) {
+        int64_t limit = int64_t{1} << (bits + shift - 1);
+        return delta >= -limit && delta < limit && (delta & ((1 << shift) - 1)) == 0;
+    };
+    switch (fixup.fixup) {
+        case Fixup::Branch26:
+        case Fixup::Call26:
+            if (!in_range(26, 2)) {
+                error_ = "branch to " + fixup.symbol + " is out of range";
+                return false;
+            }
+            word |= static_cast<uint32_t>(delta >> 2) & 0x3FFFFFF;
+            break;
+        case Fixup::CondBranch19:
+            if (!in_range(19, 2)) {
+                error_ = "conditional branch to " + fixup.symbol + " is out of range";
+                return false;
+            }
+            word |= (static_cast<uint32_t>(delta >> 2) & 0x7FFFF) << 5;
+            break;
+        case Fixup::Adr21:
+            if (!in_range(21, 0)) {
+                error_ = "adr of " + fixup.symbol + " is out of range";
+                return false;
+            }
+            word |= (static_cast<uint32_t>(delta) & 0x3) << 29;
+            word |= (static_cast<uint32_t>(delta >> 2) & 0x7FFFF) << 5;
+            break;
+        case Fixup::Relative32:
+            if (!in_range(32, 0)) {
+                error_ = "offset of " + fixup.symbol + " is out of range";
+                return false;
+            }
+            word = static_cast<uint32_t>(delta);
+            break;
+        default:
+            error_ = "cannot resolve " + fixup.symbol + " within the object";
+            return false;
+    }
+
+    for (int index = 0; index < 4; ++index) {
+        bytes[fixup.offset + index] = static_cast<uint8_t>(word >> (8 * index));
+    }
+    return true;
+}
+
+bool Assembler::WriteObject(const std::string& filename) {
+    // Content sections come first in the section header table, after the null entry.
+    std::vector<Section> emitted;
+    std::unordered_map<int, uint16_t> section_index;
+    for (int index = 0; index < static_cast<int>(sections_.size()); ++index) {
+        auto section = static_cast<Section>(index);
+        bool has_labels = false;
+        for (const auto& [name, definition] : labels_) {
+            has_labels = has_labels || definition.section == section;
+        }
+        if (!sections_[index].bytes.empty() || has_labels) {
+            emitted.push_back(section);
+            section_index[index] = static_cast<uint16_t>(emitted.size());
+        }
+    }
+
+    // Locals precede globals in the symbol table: the section symbols, then the
+    // local functions and objects, then the global and undefined symbols.
+    std::vector<Symbol> symbols = {{"", 0, 0, 0, 0}};
+    std::unordered_map<int, uint32_t> section_symbol;
+    for (auto section : emitted) {
+        section_symbol[static_cast<int>(section)] = static_cast<uint32_t>(symbols.size());
+        symbols.push_back(
+            {"", kTypeSection, section_index[static_cast<int>(section)], 0, 0});
+    }
+
+    std::vector<std::string> names;
+    for (const auto& [name, definition] : labels_) {
+        if (definition.type != SymbolType::Label || globals_.contains(name)) {
+            names.push_back(name);
+        }
+    }
+    std::sort(names.begin(), names.end(), [&](const auto& lhs, const auto& rhs) {
+        bool lhs_global = globals_.contains(lhs);
+        bool rhs_global = globals_.contains(rhs);
+        if (lhs_global != rhs_global) {
+            return rhs_global;
+        }
+        const auto& lhs_definition = labels_.at(lhs);
+        const auto& rhs_definition = labels_.at(rhs);
+        if (lhs_definition.section != rhs_definition.section) {
+            return lhs_definition.section < rhs_definition.section;
+        }
+        return lhs_definition.offset < rhs_definition.offset;
+    });
+
+    std::unordered_map<std::string, uint32_t> symbol_index;
+    uint32_t first_global = 0;
+    for (const auto& name : names) {
+        const auto& definition = labels_.at(name);
+        bool is_global = globals_.contains(name);
+        if (is_global && first_global == 0) {
+            first_global = static_cast<uint32_t>(symbols.size());
+        }
+        uint8_t type = definition.type == SymbolType::Function ? kTypeFunction
+                       : definition.type == SymbolType::Object ? kTypeObject
+                                                               : kTypeNone;
+        uint8_t bind = is_global ? kBindGlobal : kBindLocal;
+        symbol_index[name] = static_cast<uint32_t>(symbols.size());
+        symbols.push_back({GetObjectName(name), static_cast<uint8_t>((bind << 4) | type),
+                           section_index[static_cast<int>(definition.section)],
+                           definition.offset, definition.size});
+    }
+    if (first_global == 0) {
+        first_global = static_cast<uint32_t>(symbols.size());
+    }
+
+    std::unordered_map<int, std::vector<Relocation>> relocations;
+    for (const auto& fixup : fixups_) {
+        auto it = labels_.find(fixup.symbol);
+        bool is_global = globals_.contains(fixup.symbol);
+        if (it != labels_.end() && !is_global && !IsPageFixup(fixup.fixup) &&
+            it->second.section == fixup.section) {
+            int64_t delta = static_cast<int64_t>(it->second.offset) + fixup.addend -
+                            static_cast<int64_t>(fixup.offset);
+            if (!Patch(fixup, delta)) {
+                return false;
+            }
+            continue;
+        }
+
+        Relocation relocation{fixup.offset, 0, GetRelocationType(fixup.fixup),
+                              fixup.addend};
+        if (it != labels_.end() && !is_global) {
+            relocation.symbol = section_symbol[static_cast<int>(it->second.section)];
+            relocation.addend += static_cast<int64_t>(it->second.offset);
+        } else if (auto found = symbol_index.find(fixup.symbol);
+                   found != symbol_index.end()) {
+            relocation.symbol = found->second;
+        } else {
+            relocation.symbol = static_cast<uint32_t>(symbols.size());
+            symbol_index[fixup.symbol] = relocation.symbol;
+            symbols.push_back({GetObjectName(fixup.symbol),
+                               static_cast<uint8_t>((kBindGlobal << 4) | kTypeNone), 0, 0,
+                               0});
+        }
+        relocations[static_cast<int>(fixup.section)].push_back(relocation);
+    }
+
+    struct SectionHeader {
+        uint32_t name;
+        uint32_t type;
+        uint64_t flags;
+        uint64_t offset;
+        uint64_t size;
+        uint32_t link;
+        uint32_t info;
+        uint64_t alignment;
+        uint64_t entry_size;
+    };
+    StringTable section_names;
+    StringTable symbol_names;
+    std::vector<SectionHeader> headers = {{}};
+    std::vector<uint8_t> out(kHeaderSize, 0);
+
+    for (auto section : emitted) {
+        const auto& data = sections_[static_cast<int>(section)];
+        uint64_t alignment = uint64_t{1} << std::max(data.log2_alignment,
+                                                     IsCode(section) ? 2 : 0);
+        PadTo(out, alignment);
+        auto info = GetSectionInfo(section);
+        headers.push_back({section_names.Add(info.name), kSectionProgBits, info.flags,
+                           out.size(), data.bytes.size(), 0, 0, alignment, 0});
+        out.insert(out.end(), data.bytes.begin(), data.bytes.end());
+    }
+
+    // The symbol table goes right after the relocation sections that link to it.
+    uint32_t symtab_index =
+        static_cast<uint32_t>(headers.size() + relocations.size() + 1);
+    for (auto section : emitted) {
+        auto it = relocations.find(static_cast<int>(section));
+        if (it == relocations.end()) {
+            continue;
+        }
+        PadTo(out, 8);
+        uint64_t offset = out.size();
+        for (const auto& relocation : it->second) {
+            Put(out, relocation.offset, 8);
+            Put(out, (uint64_t{relocation.symbol} << 32) | relocation.type, 8);
+            Put(out, static_cast<uint64_t>(relocation.addend), 8);
+        }
+        std::string name = std::string(".rela") + GetSectionInfo(section).name;
+        headers.push_back({section_names.Add(name), kSectionRela, kFlagInfoLink, offset,
+                           out.size() - offset, symtab_index,
+                           section_index[static_cast<int>(section)], 8, kRelaSize});
+    }
+
+    // An empty .note.GNU-stack marks the code as not needing an executable stack.
+    headers.push_back({section_names.Add(".note.GNU-stack"), kSectionProgBits, 0,
+                       out.size(), 0, 0, 0, 1, 0});
+
+    PadTo(out, 8);
+    uint64_t symtab_offset = out.size();
+    for (const auto& symbol : symbols) {
+        Put(out, symbol_names.Add(symbol.name), 4);
+        Put(out, symbol.info, 1);
+        Put(out, 0, 1);
+        Put(out, symbol.section_index, 2);
+        Put(out, symbol.value, 8);
+        Put(out, symbol.size, 8);
+    }
+    headers.push_back({section_names.Add(".symtab"), kSectionSymbolTable, 0,
+                       symtab_offset, out.size() - symtab_offset, symtab_index + 1,
+                       first_global, 8, kSymbolSize});
+
+    const auto& strtab = symbol_names.GetData();
+    headers.push_back({section_names.Add(".strtab"), kSectionStringTable, 0, out.size(),
+                       strtab.size(), 0, 0, 1, 0});
+    out.insert(out.end(), strtab.begin(), strtab.end());
+
+    uint32_t shstrtab_name = section_names.Add(".shstrtab");
+    const auto& shstrtab = section_names.GetData();
+    headers.push_back({shstrtab_name, kSectionStringTable, 0, out.size(),
+                       shstrtab.size(), 0, 0, 1, 0});
+    out.insert(out.end(), shstrtab.begin(), shstrtab.end());
+
+    PadTo(out, 8);
+    uint64_t section_headers_offset = out.size();
+    for (const auto& header : headers) {
+        Put(out, header.name, 4);
+        Put(out, header.type, 4);
+        Put(out, header.flags, 8);
+        Put(out, 0, 8);  // address
+        Put(out, header.offset, 8);
+        Put(out, header.size, 8);
+        Put(out, header.link, 4);
+        Put(out, header.info, 4);
+        Put(out, header.alignment, 8);
+        Put(out, header.entry_size, 8);
+    }
+
+    std::vector<uint8_t> header = {0x7F, 'E', 'L', 'F', 2, 1, 1, 0};
+    PadTo(header, 16);
+    Put(header, kElfTypeRelocatable, 2);
+    Put(header, kElfMachineAArch64, 2);
+    Put(header, 1, 4);  // version
+    Put(header, 0, 8);  // entry
+    Put(header, 0, 8);  // program headers
+    Put(header, section_headers_offset, 8);
+    Put(header, 0, 4);  // flags
+    Put(header, kHeaderSize, 2);
+    Put(header, 0, 2);
+    Put(header, 0, 2);
+    Put(header, kSectionHeaderSize, 2);
+    Put(header, headers.size(), 2);
+    Put(header, headers.size() - 1, 2);  // .shstrtab is last
+    std::copy(header.begin(), header.end(), out.begin());
+
+    OutputBuffer file;
+    if (!file.Open(filename)) {
+        error_ = "cannot open " + filename;
+        return false;
+    }
+    file.Write(std::string_view(reinterpret_cast<const char*>(out.data()), out.size()));
+    if (!file.Close()) {
+        error_ = "cannot write " + filename;
+        return false;
+    }
+    return true;
+}
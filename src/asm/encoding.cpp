@@ -0,0 +1,780 @@
+// AArch64 machine code for the instructions, as the integrated assembler sees them.
+// Each Encode produces exactly what an assembler would for the text of ToString.
+
+#include <bit>
+#include <optional>
+#include <stdexcept>
+
+#include "include/asm/assembler.h"
+#include "include/asm/instructions.h"
+
+namespace {
+
+constexpr uint32_t kSf = 1u << 31;
+
+template <typename Instruction>
+[[noreturn]] void CannotEncode(const Instruction& instr) {
+    throw std::runtime_error("Cannot encode instruction: " + instr.ToString());
+}
+
+uint32_t Sf(const Register& reg) {
+    return reg.GetSize() == ASMOperand::Size::Byte8 ? kSf : 0;
+}
+
+int64_t GetIntValue(const Immediate& imm) {
+    auto value = imm.GetValue();
+    return value.IsSigned() ? value.AsInt64() : static_cast<int64_t>(value.AsUInt64());
+}
+
+bool IsFloatingPointOp(BinaryOp op) {
+    return op == BinaryOp::FAdd || op == BinaryOp::FSub || op == BinaryOp::FMul ||
+           op == BinaryOp::FDiv;
+}
+
+uint32_t ConditionCode(Condition cond) {
+    switch (cond) {
+        case Condition::Eq:
+            return 0x0;
+        case Condition::Ne:
+            return 0x1;
+        case Condition::Hs:
+            return 0x2;
+        case Condition::Lo:
+            return 0x3;
+        case Condition::Mi:
+            return 0x4;
+        case Condition::Hi:
+            return 0x8;
+        case Condition::Ls:
+            return 0x9;
+        case Condition::Ge:
+            return 0xA;
+        case Condition::Lt:
+            return 0xB;
+        case Condition::Gt:
+            return 0xC;
+        case Condition::Le:
+            return 0xD;
+    }
+    return 0xE;
+}
+
+// The 8-bit fmov immediate: sign, a 3-bit exponent and a 4-bit fraction.
+std::optional<uint32_t> EncodeFloatImm8(double value) {
+    auto bits = std::bit_cast<uint64_t>(value);
+    if ((bits & 0x0000FFFFFFFFFFFFull) != 0) {
+        return std::nullopt;
+    }
+    uint64_t b = (bits >> 61) & 1;
+    uint64_t repeated = (bits >> 54) & 0xFF;
+    if (((bits >> 62) & 1) == b || repeated != (b ? 0xFF : 0x00)) {
+        return std::nullopt;
+    }
+    return static_cast<uint32_t>(((bits >> 63) << 7) | (b << 6) | ((bits >> 48) & 0x3F));
+}
+
+// add/sub (immediate) with a 12-bit value, optionally shifted left by 12.
+std::optional<uint32_t> EncodeArithmeticImm(uint64_t value) {
+    if (value < 4096) {
+        return static_cast<uint32_t>(value) << 10;
+    }
+    if ((value & 0xFFF) == 0 && (value >> 12) < 4096) {
+        return (1u << 22) | (static_cast<uint32_t>(value >> 12) << 10);
+    }
+    return std::nullopt;
+}
+
+// Base opcode of the unscaled (ldur/stur) form; the other addressing forms are derived
+// from it by fixed bits.
+uint32_t LoadStoreOpcode(const Register& reg, bool is_load, bool sign_extend) {
+    if (reg.IsFloatingPoint()) {
+        return is_load ? 0xFC400000 : 0xFC000000;
+    }
+    if (sign_extend) {
+        return 0xB8800000;
+    }
+    bool is_64 = reg.GetSize() == ASMOperand::Size::Byte8;
+    if (is_load) {
+        return is_64 ? 0xF8400000 : 0xB8400000;
+    }
+    return is_64 ? 0xF8000000 : 0xB8000000;
+}
+
+std::optional<uint32_t> EncodeLoadStore(uint32_t opcode, int scale,
+                                        const MemoryOperand& memory, uint32_t rt) {
+    int offset = memory.GetOffset();
+    uint32_t base = (memory.GetBase().GetEncoding() << 5) | rt;
+    uint32_t imm9 = (static_cast<uint32_t>(offset) & 0x1FF) << 12;
+    bool fits_imm9 = offset >= -256 && offset <= 255;
+    switch (memory.GetMode()) {
+        case MemoryOperand::Mode::Offset:
+            if (offset >= 0 && offset % scale == 0 && offset / scale < 4096) {
+                uint32_t scaled = static_cast<uint32_t>(offset / scale);
+                return opcode | 0x01000000 | (scaled << 10) | base;
+            }
+            if (fits_imm9) {
+                return opcode | imm9 | base;
+            }
+            return std::nullopt;
+        case MemoryOperand::Mode::PreIndexed:
+            return fits_imm9 ? std::optional(opcode | 0xC00 | imm9 | base) : std::nullopt;
+        case MemoryOperand::Mode::PostIndexed:
+            return fits_imm9 ? std::optional(opcode | 0x400 | imm9 | base) : std::nullopt;
+    }
+    return std::nullopt;
+}
+
+std::optional<uint32_t> EncodePair(bool is_load, const Register& first,
+                                   const Register& second, const MemoryOperand& memory) {
+    int offset = memory.GetOffset();
+    if (offset % 8 != 0 || offset / 8 < -64 || offset / 8 > 63) {
+        return std::nullopt;
+    }
+    uint32_t opcode = first.IsFloatingPoint() ? 0x6D000000 : 0xA9000000;
+    switch (memory.GetMode()) {
+        case MemoryOperand::Mode::Offset:
+            break;
+        case MemoryOperand::Mode::PreIndexed:
+            opcode |= 0x00800000;
+            break;
+        case MemoryOperand::Mode::PostIndexed:
+            opcode ^= 0x01800000;
+            break;
+    }
+    if (is_load) {
+        opcode |= 0x00400000;
+    }
+    return opcode | ((static_cast<uint32_t>(offset / 8) & 0x7F) << 15) |
+           (second.GetEncoding() << 10) | (memory.GetBase().GetEncoding() << 5) |
+           first.GetEncoding();
+}
+
+// "add/sub dst, lhs, rhs" with the stack pointer on either side needs the
+// extended-register form; uxtx there is the same as no extension at all.
+uint32_t EncodeAddSubRegister(bool is_add, const Register& dst, const Register& lhs,
+                              const Register& rhs, OperandExtend extend) {
+    uint32_t rd_rn = (lhs.GetEncoding() << 5) | dst.GetEncoding();
+    uint32_t rm = rhs.GetEncoding() << 16;
+    uint32_t option = 0;
+    if (extend == OperandExtend::Sxtw) {
+        option = 0b110;
+    } else if (extend == OperandExtend::Uxtw) {
+        option = 0b010;
+    } else if (dst.IsStackPointer() || lhs.IsStackPointer()) {
+        option = Sf(dst) ? 0b011 : 0b010;
+    } else {
+        return (is_add ? 0x0B000000 : 0x4B000000) | Sf(dst) | rm | rd_rn;
+    }
+    return (is_add ? 0x0B200000 : 0x4B200000) | Sf(dst) | rm | (option << 13) | rd_rn;
+}
+
+}  // namespace
+
+void LabelInstruction::Encode(Assembler& out) const {
+    if (alignment_ > 0) {
+        out.Align(alignment_);
+    }
+    out.DefineLabel(label_, IsFunction() ? Assembler::SymbolType::Function
+                                         : Assembler::SymbolType::Label);
+}
+
+void GlobalDirective::Encode(Assembler& out) const { out.DeclareGlobal(name_); }
+
+///////////////////////////////////////////////
+
+void MovInstruction::Encode(Assembler& out) const {
+    auto dst = OperandCast<Register>(operands_[0]);
+    if (!dst) {
+        CannotEncode(*this);
+    }
+    uint32_t rd = dst->GetEncoding();
+
+    if (auto imm = OperandCast<Immediate>(operands_[1])) {
+        if (dst->IsFloatingPoint()) {
+            double value = imm->GetValue().AsDouble();
+            if (std::bit_cast<uint64_t>(value) == 0) {
+                out.EmitWord(0x2F00E400 | rd);  // movi dN, #0
+                return;
+            }
+            auto imm8 = EncodeFloatImm8(value);
+            if (!imm8) {
+                CannotEncode(*this);
+            }
+            out.EmitWord(0x1E601000 | (*imm8 << 13) | rd);
+            return;
+        }
+
+        // The mov alias of a single movz or movn.
+        bool is_64 = Sf(*dst) != 0;
+        uint64_t value = static_cast<uint64_t>(GetIntValue(*imm));
+        uint64_t mask = is_64 ? ~uint64_t{0} : 0xFFFFFFFFull;
+        for (uint32_t opcode : {0x52800000u, 0x12800000u}) {
+            uint64_t bits = (opcode == 0x12800000u ? ~value : value) & mask;
+            for (uint32_t hw = 0; hw < (is_64 ? 4u : 2u); ++hw) {
+                if ((bits & ~(uint64_t{0xFFFF} << (16 * hw))) == 0) {
+                    uint32_t imm16 = static_cast<uint32_t>(bits >> (16 * hw));
+                    out.EmitWord(opcode | Sf(*dst) | (hw << 21) | (imm16 << 5) | rd);
+                    return;
+                }
+            }
+        }
+        CannotEncode(*this);
+    }
+
+    auto src = OperandCast<Register>(operands_[1]);
+    if (!src) {
+        CannotEncode(*this);
+    }
+    uint32_t rn = src->GetEncoding();
+    if (dst->IsFloatingPoint() && src->IsFloatingPoint()) {
+        out.EmitWord(0x1E604000 | (rn << 5) | rd);
+    } else if (dst->IsFloatingPoint()) {
+        out.EmitWord((Sf(*src) ? 0x9E670000 : 0x1E270000) | (rn << 5) | rd);
+    } else if (src->IsFloatingPoint()) {
+        out.EmitWord((Sf(*dst) ? 0x9E660000 : 0x1E260000) | (rn << 5) | rd);
+    } else if (dst->IsStackPointer() || src->IsStackPointer()) {
+        out.EmitWord(0x11000000 | Sf(*dst) | (rn << 5) | rd);
+    } else {
+        out.EmitWord(0x2A0003E0 | Sf(*dst) | (rn << 16) | rd);
+    }
+}
+
+void MovzInstruction::Encode(Assembler& out) const {
+    auto dst = OperandCast<Register>(operands_[0]);
+    if (!dst) {
+        CannotEncode(*this);
+    }
+    out.EmitWord(0x52800000 | Sf(*dst) | (static_cast<uint32_t>(shift_ / 16) << 21) |
+                 (uint32_t{imm16_} << 5) | dst->GetEncoding());
+}
+
+void MovkInstruction::Encode(Assembler& out) const {
+    auto dst = OperandCast<Register>(operands_[0]);
+    if (!dst) {
+        CannotEncode(*this);
+    }
+    out.EmitWord(0x72800000 | Sf(*dst) | (static_cast<uint32_t>(shift_ / 16) << 21) |
+                 (uint32_t{imm16_} << 5) | dst->GetEncoding());
+}
+
+void MovnInstruction::Encode(Assembler& out) const {
+    auto dst = OperandCast<Register>(operands_[0]);
+    if (!dst) {
+        CannotEncode(*this);
+    }
+    out.EmitWord(0x12800000 | Sf(*dst) | (static_cast<uint32_t>(shift_ / 16) << 21) |
+                 (uint32_t{imm16_} << 5) | dst->GetEncoding());
+}
+
+///////////////////////////////////////////////
+
+void BinaryInstruction::Encode(Assembler& out) const {
+    auto dst = OperandCast<Register>(operands_[0]);
+    auto lhs = OperandCast<Register>(operands_[1]);
+    // The opcode alone picks the register bank, so registers of the other bank would
+    // be encoded as different registers.
+    bool is_floating_point = IsFloatingPointOp(op_);
+    if (!dst || !lhs || dst->IsFloatingPoint() != is_floating_point ||
+        lhs->IsFloatingPoint() != is_floating_point) {
+        CannotEncode(*this);
+    }
+    uint32_t sf = Sf(*dst);
+    uint32_t rd_rn = (lhs->GetEncoding() << 5) | dst->GetEncoding();
+
+    if (auto imm = OperandCast<Immediate>(operands_[2])) {
+        int64_t value = GetIntValue(*imm);
+        uint32_t width = sf ? 64 : 32;
+        switch (op_) {
+            case BinaryOp::Add:
+            case BinaryOp::Sub: {
+                bool is_add = (op_ == BinaryOp::Add) == (value >= 0);
+                auto encoded = EncodeArithmeticImm(
+                    value >= 0 ? value : 0 - static_cast<uint64_t>(value));
+                if (!encoded) {
+                    CannotEncode(*this);
+                }
+                out.EmitWord((is_add ? 0x11000000 : 0x51000000) | sf | *encoded | rd_rn);
+                return;
+            }
+            case BinaryOp::Lsl:
+            case BinaryOp::Lsr:
+            case BinaryOp::Asr: {
+                if (value < 0 || value >= width) {
+                    CannotEncode(*this);
+                }
+                auto shift = static_cast<uint32_t>(value);
+                uint32_t opcode = op_ == BinaryOp::Asr ? 0x13000000 : 0x53000000;
+                if (sf) {
+                    opcode |= kSf | (1u << 22);
+                }
+                uint32_t immr = shift;
+                uint32_t imms = width - 1;
+                if (op_ == BinaryOp::Lsl) {
+                    immr = (width - shift) % width;
+                    imms = width - 1 - shift;
+                }
+                out.EmitWord(opcode | (immr << 16) | (imms << 10) | rd_rn);
+                return;
+            }
+            default:
+                CannotEncode(*this);
+        }
+    }
+
+    auto rhs = OperandCast<Register>(operands_[2]);
+    if (!rhs || rhs->IsFloatingPoint() != is_floating_point) {
+        CannotEncode(*this);
+    }
+    uint32_t rm = rhs->GetEncoding() << 16;
+    uint32_t opcode = 0;
+    switch (op_) {
+        case BinaryOp::Add:
+        case BinaryOp::Sub:
+            out.EmitWord(
+                EncodeAddSubRegister(op_ == BinaryOp::Add, *dst, *lhs, *rhs, extend_));
+            return;
+        case BinaryOp::Mul:
+            opcode = 0x1B007C00 | sf;
+            break;
+        case BinaryOp::SDiv:
+            opcode = 0x1AC00C00 | sf;
+            break;
+        case BinaryOp::UDiv:
+            opcode = 0x1AC00800 | sf;
+            break;
+        case BinaryOp::And:
+            opcode = 0x0A000000 | sf;
+            break;
+        case BinaryOp::Orr:
+            opcode = 0x2A000000 | sf;
+            break;
+        case BinaryOp::Eor:
+            opcode = 0x4A000000 | sf;
+            break;
+        case BinaryOp::Lsl:
+            opcode = 0x1AC02000 | sf;
+            break;
+        case BinaryOp::Lsr:
+            opcode = 0x1AC02400 | sf;
+            break;
+        case BinaryOp::Asr:
+            opcode = 0x1AC02800 | sf;
+            break;
+        case BinaryOp::FAdd:
+            opcode = 0x1E602800;
+            break;
+        case BinaryOp::FSub:
+            opcode = 0x1E603800;
+            break;
+        case BinaryOp::FMul:
+            opcode = 0x1E600800;
+            break;
+        case BinaryOp::FDiv:
+            opcode = 0x1E601800;
+            break;
+    }
+    out.EmitWord(opcode | rm | rd_rn);
+}
+
+void UnaryInstruction::Encode(Assembler& out) const {
+    auto dst = OperandCast<Register>(operands_[0]);
+    auto operand = OperandCast<Register>(operands_[1]);
+    bool is_floating_point = op_ == UnaryOp::FNeg;
+    if (!dst || !operand || dst->IsFloatingPoint() != is_floating_point ||
+        operand->IsFloatingPoint() != is_floating_point) {
+        CannotEncode(*this);
+    }
+    uint32_t sf = Sf(*dst);
+    uint32_t rd = dst->GetEncoding();
+    uint32_t rn = operand->GetEncoding();
+    switch (op_) {
+        case UnaryOp::Neg:
+            out.EmitWord(0x4B0003E0 | sf | (rn << 16) | rd);
+            return;
+        case UnaryOp::Mvn:
+            out.EmitWord(0x2A2003E0 | sf | (rn << 16) | rd);
+            return;
+        case UnaryOp::FNeg:
+            out.EmitWord(0x1E614000 | (rn << 5) | rd);
+            return;
+        case UnaryOp::Clz:
+            out.EmitWord(0x5AC01000 | sf | (rn << 5) | rd);
+            return;
+        case UnaryOp::Rbit:
+            out.EmitWord(0x5AC00000 | sf | (rn << 5) | rd);
+            return;
+        case UnaryOp::Rev:
+            out.EmitWord((sf ? 0xDAC00C00 : 0x5AC00800) | (rn << 5) | rd);
+            return;
+    }
+}
+
+void FusedMultiplyInstruction::Encode(Assembler& out) const {
+    auto dst = OperandCast<Register>(operands_[0]);
+    auto lhs = OperandCast<Register>(operands_[1]);
+    auto rhs = OperandCast<Register>(operands_[2]);
+    auto addend = OperandCast<Register>(operands_[3]);
+    if (!dst || !lhs || !rhs || !addend) {
+        CannotEncode(*this);
+    }
+    uint32_t opcode = 0;
+    switch (op_) {
+        case FusedOp::FMAdd:
+            opcode = 0x1F400000;
+            break;
+        case FusedOp::FMSub:
+            opcode = 0x1F408000;
+            break;
+        case FusedOp::FNMSub:
+            opcode = 0x1F608000;
+            break;
+    }
+    out.EmitWord(opcode | (rhs->GetEncoding() << 16) | (addend->GetEncoding() << 10) |
+                 (lhs->GetEncoding() << 5) | dst->GetEncoding());
+}
+
+void ConvertInstruction::Encode(Assembler& out) const {
+    auto dst = OperandCast<Register>(operands_[0]);
+    auto src = OperandCast<Register>(operands_[1]);
+    if (!dst || !src) {
+        CannotEncode(*this);
+    }
+    uint32_t opcode = 0;
+    switch (op_) {
+        case ConvertOp::FCvtZS:
+            opcode = 0x1E780000 | Sf(*dst);
+            break;
+        case ConvertOp::FCvtZU:
+            opcode = 0x1E790000 | Sf(*dst);
+            break;
+        case ConvertOp::SCvtF:
+            opcode = 0x1E620000 | Sf(*src);
+            break;
+        case ConvertOp::UCvtF:
+            opcode = 0x1E630000 | Sf(*src);
+            break;
+    }
+    out.EmitWord(opcode | (src->GetEncoding() << 5) | dst->GetEncoding());
+}
+
+void PopCountInstruction::Encode(Assembler& out) const {
+    auto dst = OperandCast<Register>(operands_[0]);
+    auto src = OperandCast<Register>(operands_[1]);
+    if (!dst || !src) {
+        CannotEncode(*this);
+    }
+    constexpr uint32_t v31 = 31;
+    bool is_64 = src->GetSize() == ASMOperand::Size::Byte8;
+    out.EmitWord((is_64 ? 0x9E670000 : 0x1E270000) | (src->GetEncoding() << 5) | v31);
+    out.EmitWord(0x0E205800 | (v31 << 5) | v31);  // cnt v31.8b, v31.8b
+    out.EmitWord(0x0E31B800 | (v31 << 5) | v31);  // addv b31, v31.8b
+    out.EmitWord((is_64 ? 0x9E660000 : 0x1E260000) | (v31 << 5) | dst->GetEncoding());
+}
+
+///////////////////////////////////////////////
+
+void CompareInstruction::Encode(Assembler& out) const {
+    auto lhs = OperandCast<Register>(operands_[0]);
+    if (!lhs) {
+        CannotEncode(*this);
+    }
+    uint32_t rn = lhs->GetEncoding() << 5;
+
+    if (auto imm = OperandCast<Immediate>(operands_[1])) {
+        if (lhs->IsFloatingPoint()) {
+            out.EmitWord(0x1E602008 | rn);  // fcmp dN, #0.0
+            return;
+        }
+        int64_t value = GetIntValue(*imm);
+        auto encoded =
+            EncodeArithmeticImm(value >= 0 ? value : 0 - static_cast<uint64_t>(value));
+        if (!encoded) {
+            CannotEncode(*this);
+        }
+        // cmp with a negative value is cmn.
+        out.EmitWord((value >= 0 ? 0x7100001F : 0x3100001F) | Sf(*lhs) | *encoded | rn);
+        return;
+    }
+
+    auto rhs = OperandCast<Register>(operands_[1]);
+    if (!rhs) {
+        CannotEncode(*this);
+    }
+    uint32_t rm = rhs->GetEncoding() << 16;
+    if (lhs->IsFloatingPoint()) {
+        out.EmitWord(0x1E602000 | rm | rn);
+    } else if (lhs->IsStackPointer()) {
+        out.EmitWord(0x6B20601F | Sf(*lhs) | rm | rn);  // uxtx
+    } else {
+        out.EmitWord(0x6B00001F | Sf(*lhs) | rm | rn);
+    }
+}
+
+void CSetInstruction::Encode(Assembler& out) const {
+    auto dst = OperandCast<Register>(operands_[0]);
+    if (!dst) {
+        CannotEncode(*this);
+    }
+    // csinc dst, zr, zr with the inverted condition.
+    out.EmitWord(0x1A9F07E0 | Sf(*dst) | ((ConditionCode(cond_) ^ 1) << 12) |
+                 dst->GetEncoding());
+}
+
+void BranchInstruction::Encode(Assembler& out) const {
+    switch (type_) {
+        case BranchType::Unconditional:
+            out.EmitWord(0x14000000, Assembler::Fixup::Branch26, label_);
+            return;
+        case BranchType::Call:
+            out.EmitWord(0x94000000, Assembler::Fixup::Call26, label_);
+            return;
+        case BranchType::Conditional:
+            out.EmitWord(0x54000000 | ConditionCode(cond_),
+                         Assembler::Fixup::CondBranch19, label_);
+            return;
+    }
+}
+
+void RetInstruction::Encode(Assembler& out) const { out.EmitWord(0xD65F03C0); }
+
+void IndirectBranchInstruction::Encode(Assembler& out) const {
+    auto address = OperandCast<Register>(operands_[0]);
+    if (!address) {
+        CannotEncode(*this);
+    }
+    out.EmitWord(0xD61F0000 | (address->GetEncoding() << 5));
+}
+
+///////////////////////////////////////////////
+
+void LoadInstruction::Encode(Assembler& out) const {
+    auto dst = OperandCast<Register>(operands_[0]);
+    auto address = OperandCast<MemoryOperand>(operands_[1]);
+    if (!dst || !address) {
+        CannotEncode(*this);
+    }
+    int scale = sign_extend_ ? 4 : static_cast<int>(dst->GetSize());
+    auto word = EncodeLoadStore(LoadStoreOpcode(*dst, true, sign_extend_), scale,
+                                *address, dst->GetEncoding());
+    if (!word) {
+        CannotEncode(*this);
+    }
+    out.EmitWord(*word);
+}
+
+void LoadIndexedInstruction::Encode(Assembler& out) const {
+    auto dst = OperandCast<Register>(operands_[0]);
+    auto base = OperandCast<Register>(operands_[1]);
+    auto index = OperandCast<Register>(operands_[2]);
+    if (!dst || !base || !index) {
+        CannotEncode(*this);
+    }
+    int scale = sign_extend_ ? 4 : static_cast<int>(dst->GetSize());
+    if (shift_ != 0 && (1 << shift_) != scale) {
+        CannotEncode(*this);
+    }
+    // A 32-bit index is zero-extended; it has already been range checked.
+    uint32_t option = index->GetSize() == ASMOperand::Size::Byte8 ? 0b011 : 0b010;
+    out.EmitWord(LoadStoreOpcode(*dst, true, sign_extend_) | 0x00200800 |
+                 (index->GetEncoding() << 16) | (option << 13) |
+                 (shift_ != 0 ? 1u << 12 : 0) | (base->GetEncoding() << 5) |
+                 dst->GetEncoding());
+}
+
+void LoadPairInstruction::Encode(Assembler& out) const {
+    auto dst1 = OperandCast<Register>(dst1_);
+    auto dst2 = OperandCast<Register>(dst2_);
+    auto address = OperandCast<MemoryOperand>(address_);
+    if (!dst1 || !dst2 || !address) {
+        CannotEncode(*this);
+    }
+    auto word = EncodePair(true, *dst1, *dst2, *address);
+    if (!word) {
+        CannotEncode(*this);
+    }
+    out.EmitWord(*word);
+}
+
+void StoreInstruction::Encode(Assembler& out) const {
+    auto src = OperandCast<Register>(operands_[0]);
+    auto address = OperandCast<MemoryOperand>(operands_[1]);
+    if (!src || !address) {
+        CannotEncode(*this);
+    }
+    auto word = EncodeLoadStore(LoadStoreOpcode(*src, false, false),
+                                static_cast<int>(src->GetSize()), *address,
+                                src->GetEncoding());
+    if (!word) {
+        CannotEncode(*this);
+    }
+    out.EmitWord(*word);
+}
+
+void StorePairInstruction::Encode(Assembler& out) const {
+    auto src1 = OperandCast<Register>(src1_);
+    auto src2 = OperandCast<Register>(src2_);
+    auto address = OperandCast<MemoryOperand>(address_);
+    if (!src1 || !src2 || !address) {
+        CannotEncode(*this);
+    }
+    auto word = EncodePair(false, *src1, *src2, *address);
+    if (!word) {
+        CannotEncode(*this);
+    }
+    out.EmitWord(*word);
+}
+
+///////////////////////////////////////////////
+
+namespace {
+
+// "sub/add sp, sp, #size", split into a shifted and a plain part for large frames.
+template <typename Instruction>
+void EncodeStackAdjustment(Assembler& out, const Instruction& instr,
+                           const Immediate& size, bool is_add) {
+    int64_t value = GetIntValue(size);
+    if (value < 0 || (value >> 24) != 0) {
+        CannotEncode(instr);
+    }
+    uint32_t opcode = (is_add ? 0x91000000 : 0xD1000000) | (31 << 5) | 31;
+    auto high = static_cast<uint32_t>(value >> 12);
+    auto low = static_cast<uint32_t>(value & 0xFFF);
+    if (high != 0) {
+        out.EmitWord(opcode | (1u << 22) | (high << 10));
+    }
+    if (low != 0 || high == 0) {
+        out.EmitWord(opcode | (low << 10));
+    }
+}
+
+}  // namespace
+
+void AllocateStackInstruction::Encode(Assembler& out) const {
+    EncodeStackAdjustment(out, *this, size_, false);
+}
+
+void DeallocateStackInstruction::Encode(Assembler& out) const {
+    EncodeStackAdjustment(out, *this, size_, true);
+}
+
+///////////////////////////////////////////////
+
+void ExtendInstruction::Encode(Assembler& out) const {
+    auto dst = OperandCast<Register>(operands_[0]);
+    auto src = OperandCast<Register>(operands_[1]);
+    if (!dst || !src) {
+        CannotEncode(*this);
+    }
+    bool dst_is_x = Sf(*dst) != 0;
+    bool src_is_w = Sf(*src) == 0;
+    if (dst_is_x && src_is_w && is_signed_) {
+        out.EmitWord(0x93407C00 | (src->GetEncoding() << 5) | dst->GetEncoding());
+        return;
+    }
+    uint32_t sf = dst_is_x && !src_is_w ? kSf : 0;
+    out.EmitWord(0x2A0003E0 | sf | (src->GetEncoding() << 16) | dst->GetEncoding());
+}
+
+void TruncateInstruction::Encode(Assembler& out) const {
+    auto dst = OperandCast<Register>(operands_[0]);
+    auto src = OperandCast<Register>(operands_[1]);
+    if (!dst || !src) {
+        CannotEncode(*this);
+    }
+    out.EmitWord(0x2A0003E0 | Sf(*dst) | (src->GetEncoding() << 16) | dst->GetEncoding());
+}
+
+///////////////////////////////////////////////
+
+void TextSectionDirective::Encode(Assembler& out) const {
+    out.SwitchSection(Assembler::Section::Text);
+}
+
+void ColdTextSectionDirective::Encode(Assembler& out) const {
+    out.SwitchSection(Assembler::Section::ColdText);
+}
+
+void DataSectionDirective::Encode(Assembler& out) const {
+    out.SwitchSection(Assembler::Section::Data);
+}
+
+void LiteralSectionDirective::Encode(Assembler& out) const {
+    out.SwitchSection(Assembler::Section::Literal);
+}
+
+void LiteralDirective::Encode(Assembler& out) const {
+    out.Align(3);
+    out.DefineLabel(label_);
+    out.EmitQuad(bits_);
+}
+
+void JumpTableDirective::Encode(Assembler& out) const {
+    out.Align(2);
+    out.DefineLabel(label_);
+    for (size_t index = 0; index < targets_.size(); ++index) {
+        // target - label, where the entry itself is 4 * index bytes past the label.
+        out.EmitWord(0, Assembler::Fixup::Relative32, targets_[index],
+                     static_cast<int64_t>(4 * index));
+    }
+}
+
+void StaticVariableDirective::Encode(Assembler& out) const {
+    std::string symbol = "_" + name_;
+    if (is_global_) {
+        out.DeclareGlobal(symbol);
+    }
+    out.Align(size_ == 8 ? 3 : 2);
+    out.DefineLabel(symbol, Assembler::SymbolType::Object, size_);
+    uint64_t bits = value_.IsFloatingPoint() ? std::bit_cast<uint64_t>(value_.AsDouble())
+                    : value_.IsSigned()      ? static_cast<uint64_t>(value_.AsInt64())
+                                             : value_.AsUInt64();
+    if (value_.IsFloatingPoint() || size_ == 8) {
+        out.EmitQuad(bits);
+    } else {
+        out.EmitWord(static_cast<uint32_t>(bits));
+    }
+}
+
+///////////////////////////////////////////////
+
+void AdrpInstruction::Encode(Assembler& out) const {
+    auto dst = OperandCast<Register>(operands_[0]);
+    if (!dst) {
+        CannotEncode(*this);
+    }
+    out.EmitWord(0x90000000 | dst->GetEncoding(), Assembler::Fixup::AdrPage21, symbol_);
+}
+
+void AdrInstruction::Encode(Assembler& out) const {
+    auto dst = OperandCast<Register>(operands_[0]);
+    if (!dst) {
+        CannotEncode(*this);
+    }
+    out.EmitWord(0x10000000 | dst->GetEncoding(), Assembler::Fixup::Adr21, label_);
+}
+
+void LoadGlobalInstruction::Encode(Assembler& out) const {
+    auto dst = OperandCast<Register>(operands_[0]);
+    auto base = OperandCast<Register>(operands_[1]);
+    if (!dst || !base) {
+        CannotEncode(*this);
+    }
+    bool is_64 = dst->GetSize() == ASMOperand::Size::Byte8;
+    out.EmitWord(LoadStoreOpcode(*dst, true, false) | 0x01000000 |
+                     (base->GetEncoding() << 5) | dst->GetEncoding(),
+                 is_64 ? Assembler::Fixup::PageOffset64 : Assembler::Fixup::PageOffset32,
+                 symbol_);
+}
+
+void StoreGlobalInstruction::Encode(Assembler& out) const {
+    auto src = OperandCast<Register>(operands_[0]);
+    auto base = OperandCast<Register>(operands_[1]);
+    if (!src || !base) {
+        CannotEncode(*this);
+    }
+    bool is_64 = src->GetSize() == ASMOperand::Size::Byte8;
+    out.EmitWord(LoadStoreOpcode(*src, false, false) | 0x01000000 |
+                     (base->GetEncoding() << 5) | src->GetEncoding(),
+                 is_64 ? Assembler::Fixup::PageOffset64 : Assembler::Fixup::PageOffset32,
+                 symbol_);
+}
@@ -1,24 +1,148 @@
 #include "include/asm/instructions.h"
 
+#include <bit>
 #include <cassert>
+#include <utility>
 
 #include "include/types/numeric_constant.h"
 
-std::vector<std::shared_ptr<ASMOperand>> ASMInstruction::GetOperands() const {
-    return {};
+namespace {
+
+const char* BinaryOpToStr(BinaryOp op) {
+    switch (op) {
+        case BinaryOp::Add:
+            return "add";
+        case BinaryOp::Sub:
+            return "sub";
+        case BinaryOp::Mul:
+            return "mul";
+        case BinaryOp::SDiv:
+            return "sdiv";
+        case BinaryOp::UDiv:
+            return "udiv";
+        case BinaryOp::And:
+            return "and";
+        case BinaryOp::Orr:
+            return "orr";
+        case BinaryOp::Eor:
+            return "eor";
+        case BinaryOp::Lsl:
+            return "lsl";
+        case BinaryOp::Asr:
+            return "asr";
+        case BinaryOp::Lsr:
+            return "lsr";
+        case BinaryOp::FAdd:
+            return "fadd";
+        case BinaryOp::FSub:
+            return "fsub";
+        case BinaryOp::FMul:
+            return "fmul";
+        case BinaryOp::FDiv:
+            return "fdiv";
+    }
+    return "";
 }
 
-void ASMInstruction::SetOperands(
-    const std::vector<std::shared_ptr<ASMOperand>>& new_operands) {}
+const char* OperandExtendToStr(OperandExtend extend) {
+    switch (extend) {
+        case OperandExtend::None:
+            return "";
+        case OperandExtend::Sxtw:
+            return ", sxtw";
+        case OperandExtend::Uxtw:
+            return ", uxtw";
+    }
+    return "";
+}
+
+template <size_t... Index>
+constexpr bool MatchesOpcodes(std::index_sequence<Index...>) {
+    return ((std::variant_alternative_t<Index, ASMInstruction::Storage>::kOpcode ==
+             static_cast<Opcode>(Index)) &&
+            ...);
+}
+
+static_assert(MatchesOpcodes(
+    std::make_index_sequence<std::variant_size_v<ASMInstruction::Storage>>()));
+
+}  // namespace
+
+std::string ASMInstruction::ToString() const {
+    return std::visit([](const auto& instr) { return instr.ToString(); }, instr_);
+}
+
+void ASMInstruction::Write(OutputBuffer& out) const {
+    std::visit(
+        [&out](const auto& instr) {
+            if constexpr (requires { instr.Write(out); }) {
+                instr.Write(out);
+            } else {
+                out << instr.ToString();
+            }
+        },
+        instr_);
+}
+
+void ASMInstruction::Encode(Assembler& out) const {
+    std::visit([&out](const auto& instr) { instr.Encode(out); }, instr_);
+}
+
+std::span<ASMOperand> ASMInstruction::GetOperands() {
+    return std::visit(
+        [](auto& instr) -> std::span<ASMOperand> {
+            if constexpr (requires { instr.GetOperands(); }) {
+                return instr.GetOperands();
+            } else {
+                return {};
+            }
+        },
+        instr_);
+}
+
+std::span<const ASMOperand> ASMInstruction::GetOperands() const {
+    return std::visit(
+        [](const auto& instr) -> std::span<const ASMOperand> {
+            if constexpr (requires { instr.GetOperands(); }) {
+                return instr.GetOperands();
+            } else {
+                return {};
+            }
+        },
+        instr_);
+}
+
+Opcode ASMInstruction::GetOpcode() const { return static_cast<Opcode>(instr_.index()); }
+
+ASMInstruction::Storage& ASMInstruction::GetStorage() { return instr_; }
+
+const ASMInstruction::Storage& ASMInstruction::GetStorage() const { return instr_; }
 
 ///////////////////////////////////////////////
 
-LabelInstruction::LabelInstruction(const std::string& label) : label_(label) {}
+LabelInstruction::LabelInstruction(const std::string& label, int alignment)
+    : label_(label), alignment_(alignment) {}
 
-std::string LabelInstruction::ToString() const { return label_ + ":"; }
+std::string LabelInstruction::ToString() const {
+    if (alignment_ > 0) {
+        return ".p2align " + std::to_string(alignment_) + "\n" + label_ + ":";
+    }
+    return label_ + ":";
+}
+
+void LabelInstruction::Write(OutputBuffer& out) const {
+    if (alignment_ > 0) {
+        out << ".p2align ";
+        out.WriteInt(alignment_);
+        out << '\n';
+    }
+    out << label_ << ':';
+}
 
 bool LabelInstruction::IsFunction() const { return !label_.empty() && label_[0] == '_'; }
 
+const std::string& LabelInstruction::GetLabel() const { return label_; }
+
 ///////////////////////////////////////////////
 
 GlobalDirective::GlobalDirective(const std::string& name) : name_(name) {}
@@ -27,191 +151,199 @@ std::string GlobalDirective::ToString() const { return ".globl " + name_; }
 
 ///////////////////////////////////////////////
 
-MovInstruction::MovInstruction(std::shared_ptr<ASMOperand> dst,
-                               std::shared_ptr<ASMOperand> src)
-    : dst_(dst), src_(src) {}
+MovInstruction::MovInstruction(ASMOperand dst, ASMOperand src)
+    : InstructionOperands(dst, src) {}
 
 std::string MovInstruction::ToString() const {
-    return "mov " + dst_->ToString() + ", " + src_->ToString();
-}
-
-std::vector<std::shared_ptr<ASMOperand>> MovInstruction::GetOperands() const {
-    return {dst_, src_};
+    const auto& [dst, src] = operands_;
+    std::string opcode =
+        dst.IsFloatingPoint() || src.IsFloatingPoint() ? "fmov " : "mov ";
+    return opcode + dst.ToString() + ", " + src.ToString();
 }
 
-void MovInstruction::SetOperands(const std::vector<std::shared_ptr<ASMOperand>>& ops) {
-    assert(ops.size() == 2);
-    dst_ = ops[0];
-    src_ = ops[1];
+void MovInstruction::Write(OutputBuffer& out) const {
+    const auto& [dst, src] = operands_;
+    out << (dst.IsFloatingPoint() || src.IsFloatingPoint() ? "fmov " : "mov ");
+    dst.Write(out);
+    out << ", ";
+    src.Write(out);
 }
 
-MovzInstruction::MovzInstruction(std::shared_ptr<ASMOperand> dst, uint16_t imm16,
-                                 int shift)
-    : dst_(dst), imm16_(imm16), shift_(shift) {}
-
-std::vector<std::shared_ptr<ASMOperand>> MovzInstruction::GetOperands() const {
-    return {dst_};
-}
-
-void MovzInstruction::SetOperands(
-    const std::vector<std::shared_ptr<ASMOperand>>& new_operands) {
-    assert(new_operands.size() == 1);
-    dst_ = new_operands[0];
-}
+MovzInstruction::MovzInstruction(ASMOperand dst, uint16_t imm16, int shift)
+    : InstructionOperands(dst), imm16_(imm16), shift_(shift) {}
 
 std::string MovzInstruction::ToString() const {
+    const auto& dst = operands_[0];
     if (shift_ == 0) {
-        return "movz " + dst_->ToString() + ", #" + std::to_string(imm16_);
+        return "movz " + dst.ToString() + ", #" + std::to_string(imm16_);
     }
-    return "movz " + dst_->ToString() + ", #" + std::to_string(imm16_) + ", lsl #" +
+    return "movz " + dst.ToString() + ", #" + std::to_string(imm16_) + ", lsl #" +
            std::to_string(shift_);
 }
 
-MovkInstruction::MovkInstruction(std::shared_ptr<ASMOperand> dst, uint16_t imm16,
-                                 int shift)
-    : dst_(dst), imm16_(imm16), shift_(shift) {}
+MovkInstruction::MovkInstruction(ASMOperand dst, uint16_t imm16, int shift)
+    : InstructionOperands(dst), imm16_(imm16), shift_(shift) {}
 
-std::vector<std::shared_ptr<ASMOperand>> MovkInstruction::GetOperands() const {
-    return {dst_};
+std::string MovkInstruction::ToString() const {
+    const auto& dst = operands_[0];
+    if (shift_ == 0) return "movk " + dst.ToString() + ", #" + std::to_string(imm16_);
+    return "movk " + dst.ToString() + ", #" + std::to_string(imm16_) + ", lsl #" +
+           std::to_string(shift_);
 }
 
-void MovkInstruction::SetOperands(
-    const std::vector<std::shared_ptr<ASMOperand>>& new_operands) {
-    assert(new_operands.size() == 1);
-    dst_ = new_operands[0];
-}
+MovnInstruction::MovnInstruction(ASMOperand dst, uint16_t imm16, int shift)
+    : InstructionOperands(dst), imm16_(imm16), shift_(shift) {}
 
-std::string MovkInstruction::ToString() const {
-    if (shift_ == 0) return "movk " + dst_->ToString() + ", #" + std::to_string(imm16_);
-    return "movk " + dst_->ToString() + ", #" + std::to_string(imm16_) + ", lsl #" +
+std::string MovnInstruction::ToString() const {
+    const auto& dst = operands_[0];
+    if (shift_ == 0) return "movn " + dst.ToString() + ", #" + std::to_string(imm16_);
+    return "movn " + dst.ToString() + ", #" + std::to_string(imm16_) + ", lsl #" +
            std::to_string(shift_);
 }
 
 ///////////////////////////////////////////////
 
-BinaryInstruction::BinaryInstruction(BinaryOp op, std::shared_ptr<ASMOperand> dst,
-                                     std::shared_ptr<ASMOperand> lhs,
-                                     std::shared_ptr<ASMOperand> rhs)
-    : op_(op), dst_(dst), lhs_(lhs), rhs_(rhs) {}
+BinaryInstruction::BinaryInstruction(BinaryOp op, ASMOperand dst, ASMOperand lhs,
+                                     ASMOperand rhs, OperandExtend extend)
+    : InstructionOperands(dst, lhs, rhs), op_(op), extend_(extend) {}
 
 std::string BinaryInstruction::ToString() const {
+    const auto& [dst, lhs, rhs] = operands_;
+    return std::string(BinaryOpToStr(op_)) + " " + dst.ToString() + ", " +
+           lhs.ToString() + ", " + rhs.ToString() + OperandExtendToStr(extend_);
+}
+
+void BinaryInstruction::Write(OutputBuffer& out) const {
+    const auto& [dst, lhs, rhs] = operands_;
+    out << BinaryOpToStr(op_) << ' ';
+    dst.Write(out);
+    out << ", ";
+    lhs.Write(out);
+    out << ", ";
+    rhs.Write(out);
+    out << OperandExtendToStr(extend_);
+}
+
+///////////////////////////////////////////////
+
+UnaryInstruction::UnaryInstruction(UnaryOp op, ASMOperand dst, ASMOperand operand)
+    : InstructionOperands(dst, operand), op_(op) {}
+
+std::string UnaryInstruction::ToString() const {
     std::string opcode;
     switch (op_) {
-        case BinaryOp::Add:
-            opcode = "add";
-            break;
-        case BinaryOp::Sub:
-            opcode = "sub";
-            break;
-        case BinaryOp::Mul:
-            opcode = "mul";
-            break;
-        case BinaryOp::SDiv:
-            opcode = "sdiv";
-            break;
-        case BinaryOp::UDiv:
-            opcode = "udiv";
-            break;
-        case BinaryOp::And:
-            opcode = "and";
+        case UnaryOp::Neg:
+            opcode = "neg";
             break;
-        case BinaryOp::Orr:
-            opcode = "orr";
+        case UnaryOp::Mvn:
+            opcode = "mvn";
             break;
-        case BinaryOp::Eor:
-            opcode = "eor";
+        case UnaryOp::FNeg:
+            opcode = "fneg";
             break;
-        case BinaryOp::Lsl:
-            opcode = "lsl";
+        case UnaryOp::Clz:
+            opcode = "clz";
             break;
-        case BinaryOp::Asr:
-            opcode = "asr";
+        case UnaryOp::Rbit:
+            opcode = "rbit";
             break;
-        case BinaryOp::Lsr:
-            opcode = "lsr";
+        case UnaryOp::Rev:
+            opcode = "rev";
             break;
     }
-    return opcode + " " + dst_->ToString() + ", " + lhs_->ToString() + ", " +
-           rhs_->ToString();
+    const auto& [dst, operand] = operands_;
+    return opcode + " " + dst.ToString() + ", " + operand.ToString();
 }
 
-std::vector<std::shared_ptr<ASMOperand>> BinaryInstruction::GetOperands() const {
-    return {dst_, lhs_, rhs_};
-}
+///////////////////////////////////////////////
 
-void BinaryInstruction::SetOperands(const std::vector<std::shared_ptr<ASMOperand>>& ops) {
-    assert(ops.size() == 3);
-    dst_ = ops[0];
-    lhs_ = ops[1];
-    rhs_ = ops[2];
+FusedMultiplyInstruction::FusedMultiplyInstruction(FusedOp op, ASMOperand dst,
+                                                   ASMOperand lhs, ASMOperand rhs,
+                                                   ASMOperand addend)
+    : InstructionOperands(dst, lhs, rhs, addend), op_(op) {}
+
+std::string FusedMultiplyInstruction::ToString() const {
+    std::string opcode;
+    switch (op_) {
+        case FusedOp::FMAdd:
+            opcode = "fmadd";
+            break;
+        case FusedOp::FMSub:
+            opcode = "fmsub";
+            break;
+        case FusedOp::FNMSub:
+            opcode = "fnmsub";
+            break;
+    }
+    const auto& [dst, lhs, rhs, addend] = operands_;
+    return opcode + " " + dst.ToString() + ", " + lhs.ToString() + ", " +
+           rhs.ToString() + ", " + addend.ToString();
 }
 
 ///////////////////////////////////////////////
 
-UnaryInstruction::UnaryInstruction(UnaryOp op, std::shared_ptr<ASMOperand> dst,
-                                   std::shared_ptr<ASMOperand> operand)
-    : op_(op), dst_(dst), operand_(operand) {}
+ConvertInstruction::ConvertInstruction(ConvertOp op, ASMOperand dst, ASMOperand src)
+    : InstructionOperands(dst, src), op_(op) {}
 
-std::string UnaryInstruction::ToString() const {
+std::string ConvertInstruction::ToString() const {
     std::string opcode;
     switch (op_) {
-        case UnaryOp::Neg:
-            opcode = "neg";
+        case ConvertOp::FCvtZS:
+            opcode = "fcvtzs";
             break;
-        case UnaryOp::Mvn:
-            opcode = "mvn";
+        case ConvertOp::FCvtZU:
+            opcode = "fcvtzu";
+            break;
+        case ConvertOp::SCvtF:
+            opcode = "scvtf";
+            break;
+        case ConvertOp::UCvtF:
+            opcode = "ucvtf";
             break;
     }
-    return opcode + " " + dst_->ToString() + ", " + operand_->ToString();
+    const auto& [dst, src] = operands_;
+    return opcode + " " + dst.ToString() + ", " + src.ToString();
 }
 
-std::vector<std::shared_ptr<ASMOperand>> UnaryInstruction::GetOperands() const {
-    return {dst_, operand_};
-}
+///////////////////////////////////////////////
+
+PopCountInstruction::PopCountInstruction(ASMOperand dst, ASMOperand src)
+    : InstructionOperands(dst, src) {}
 
-void UnaryInstruction::SetOperands(const std::vector<std::shared_ptr<ASMOperand>>& ops) {
-    assert(ops.size() == 2);
-    dst_ = ops[0];
-    operand_ = ops[1];
+std::string PopCountInstruction::ToString() const {
+    const auto& [dst, src] = operands_;
+    std::string scalar = src.GetSize() == ASMOperand::Size::Byte8 ? "d31" : "s31";
+    return "fmov " + scalar + ", " + src.ToString() +
+           "\ncnt v31.8b, v31.8b\naddv b31, v31.8b\nfmov " + dst.ToString() + ", " +
+           scalar;
 }
 
 ///////////////////////////////////////////////
 
-CompareInstruction::CompareInstruction(std::shared_ptr<ASMOperand> lhs,
-                                       std::shared_ptr<ASMOperand> rhs)
-    : lhs_(lhs), rhs_(rhs) {}
+CompareInstruction::CompareInstruction(ASMOperand lhs, ASMOperand rhs)
+    : InstructionOperands(lhs, rhs) {}
 
 std::string CompareInstruction::ToString() const {
-    return "cmp " + lhs_->ToString() + ", " + rhs_->ToString();
-}
-
-std::vector<std::shared_ptr<ASMOperand>> CompareInstruction::GetOperands() const {
-    return {lhs_, rhs_};
+    const auto& [lhs, rhs] = operands_;
+    std::string opcode = lhs.IsFloatingPoint() ? "fcmp " : "cmp ";
+    return opcode + lhs.ToString() + ", " + rhs.ToString();
 }
 
-void CompareInstruction::SetOperands(
-    const std::vector<std::shared_ptr<ASMOperand>>& ops) {
-    assert(ops.size() == 2);
-    lhs_ = ops[0];
-    rhs_ = ops[1];
+void CompareInstruction::Write(OutputBuffer& out) const {
+    const auto& [lhs, rhs] = operands_;
+    out << (lhs.IsFloatingPoint() ? "fcmp " : "cmp ");
+    lhs.Write(out);
+    out << ", ";
+    rhs.Write(out);
 }
 
 ///////////////////////////////////////////////
 
-CSetInstruction::CSetInstruction(std::shared_ptr<ASMOperand> dst, Condition cond)
-    : dst_(dst), cond_(cond) {}
+CSetInstruction::CSetInstruction(ASMOperand dst, Condition cond)
+    : InstructionOperands(dst), cond_(cond) {}
 
 std::string CSetInstruction::ToString() const {
-    return "cset " + dst_->ToString() + ", " + ConditionToStr(cond_);
-}
-
-std::vector<std::shared_ptr<ASMOperand>> CSetInstruction::GetOperands() const {
-    return {dst_};
-}
-
-void CSetInstruction::SetOperands(const std::vector<std::shared_ptr<ASMOperand>>& ops) {
-    assert(ops.size() == 1);
-    dst_ = ops[0];
+    return "cset " + operands_[0].ToString() + ", " + ConditionToStr(cond_);
 }
 
 ///////////////////////////////////////////////
@@ -232,150 +364,173 @@ std::string BranchInstruction::ToString() const {
     return std::string("b.") + ConditionToStr(cond_) + " " + label_;
 }
 
-///////////////////////////////////////////////
+void BranchInstruction::Write(OutputBuffer& out) const {
+    if (type_ == BranchType::Unconditional) {
+        out << "b ";
+    } else if (type_ == BranchType::Call) {
+        out << "bl ";
+    } else {
+        out << "b." << ConditionToStr(cond_) << ' ';
+    }
+    out << label_;
+}
 
-RetInstruction::RetInstruction() {}
+BranchType BranchInstruction::GetType() const { return type_; }
+
+const std::string& BranchInstruction::GetLabel() const { return label_; }
+
+///////////////////////////////////////////////
 
 std::string RetInstruction::ToString() const { return "ret"; }
 
+IndirectBranchInstruction::IndirectBranchInstruction(ASMOperand address,
+                                                     std::vector<std::string> targets)
+    : InstructionOperands(address), targets_(std::move(targets)) {}
+
+std::string IndirectBranchInstruction::ToString() const {
+    return "br " + operands_[0].ToString();
+}
+
+const std::vector<std::string>& IndirectBranchInstruction::GetTargets() const {
+    return targets_;
+}
+
 ///////////////////////////////////////////////
 
-LoadInstruction::LoadInstruction(std::shared_ptr<ASMOperand> dst,
-                                 std::shared_ptr<ASMOperand> address)
-    : dst_(dst), address_(address) {}
+LoadInstruction::LoadInstruction(ASMOperand dst, ASMOperand address, bool sign_extend)
+    : InstructionOperands(dst, address), sign_extend_(sign_extend) {}
 
 std::string LoadInstruction::ToString() const {
-    return "ldr " + dst_->ToString() + ", " + address_->ToString();
+    const auto& [dst, address] = operands_;
+    std::string opcode = sign_extend_ ? "ldrsw " : "ldr ";
+    return opcode + dst.ToString() + ", " + address.ToString();
 }
 
-std::vector<std::shared_ptr<ASMOperand>> LoadInstruction::GetOperands() const {
-    return {dst_, address_};
+void LoadInstruction::Write(OutputBuffer& out) const {
+    const auto& [dst, address] = operands_;
+    out << (sign_extend_ ? "ldrsw " : "ldr ");
+    dst.Write(out);
+    out << ", ";
+    address.Write(out);
 }
 
-void LoadInstruction::SetOperands(const std::vector<std::shared_ptr<ASMOperand>>& ops) {
-    assert(ops.size() == 2);
-    dst_ = ops[0];
-    address_ = ops[1];
+LoadIndexedInstruction::LoadIndexedInstruction(ASMOperand dst, ASMOperand base,
+                                               ASMOperand index, int shift,
+                                               bool sign_extend)
+    : InstructionOperands(dst, base, index), shift_(shift), sign_extend_(sign_extend) {}
+
+std::string LoadIndexedInstruction::ToString() const {
+    const auto& [dst, base, index] = operands_;
+    std::string opcode = sign_extend_ ? "ldrsw " : "ldr ";
+    return opcode + dst.ToString() + ", [" + base.ToString() + ", " + index.ToString() +
+           ", lsl #" + std::to_string(shift_) + "]";
 }
 
 ///////////////////////////////////////////////
 
-StoreInstruction::StoreInstruction(std::shared_ptr<ASMOperand> src,
-                                   std::shared_ptr<ASMOperand> address)
-    : src_(src), address_(address) {}
+StoreInstruction::StoreInstruction(ASMOperand src, ASMOperand address)
+    : InstructionOperands(src, address) {}
 
 std::string StoreInstruction::ToString() const {
-    return "str " + src_->ToString() + ", " + address_->ToString();
+    const auto& [src, address] = operands_;
+    return "str " + src.ToString() + ", " + address.ToString();
 }
 
-std::vector<std::shared_ptr<ASMOperand>> StoreInstruction::GetOperands() const {
-    return {src_, address_};
-}
-
-void StoreInstruction::SetOperands(const std::vector<std::shared_ptr<ASMOperand>>& ops) {
-    assert(ops.size() == 2);
-    src_ = ops[0];
-    address_ = ops[1];
+void StoreInstruction::Write(OutputBuffer& out) const {
+    const auto& [src, address] = operands_;
+    out << "str ";
+    src.Write(out);
+    out << ", ";
+    address.Write(out);
 }
 
 ///////////////////////////////////////////////
 
-StorePairInstruction::StorePairInstruction(std::shared_ptr<ASMOperand> src1,
-                                           std::shared_ptr<ASMOperand> src2,
-                                           std::shared_ptr<ASMOperand> address)
+StorePairInstruction::StorePairInstruction(ASMOperand src1, ASMOperand src2,
+                                           ASMOperand address)
     : src1_(std::move(src1)), src2_(std::move(src2)), address_(std::move(address)) {}
 
 std::string StorePairInstruction::ToString() const {
-    return "stp " + src1_->ToString() + ", " + src2_->ToString() + ", " +
-           address_->ToString();
+    return "stp " + src1_.ToString() + ", " + src2_.ToString() + ", " +
+           address_.ToString();
 }
 
 ////////////////////////////////////////////////////
 
-LoadPairInstruction::LoadPairInstruction(std::shared_ptr<ASMOperand> dst1,
-                                         std::shared_ptr<ASMOperand> dst2,
-                                         std::shared_ptr<ASMOperand> address)
+LoadPairInstruction::LoadPairInstruction(ASMOperand dst1, ASMOperand dst2,
+                                         ASMOperand address)
     : dst1_(std::move(dst1)), dst2_(std::move(dst2)), address_(std::move(address)) {}
 
 std::string LoadPairInstruction::ToString() const {
-    return "ldp " + dst1_->ToString() + ", " + dst2_->ToString() + ", " +
-           address_->ToString();
+    return "ldp " + dst1_.ToString() + ", " + dst2_.ToString() + ", " +
+           address_.ToString();
 }
 
 ///////////////////////////////////////////////
 
-AllocateStackInstruction::AllocateStackInstruction(std::shared_ptr<ASMOperand> size,
-                                                   bool final_size)
-    : size_(std::move(size)), final_size_(final_size) {}
+AllocateStackInstruction::AllocateStackInstruction(Immediate size, bool final_size)
+    : size_(size), final_size_(final_size) {}
 
 std::string AllocateStackInstruction::ToString() const {
-    return "sub sp, sp, " + size_->ToString();
+    return "sub sp, sp, " + size_.ToString();
 }
 
-void AllocateStackInstruction::ChangeSize(std::shared_ptr<ASMOperand> size) {
+void AllocateStackInstruction::ChangeSize(Immediate size) {
     if (final_size_) {
         return;
     }
-    size_ = std::move(size);
+    size_ = size;
 }
 
 ///////////////////////////////////////////////
 
-DeallocateStackInstruction::DeallocateStackInstruction(std::shared_ptr<ASMOperand> size,
-                                                       bool final_size)
-    : size_(std::move(size)), final_size_(final_size) {}
+DeallocateStackInstruction::DeallocateStackInstruction(Immediate size, bool final_size)
+    : size_(size), final_size_(final_size) {}
 
 std::string DeallocateStackInstruction::ToString() const {
-    return "add sp, sp, " + size_->ToString();
+    return "add sp, sp, " + size_.ToString();
 }
 
-void DeallocateStackInstruction::ChangeSize(std::shared_ptr<ASMOperand> size) {
+void DeallocateStackInstruction::ChangeSize(Immediate size) {
     if (final_size_) {
         return;
     }
-    size_ = std::move(size);
+    size_ = size;
 }
 
 ///////////////////////////////////////////////
 
-ExtendInstruction::ExtendInstruction(std::shared_ptr<ASMOperand> dst,
-                                     std::shared_ptr<ASMOperand> src, bool is_signed)
-    : dst_(dst), src_(src), is_signed_(is_signed) {}
+ExtendInstruction::ExtendInstruction(ASMOperand dst, ASMOperand src, bool is_signed)
+    : InstructionOperands(dst, src), is_signed_(is_signed) {}
 
 std::string ExtendInstruction::ToString() const {
-    auto dst_str = dst_->ToString();
-    auto src_str = src_->ToString();
+    auto dst_str = operands_[0].ToString();
+    auto src_str = operands_[1].ToString();
 
     bool dst_is_x = !dst_str.empty() && dst_str[0] == 'x';
     bool src_is_w = !src_str.empty() && src_str[0] == 'w';
     assert(dst_is_x || src_is_w);
 
+    if (dst_is_x && src_is_w && is_signed_) {
+        return "sxtw " + dst_str + ", " + src_str;
+    }
     if (dst_is_x && src_is_w) {
-        std::string op = is_signed_ ? "sxtw" : "uxtw";
-        return op + " " + dst_str + ", " + src_str;
+        // There is no uxtw instruction; writing a W register clears the upper half.
+        dst_str[0] = 'w';
     }
     return "mov " + dst_str + ", " + src_str;
 }
 
-std::vector<std::shared_ptr<ASMOperand>> ExtendInstruction::GetOperands() const {
-    return {dst_, src_};
-}
-
-void ExtendInstruction::SetOperands(const std::vector<std::shared_ptr<ASMOperand>>& ops) {
-    assert(ops.size() == 2);
-    dst_ = ops[0];
-    src_ = ops[1];
-}
+bool ExtendInstruction::IsSigned() const { return is_signed_; }
 
 ///////////////////////////////////////////////
 
-TruncateInstruction::TruncateInstruction(std::shared_ptr<ASMOperand> dst,
-                                         std::shared_ptr<ASMOperand> src)
-    : dst_(dst), src_(src) {}
+TruncateInstruction::TruncateInstruction(ASMOperand dst, ASMOperand src)
+    : InstructionOperands(dst, src) {}
 
 std::string TruncateInstruction::ToString() const {
-    auto dst_str = dst_->ToString();
-    auto src_str = src_->ToString();
+    auto dst_str = operands_[0].ToString();
+    auto src_str = operands_[1].ToString();
 
     bool dst_is_w = !dst_str.empty() && dst_str[0] == 'w';
     bool src_is_x = !src_str.empty() && src_str[0] == 'x';
@@ -387,22 +542,38 @@ std::string TruncateInstruction::ToString() const {
     return "mov " + dst_str + ", " + src_str;
 }
 
-std::vector<std::shared_ptr<ASMOperand>> TruncateInstruction::GetOperands() const {
-    return {dst_, src_};
+///////////////////////////////////////////////
+
+std::string TextSectionDirective::ToString() const { return ".text"; }
+
+std::string ColdTextSectionDirective::ToString() const {
+    return ".section __TEXT,__text_cold,regular,pure_instructions";
 }
 
-void TruncateInstruction::SetOperands(
-    const std::vector<std::shared_ptr<ASMOperand>>& ops) {
-    assert(ops.size() == 2);
-    dst_ = ops[0];
-    src_ = ops[1];
+std::string DataSectionDirective::ToString() const { return ".data"; }
+
+std::string LiteralSectionDirective::ToString() const {
+    return ".section __TEXT,__literal8,8byte_literals";
 }
 
-///////////////////////////////////////////////
+LiteralDirective::LiteralDirective(const std::string& label, uint64_t bits)
+    : label_(label), bits_(bits) {}
 
-std::string TextSectionDirective::ToString() const { return ".text"; }
+std::string LiteralDirective::ToString() const {
+    return ".p2align 3\n" + label_ + ":\n    .quad " + std::to_string(bits_);
+}
 
-std::string DataSectionDirective::ToString() const { return ".data"; }
+JumpTableDirective::JumpTableDirective(const std::string& label,
+                                       std::vector<std::string> targets)
+    : label_(label), targets_(std::move(targets)) {}
+
+std::string JumpTableDirective::ToString() const {
+    std::string result = ".p2align 2\n" + label_ + ":";
+    for (const auto& target : targets_) {
+        result += "\n    .long " + target + "-" + label_;
+    }
+    return result;
+}
 
 StaticVariableDirective::StaticVariableDirective(const std::string& name,
                                                  NumericConstant value, int size,
@@ -420,7 +591,10 @@ std::string StaticVariableDirective::ToString() const {
         result += ".p2align 2\n";
     }
     result += "_" + name_ + ":\n";
-    if (size_ == 8) {
+    if (value_.IsFloatingPoint()) {
+        result += "    .quad " +
+                  std::to_string(std::bit_cast<uint64_t>(value_.AsDouble()));
+    } else if (size_ == 8) {
         result += "    .quad " + value_.ToString();
     } else {
         result += "    .long " + value_.ToString();
@@ -430,67 +604,40 @@ std::string StaticVariableDirective::ToString() const {
 
 ///////////////////////////////////////////////
 
-AdrpInstruction::AdrpInstruction(std::shared_ptr<ASMOperand> dst,
-                                 const std::string& symbol)
-    : dst_(dst), symbol_(symbol) {}
+AdrpInstruction::AdrpInstruction(ASMOperand dst, const std::string& symbol)
+    : InstructionOperands(dst), symbol_(symbol) {}
 
 std::string AdrpInstruction::ToString() const {
-    return "adrp " + dst_->ToString() + ", " + symbol_ + "@PAGE";
+    return "adrp " + operands_[0].ToString() + ", " + symbol_ + "@PAGE";
 }
 
-std::vector<std::shared_ptr<ASMOperand>> AdrpInstruction::GetOperands() const {
-    return {dst_};
-}
+AdrInstruction::AdrInstruction(ASMOperand dst, const std::string& label)
+    : InstructionOperands(dst), label_(label) {}
 
-void AdrpInstruction::SetOperands(const std::vector<std::shared_ptr<ASMOperand>>& ops) {
-    assert(ops.size() == 1);
-    dst_ = ops[0];
+std::string AdrInstruction::ToString() const {
+    return "adr " + operands_[0].ToString() + ", " + label_;
 }
 
 ///////////////////////////////////////////////
 
-LoadGlobalInstruction::LoadGlobalInstruction(std::shared_ptr<ASMOperand> dst,
-                                             std::shared_ptr<ASMOperand> base,
+LoadGlobalInstruction::LoadGlobalInstruction(ASMOperand dst, ASMOperand base,
                                              const std::string& symbol)
-    : dst_(dst), base_(base), symbol_(symbol) {}
+    : InstructionOperands(dst, base), symbol_(symbol) {}
 
 std::string LoadGlobalInstruction::ToString() const {
-    return "ldr " + dst_->ToString() + ", [" + base_->ToString() + ", " + symbol_ +
+    const auto& [dst, base] = operands_;
+    return "ldr " + dst.ToString() + ", [" + base.ToString() + ", " + symbol_ +
            "@PAGEOFF]";
 }
 
-std::vector<std::shared_ptr<ASMOperand>> LoadGlobalInstruction::GetOperands() const {
-    return {dst_, base_};
-}
-
-void LoadGlobalInstruction::SetOperands(
-    const std::vector<std::shared_ptr<ASMOperand>>& ops) {
-    assert(ops.size() == 2);
-    dst_ = ops[0];
-    base_ = ops[1];
-}
-
 ///////////////////////////////////////////////
 
-StoreGlobalInstruction::StoreGlobalInstruction(std::shared_ptr<ASMOperand> src,
-                                               std::shared_ptr<ASMOperand> base,
+StoreGlobalInstruction::StoreGlobalInstruction(ASMOperand src, ASMOperand base,
                                                const std::string& symbol)
-    : src_(src), base_(base), symbol_(symbol) {}
+    : InstructionOperands(src, base), symbol_(symbol) {}
 
 std::string StoreGlobalInstruction::ToString() const {
-    return "str " + src_->ToString() + ", [" + base_->ToString() + ", " + symbol_ +
+    const auto& [src, base] = operands_;
+    return "str " + src.ToString() + ", [" + base.ToString() + ", " + symbol_ +
            "@PAGEOFF]";
 }
-
-std::vector<std::shared_ptr<ASMOperand>> StoreGlobalInstruction::GetOperands() const {
-    return {src_, base_};
-}
-
-void StoreGlobalInstruction::SetOperands(
-    const std::vector<std::shared_ptr<ASMOperand>>& ops) {
-    assert(ops.size() == 2);
-    src_ = ops[0];
-    base_ = ops[1];
-}
-
-///////////////////////////////////////////////
\ No newline at end of file
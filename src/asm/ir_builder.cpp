@@ -1,10 +1,12 @@
 #include "include/asm/ir_builder.h"
 
+#include <bit>
 #include <cstdlib>
 #include <iostream>
-#include <memory>
+#include <unordered_map>
 
 #include "include/asm/instructions.h"
+#include "include/asm/liveness.h"
 #include "include/asm/operands.h"
 #include "include/tac/instruction.h"
 #include "include/types/function_type.h"
@@ -25,25 +27,56 @@ void LinearIRBuilder::Build() {
             stack_allocator_.PushFrame();
         }
 
-        for (const auto& instruction : instructions) {
-            LowerInstruction(instruction);
+        auto use_counts = CountOperandUses(instructions);
+        auto branch_uses = CountCompareBranchUses(instructions);
+        for (size_t index = 0; index < instructions.size(); ++index) {
+            bool fused =
+                TryFoldExtendIntoOperand(instructions, index, use_counts) ||
+                TryFuseCompareAndBranch(instructions, index, use_counts, branch_uses) ||
+                (fp_contract_ && TryContractMultiplyAdd(instructions, index, use_counts));
+            if (fused) {
+                ++index;
+                continue;
+            }
+            LowerInstruction(instructions[index]);
         }
         if (is_function) {
-            AddFunctionEpilogue();
+            if (!in_cold_part_) {
+                AddFunctionEpilogue();
+            }
+            in_cold_part_ = false;
+            for (auto& table : jump_tables_) {
+                Emit(std::move(table));
+            }
+            jump_tables_.clear();
+            stack_allocator_.AssignSharedSlots(
+                ComputeStackSlotIntervals(asm_instructions_.back()));
             ResolveOperands();
             ChangeStackSize();
             optimizer_.Optimize(asm_instructions_.back());
             stack_allocator_.PopFrame();
         }
     }
+    EmitLiteralPool();
+}
+
+void LinearIRBuilder::EnableFPContraction(bool enable) { fp_contract_ = enable; }
+
+void LinearIRBuilder::Print(OutputBuffer& out) const {
+    for (const auto& instructions : asm_instructions_) {
+        for (const auto& instruction : instructions) {
+            instruction.Write(out);
+            out << '\n';
+        }
+        out << '\n';
+    }
 }
 
-void LinearIRBuilder::Print(std::ostream& out) const {
+void LinearIRBuilder::Assemble(Assembler& out) const {
     for (const auto& instructions : asm_instructions_) {
         for (const auto& instruction : instructions) {
-            out << instruction->ToString() << std::endl;
+            instruction.Encode(out);
         }
-        out << std::endl;
     }
 }
 
@@ -84,6 +117,8 @@ void LinearIRBuilder::LowerInstruction(const TACInstruction& instr) {
         case Op::IfFalse:
         case Op::GoTo:
             return LowerBranch(instr);
+        case Op::JumpTable:
+            return LowerJumpTable(instr);
 
         case Op::Return:
         case Op::Label:
@@ -101,6 +136,16 @@ void LinearIRBuilder::LowerInstruction(const TACInstruction& instr) {
             return LowerExtend(instr, false);
         case Op::Truncate:
             return LowerTruncate(instr);
+        case Op::DoubleToInt:
+        case Op::DoubleToUInt:
+        case Op::IntToDouble:
+        case Op::UIntToDouble:
+            return LowerConvert(instr);
+        case Op::CountLeadingZeros:
+        case Op::CountTrailingZeros:
+        case Op::PopCount:
+        case Op::ByteSwap:
+            return LowerBitOp(instr);
 
         case Op::StaticVariable:
             return LowerStaticVariable(instr);
@@ -111,45 +156,48 @@ void LinearIRBuilder::LowerInstruction(const TACInstruction& instr) {
 }
 
 void LinearIRBuilder::ResolveOperands() {
-    std::vector<std::shared_ptr<ASMInstruction>> new_instructions;
+    std::vector<ASMInstruction> new_instructions;
+    new_instructions.reserve(asm_instructions_.back().size());
 
-    auto base = std::make_shared<Register>("x29");
-    std::vector<std::shared_ptr<Register>> temps;
+    auto base = Register::Get("x29");
+    std::vector<Register> temps;
+    std::vector<ASMInstruction> before;
+    std::vector<ASMInstruction> after;
     for (auto& instr : asm_instructions_.back()) {
-        auto operands = instr->GetOperands();
-        std::vector<std::shared_ptr<ASMInstruction>> before;
-        std::vector<std::shared_ptr<ASMInstruction>> after;
+        auto operands = instr.GetOperands();
+        before.clear();
+        after.clear();
 
-        bool isLoad = dynamic_cast<LoadInstruction*>(instr.get()) != nullptr;
-        bool isStore = dynamic_cast<StoreInstruction*>(instr.get()) != nullptr;
+        bool isLoad = InstructionCast<LoadInstruction>(&instr) != nullptr;
+        bool isStore = InstructionCast<StoreInstruction>(&instr) != nullptr;
 
         for (size_t index = 0; index < operands.size(); ++index) {
-            if (auto pseudo = std::dynamic_pointer_cast<Pseudo>(operands[index])) {
+            if (const auto* pseudo = OperandCast<Pseudo>(operands[index])) {
                 auto size = pseudo->GetSize();
                 int offset = stack_allocator_.GetLocalOffset(pseudo->GetName(),
                                                              static_cast<int>(size));
-                operands[index] = std::make_shared<MemoryOperand>(base, offset, size);
-            } else if (auto data_op =
-                           std::dynamic_pointer_cast<DataOperand>(operands[index])) {
+                operands[index] =
+                    MemoryOperand(base, offset, size, MemoryOperand::Mode::Offset,
+                                  pseudo->IsFloatingPoint());
+            } else if (const auto* data_op = OperandCast<DataOperand>(operands[index])) {
                 auto size = data_op->GetSize();
-                std::string symbol = "_" + data_op->GetName();
+                bool is_floating_point = data_op->IsFloatingPoint();
+                std::string symbol = "_" + data_op->GetName().Str();
 
                 auto addr_reg = reg_allocator_.Allocate(ASMOperand::Size::Byte8);
                 temps.push_back(addr_reg);
 
-                before.push_back(std::make_shared<AdrpInstruction>(addr_reg, symbol));
+                before.push_back(AdrpInstruction(addr_reg, symbol));
 
                 bool is_dst = (index == 0 && !IsPureInputInstruction(instr));
 
-                auto value_reg = reg_allocator_.Allocate(size);
+                auto value_reg = reg_allocator_.Allocate(size, is_floating_point);
                 temps.push_back(value_reg);
 
                 if (is_dst) {
-                    after.push_back(std::make_shared<StoreGlobalInstruction>(
-                        value_reg, addr_reg, symbol));
+                    after.push_back(StoreGlobalInstruction(value_reg, addr_reg, symbol));
                 } else {
-                    before.push_back(std::make_shared<LoadGlobalInstruction>(
-                        value_reg, addr_reg, symbol));
+                    before.push_back(LoadGlobalInstruction(value_reg, addr_reg, symbol));
                 }
                 operands[index] = value_reg;
             }
@@ -161,21 +209,20 @@ void LinearIRBuilder::ResolveOperands() {
 
         ASMOperand::Size target_size = ASMOperand::Size::Byte4;
         for (const auto& op : operands) {
-            if (!std::dynamic_pointer_cast<Immediate>(op)) {
-                target_size = max_size(target_size, op->GetSize());
+            if (!OperandCast<Immediate>(op)) {
+                target_size = max_size(target_size, op.GetSize());
             }
         }
         for (const auto& op : operands) {
-            if (auto imm = std::dynamic_pointer_cast<Immediate>(op)) {
+            if (const auto* imm = OperandCast<Immediate>(op)) {
                 target_size = max_size(target_size, imm->GetSize());
             }
         }
 
         for (size_t index = 0; index < operands.size(); ++index) {
-            auto memory = std::dynamic_pointer_cast<MemoryOperand>(operands[index]);
-            auto immediate = std::dynamic_pointer_cast<Immediate>(operands[index]);
-            if (memory) {
-                if (memory->GetMode() == MemoryOperand::Mode::Offset) {
+            if (const auto* memory_op = OperandCast<MemoryOperand>(operands[index])) {
+                auto memory = *memory_op;
+                if (memory.GetMode() == MemoryOperand::Mode::Offset) {
                     memory = MaterializeLargeStackOffset(memory, before, temps);
                     operands[index] = memory;
                 }
@@ -188,16 +235,16 @@ void LinearIRBuilder::ResolveOperands() {
                     continue;
                 }
 
-                auto size = memory->GetSize();
-                auto reg = reg_allocator_.Allocate(size);
+                auto size = memory.GetSize();
+                auto reg = reg_allocator_.Allocate(size, memory.IsFloatingPoint());
                 temps.push_back(reg);
 
                 if (isStore) {
-                    before.push_back(std::make_shared<LoadInstruction>(reg, memory));
+                    before.push_back(LoadInstruction(reg, memory));
                     operands[index] = reg;
                     continue;
                 } else if (isLoad) {
-                    after.push_back(std::make_shared<StoreInstruction>(reg, memory));
+                    after.push_back(StoreInstruction(reg, memory));
                     operands[index] = reg;
                     continue;
                 }
@@ -205,26 +252,67 @@ void LinearIRBuilder::ResolveOperands() {
                 bool is_dst = (index == 0 &&
                                !IsPureInputInstruction(instr));  // convention: dst first
                 if (is_dst) {
-                    after.push_back(std::make_shared<StoreInstruction>(reg, memory));
+                    after.push_back(StoreInstruction(reg, memory));
+                } else {
+                    before.push_back(LoadInstruction(reg, memory));
+                }
+                operands[index] = reg;
+                continue;
+            }
+
+            const auto* immediate_op = OperandCast<Immediate>(operands[index]);
+            if (!immediate_op) {
+                continue;
+            }
+            auto immediate = *immediate_op;
+            if (immediate.IsFloatingPoint()) {
+                double number = immediate.GetValue().AsDouble();
+                if (number == 0.0 &&
+                    InstructionCast<CompareInstruction>(&instr) != nullptr) {
+                    continue;  // fcmp dN, #0.0
+                }
+                auto reg = reg_allocator_.Allocate(ASMOperand::Size::Byte8, true);
+                temps.push_back(reg);
+
+                auto bits = std::bit_cast<uint64_t>(number);
+                if (bits == 0) {
+                    auto xzr = Register::Get("xzr");
+                    before.push_back(MovInstruction(reg, xzr));
+                } else if (CanEncodeFloatImm8(number)) {
+                    before.push_back(MovInstruction(reg, immediate));
                 } else {
-                    before.push_back(std::make_shared<LoadInstruction>(reg, memory));
+                    auto bits_reg = reg_allocator_.Allocate(ASMOperand::Size::Byte8);
+                    temps.push_back(bits_reg);
+
+                    auto load_seq = MakeLoadImmediateInstrs(
+                        bits_reg, static_cast<unsigned long>(bits));
+                    if (load_seq.size() == 1) {
+                        load_seq.push_back(MovInstruction(reg, bits_reg));
+                    } else {
+                        load_seq = MakeLoadLiteralInstrs(reg, bits_reg, bits);
+                    }
+                    before.insert(before.end(), load_seq.begin(), load_seq.end());
                 }
                 operands[index] = reg;
-            } else if (immediate) {
-                auto value = immediate->GetValue();
-                auto size = max_size(target_size, immediate->GetSize());
+            } else {
+                auto value = immediate.GetValue();
+                auto size = max_size(target_size, immediate.GetSize());
                 auto reg = reg_allocator_.Allocate(size);
                 temps.push_back(reg);
 
                 auto load_seq = MakeLoadImmediateInstrs(reg, value);
+                if (load_seq.size() > 2) {
+                    auto bits = value.IsSigned() ? static_cast<uint64_t>(value.AsInt64())
+                                                 : value.AsUInt64();
+                    load_seq = MakeLoadLiteralInstrs(reg, reg, bits);
+                }
                 before.insert(before.end(), load_seq.begin(), load_seq.end());
                 operands[index] = reg;
             }
         }
-        instr->SetOperands(operands);
 
         new_instructions.insert(new_instructions.end(), before.begin(), before.end());
-        new_instructions.push_back(instr);
+        new_instructions.push_back(std::move(instr));
         new_instructions.insert(new_instructions.end(), after.begin(), after.end());
 
         while (!temps.empty()) {
@@ -236,46 +324,52 @@ void LinearIRBuilder::ResolveOperands() {
     asm_instructions_.back() = std::move(new_instructions);
 }
 
-std::shared_ptr<MemoryOperand> LinearIRBuilder::MaterializeLargeStackOffset(
-    const std::shared_ptr<MemoryOperand>& memory,
-    std::vector<std::shared_ptr<ASMInstruction>>& before,
-    std::vector<std::shared_ptr<Register>>& temps) {
-    if (CanEncodeUnscaledImm9(memory->GetOffset())) {
+MemoryOperand LinearIRBuilder::MaterializeLargeStackOffset(
+    const MemoryOperand& memory, std::vector<ASMInstruction>& before,
+    std::vector<Register>& temps) {
+    if (CanEncodeUnscaledImm9(memory.GetOffset())) {
         return memory;
     }
 
     auto addr_reg = reg_allocator_.Allocate(ASMOperand::Size::Byte8);
     temps.push_back(addr_reg);
 
-    auto imm_reg = reg_allocator_.Allocate(ASMOperand::Size::Byte8);
-    temps.push_back(imm_reg);
-
-    before.push_back(std::make_shared<MovInstruction>(addr_reg, memory->GetBase()));
-
-    const int offset = memory->GetOffset();
+    const int offset = memory.GetOffset();
     const auto abs_offset = static_cast<unsigned long>(std::llabs((long long)offset));
-    auto load_seq = MakeLoadImmediateInstrs(imm_reg, abs_offset);
-    before.insert(before.end(), load_seq.begin(), load_seq.end());
-
-    if (offset < 0) {
+    const auto op = offset < 0 ? BinaryOp::Sub : BinaryOp::Add;
+    if (CanEncodeArithmeticImm12(abs_offset)) {
         before.push_back(
-            std::make_shared<BinaryInstruction>(BinaryOp::Sub, addr_reg, addr_reg, imm_reg));
+            BinaryInstruction(op, addr_reg, memory.GetBase(), Immediate(abs_offset)));
     } else {
-        before.push_back(
-            std::make_shared<BinaryInstruction>(BinaryOp::Add, addr_reg, addr_reg, imm_reg));
+        auto load_seq = MakeLoadImmediateInstrs(addr_reg, abs_offset);
+        before.insert(before.end(), load_seq.begin(), load_seq.end());
+        before.push_back(BinaryInstruction(op, addr_reg, memory.GetBase(), addr_reg));
     }
 
-    return std::make_shared<MemoryOperand>(addr_reg, 0, memory->GetSize());
+    return MemoryOperand(addr_reg, 0, memory.GetSize(), MemoryOperand::Mode::Offset,
+                         memory.IsFloatingPoint());
 }
 
 bool LinearIRBuilder::CanEncodeUnscaledImm9(int offset) const {
     return offset >= -256 && offset <= 255;
 }
 
+bool LinearIRBuilder::CanEncodeArithmeticImm12(unsigned long value) const {
+    return value <= 4095;
+}
+
+// fmov (immediate) takes +-(16..31)/16 * 2^(-3..4): only the top four mantissa bits
+// may be set and the unbiased exponent must lie in [-3, 4].
+bool LinearIRBuilder::CanEncodeFloatImm8(double value) const {
+    auto bits = std::bit_cast<uint64_t>(value);
+    auto exponent = (bits >> 52) & 0x7FF;
+    return (bits & 0xFFFFFFFFFFFFull) == 0 && exponent >= 0x3FC && exponent <= 0x403;
+}
+
 void LinearIRBuilder::LowerAssign(const TACInstruction& instr) {
     auto dst = MakeOperand(instr.GetDst());
     auto lhs = MakeOperand(instr.GetLhs());
-    Emit(std::make_shared<MovInstruction>(dst, lhs));
+    Emit(MovInstruction(dst, lhs));
 }
 
 void LinearIRBuilder::LowerUnaryOp(const TACInstruction& instr) {
@@ -284,15 +378,15 @@ void LinearIRBuilder::LowerUnaryOp(const TACInstruction& instr) {
 
     UnaryOp op;
     if (instr.GetOp() == TACInstruction::OpCode::Plus) {
-        Emit(std::make_shared<MovInstruction>(dst, lhs));
+        Emit(MovInstruction(dst, lhs));
     } else if (instr.GetOp() == TACInstruction::OpCode::Minus) {
-        Emit(std::make_shared<UnaryInstruction>(UnaryOp::Neg, dst, lhs));
+        op = lhs.IsFloatingPoint() ? UnaryOp::FNeg : UnaryOp::Neg;
+        Emit(UnaryInstruction(op, dst, lhs));
     } else if (instr.GetOp() == TACInstruction::OpCode::BinaryNot) {
-        Emit(std::make_shared<UnaryInstruction>(UnaryOp::Mvn, dst, lhs));
+        Emit(UnaryInstruction(UnaryOp::Mvn, dst, lhs));
     } else if (instr.GetOp() == TACInstruction::OpCode::Not) {
-        auto zero = MakeOperand(TACOperand(NumericConstant(0)));
-        Emit(std::make_shared<CompareInstruction>(lhs, zero));
-        Emit(std::make_shared<CSetInstruction>(dst, Condition::Eq));
+        Emit(CompareInstruction(lhs, MakeZeroOperand(lhs)));
+        Emit(CSetInstruction(dst, Condition::Eq));
     } else {
         throw std::runtime_error("Unknown binary operation");
     }
@@ -302,7 +396,7 @@ bool LinearIRBuilder::IsSignedOperand(const TACOperand& operand) const {
     if (operand.IsConstant()) {
         return operand.AsConstant().IsSigned();
     }
-    return symbol_table_.FindByUniqueName(operand.AsIdentifier())->type->IsSigned();
+    return symbol_table_.FindByUniqueName(operand.AsName())->type->IsSigned();
 }
 
 void LinearIRBuilder::LowerBinaryOp(const TACInstruction& instr) {
@@ -313,7 +407,9 @@ void LinearIRBuilder::LowerBinaryOp(const TACInstruction& instr) {
     bool is_signed = IsSignedOperand(instr.GetDst());
 
     BinaryOp op;
-    if (instr.GetOp() == TACInstruction::OpCode::Add) {
+    if (dst.IsFloatingPoint()) {
+        op = GetFloatingPointOp(instr.GetOp());
+    } else if (instr.GetOp() == TACInstruction::OpCode::Add) {
         op = BinaryOp::Add;
     } else if (instr.GetOp() == TACInstruction::OpCode::Sub) {
         op = BinaryOp::Sub;
@@ -335,7 +431,7 @@ void LinearIRBuilder::LowerBinaryOp(const TACInstruction& instr) {
         throw std::runtime_error("Unknown binary operation");
     }
 
-    Emit(std::make_shared<BinaryInstruction>(op, dst, lhs, rhs));
+    Emit(BinaryInstruction(op, dst, lhs, rhs));
 }
 
 void LinearIRBuilder::LowerMod(const TACInstruction& instr) {
@@ -346,49 +442,80 @@ void LinearIRBuilder::LowerMod(const TACInstruction& instr) {
     bool is_signed = IsSignedOperand(instr.GetDst());
     auto div_op = is_signed ? BinaryOp::SDiv : BinaryOp::UDiv;
 
-    auto size = dst->GetSize();
-    std::string reg_prefix = (size == ASMOperand::Size::Byte8) ? "x" : "w";
-    auto temp = std::make_shared<Register>(reg_prefix + "1");
+    auto size = dst.GetSize();
+    auto temp = Register::Get(1, size, false);
 
-    Emit(std::make_shared<BinaryInstruction>(div_op, temp, lhs, rhs));
-    Emit(std::make_shared<BinaryInstruction>(BinaryOp::Mul, temp, temp, rhs));
-    Emit(std::make_shared<BinaryInstruction>(BinaryOp::Sub, dst, lhs, temp));
+    Emit(BinaryInstruction(div_op, temp, lhs, rhs));
+    Emit(BinaryInstruction(BinaryOp::Mul, temp, temp, rhs));
+    Emit(BinaryInstruction(BinaryOp::Sub, dst, lhs, temp));
 }
 
 void LinearIRBuilder::LowerComparison(const TACInstruction& instr) {
     auto dst = MakeOperand(instr.GetDst());
+    Condition cond = EmitCompare(instr);
+    Emit(CSetInstruction(dst, cond));
+}
+
+// Emits the cmp or fcmp of a comparison and returns the condition under which it holds.
+Condition LinearIRBuilder::EmitCompare(const TACInstruction& instr) {
     auto lhs = MakeOperand(instr.GetLhs());
     auto rhs = MakeOperand(instr.GetRhs());
 
-    Emit(std::make_shared<CompareInstruction>(lhs, rhs));
+    Emit(CompareInstruction(lhs, rhs));
 
     bool is_signed = IsSignedOperand(instr.GetLhs());
+    bool is_floating_point = lhs.IsFloatingPoint();
 
-    Condition cond;
     switch (instr.GetOp()) {
         case TACInstruction::OpCode::Less:
-            cond = is_signed ? Condition::Lt : Condition::Lo;
-            break;
+            if (is_floating_point) {
+                return Condition::Mi;
+            }
+            return is_signed ? Condition::Lt : Condition::Lo;
         case TACInstruction::OpCode::LessEqual:
-            cond = is_signed ? Condition::Le : Condition::Ls;
-            break;
+            return is_signed && !is_floating_point ? Condition::Le : Condition::Ls;
         case TACInstruction::OpCode::Greater:
-            cond = is_signed ? Condition::Gt : Condition::Hi;
-            break;
+            return is_signed || is_floating_point ? Condition::Gt : Condition::Hi;
         case TACInstruction::OpCode::GreaterEqual:
-            cond = is_signed ? Condition::Ge : Condition::Hs;
-            break;
+            return is_signed || is_floating_point ? Condition::Ge : Condition::Hs;
         case TACInstruction::OpCode::Equal:
-            cond = Condition::Eq;
-            break;
+            return Condition::Eq;
         case TACInstruction::OpCode::NotEqual:
-            cond = Condition::Ne;
-            break;
+            return Condition::Ne;
         default:
             throw std::runtime_error("Unknown comparison opcode");
     }
+}
 
-    Emit(std::make_shared<CSetInstruction>(dst, cond));
+// The condition that holds exactly when cond does not, after a cmp or fcmp. An
+// unordered fcmp sets C and V, so the inverse of the floating-point Mi is Hs and the
+// other inverses also hold for NaNs.
+Condition LinearIRBuilder::InvertCondition(Condition cond) {
+    switch (cond) {
+        case Condition::Eq:
+            return Condition::Ne;
+        case Condition::Ne:
+            return Condition::Eq;
+        case Condition::Lt:
+            return Condition::Ge;
+        case Condition::Ge:
+            return Condition::Lt;
+        case Condition::Le:
+            return Condition::Gt;
+        case Condition::Gt:
+            return Condition::Le;
+        case Condition::Lo:
+            return Condition::Hs;
+        case Condition::Hs:
+            return Condition::Lo;
+        case Condition::Ls:
+            return Condition::Hi;
+        case Condition::Hi:
+            return Condition::Ls;
+        case Condition::Mi:
+            return Condition::Hs;
+    }
+    throw std::runtime_error("Unknown condition");
 }
 
 void LinearIRBuilder::LowerBranch(const TACInstruction& instr) {
@@ -409,26 +536,50 @@ void LinearIRBuilder::LowerBranch(const TACInstruction& instr) {
 
     if (instr.GetOp() != TACInstruction::OpCode::GoTo) {
         auto cond_operand = MakeOperand(instr.GetLhs());
-        auto zero = MakeOperand(TACOperand(NumericConstant(0)));
-        Emit(std::make_shared<CompareInstruction>(cond_operand, zero));
+        Emit(CompareInstruction(cond_operand, MakeZeroOperand(cond_operand)));
     }
 
-    Emit(std::make_shared<BranchInstruction>(type, instr.GetLabel(), cond));
+    Emit(BranchInstruction(type, instr.GetLabel(), cond));
+}
+
+// The index is already range checked, so dispatch is a load of the target's offset from
+// the table and an indirect branch. The table itself goes after the function body.
+void LinearIRBuilder::LowerJumpTable(const TACInstruction& instr) {
+    auto table = Register::Get("x16");
+    auto offset = Register::Get("x17");
+    std::string label = "lJTI" + std::to_string(jump_table_count_++);
+
+    Emit(AdrInstruction(table, label));
+    Emit(LoadIndexedInstruction(offset, table, MakeOperand(instr.GetLhs()), 2, true));
+    Emit(BinaryInstruction(BinaryOp::Add, table, table, offset));
+    Emit(IndirectBranchInstruction(table, instr.GetTargets()));
+    jump_tables_.push_back(JumpTableDirective(label, instr.GetTargets()));
 }
 
 void LinearIRBuilder::LowerControl(const TACInstruction& instr) {
     switch (instr.GetOp()) {
-        case TACInstruction::OpCode::Label:
-            Emit(std::make_shared<LabelInstruction>(instr.GetLabel()));
+        case TACInstruction::OpCode::Label: {
+            // The cold part follows the epilogue in a section of its own, under a
+            // symbol of its own for profilers and debuggers.
+            if (instr.StartsColdPart()) {
+                AddFunctionEpilogue();
+                Emit(ColdTextSectionDirective());
+                Emit(LabelInstruction("_" + current_function_name_ + ".cold"));
+                in_cold_part_ = true;
+            }
+            int alignment = instr.GetLhs().IsConstant()
+                                ? static_cast<int>(instr.GetLhs().AsConstant().AsInt64())
+                                : 0;
+            Emit(LabelInstruction(instr.GetLabel(), alignment));
             break;
+        }
         case TACInstruction::OpCode::Return:
             if (!instr.GetLhs().Empty()) {
                 auto value = MakeOperand(instr.GetLhs());
                 auto ret_reg = GetReturnRegister();
-                Emit(std::make_shared<MovInstruction>(ret_reg, value));
+                Emit(MovInstruction(ret_reg, value));
             }
-            Emit(std::make_shared<BranchInstruction>(BranchType::Unconditional,
-                                                     GetCurrentExitLabel()));
+            Emit(BranchInstruction(BranchType::Unconditional, GetCurrentExitLabel()));
             break;
         default:
             throw std::runtime_error("Unknown control opcode");
@@ -438,12 +589,15 @@ void LinearIRBuilder::LowerControl(const TACInstruction& instr) {
 void LinearIRBuilder::LowerFunction(const TACInstruction& instr) {
     current_function_name_ = instr.GetDst().AsIdentifier();
     std::string asm_name = "_" + current_function_name_;
-    Emit(std::make_shared<TextSectionDirective>());
+    Emit(TextSectionDirective());
     bool is_global = instr.GetRhs().AsConstant().AsInt64() == 1;
     if (is_global) {
-        Emit(std::make_shared<GlobalDirective>(asm_name));
+        Emit(GlobalDirective(asm_name));
     }
-    Emit(std::make_shared<LabelInstruction>(asm_name));
+    // Hot functions start on a 16-byte boundary, like hot loops.
+    const auto* info = symbol_table_.FindByUniqueName(current_function_name_);
+    bool is_hot = info && info->attributes.hotness == FunctionAttributes::Hotness::Hot;
+    Emit(LabelInstruction(asm_name, is_hot ? 4 : 0));
     AddFunctionPrologue();
 
     current_param_count_ = static_cast<int>(instr.GetLhs().AsConstant().AsInt64());
@@ -457,42 +611,41 @@ void LinearIRBuilder::LowerParam(const TACInstruction& instr) {
 
 void LinearIRBuilder::LowerCall(const TACInstruction& instr) {
     SaveCallerRegisters();
-    int index = 0;
-    while (!pending_args_.empty() && index < 8) {
+    std::vector<ASMOperand> stack_args;
+    int gp_index = 0;
+    int fp_index = 0;
+    while (!pending_args_.empty()) {
         auto arg = pending_args_.front();
         pending_args_.pop();
 
-        auto size = arg->GetSize();
-        std::string reg_prefix = (size == ASMOperand::Size::Byte8) ? "x" : "w";
-        auto dst = std::make_shared<Register>(reg_prefix + std::to_string(index));
-        Emit(std::make_shared<MovInstruction>(dst, arg));
-        ++index;
+        auto reg = NextArgumentRegister(arg.GetSize(), arg.IsFloatingPoint(), gp_index,
+                                        fp_index);
+        if (!reg) {
+            stack_args.push_back(arg);
+            continue;
+        }
+        Emit(MovInstruction(*reg, arg));
     }
-    int stack_args_size = stack_allocator_.ReserveStackArguments(pending_args_.size());
+    int stack_args_size = stack_allocator_.ReserveStackArguments(stack_args.size());
 
-    auto sp = std::make_shared<Register>("sp");
-    Emit(std::make_shared<AllocateStackInstruction>(
-        std::make_shared<Immediate>(stack_args_size), true));
-    int pending_args_size = pending_args_.size();
-    for (size_t idx = 0; idx < pending_args_size; ++idx) {
-        auto arg = pending_args_.front();
-        auto size = arg->GetSize();
+    auto sp = Register::Get("sp");
+    Emit(AllocateStackInstruction(Immediate(stack_args_size), true));
+    for (size_t idx = 0; idx < stack_args.size(); ++idx) {
+        const auto& arg = stack_args[idx];
+        auto size = arg.GetSize();
         int offset =
             stack_allocator_.GetArgumentOffsetForCaller(idx, static_cast<int>(size));
-        auto mem = std::make_shared<MemoryOperand>(sp, offset, size);
-        Emit(std::make_shared<StoreInstruction>(arg, mem));
-        pending_args_.pop();
+        auto mem = MemoryOperand(sp, offset, size);
+        Emit(StoreInstruction(arg, mem));
     }
     std::string call_name = "_" + instr.GetLhs().AsIdentifier();
-    Emit(std::make_shared<BranchInstruction>(BranchType::Call, call_name));
-    Emit(std::make_shared<DeallocateStackInstruction>(
-        std::make_shared<Immediate>(stack_args_size), true));
+    Emit(BranchInstruction(BranchType::Call, call_name));
+    Emit(DeallocateStackInstruction(Immediate(stack_args_size), true));
     if (!instr.GetDst().Empty()) {
         auto dst = MakeOperand(instr.GetDst());
-        auto size = dst->GetSize();
-        std::string reg_prefix = (size == ASMOperand::Size::Byte8) ? "x" : "w";
-        auto ret_reg = std::make_shared<Register>(reg_prefix + "0");
-        Emit(std::make_shared<MovInstruction>(dst, ret_reg));
+        auto size = dst.GetSize();
+        auto ret_reg = Register::Get(0, size, dst.IsFloatingPoint());
+        Emit(MovInstruction(dst, ret_reg));
     }
     LoadCallerRegisters();
 }
@@ -501,12 +654,15 @@ void LinearIRBuilder::MaterializeFormalParameters() {
     std::vector<TypeRef> param_types;
     std::string func_name = current_function_name_;
     if (auto* info = symbol_table_.FindByUniqueName(func_name)) {
-        if (auto func_type = std::dynamic_pointer_cast<FunctionType>(info->type)) {
+        if (auto func_type = dynamic_cast<const FunctionType*>(info->type)) {
             param_types = func_type->GetParamTypes();
         }
     }
 
-    auto x29 = std::make_shared<Register>("x29");
+    auto x29 = Register::Get("x29");
+    int gp_index = 0;
+    int fp_index = 0;
+    int stack_index = 0;
     for (int index = 0; index < current_param_count_; ++index) {
         TypeRef param_type = nullptr;
         if (index < static_cast<int>(param_types.size())) {
@@ -514,184 +670,487 @@ void LinearIRBuilder::MaterializeFormalParameters() {
         }
 
         auto size = ASMOperand::Size::Byte4;
+        bool is_floating_point = false;
         if (param_type) {
             size = static_cast<ASMOperand::Size>(param_type->Size());
+            is_floating_point = param_type->IsFloatingPoint();
         }
 
         std::string arg_name = "arg.." + std::to_string(index);
         symbol_table_.Register(
             {.name = arg_name, .original_name = arg_name, .type = param_type});
 
-        auto dstPseudo = std::make_shared<Pseudo>(arg_name, size);
-        if (index < 8) {
-            std::string reg_prefix = (size == ASMOperand::Size::Byte8) ? "x" : "w";
-            auto reg = std::make_shared<Register>(reg_prefix + std::to_string(index));
-            Emit(std::make_shared<MovInstruction>(dstPseudo, reg));
+        auto dstPseudo = Pseudo(arg_name, size, is_floating_point);
+        auto reg = NextArgumentRegister(size, is_floating_point, gp_index, fp_index);
+        if (reg) {
+            Emit(MovInstruction(dstPseudo, *reg));
         } else {
-            int incoming_offset = stack_allocator_.GetArgumentOffset(
-                "arg.." + std::to_string(index), static_cast<int>(size));
-            auto mem = std::make_shared<MemoryOperand>(x29, incoming_offset, size);
-            Emit(std::make_shared<LoadInstruction>(dstPseudo, mem));
+            int incoming_offset = stack_allocator_.GetArgumentOffset(stack_index++);
+            auto mem = MemoryOperand(
+                x29, incoming_offset, size, MemoryOperand::Mode::Offset,
+                is_floating_point);
+            Emit(LoadInstruction(dstPseudo, mem));
         }
     }
 }
 
-std::shared_ptr<ASMOperand> LinearIRBuilder::MakeOperand(const TACOperand& value) {
+// AAPCS64: integer arguments go in x0-x7 and floating-point ones in d0-d7, each
+// class counted separately; the rest are passed on the stack in order.
+std::optional<Register> LinearIRBuilder::NextArgumentRegister(ASMOperand::Size size,
+                                                              bool is_floating_point,
+                                                              int& gp_index,
+                                                              int& fp_index) const {
+    int& index = is_floating_point ? fp_index : gp_index;
+    if (index >= 8) {
+        return std::nullopt;
+    }
+    return Register::Get(index++, size, is_floating_point);
+}
+
+ASMOperand LinearIRBuilder::MakeOperand(const TACOperand& value) {
     if (value.IsConstant()) {
-        return std::make_shared<Immediate>(value.AsConstant());
+        return Immediate(value.AsConstant());
     }
 
-    const std::string& identifier = value.AsIdentifier();
-    if (auto* info = symbol_table_.FindByUniqueName(identifier)) {
+    InternedString name = value.AsName();
+    if (auto* info = symbol_table_.FindByUniqueName(name)) {
         if (info->type) {
             auto size = static_cast<ASMOperand::Size>(info->type->Size());
+            bool is_floating_point = info->type->IsFloatingPoint();
             if (info->HasStaticDuration()) {
-                return std::make_shared<DataOperand>(identifier, size);
+                return DataOperand(name, size, is_floating_point);
             }
-            return std::make_shared<Pseudo>(identifier, size);
+            return Pseudo(name, size, is_floating_point);
         }
     }
     throw std::runtime_error("Unknown operand: " + value.ToString());
 }
 
-void LinearIRBuilder::Emit(std::shared_ptr<ASMInstruction> instr) {
+ASMOperand LinearIRBuilder::MakeZeroOperand(const ASMOperand& operand) {
+    if (operand.IsFloatingPoint()) {
+        return Immediate(0.0);
+    }
+    return Immediate(0);
+}
+
+void LinearIRBuilder::Emit(ASMInstruction instr) {
     asm_instructions_.back().push_back(std::move(instr));
 }
 
 void LinearIRBuilder::AddFunctionPrologue() {
     int temp_stack_size = 0;
-    auto sp = std::make_shared<Register>("sp");
-    auto x29 = std::make_shared<Register>("x29");
-    auto x30 = std::make_shared<Register>("x30");
+    auto sp = Register::Get("sp");
+    auto x29 = Register::Get("x29");
+    auto x30 = Register::Get("x30");
 
-    asm_instructions_.back().push_back(std::make_shared<StorePairInstruction>(
+    asm_instructions_.back().push_back(StorePairInstruction(
         x29, x30,
-        std::make_shared<MemoryOperand>(sp, -16, ASMOperand::Size::Byte8,
-                                        MemoryOperand::Mode::PreIndexed)));
+        MemoryOperand(sp, -16, ASMOperand::Size::Byte8,
+                      MemoryOperand::Mode::PreIndexed)));
 
-    asm_instructions_.back().push_back(std::make_shared<MovInstruction>(x29, sp));
+    asm_instructions_.back().push_back(MovInstruction(x29, sp));
 
-    asm_instructions_.back().push_back(std::make_shared<AllocateStackInstruction>(
-        std::make_shared<Immediate>(temp_stack_size)));
+    asm_instructions_.back().push_back(
+        AllocateStackInstruction(Immediate(temp_stack_size)));
 }
 
 void LinearIRBuilder::AddFunctionEpilogue() {
     auto ret_reg = GetReturnRegister();
-    auto zero = std::make_shared<Immediate>(0);
-    asm_instructions_.back().push_back(std::make_shared<MovInstruction>(ret_reg, zero));
-    asm_instructions_.back().push_back(
-        std::make_shared<LabelInstruction>(GetCurrentExitLabel()));
+    auto zero = MakeZeroOperand(ret_reg);
+    asm_instructions_.back().push_back(MovInstruction(ret_reg, zero));
+    asm_instructions_.back().push_back(LabelInstruction(GetCurrentExitLabel()));
 
-    auto sp = std::make_shared<Register>("sp");
-    auto x29 = std::make_shared<Register>("x29");
-    auto x30 = std::make_shared<Register>("x30");
+    auto sp = Register::Get("sp");
+    auto x29 = Register::Get("x29");
+    auto x30 = Register::Get("x30");
 
-    asm_instructions_.back().push_back(std::make_shared<MovInstruction>(sp, x29));
+    asm_instructions_.back().push_back(MovInstruction(sp, x29));
 
-    asm_instructions_.back().push_back(std::make_shared<LoadPairInstruction>(
+    asm_instructions_.back().push_back(LoadPairInstruction(
         x29, x30,
-        std::make_shared<MemoryOperand>(sp, 16, ASMOperand::Size::Byte8,
-                                        MemoryOperand::Mode::PostIndexed)));
-    asm_instructions_.back().push_back(std::make_shared<RetInstruction>());
+        MemoryOperand(sp, 16, ASMOperand::Size::Byte8,
+                      MemoryOperand::Mode::PostIndexed)));
+    asm_instructions_.back().push_back(RetInstruction());
 }
 
 void LinearIRBuilder::ChangeStackSize() {
     int stack_size = stack_allocator_.GetAlignedFrameSize();
     for (auto& instr : asm_instructions_.back()) {
-        auto allocate = std::dynamic_pointer_cast<AllocateStackInstruction>(instr);
+        auto* allocate = InstructionCast<AllocateStackInstruction>(&instr);
         if (allocate) {
-            allocate->ChangeSize(std::make_shared<Immediate>(stack_size));
+            allocate->ChangeSize(Immediate(stack_size));
         }
-        auto deallocate = std::dynamic_pointer_cast<DeallocateStackInstruction>(instr);
+        auto* deallocate = InstructionCast<DeallocateStackInstruction>(&instr);
         if (deallocate) {
-            deallocate->ChangeSize(std::make_shared<Immediate>(stack_size));
+            deallocate->ChangeSize(Immediate(stack_size));
         }
     }
 }
 
-bool LinearIRBuilder::IsPureInputInstruction(
-    const std::shared_ptr<ASMInstruction>& instr) {
-    return dynamic_cast<CompareInstruction*>(instr.get()) != nullptr ||
-           dynamic_cast<BranchInstruction*>(instr.get()) != nullptr ||
-           dynamic_cast<RetInstruction*>(instr.get()) != nullptr;
+bool LinearIRBuilder::IsPureInputInstruction(const ASMInstruction& instr) {
+    return InstructionCast<CompareInstruction>(&instr) != nullptr ||
+           InstructionCast<BranchInstruction>(&instr) != nullptr ||
+           InstructionCast<RetInstruction>(&instr) != nullptr;
 }
 
 std::string LinearIRBuilder::GetCurrentExitLabel() const {
     return "exit_" + std::to_string(asm_instructions_.size());
 }
 
-std::shared_ptr<Register> LinearIRBuilder::GetReturnRegister() const {
+Register LinearIRBuilder::GetReturnRegister() const {
     std::string func_name = current_function_name_;
     if (auto* info = symbol_table_.FindByUniqueName(func_name)) {
-        if (auto func_type = std::dynamic_pointer_cast<FunctionType>(info->type)) {
+        if (auto func_type = dynamic_cast<const FunctionType*>(info->type)) {
             auto ret_type = func_type->GetReturnType();
+            if (ret_type && ret_type->IsFloatingPoint()) {
+                return Register::Get("d0");
+            }
             if (ret_type && ret_type->Size() == 8) {
-                return std::make_shared<Register>("x0");
+                return Register::Get("x0");
             }
         }
     }
-    return std::make_shared<Register>("w0");
+    return Register::Get("w0");
 }
 
 void LinearIRBuilder::SaveCallerRegisters() const {}
 
 void LinearIRBuilder::LoadCallerRegisters() const {}
 
-// to do: переписать это когда-нибудь
-std::vector<std::shared_ptr<ASMInstruction>> LinearIRBuilder::MakeLoadImmediateInstrs(
-    std::shared_ptr<ASMOperand> dst, const NumericConstant& value) {
-    std::vector<std::shared_ptr<ASMInstruction>> out;
+// Starts from movz when most halfwords are zero and from movn when most are 0xFFFF,
+// then patches the remaining halfwords with movk.
+std::vector<ASMInstruction> LinearIRBuilder::MakeLoadImmediateInstrs(
+    const ASMOperand& dst, const NumericConstant& value) {
+    std::vector<ASMInstruction> out;
     uint64_t raw_value =
         value.IsSigned() ? static_cast<uint64_t>(value.AsInt64()) : value.AsUInt64();
 
     bool is_32bit = false;
-    if (auto reg = std::dynamic_pointer_cast<Register>(dst)) {
-        is_32bit = reg->ToString().starts_with("w");
+    if (const auto* reg = OperandCast<Register>(dst)) {
+        is_32bit = reg->GetSize() == ASMOperand::Size::Byte4;
     }
 
+    const int part_count = is_32bit ? 2 : 4;
     uint16_t parts[4];
-    for (int index = 0; index < 4; ++index) {
+    int zero_parts = 0;
+    int ones_parts = 0;
+    for (int index = 0; index < part_count; ++index) {
         parts[index] = static_cast<uint16_t>((raw_value >> (index * 16)) & 0xFFFFu);
+        zero_parts += parts[index] == 0;
+        ones_parts += parts[index] == 0xFFFF;
     }
-    int first_nonzero = -1;
-    for (int index = 0; index < 4; ++index) {
-        if (parts[index] != 0) {
-            first_nonzero = index;
+
+    const bool use_movn = ones_parts > zero_parts;
+    const uint16_t filler = use_movn ? 0xFFFF : 0;
+    int first = -1;
+    for (int index = 0; index < part_count; ++index) {
+        if (parts[index] != filler) {
+            first = index;
             break;
         }
     }
 
-    if (first_nonzero == -1) {
-        out.push_back(std::make_shared<MovzInstruction>(dst, 0, 0));
+    if (first == -1) {
+        if (use_movn) {
+            out.push_back(MovnInstruction(dst, 0, 0));
+        } else {
+            out.push_back(MovzInstruction(dst, 0, 0));
+        }
         return out;
     }
 
-    int max_shift = is_32bit ? 1 : 3;
-    out.push_back(
-        std::make_shared<MovzInstruction>(dst, parts[first_nonzero], first_nonzero * 16));
-    for (int index = 0; index <= max_shift; ++index) {
-        if (index == first_nonzero) {
-            continue;
-        }
-        if (parts[index] != 0) {
-            out.push_back(
-                std::make_shared<MovkInstruction>(dst, parts[index], index * 16));
+    if (use_movn) {
+        out.push_back(MovnInstruction(
+            dst, static_cast<uint16_t>(~parts[first]), first * 16));
+    } else {
+        out.push_back(MovzInstruction(dst, parts[first], first * 16));
+    }
+    for (int index = first + 1; index < part_count; ++index) {
+        if (parts[index] != filler) {
+            out.push_back(MovkInstruction(dst, parts[index], index * 16));
         }
     }
 
     return out;
 }
 
+// adrp + ldr from the module's literal pool. For an integer constant the destination
+// can double as the address register.
+std::vector<ASMInstruction> LinearIRBuilder::MakeLoadLiteralInstrs(const Register& dst,
+                                                                   const Register& addr,
+                                                                   uint64_t bits) {
+    std::string label = GetLiteralLabel(bits);
+    return {AdrpInstruction(addr, label), LoadGlobalInstruction(dst, addr, label)};
+}
+
+std::string LinearIRBuilder::GetLiteralLabel(uint64_t bits) {
+    auto [it, inserted] = literal_indices_.emplace(bits, literal_pool_.size());
+    if (inserted) {
+        literal_pool_.push_back(bits);
+    }
+    return "lCPI" + std::to_string(it->second);
+}
+
+void LinearIRBuilder::EmitLiteralPool() {
+    if (literal_pool_.empty()) {
+        return;
+    }
+    asm_instructions_.emplace_back();
+    Emit(LiteralSectionDirective());
+    for (size_t index = 0; index < literal_pool_.size(); ++index) {
+        Emit(LiteralDirective("lCPI" + std::to_string(index), literal_pool_[index]));
+    }
+}
+
 void LinearIRBuilder::LowerExtend(const TACInstruction& instr, bool is_signed) {
     auto dst = MakeOperand(instr.GetDst());
     auto src = MakeOperand(instr.GetLhs());
-    Emit(std::make_shared<ExtendInstruction>(dst, src, is_signed));
+    Emit(ExtendInstruction(dst, src, is_signed));
+}
+
+void LinearIRBuilder::LowerConvert(const TACInstruction& instr) {
+    auto dst = MakeOperand(instr.GetDst());
+    auto src = MakeOperand(instr.GetLhs());
+
+    ConvertOp op;
+    switch (instr.GetOp()) {
+        case TACInstruction::OpCode::DoubleToInt:
+            op = ConvertOp::FCvtZS;
+            break;
+        case TACInstruction::OpCode::DoubleToUInt:
+            op = ConvertOp::FCvtZU;
+            break;
+        case TACInstruction::OpCode::IntToDouble:
+            op = ConvertOp::SCvtF;
+            break;
+        case TACInstruction::OpCode::UIntToDouble:
+            op = ConvertOp::UCvtF;
+            break;
+        default:
+            throw std::runtime_error("Unknown conversion opcode");
+    }
+    Emit(ConvertInstruction(op, dst, src));
+}
+
+// AArch64 has no count of trailing zeros: reversing the bits first makes them leading
+// zeros for clz.
+void LinearIRBuilder::LowerBitOp(const TACInstruction& instr) {
+    auto dst = MakeOperand(instr.GetDst());
+    auto src = MakeOperand(instr.GetLhs());
+    switch (instr.GetOp()) {
+        case TACInstruction::OpCode::CountLeadingZeros:
+            Emit(UnaryInstruction(UnaryOp::Clz, dst, src));
+            break;
+        case TACInstruction::OpCode::CountTrailingZeros:
+            Emit(UnaryInstruction(UnaryOp::Rbit, dst, src));
+            Emit(UnaryInstruction(UnaryOp::Clz, dst, dst));
+            break;
+        case TACInstruction::OpCode::PopCount:
+            Emit(PopCountInstruction(dst, src));
+            break;
+        case TACInstruction::OpCode::ByteSwap:
+            Emit(UnaryInstruction(UnaryOp::Rev, dst, src));
+            break;
+        default:
+            throw std::runtime_error("Unknown bit opcode");
+    }
+}
+
+BinaryOp LinearIRBuilder::GetFloatingPointOp(TACInstruction::OpCode op) const {
+    switch (op) {
+        case TACInstruction::OpCode::Add:
+            return BinaryOp::FAdd;
+        case TACInstruction::OpCode::Sub:
+            return BinaryOp::FSub;
+        case TACInstruction::OpCode::Mul:
+            return BinaryOp::FMul;
+        case TACInstruction::OpCode::Div:
+            return BinaryOp::FDiv;
+        default:
+            throw std::runtime_error("Unknown floating-point binary operation");
+    }
+}
+
+std::unordered_map<std::string, int> LinearIRBuilder::CountOperandUses(
+    const std::vector<TACInstruction>& instructions) const {
+    std::unordered_map<std::string, int> use_counts;
+    for (const auto& instr : instructions) {
+        for (const auto* operand : {&instr.GetLhs(), &instr.GetRhs()}) {
+            if (operand->IsIdentifier() && !operand->Empty()) {
+                ++use_counts[operand->AsIdentifier()];
+            }
+        }
+    }
+    return use_counts;
+}
+
+// "t = sext w" immediately followed by the only use of t in "d = x + t", "d = t + x"
+// or "d = x - t" becomes "add/sub d, x, w, sxtw" (uxtw for zero extension).
+bool LinearIRBuilder::TryFoldExtendIntoOperand(
+    const std::vector<TACInstruction>& instructions, size_t index,
+    const std::unordered_map<std::string, int>& use_counts) {
+    using Op = TACInstruction::OpCode;
+    if (index + 1 >= instructions.size()) {
+        return false;
+    }
+    const auto& extend = instructions[index];
+    const auto& next = instructions[index + 1];
+    if ((extend.GetOp() != Op::SignExtend && extend.GetOp() != Op::ZeroExtend) ||
+        (next.GetOp() != Op::Add && next.GetOp() != Op::Sub)) {
+        return false;
+    }
+    if (!extend.GetDst().IsIdentifier() || !extend.GetLhs().IsIdentifier()) {
+        return false;
+    }
+    auto it = use_counts.find(extend.GetDst().AsIdentifier());
+    if (it == use_counts.end() || it->second != 1) {
+        return false;
+    }
+
+    auto wide = MakeOperand(extend.GetDst());
+    auto narrow = MakeOperand(extend.GetLhs());
+    if (!OperandCast<Pseudo>(wide) || wide.IsFloatingPoint() ||
+        narrow.IsFloatingPoint() || wide.GetSize() != ASMOperand::Size::Byte8 ||
+        narrow.GetSize() != ASMOperand::Size::Byte4) {
+        return false;
+    }
+
+    bool extended_is_lhs = next.GetLhs() == extend.GetDst();
+    bool extended_is_rhs = next.GetRhs() == extend.GetDst();
+    if (extended_is_lhs == extended_is_rhs ||
+        (extended_is_lhs && next.GetOp() == Op::Sub)) {
+        return false;
+    }
+
+    auto dst = MakeOperand(next.GetDst());
+    if (dst.IsFloatingPoint() || dst.GetSize() != ASMOperand::Size::Byte8) {
+        return false;
+    }
+    auto other = MakeOperand(extended_is_lhs ? next.GetRhs() : next.GetLhs());
+    auto op = next.GetOp() == Op::Add ? BinaryOp::Add : BinaryOp::Sub;
+    auto kind =
+        extend.GetOp() == Op::SignExtend ? OperandExtend::Sxtw : OperandExtend::Uxtw;
+    Emit(BinaryInstruction(op, dst, other, narrow, kind));
+    return true;
+}
+
+// Whether instructions[index] is a comparison "t = a < b" (or any other) immediately
+// followed by "if t goto L" or "ifFalse t goto L".
+bool LinearIRBuilder::IsCompareAndBranch(const std::vector<TACInstruction>& instructions,
+                                         size_t index) const {
+    using Op = TACInstruction::OpCode;
+    if (index + 1 >= instructions.size()) {
+        return false;
+    }
+    const auto& compare = instructions[index];
+    const auto& branch = instructions[index + 1];
+    switch (compare.GetOp()) {
+        case Op::Less:
+        case Op::LessEqual:
+        case Op::Greater:
+        case Op::GreaterEqual:
+        case Op::Equal:
+        case Op::NotEqual:
+            break;
+        default:
+            return false;
+    }
+    return (branch.GetOp() == Op::If || branch.GetOp() == Op::IfFalse) &&
+           compare.GetDst().IsIdentifier() && branch.GetLhs() == compare.GetDst();
+}
+
+// How many of the uses of each temporary are branches right after the comparison that
+// computes it. Loop rotation leaves two such pairs for one condition temporary.
+std::unordered_map<std::string, int> LinearIRBuilder::CountCompareBranchUses(
+    const std::vector<TACInstruction>& instructions) const {
+    std::unordered_map<std::string, int> branch_uses;
+    for (size_t index = 0; index < instructions.size(); ++index) {
+        if (IsCompareAndBranch(instructions, index)) {
+            ++branch_uses[instructions[index].GetDst().AsIdentifier()];
+        }
+    }
+    return branch_uses;
+}
+
+// A compare and branch pair whose branches are all the uses of t branches on the flags
+// of the compare instead of materializing t and testing it again.
+bool LinearIRBuilder::TryFuseCompareAndBranch(
+    const std::vector<TACInstruction>& instructions, size_t index,
+    const std::unordered_map<std::string, int>& use_counts,
+    const std::unordered_map<std::string, int>& branch_uses) {
+    if (!IsCompareAndBranch(instructions, index)) {
+        return false;
+    }
+    const auto& compare = instructions[index];
+    const auto& branch = instructions[index + 1];
+    const std::string& name = compare.GetDst().AsIdentifier();
+    auto uses = use_counts.find(name);
+    auto fusable = branch_uses.find(name);
+    if (uses == use_counts.end() || fusable == branch_uses.end() ||
+        uses->second != fusable->second) {
+        return false;
+    }
+    // A static variable must still be stored.
+    if (!OperandCast<Pseudo>(MakeOperand(compare.GetDst()))) {
+        return false;
+    }
+
+    Condition cond = EmitCompare(compare);
+    if (branch.GetOp() == TACInstruction::OpCode::IfFalse) {
+        cond = InvertCondition(cond);
+    }
+    Emit(BranchInstruction(BranchType::Conditional, branch.GetLabel(), cond));
+    return true;
+}
+
+// -ffp-contract=fast: "t = a * b" immediately followed by the only use of t in
+// "d = t + c", "d = c + t", "d = t - c" or "d = c - t" becomes one fused instruction.
+bool LinearIRBuilder::TryContractMultiplyAdd(
+    const std::vector<TACInstruction>& instructions, size_t index,
+    const std::unordered_map<std::string, int>& use_counts) {
+    using Op = TACInstruction::OpCode;
+    if (index + 1 >= instructions.size()) {
+        return false;
+    }
+    const auto& mul = instructions[index];
+    const auto& next = instructions[index + 1];
+    if (mul.GetOp() != Op::Mul || (next.GetOp() != Op::Add && next.GetOp() != Op::Sub)) {
+        return false;
+    }
+
+    if (!mul.GetDst().IsIdentifier()) {
+        return false;
+    }
+    auto product = MakeOperand(mul.GetDst());
+    if (!OperandCast<Pseudo>(product) || !product.IsFloatingPoint()) {
+        return false;
+    }
+    auto it = use_counts.find(mul.GetDst().AsIdentifier());
+    if (it == use_counts.end() || it->second != 1) {
+        return false;
+    }
+
+    bool product_is_lhs = next.GetLhs() == mul.GetDst();
+    bool product_is_rhs = next.GetRhs() == mul.GetDst();
+    if (product_is_lhs == product_is_rhs) {
+        return false;
+    }
+
+    FusedOp op = FusedOp::FMAdd;
+    if (next.GetOp() == Op::Sub) {
+        op = product_is_lhs ? FusedOp::FNMSub : FusedOp::FMSub;
+    }
+    const auto& addend = product_is_lhs ? next.GetRhs() : next.GetLhs();
+    Emit(FusedMultiplyInstruction(
+        op, MakeOperand(next.GetDst()), MakeOperand(mul.GetLhs()),
+        MakeOperand(mul.GetRhs()), MakeOperand(addend)));
+    return true;
 }
 
 void LinearIRBuilder::LowerTruncate(const TACInstruction& instr) {
     auto dst = MakeOperand(instr.GetDst());
     auto src = MakeOperand(instr.GetLhs());
-    Emit(std::make_shared<TruncateInstruction>(dst, src));
+    Emit(TruncateInstruction(dst, src));
 }
 
 void LinearIRBuilder::LowerStaticVariable(const TACInstruction& instr) {
@@ -707,6 +1166,6 @@ void LinearIRBuilder::LowerStaticVariable(const TACInstruction& instr) {
         }
     }
 
-    Emit(std::make_shared<DataSectionDirective>());
-    Emit(std::make_shared<StaticVariableDirective>(name, value, size, is_global));
+    Emit(DataSectionDirective());
+    Emit(StaticVariableDirective(name, value, size, is_global));
 }
\ No newline at end of file
@@ -0,0 +1,201 @@
+#include "include/asm/liveness.h"
+
+#include <algorithm>
+#include <string>
+#include <unordered_map>
+
+#include "include/asm/operands.h"
+
+namespace {
+
+struct LivenessBlock {
+    size_t begin;
+    size_t end;
+    std::vector<size_t> successors;
+    std::vector<bool> uses;
+    std::vector<bool> defs;
+    std::vector<bool> live_in;
+    std::vector<bool> live_out;
+};
+
+bool HasOnlyInputOperands(const ASMInstruction* instr) {
+    return InstructionCast<CompareInstruction>(instr) != nullptr ||
+           InstructionCast<BranchInstruction>(instr) != nullptr ||
+           InstructionCast<RetInstruction>(instr) != nullptr ||
+           InstructionCast<StoreInstruction>(instr) != nullptr;
+}
+
+bool EndsBlock(const ASMInstruction* instr) {
+    if (auto branch = InstructionCast<BranchInstruction>(instr)) {
+        return branch->GetType() != BranchType::Call;
+    }
+    return InstructionCast<RetInstruction>(instr) != nullptr ||
+           InstructionCast<IndirectBranchInstruction>(instr) != nullptr;
+}
+
+}  // namespace
+
+std::vector<StackSlotInterval> ComputeStackSlotIntervals(
+    const std::vector<ASMInstruction>& instructions) {
+    std::vector<StackSlotInterval> intervals;
+    std::unordered_map<InternedString, size_t> pseudo_ids;
+    std::vector<std::vector<size_t>> uses(instructions.size());
+    std::vector<std::vector<size_t>> defs(instructions.size());
+
+    auto get_id = [&](const Pseudo& pseudo) {
+        auto [it, inserted] = pseudo_ids.emplace(pseudo.GetName(), intervals.size());
+        if (inserted) {
+            intervals.push_back({.name = pseudo.GetName(),
+                                 .size = static_cast<int>(pseudo.GetSize()),
+                                 .start = -1,
+                                 .end = -1});
+        }
+        return it->second;
+    };
+
+    for (size_t index = 0; index < instructions.size(); ++index) {
+        const auto& instr = instructions[index];
+        auto operands = instr.GetOperands();
+        bool only_inputs = HasOnlyInputOperands(&instr);
+        for (size_t op_index = 0; op_index < operands.size(); ++op_index) {
+            const auto* pseudo = OperandCast<Pseudo>(operands[op_index]);
+            if (!pseudo) {
+                continue;
+            }
+            size_t id = get_id(*pseudo);
+            if (op_index == 0 && !only_inputs) {
+                defs[index].push_back(id);
+            } else {
+                uses[index].push_back(id);
+            }
+        }
+    }
+
+    const size_t pseudo_count = intervals.size();
+    if (pseudo_count == 0) {
+        return intervals;
+    }
+
+    std::vector<LivenessBlock> blocks;
+    std::unordered_map<std::string, size_t> label_to_block;
+    size_t block_begin = 0;
+    for (size_t index = 0; index < instructions.size(); ++index) {
+        const auto* instr = &instructions[index];
+        if (auto label = InstructionCast<LabelInstruction>(instr)) {
+            if (index > block_begin) {
+                blocks.push_back({.begin = block_begin, .end = index});
+                block_begin = index;
+            }
+            label_to_block[label->GetLabel()] = blocks.size();
+        }
+        if (EndsBlock(instr)) {
+            blocks.push_back({.begin = block_begin, .end = index + 1});
+            block_begin = index + 1;
+        }
+    }
+    if (block_begin < instructions.size()) {
+        blocks.push_back({.begin = block_begin, .end = instructions.size()});
+    }
+
+    for (size_t id = 0; id < blocks.size(); ++id) {
+        auto& block = blocks[id];
+        const auto* last = &instructions[block.end - 1];
+        bool falls_through = true;
+        if (auto branch = InstructionCast<BranchInstruction>(last)) {
+            if (branch->GetType() != BranchType::Call) {
+                if (auto it = label_to_block.find(branch->GetLabel());
+                    it != label_to_block.end()) {
+                    block.successors.push_back(it->second);
+                }
+                falls_through = branch->GetType() == BranchType::Conditional;
+            }
+        } else if (auto indirect = InstructionCast<IndirectBranchInstruction>(last)) {
+            for (const auto& target : indirect->GetTargets()) {
+                if (auto it = label_to_block.find(target); it != label_to_block.end()) {
+                    block.successors.push_back(it->second);
+                }
+            }
+            falls_through = false;
+        } else if (InstructionCast<RetInstruction>(last)) {
+            falls_through = false;
+        }
+        if (falls_through && id + 1 < blocks.size()) {
+            block.successors.push_back(id + 1);
+        }
+
+        block.uses.assign(pseudo_count, false);
+        block.defs.assign(pseudo_count, false);
+        block.live_in.assign(pseudo_count, false);
+        block.live_out.assign(pseudo_count, false);
+        for (size_t index = block.begin; index < block.end; ++index) {
+            for (size_t use : uses[index]) {
+                if (!block.defs[use]) {
+                    block.uses[use] = true;
+                }
+            }
+            for (size_t def : defs[index]) {
+                block.defs[def] = true;
+            }
+        }
+    }
+
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (size_t id = blocks.size(); id-- > 0;) {
+            auto& block = blocks[id];
+            for (size_t succ : block.successors) {
+                const auto& succ_in = blocks[succ].live_in;
+                for (size_t pseudo = 0; pseudo < pseudo_count; ++pseudo) {
+                    if (succ_in[pseudo] && !block.live_out[pseudo]) {
+                        block.live_out[pseudo] = true;
+                        changed = true;
+                    }
+                }
+            }
+            for (size_t pseudo = 0; pseudo < pseudo_count; ++pseudo) {
+                bool live = block.uses[pseudo] ||
+                            (block.live_out[pseudo] && !block.defs[pseudo]);
+                if (live && !block.live_in[pseudo]) {
+                    block.live_in[pseudo] = true;
+                    changed = true;
+                }
+            }
+        }
+    }
+
+    // A use of instruction i is at point 2i and a def at 2i + 1, so a value may share
+    // a slot with one that dies in the instruction defining it.
+    auto extend = [&](size_t id, int point) {
+        auto& interval = intervals[id];
+        if (interval.start < 0 || point < interval.start) {
+            interval.start = point;
+        }
+        if (interval.end < 0 || point > interval.end) {
+            interval.end = point;
+        }
+    };
+
+    for (const auto& block : blocks) {
+        int begin_point = static_cast<int>(2 * block.begin);
+        int end_point = static_cast<int>(2 * (block.end - 1) + 1);
+        for (size_t pseudo = 0; pseudo < pseudo_count; ++pseudo) {
+            if (block.live_in[pseudo]) {
+                extend(pseudo, begin_point);
+            }
+            if (block.live_out[pseudo]) {
+                extend(pseudo, end_point);
+            }
+        }
+        for (size_t index = block.begin; index < block.end; ++index) {
+            for (size_t use : uses[index]) {
+                extend(use, static_cast<int>(2 * index));
+            }
+            for (size_t def : defs[index]) {
+                extend(def, static_cast<int>(2 * index + 1));
+            }
+        }
+    }
+
+    return intervals;
+}
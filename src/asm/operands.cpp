@@ -1,63 +1,208 @@
 #include "include/asm/operands.h"
 
 #include <sstream>
+#include <stdexcept>
 
 #include "include/types/numeric_constant.h"
 
-ASMOperand::ASMOperand(Size size) : size_(size) {}
+namespace {
 
-ASMOperand::Size ASMOperand::GetSize() const { return size_; }
+constexpr int kRegisterCount = 32;
 
-///////////////////////////////////////////////
+}  // namespace
+
+Register::Register(Bank bank, int number) : bank_(bank), number_(number) {}
+
+Register Register::Get(std::string_view name) {
+    if (name == "sp") {
+        return Register(Bank::Sp, -1);
+    }
+    if (name == "xzr") {
+        return Register(Bank::Xzr, -1);
+    }
+    if (name == "wzr") {
+        return Register(Bank::Wzr, -1);
+    }
+    if (name.size() >= 2 && name.size() <= 3) {
+        int number = 0;
+        bool is_number = true;
+        for (char digit : name.substr(1)) {
+            is_number = is_number && digit >= '0' && digit <= '9';
+            number = number * 10 + (digit - '0');
+        }
+        if (is_number && number < kRegisterCount) {
+            switch (name[0]) {
+                case 'x':
+                    return Register(Bank::X, number);
+                case 'w':
+                    return Register(Bank::W, number);
+                case 'd':
+                    return Register(Bank::D, number);
+            }
+        }
+    }
+    throw std::invalid_argument("Unknown register: " + std::string(name));
+}
+
+Register Register::Get(int number, Size size, bool is_floating_point) {
+    Bank bank = is_floating_point ? Bank::D : (size == Size::Byte8 ? Bank::X : Bank::W);
+    return Register(bank, number);
+}
+
+std::string Register::ToString() const {
+    switch (bank_) {
+        case Bank::X:
+            return "x" + std::to_string(number_);
+        case Bank::W:
+            return "w" + std::to_string(number_);
+        case Bank::D:
+            return "d" + std::to_string(number_);
+        case Bank::Sp:
+            return "sp";
+        case Bank::Xzr:
+            return "xzr";
+        case Bank::Wzr:
+            return "wzr";
+    }
+    return "";
+}
+
+void Register::Write(OutputBuffer& out) const {
+    switch (bank_) {
+        case Bank::X:
+            out << 'x';
+            break;
+        case Bank::W:
+            out << 'w';
+            break;
+        case Bank::D:
+            out << 'd';
+            break;
+        case Bank::Sp:
+            out << "sp";
+            return;
+        case Bank::Xzr:
+            out << "xzr";
+            return;
+        case Bank::Wzr:
+            out << "wzr";
+            return;
+    }
+    out.WriteInt(number_);
+}
+
+Register::Size Register::GetSize() const {
+    return bank_ == Bank::W || bank_ == Bank::Wzr ? Size::Byte4 : Size::Byte8;
+}
+
+bool Register::IsFloatingPoint() const { return bank_ == Bank::D; }
+
+int Register::GetNumber() const { return number_; }
+
+uint32_t Register::GetEncoding() const {
+    return number_ < 0 ? 31 : static_cast<uint32_t>(number_);
+}
 
-Register::Register(std::string name)
-    : ASMOperand(!name.empty() && name[0] == 'x' ? Size::Byte8 : Size::Byte4),
-      name_(name) {}
+bool Register::IsStackPointer() const { return bank_ == Bank::Sp; }
 
-std::string Register::ToString() const { return name_; }
+bool Register::operator==(const Register& other) const {
+    return bank_ == other.bank_ && number_ == other.number_;
+}
 
 ///////////////////////////////////////////////
 
-Immediate::Immediate(NumericConstant value)
-    : ASMOperand(value.Is64Bit() ? Size::Byte8 : Size::Byte4), value_(value) {}
+Immediate::Immediate(NumericConstant value) : value_(value) {}
+
+std::string Immediate::ToString() const {
+    std::string text = value_.ToString();
+    if (value_.IsFloatingPoint() && text.find_first_of(".en") == std::string::npos) {
+        text += ".0";
+    }
+    return "#" + text;
+}
+
+void Immediate::Write(OutputBuffer& out) const {
+    if (value_.IsFloatingPoint()) {
+        out << ToString();
+        return;
+    }
+    out << '#';
+    if (value_.IsSigned()) {
+        out.WriteInt(value_.AsInt64());
+    } else {
+        out.WriteUInt(value_.AsUInt64());
+    }
+}
+
+Immediate::Size Immediate::GetSize() const {
+    return value_.Is64Bit() ? Size::Byte8 : Size::Byte4;
+}
 
-std::string Immediate::ToString() const { return "#" + value_.ToString(); }
+bool Immediate::IsFloatingPoint() const { return value_.IsFloatingPoint(); }
 
 NumericConstant Immediate::GetValue() const { return value_; }
 
 ///////////////////////////////////////////////
 
-Pseudo::Pseudo(const std::string& name, Size size) : ASMOperand(size), name_(name) {}
+Pseudo::Pseudo(InternedString name, Size size, bool is_floating_point)
+    : name_(name), size_(size), is_floating_point_(is_floating_point) {}
+
+std::string Pseudo::ToString() const { return "%" + name_.Str(); }  // debug only
 
-std::string Pseudo::ToString() const { return "%" + name_; }  // debug only
+void Pseudo::Write(OutputBuffer& out) const { out << '%' << name_.Str(); }
 
-const std::string& Pseudo::GetName() const { return name_; }
+Pseudo::Size Pseudo::GetSize() const { return size_; }
+
+bool Pseudo::IsFloatingPoint() const { return is_floating_point_; }
+
+InternedString Pseudo::GetName() const { return name_; }
 
 ///////////////////////////////////////////////
 
-MemoryOperand::MemoryOperand(std::shared_ptr<Register> base, int offset, Size size,
-                             Mode mode)
-    : ASMOperand(size), base_(base), offset_(offset), mode_(mode) {}
+MemoryOperand::MemoryOperand(Register base, int offset, Size size, Mode mode,
+                             bool is_floating_point)
+    : base_(base),
+      size_(size),
+      mode_(mode),
+      is_floating_point_(is_floating_point),
+      offset_(offset) {}
 
 std::string MemoryOperand::ToString() const {
     std::ostringstream out;
 
     switch (mode_) {
         case Mode::Offset:
-            out << "[" << base_->ToString() << ", #" << offset_ << "]";
+            out << "[" << base_.ToString() << ", #" << offset_ << "]";
             break;
         case Mode::PreIndexed:
-            out << "[" << base_->ToString() << ", #" << offset_ << "]!";
+            out << "[" << base_.ToString() << ", #" << offset_ << "]!";
             break;
         case Mode::PostIndexed:
-            out << "[" << base_->ToString() << "], #" << offset_;
+            out << "[" << base_.ToString() << "], #" << offset_;
             break;
     }
 
     return out.str();
 }
 
-const std::shared_ptr<Register>& MemoryOperand::GetBase() const { return base_; }
+void MemoryOperand::Write(OutputBuffer& out) const {
+    out << '[';
+    base_.Write(out);
+    if (mode_ == Mode::PostIndexed) {
+        out << "], #";
+        out.WriteInt(offset_);
+        return;
+    }
+    out << ", #";
+    out.WriteInt(offset_);
+    out << (mode_ == Mode::PreIndexed ? "]!" : "]");
+}
+
+MemoryOperand::Size MemoryOperand::GetSize() const { return size_; }
+
+bool MemoryOperand::IsFloatingPoint() const { return is_floating_point_; }
+
+const Register& MemoryOperand::GetBase() const { return base_; }
 
 int MemoryOperand::GetOffset() const { return offset_; }
 
@@ -65,9 +210,50 @@ MemoryOperand::Mode MemoryOperand::GetMode() const { return mode_; }
 
 ///////////////////////////////////////////////
 
-DataOperand::DataOperand(const std::string& name, Size size)
-    : ASMOperand(size), name_(name) {}
+DataOperand::DataOperand(InternedString name, Size size, bool is_floating_point)
+    : name_(name), size_(size), is_floating_point_(is_floating_point) {}
+
+std::string DataOperand::ToString() const { return "data@" + name_.Str(); }  // debug only
+
+void DataOperand::Write(OutputBuffer& out) const { out << "data@" << name_.Str(); }
+
+DataOperand::Size DataOperand::GetSize() const { return size_; }
+
+bool DataOperand::IsFloatingPoint() const { return is_floating_point_; }
+
+InternedString DataOperand::GetName() const { return name_; }
+
+///////////////////////////////////////////////
+
+ASMOperand::ASMOperand(Register operand) : operand_(operand) {}
+
+ASMOperand::ASMOperand(Immediate operand) : operand_(operand) {}
+
+ASMOperand::ASMOperand(Pseudo operand) : operand_(operand) {}
+
+ASMOperand::ASMOperand(MemoryOperand operand) : operand_(operand) {}
+
+ASMOperand::ASMOperand(DataOperand operand) : operand_(operand) {}
+
+std::string ASMOperand::ToString() const {
+    return std::visit([](const auto& operand) { return operand.ToString(); }, operand_);
+}
+
+void ASMOperand::Write(OutputBuffer& out) const {
+    std::visit([&out](const auto& operand) { operand.Write(out); }, operand_);
+}
+
+ASMOperand::Size ASMOperand::GetSize() const {
+    return std::visit([](const auto& operand) { return operand.GetSize(); }, operand_);
+}
+
+bool ASMOperand::IsFloatingPoint() const {
+    return std::visit([](const auto& operand) { return operand.IsFloatingPoint(); },
+                      operand_);
+}
 
-std::string DataOperand::ToString() const { return "data@" + name_; }  // debug only
+ASMOperand::Kind ASMOperand::GetKind() const {
+    return static_cast<Kind>(operand_.index());
+}
 
-const std::string& DataOperand::GetName() const { return name_; }
\ No newline at end of file
+const ASMOperand::Storage& ASMOperand::GetStorage() const { return operand_; }
@@ -0,0 +1,30 @@
+#include "include/ast/arena.h"
+
+#include <sanitizer/asan_interface.h>
+
+#include <algorithm>
+
+AstArena::~AstArena() {
+    for (const auto& block : blocks_) {
+        ASAN_UNPOISON_MEMORY_REGION(block.data.get(), block.size);
+    }
+}
+
+void* AstArena::Allocate(size_t size) {
+    constexpr size_t kAlignment = alignof(std::max_align_t);
+    size = (size + kAlignment - 1) & ~(kAlignment - 1);
+    if (static_cast<size_t>(end_ - next_) < size) {
+        size_t block_size = std::max(size, kBlockSize);
+        blocks_.push_back({std::make_unique_for_overwrite<std::byte[]>(block_size),
+                           block_size});
+        next_ = blocks_.back().data.get();
+        end_ = next_ + block_size;
+    }
+    void* result = next_;
+    next_ += size;
+    return result;
+}
+
+void AstArena::Release([[maybe_unused]] void* pointer, [[maybe_unused]] size_t size) {
+    ASAN_POISON_MEMORY_REGION(pointer, size);
+}
@@ -1,6 +1,7 @@
 #include "include/ast/declarations.h"
 
 #include <stdexcept>
+#include <string_view>
 
 #include "include/visitors/visitor.h"
 
@@ -12,7 +13,7 @@ IdentifierDeclarator::IdentifierDeclarator(std::string id) : id_(id) {}
 
 void IdentifierDeclarator::Accept(Visitor* visitor) { visitor->Visit(this); }
 
-std::string IdentifierDeclarator::GetId() const { return id_; }
+const std::string& IdentifierDeclarator::GetId() const { return id_.Str(); }
 
 void IdentifierDeclarator::SetId(const std::string& id) { id_ = id; }
 
@@ -50,7 +51,7 @@ ParameterList* FunctionDeclarator::GetParameters() const {
 
 bool FunctionDeclarator::HasParameters() const { return parameters_.has_value(); }
 
-std::string FunctionDeclarator::GetId() const { return declarator_->GetId(); }
+const std::string& FunctionDeclarator::GetId() const { return declarator_->GetId(); }
 
 void FunctionDeclarator::SetId(const std::string& id) { declarator_->SetId(id); }
 
@@ -140,9 +141,31 @@ void TypeSpecification::Accept(Visitor* visitor) { visitor->Visit(this); }
 
 ///////////////////////////////////////////////
 
-DeclarationSpecifiers::DeclarationSpecifiers(const DeclarationSpecifierSet& specifiers)
-    : type_(std::make_unique<TypeSpecification>(specifiers.type_specifiers)),
-      storage_class_(ResolveStorageClass(specifiers.storage_class_specifiers)) {}
+std::optional<FunctionSpecifierSet::Specifier> FunctionSpecifierSet::FromAttribute(
+    const std::string& name) {
+    std::string_view bare = name;
+    if (bare.size() > 4 && bare.starts_with("__") && bare.ends_with("__")) {
+        bare = bare.substr(2, bare.size() - 4);
+    }
+    if (bare == "hot") {
+        return Specifier::Hot;
+    } else if (bare == "cold") {
+        return Specifier::Cold;
+    } else if (bare == "noinline") {
+        return Specifier::NoInline;
+    } else if (bare == "always_inline") {
+        return Specifier::AlwaysInline;
+    }
+    return std::nullopt;
+}
+
+///////////////////////////////////////////////
+
+DeclarationSpecifiers::DeclarationSpecifiers(AstArena& arena,
+                                             const DeclarationSpecifierSet& specifiers)
+    : type_(MakeNode<TypeSpecification>(arena, specifiers.type_specifiers)),
+      storage_class_(ResolveStorageClass(specifiers.storage_class_specifiers)),
+      function_specifiers_(ResolveFunctionSpecifiers(specifiers.function_specifiers)) {}
 
 void DeclarationSpecifiers::Accept(Visitor* visitor) { visitor->Visit(this); }
 
@@ -152,6 +175,10 @@ TypeSpecification* DeclarationSpecifiers::GetTypeSpecification() const {
 
 StorageClass DeclarationSpecifiers::GetStorageClass() const { return storage_class_; }
 
+const FunctionSpecifierSet& DeclarationSpecifiers::GetFunctionSpecifiers() const {
+    return function_specifiers_;
+}
+
 bool DeclarationSpecifiers::HasTypeSpecifier() const { return true; }
 
 bool DeclarationSpecifiers::IsStatic() const {
@@ -162,6 +189,8 @@ bool DeclarationSpecifiers::IsExtern() const {
     return storage_class_ == StorageClass::Extern;
 }
 
+bool DeclarationSpecifiers::IsInline() const { return function_specifiers_.has_inline; }
+
 StorageClass DeclarationSpecifiers::ResolveStorageClass(
     const StorageClassSpecifierSet& specifier) {
     if (specifier.has_static && specifier.has_extern) {
@@ -176,6 +205,18 @@ StorageClass DeclarationSpecifiers::ResolveStorageClass(
     return StorageClass::None;
 }
 
+FunctionSpecifierSet DeclarationSpecifiers::ResolveFunctionSpecifiers(
+    const FunctionSpecifierSet& specifiers) {
+    if (specifiers.has_hot && specifiers.has_cold) {
+        throw std::runtime_error("cannot combine 'hot' and 'cold' attributes");
+    }
+    if (specifiers.has_noinline && specifiers.has_always_inline) {
+        throw std::runtime_error(
+            "cannot combine 'noinline' and 'always_inline' attributes");
+    }
+    return specifiers;
+}
+
 ///////////////////////////////////////////////
 
 FunctionDefinition::FunctionDefinition(std::unique_ptr<DeclarationSpecifiers> decl_specs,
@@ -195,6 +236,10 @@ TypeSpecification* FunctionDefinition::GetReturnType() const {
     return decl_specs_->GetTypeSpecification();
 }
 
+const FunctionSpecifierSet& FunctionDefinition::GetFunctionSpecifiers() const {
+    return decl_specs_->GetFunctionSpecifiers();
+}
+
 Declarator* FunctionDefinition::GetDeclarator() const { return declarator_.get(); }
 
 CompoundStatement* FunctionDefinition::GetBody() const { return body_.get(); }
@@ -24,11 +24,11 @@ NumericConstant& PrimaryExpression::GetValue() { return value_; }
 
 ///////////////////////////////////////////////
 
-IdExpression::IdExpression(std::string id) : id_(std::move(id)) {}
+IdExpression::IdExpression(std::string id) : id_(id) {}
 
 void IdExpression::Accept(Visitor* visitor) { visitor->Visit(this); }
 
-std::string IdExpression::GetId() const { return id_; }
+const std::string& IdExpression::GetId() const { return id_.Str(); }
 
 void IdExpression::SetId(const std::string& id) { id_ = id; }
 
@@ -132,4 +132,65 @@ Statement* ForStatement::GetBody() const { return body_.get(); }
 
 void ForStatement::SetLabel(std::string label) { label_ = std::move(label); }
 
-std::string ForStatement::GetLabel() const { return label_; }
\ No newline at end of file
+std::string ForStatement::GetLabel() const { return label_; }
+
+///////////////////////////////////////////////
+
+SwitchStatement::SwitchStatement(std::unique_ptr<Expression> expression,
+                                 std::unique_ptr<Statement> body)
+    : expression_(std::move(expression)), body_(std::move(body)) {}
+
+void SwitchStatement::Accept(Visitor* visitor) { visitor->Visit(this); }
+
+Expression* SwitchStatement::GetExpression() const { return expression_.get(); }
+
+Statement* SwitchStatement::GetBody() const { return body_.get(); }
+
+void SwitchStatement::SetLabel(std::string label) { label_ = std::move(label); }
+
+std::string SwitchStatement::GetLabel() const { return label_; }
+
+void SwitchStatement::AddCase(CaseStatement* statement) { cases_.push_back(statement); }
+
+const std::vector<CaseStatement*>& SwitchStatement::GetCases() const { return cases_; }
+
+void SwitchStatement::SetDefault(DefaultStatement* statement) { default_ = statement; }
+
+bool SwitchStatement::HasDefault() const { return default_ != nullptr; }
+
+DefaultStatement* SwitchStatement::GetDefault() const { return default_; }
+
+///////////////////////////////////////////////
+
+CaseStatement::CaseStatement(std::unique_ptr<Expression> expression,
+                             std::unique_ptr<Statement> statement)
+    : expression_(std::move(expression)), statement_(std::move(statement)) {}
+
+void CaseStatement::Accept(Visitor* visitor) { visitor->Visit(this); }
+
+Expression* CaseStatement::GetExpression() const { return expression_.get(); }
+
+Statement* CaseStatement::GetStatement() const { return statement_.get(); }
+
+void CaseStatement::SetLabel(std::string label) { label_ = std::move(label); }
+
+std::string CaseStatement::GetLabel() const { return label_; }
+
+void CaseStatement::SetValue(NumericConstant value) { value_ = value; }
+
+bool CaseStatement::HasValue() const { return value_.has_value(); }
+
+const NumericConstant& CaseStatement::GetValue() const { return *value_; }
+
+///////////////////////////////////////////////
+
+DefaultStatement::DefaultStatement(std::unique_ptr<Statement> statement)
+    : statement_(std::move(statement)) {}
+
+void DefaultStatement::Accept(Visitor* visitor) { visitor->Visit(this); }
+
+Statement* DefaultStatement::GetStatement() const { return statement_.get(); }
+
+void DefaultStatement::SetLabel(std::string label) { label_ = std::move(label); }
+
+std::string DefaultStatement::GetLabel() const { return label_; }
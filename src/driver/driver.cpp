@@ -1,8 +1,12 @@
 #include "include/driver/driver.h"
 
+#include <stdexcept>
+
+#include "include/asm/assembler.h"
 #include "include/asm/ir_builder.h"
 #include "include/optimizer/tac_optimizer.h"
 #include "include/semantic/analyzer.h"
+#include "include/support/output_buffer.h"
 #include "include/tac/tac_visitor.h"
 #include "include/visitors/print_visitor.h"
 
@@ -10,20 +14,37 @@ Driver::Driver() : scanner_(*this), parser_(scanner_, *this) {}
 
 int Driver::CompileFile(const std::string& filename) {
     file_ = filename;
-    location_.initialize(&filename);
+    from_source_ = false;
+    return Compile();
+}
+
+int Driver::CompileSource(const std::string& filename, std::string source) {
+    file_ = filename;
+    source_stream_.str(std::move(source));
+    source_stream_.clear();
+    from_source_ = true;
+    return Compile();
+}
+
+int Driver::Compile() {
+    location_.initialize(&file_);
+    tac_instructions_.clear();
+    tac_pool_.Clear();
+    TACOperandPool::Scope tac_scope(tac_pool_);
 
     bool ok = Scan() && Parse();
 
     if (ok && print_ast) {
         if (debug_output) {
-            std::cout << "Printing parsed AST:" << std::endl;
+            *message_stream << "Printing parsed AST:" << std::endl;
         }
-        PrintVisitor printer(std::cout);
+        PrintVisitor printer(*message_stream);
         translation_unit_->Accept(&printer);
     }
 
     if (ok && compile) {
-        ok = AnalyzeSemantics() && GenerateTAC() && GenerateASM();  // && OptimizeTAC()
+        ok = AnalyzeSemantics() && GenerateTAC() && (!optimize || OptimizeTAC()) &&
+             GenerateASM();
     }
 
     ScanEnd();
@@ -33,7 +54,9 @@ int Driver::CompileFile(const std::string& filename) {
 void Driver::ScanBegin() {
     scanner_.set_debug(debug_scan);
 
-    if (!file_.empty() && file_ != "-") {
+    if (from_source_) {
+        scanner_.yyrestart(&source_stream_);
+    } else if (!file_.empty() && file_ != "-") {
         stream_.open(file_);
         scanner_.yyrestart(&stream_);
     }
@@ -41,6 +64,8 @@ void Driver::ScanBegin() {
 
 void Driver::ScanEnd() { stream_.close(); }
 
+AstArena& Driver::GetAstArena() { return ast_arena_; }
+
 void Driver::SetTranslationUnit(std::unique_ptr<TranslationUnit> unit) {
     translation_unit_ = std::move(unit);
 }
@@ -55,7 +80,7 @@ bool Driver::Parse() {
     parser_.set_debug_level(debug_parse);
     int result = parser_();
     if (result != 0) {
-        std::cerr << "Parsing error: Parser failed with exit code " << result
+        *error_stream << "Parsing error: Parser failed with exit code " << result
                   << std::endl;
         return false;
     }
@@ -64,14 +89,14 @@ bool Driver::Parse() {
 
 bool Driver::AnalyzeSemantics() {
     if (debug_output) {
-        std::cout << "Analyzing semantics..." << std::endl;
+        *message_stream << "Analyzing semantics..." << std::endl;
     }
-    SemanticAnalyzer analyzer(symbol_table_);
+    SemanticAnalyzer analyzer(symbol_table_, ast_arena_);
     analyzer.Analyze(translation_unit_.get());
     if (analyzer.HasErrors()) {
-        std::cerr << "Semantic error:" << std::endl;
+        *error_stream << "Semantic error:" << std::endl;
         for (const auto& error : analyzer.GetErrors()) {
-            std::cerr << "  " << error << std::endl;
+            *error_stream << "  " << error << std::endl;
         }
         return false;
     }
@@ -80,7 +105,7 @@ bool Driver::AnalyzeSemantics() {
 
 bool Driver::GenerateTAC() {
     if (debug_output) {
-        std::cout << "Starting TAC generation..." << std::endl;
+        *message_stream << "Starting TAC generation..." << std::endl;
     }
 
     TACVisitor tac_visitor(symbol_table_);
@@ -88,20 +113,12 @@ bool Driver::GenerateTAC() {
     tac_visitor.AddStaticVariables();
     tac_instructions_ = tac_visitor.GetTACInstructions();
 
-    std::string tac_file = ReplaceExtension(original_filename_, ".tac.txt");
-    if (debug_output) {
-        std::cout << "Generated TAC: " << tac_file << std::endl;
-    }
-    std::ofstream out(tac_file);
-    if (!out.is_open()) {
-        std::cerr << "TAC generation error: Cannot open TAC output file: " << tac_file
-                  << std::endl;
+    if (keep_tac && !WriteTAC(".tac.txt")) {
         return false;
     }
-    tac_visitor.PrintTACInstructions(out);
 
     if (debug_output) {
-        std::cout << "TAC generation completed successfully" << std::endl;
+        *message_stream << "TAC generation completed successfully" << std::endl;
     }
 
     return true;
@@ -109,22 +126,29 @@ bool Driver::GenerateTAC() {
 
 bool Driver::OptimizeTAC() {
     if (debug_output) {
-        std::cout << "Starting TAC optimizations..." << std::endl;
+        *message_stream << "Starting TAC optimizations..." << std::endl;
+    }
+    TACOptimizer optimizer(symbol_table_);
+    optimizer.SetUnrollFactor(unroll_factor);
+    optimizer.EnableInlining(inline_functions);
+    optimizer.EnableInstrumentation(profile_generate);
+    ProfileData profile;
+    if (!profile_use.empty()) {
+        if (!profile.Load(profile_use)) {
+            *error_stream << "TAC optimization error: " << profile.GetError()
+                          << std::endl;
+            return false;
+        }
+        optimizer.SetProfile(&profile);
     }
-    TACOptimizer optimizer;
     optimizer.Optimize(tac_instructions_);
 
-    std::string tac_file = ReplaceExtension(original_filename_, ".tac_optimized.txt");
-    std::ofstream out(tac_file);
-    if (!out.is_open()) {
-        std::cerr << "TAC optimization error: Cannot open TAC output file: " << tac_file
-                  << std::endl;
+    if (keep_tac && !WriteTAC(".tac_optimized.txt")) {
         return false;
     }
-    PrintTACInstructions(out, tac_instructions_);
 
     if (debug_output) {
-        std::cout << "TAC optimizations completed successfully" << std::endl;
+        *message_stream << "TAC optimizations completed successfully" << std::endl;
     }
 
     return true;
@@ -132,28 +156,77 @@ bool Driver::OptimizeTAC() {
 
 bool Driver::GenerateASM() {
     if (debug_output) {
-        std::cout << "Starting ASM generation..." << std::endl;
+        *message_stream << "Starting ASM generation..." << std::endl;
     }
 
     LinearIRBuilder builder(tac_instructions_, symbol_table_);
+    builder.EnableFPContraction(fp_contract_fast);
     builder.Build();
 
-    std::string asm_file = ReplaceExtension(original_filename_, ".s");
+    if (!asm_file.empty() && !WriteASM(builder)) {
+        return false;
+    }
+    if (!object_file.empty() && !WriteObject(builder)) {
+        return false;
+    }
+
     if (debug_output) {
-        std::cout << "Generated ASM: " << asm_file << std::endl;
+        *message_stream << "ASM generation completed successfully" << std::endl;
     }
-    std::ofstream out(asm_file);
-    if (!out.is_open()) {
-        std::cerr << "Assembly generation error: Cannot open assembly output file: "
+
+    return true;
+}
+
+bool Driver::WriteASM(const LinearIRBuilder& builder) const {
+    if (debug_output) {
+        *message_stream << "Generated ASM: " << asm_file << std::endl;
+    }
+    OutputBuffer out;
+    if (!out.Open(asm_file)) {
+        *error_stream << "Assembly generation error: Cannot open assembly output file: "
                   << asm_file << std::endl;
         return false;
     }
     builder.Print(out);
+    if (!out.Close()) {
+        *error_stream << "Assembly generation error: Cannot write assembly output file: "
+                  << asm_file << std::endl;
+        return false;
+    }
+    return true;
+}
 
+bool Driver::WriteObject(const LinearIRBuilder& builder) const {
     if (debug_output) {
-        std::cout << "ASM generation completed successfully" << std::endl;
+        *message_stream << "Generated object: " << object_file << std::endl;
+    }
+    Assembler assembler;
+    try {
+        builder.Assemble(assembler);
+    } catch (const std::runtime_error& error) {
+        *error_stream << "Assembly generation error: " << error.what() << std::endl;
+        return false;
     }
+    if (!assembler.WriteObject(object_file)) {
+        *error_stream << "Assembly generation error: " << assembler.GetError()
+                      << std::endl;
+        return false;
+    }
+    return true;
+}
 
+bool Driver::WriteTAC(const std::string& extension) const {
+    std::string tac_file = ReplaceExtension(original_filename_, extension);
+    if (debug_output) {
+        *message_stream << "Generated TAC: " << tac_file << std::endl;
+    }
+    std::ofstream out(tac_file);
+    if (!out.is_open()) {
+        *error_stream << "TAC generation error: Cannot open TAC output file: " << tac_file
+                  << std::endl;
+        return false;
+    }
+    PrintTACInstructions(out, tac_instructions_);
     return true;
 }
 
@@ -0,0 +1,1507 @@
+#include "include/driver/preprocessor.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+
+namespace {
+
+using Token = Preprocessor::Token;
+using Kind = Preprocessor::Token::Kind;
+using HideSet = Preprocessor::HideSet;
+
+constexpr size_t kMaxIncludeDepth = 200;
+// A longer jump than this between output lines is bridged with a line marker.
+constexpr int kMaxBlankLines = 8;
+
+const char* const kSystemIncludePaths[] = {"/usr/local/include", "/usr/include"};
+
+// Longest spellings first, so that the first match is the longest one.
+const char* const kPunctuators[] = {
+    "<<=", ">>=", "...", "->", "++", "--", "<<", ">>", "<=", ">=", "==", "!=", "&&",
+    "||",  "+=",  "-=",  "*=", "/=", "%=", "&=", "|=", "^=", "##",
+};
+
+const std::string kCommandLine = "<command line>";
+
+bool IsIdentifierChar(char c) {
+    return std::isalnum(static_cast<unsigned char>(c)) || c == '_' || c == '$';
+}
+
+bool IsDigit(char c) { return std::isdigit(static_cast<unsigned char>(c)); }
+
+// Removes backslash-newline pairs, moving the newlines they stood for to the end of the
+// logical line so that every later line keeps its number.
+std::string JoinContinuedLines(std::string text) {
+    if (text.find("\\\n") == std::string::npos &&
+        text.find("\\\r\n") == std::string::npos) {
+        return text;
+    }
+    std::string joined;
+    joined.reserve(text.size());
+    int removed = 0;
+    for (size_t i = 0; i < text.size(); ++i) {
+        if (text[i] == '\\' && i + 1 < text.size() && text[i + 1] == '\n') {
+            ++i;
+            ++removed;
+        } else if (text[i] == '\\' && i + 2 < text.size() && text[i + 1] == '\r' &&
+                   text[i + 2] == '\n') {
+            i += 2;
+            ++removed;
+        } else if (text[i] == '\n') {
+            joined.append(removed + 1, '\n');
+            removed = 0;
+        } else {
+            joined += text[i];
+        }
+    }
+    return joined;
+}
+
+// Splits text into preprocessing tokens, always ending with an End token.
+std::vector<Token> Tokenize(const std::string& text, const std::string* file) {
+    std::vector<Token> tokens;
+    int line = 1;
+    bool at_line_start = true;
+    bool has_space = false;
+    size_t i = 0;
+    size_t size = text.size();
+
+    auto push = [&](Kind kind, size_t begin) {
+        Token token;
+        token.kind = kind;
+        token.text.assign(text, begin, i - begin);
+        token.file = file;
+        token.line = line;
+        token.at_line_start = at_line_start;
+        token.has_space = has_space;
+        tokens.push_back(std::move(token));
+        at_line_start = false;
+        has_space = false;
+    };
+
+    while (i < size) {
+        char c = text[i];
+        char next = i + 1 < size ? text[i + 1] : '\0';
+        if (c == '\n') {
+            ++line;
+            ++i;
+            at_line_start = true;
+            has_space = false;
+            continue;
+        }
+        if (c == ' ' || c == '\t' || c == '\r' || c == '\f' || c == '\v') {
+            has_space = true;
+            ++i;
+            continue;
+        }
+        if (c == '/' && next == '/') {
+            i = std::min(text.find('\n', i), size);
+            has_space = true;
+            continue;
+        }
+        if (c == '/' && next == '*') {
+            size_t end = text.find("*/", i + 2);
+            if (end == std::string::npos) {
+                throw std::runtime_error(*file + ":" + std::to_string(line) +
+                                         ": unterminated /* comment");
+            }
+            line +=
+                static_cast<int>(std::count(text.begin() + i, text.begin() + end, '\n'));
+            i = end + 2;
+            has_space = true;
+            continue;
+        }
+
+        size_t begin = i;
+        if (IsDigit(c) || (c == '.' && IsDigit(next))) {
+            ++i;
+            while (i < size) {
+                char d = text[i];
+                if ((d == 'e' || d == 'E' || d == 'p' || d == 'P') && i + 1 < size &&
+                    (text[i + 1] == '+' || text[i + 1] == '-')) {
+                    i += 2;
+                } else if (IsIdentifierChar(d) || d == '.') {
+                    ++i;
+                } else {
+                    break;
+                }
+            }
+            push(Kind::Number, begin);
+            continue;
+        }
+
+        // Encoding prefixes: L"", u"", U"", u8"" and the same for character literals.
+        size_t prefix = 0;
+        if (c == 'L' || c == 'U') {
+            prefix = 1;
+        } else if (c == 'u') {
+            prefix = next == '8' ? 2 : 1;
+        }
+        size_t quote_at = i + prefix;
+        if (quote_at < size && (text[quote_at] == '"' || text[quote_at] == '\'')) {
+            char quote = text[quote_at];
+            size_t end = quote_at + 1;
+            while (end < size && text[end] != quote && text[end] != '\n') {
+                end += text[end] == '\\' && end + 1 < size ? 2 : 1;
+            }
+            if (end < size && text[end] == quote) {
+                i = end + 1;
+                push(quote == '"' ? Kind::String : Kind::Character, begin);
+                continue;
+            }
+            if (prefix == 0) {
+                // An unmatched quote, such as an apostrophe in a skipped block, stands
+                // on its own.
+                ++i;
+                push(Kind::Punctuator, begin);
+                continue;
+            }
+        }
+
+        if (IsIdentifierChar(c)) {
+            while (i < size && IsIdentifierChar(text[i])) {
+                ++i;
+            }
+            push(Kind::Identifier, begin);
+            continue;
+        }
+
+        size_t length = 1;
+        for (const char* punctuator : kPunctuators) {
+            size_t candidate = std::strlen(punctuator);
+            if (text.compare(i, candidate, punctuator) == 0) {
+                length = candidate;
+                break;
+            }
+        }
+        i += length;
+        push(Kind::Punctuator, begin);
+    }
+
+    Token end;
+    end.file = file;
+    end.line = line;
+    end.at_line_start = true;
+    tokens.push_back(std::move(end));
+    return tokens;
+}
+
+std::string Quote(const std::string& text) {
+    std::string quoted = "\"";
+    for (char c : text) {
+        if (c == '"' || c == '\\') {
+            quoted += '\\';
+        }
+        quoted += c;
+    }
+    quoted += '"';
+    return quoted;
+}
+
+// The same file reached through different include paths has one canonical path.
+std::string CanonicalPath(const std::string& path) {
+    std::error_code error;
+    std::filesystem::path canonical = std::filesystem::weakly_canonical(path, error);
+    return error ? path : canonical.string();
+}
+
+bool Contains(const HideSet& set, const std::string& name) {
+    return set && std::find(set->begin(), set->end(), name) != set->end();
+}
+
+HideSet Union(const HideSet& lhs, const HideSet& rhs) {
+    if (!lhs || lhs == rhs) {
+        return rhs;
+    }
+    if (!rhs) {
+        return lhs;
+    }
+    auto names = std::make_shared<std::vector<std::string>>(*lhs);
+    for (const auto& name : *rhs) {
+        if (!Contains(lhs, name)) {
+            names->push_back(name);
+        }
+    }
+    return names;
+}
+
+HideSet Intersect(const HideSet& lhs, const HideSet& rhs) {
+    if (!lhs || !rhs) {
+        return nullptr;
+    }
+    auto names = std::make_shared<std::vector<std::string>>();
+    for (const auto& name : *lhs) {
+        if (Contains(rhs, name)) {
+            names->push_back(name);
+        }
+    }
+    return names->empty() ? nullptr : names;
+}
+
+HideSet With(const HideSet& set, const std::string& name) {
+    auto names = set ? std::make_shared<std::vector<std::string>>(*set)
+                     : std::make_shared<std::vector<std::string>>();
+    names->push_back(name);
+    return names;
+}
+
+// __has_include_next is answered like __has_include, from the start of the search path.
+bool IsHasInclude(const std::string& name) {
+    return name == "__has_include" || name == "__has_include_next";
+}
+
+// Whether b must be separated from a in the output so that the scanner does not read
+// them as one token.
+bool NeedsSeparation(char a, char b) {
+    bool word_a = IsIdentifierChar(a) || a == '.';
+    bool word_b = IsIdentifierChar(b) || b == '.';
+    if (word_a && word_b) {
+        return true;
+    }
+    const char* joinable = "+-*/%<>=!&|^#.:";
+    return a != '\0' && b != '\0' && std::strchr(joinable, a) && std::strchr(joinable, b);
+}
+
+// Evaluates the expression of #if and #elif after macro expansion. Identifiers that are
+// left over evaluate to 0. Arithmetic is done in 64 bits, as intmax_t or uintmax_t.
+class ConditionParser {
+public:
+    explicit ConditionParser(const std::vector<Token>& tokens) : tokens_(tokens) {}
+
+    int64_t Parse() {
+        Value value = ParseConditional(true);
+        if (index_ < tokens_.size()) {
+            throw std::runtime_error("token is not a valid binary operator in a "
+                                     "preprocessor subexpression: " +
+                                     tokens_[index_].text);
+        }
+        return value.Signed();
+    }
+
+private:
+    // The bits of a value and whether it has the unsigned type. Wrapping arithmetic is
+    // done on the bits to stay defined.
+    struct Value {
+        uint64_t bits = 0;
+        bool is_unsigned = false;
+
+        int64_t Signed() const { return static_cast<int64_t>(bits); }
+        bool IsTrue() const { return bits != 0; }
+    };
+
+    static Value Signed(int64_t value) { return {static_cast<uint64_t>(value), false}; }
+
+    bool Accept(const char* spelling) {
+        if (index_ < tokens_.size() && tokens_[index_].Is(spelling)) {
+            ++index_;
+            return true;
+        }
+        return false;
+    }
+
+    void Expect(const char* spelling) {
+        if (!Accept(spelling)) {
+            throw std::runtime_error(std::string("expected '") + spelling +
+                                     "' in preprocessor expression");
+        }
+    }
+
+    // evaluated is false in the arm of ?:, && or || that C does not evaluate, where
+    // division by zero is not an error.
+    Value ParseConditional(bool evaluated) {
+        Value condition = ParseBinary(1, evaluated);
+        if (!Accept("?")) {
+            return condition;
+        }
+        Value lhs = ParseConditional(evaluated && condition.IsTrue());
+        Expect(":");
+        Value rhs = ParseConditional(evaluated && !condition.IsTrue());
+        Value result = condition.IsTrue() ? lhs : rhs;
+        result.is_unsigned = lhs.is_unsigned || rhs.is_unsigned;
+        return result;
+    }
+
+    static int Precedence(const std::string& op) {
+        static const std::pair<const char*, int> kPrecedences[] = {
+            {"*", 10}, {"/", 10}, {"%", 10}, {"+", 9},  {"-", 9},  {"<<", 8},
+            {">>", 8}, {"<", 7},  {">", 7},  {"<=", 7}, {">=", 7}, {"==", 6},
+            {"!=", 6}, {"&", 5},  {"^", 4},  {"|", 3},  {"&&", 2}, {"||", 1},
+        };
+        for (const auto& [spelling, precedence] : kPrecedences) {
+            if (op == spelling) {
+                return precedence;
+            }
+        }
+        return -1;
+    }
+
+    Value ParseBinary(int min_precedence, bool evaluated) {
+        Value lhs = ParseUnary(evaluated);
+        while (index_ < tokens_.size()) {
+            const Token& token = tokens_[index_];
+            int precedence =
+                token.kind == Kind::Punctuator ? Precedence(token.text) : -1;
+            if (precedence < min_precedence) {
+                break;
+            }
+            std::string op = token.text;
+            ++index_;
+            if (op == "&&") {
+                Value rhs = ParseBinary(precedence + 1, evaluated && lhs.IsTrue());
+                lhs = Signed(lhs.IsTrue() && rhs.IsTrue());
+            } else if (op == "||") {
+                Value rhs = ParseBinary(precedence + 1, evaluated && !lhs.IsTrue());
+                lhs = Signed(lhs.IsTrue() || rhs.IsTrue());
+            } else {
+                lhs = Apply(op, lhs, ParseBinary(precedence + 1, evaluated), evaluated);
+            }
+        }
+        return lhs;
+    }
+
+    static Value Apply(const std::string& op, Value lhs, Value rhs, bool evaluated) {
+        // Shifts have the type of their left operand; everything else goes through the
+        // usual arithmetic conversions, which make both sides unsigned if either is.
+        if (op == "<<" || op == ">>") {
+            return Shift(op, lhs, rhs);
+        }
+        bool is_unsigned = lhs.is_unsigned || rhs.is_unsigned;
+        uint64_t a = lhs.bits;
+        uint64_t b = rhs.bits;
+        if (op == "*") {
+            return {a * b, is_unsigned};
+        }
+        if (op == "+") {
+            return {a + b, is_unsigned};
+        }
+        if (op == "-") {
+            return {a - b, is_unsigned};
+        }
+        if (op == "&") {
+            return {a & b, is_unsigned};
+        }
+        if (op == "^") {
+            return {a ^ b, is_unsigned};
+        }
+        if (op == "|") {
+            return {a | b, is_unsigned};
+        }
+        if (op == "==") {
+            return Signed(a == b);
+        }
+        if (op == "!=") {
+            return Signed(a != b);
+        }
+        if (op == "/" || op == "%") {
+            if (b == 0) {
+                if (evaluated) {
+                    throw std::runtime_error(
+                        "division by zero in preprocessor expression");
+                }
+                return {0, is_unsigned};
+            }
+            if (is_unsigned) {
+                return {op == "/" ? a / b : a % b, true};
+            }
+            if (lhs.Signed() == INT64_MIN && rhs.Signed() == -1) {
+                return op == "/" ? lhs : Signed(0);
+            }
+            return Signed(op == "/" ? lhs.Signed() / rhs.Signed()
+                                    : lhs.Signed() % rhs.Signed());
+        }
+        // The relational operators remain. Flipping the sign bit of signed values makes
+        // unsigned comparison order them correctly.
+        if (!is_unsigned) {
+            a ^= uint64_t{1} << 63;
+            b ^= uint64_t{1} << 63;
+        }
+        if (op == "<") {
+            return Signed(a < b);
+        }
+        if (op == ">") {
+            return Signed(a > b);
+        }
+        if (op == "<=") {
+            return Signed(a <= b);
+        }
+        return Signed(a >= b);
+    }
+
+    static Value Shift(const std::string& op, Value lhs, Value rhs) {
+        bool in_range =
+            rhs.is_unsigned ? rhs.bits < 64 : rhs.Signed() >= 0 && rhs.Signed() < 64;
+        bool negative = !lhs.is_unsigned && lhs.Signed() < 0;
+        if (!in_range) {
+            return {op == ">>" && negative ? ~uint64_t{0} : 0, lhs.is_unsigned};
+        }
+        if (op == "<<") {
+            return {lhs.bits << rhs.bits, lhs.is_unsigned};
+        }
+        if (lhs.is_unsigned) {
+            return {lhs.bits >> rhs.bits, true};
+        }
+        return Signed(lhs.Signed() >> rhs.bits);
+    }
+
+    Value ParseUnary(bool evaluated) {
+        if (Accept("+")) {
+            return ParseUnary(evaluated);
+        }
+        if (Accept("-")) {
+            Value value = ParseUnary(evaluated);
+            return {0 - value.bits, value.is_unsigned};
+        }
+        if (Accept("~")) {
+            Value value = ParseUnary(evaluated);
+            return {~value.bits, value.is_unsigned};
+        }
+        if (Accept("!")) {
+            return Signed(!ParseUnary(evaluated).IsTrue());
+        }
+        if (Accept("(")) {
+            Value value = ParseConditional(evaluated);
+            Expect(")");
+            return value;
+        }
+        if (index_ >= tokens_.size()) {
+            throw std::runtime_error("expected value in preprocessor expression");
+        }
+        const Token& token = tokens_[index_++];
+        switch (token.kind) {
+            case Kind::Number:
+                return ParseNumber(token.text);
+            case Kind::Character:
+                return Signed(ParseCharacter(token.text));
+            case Kind::Identifier:
+                return Signed(0);
+            default:
+                throw std::runtime_error("invalid token in preprocessor expression: " +
+                                         token.text);
+        }
+    }
+
+    // A u or U suffix makes the literal unsigned, and so does a value that does not fit
+    // in intmax_t.
+    static Value ParseNumber(const std::string& text) {
+        size_t end = text.size();
+        bool is_unsigned = false;
+        while (end > 0 && std::strchr("uUlL", text[end - 1])) {
+            is_unsigned = is_unsigned || text[end - 1] == 'u' || text[end - 1] == 'U';
+            --end;
+        }
+        std::string digits = text.substr(0, end);
+        int base = 0;
+        if (digits.size() > 2 && digits[0] == '0' &&
+            (digits[1] == 'b' || digits[1] == 'B')) {
+            digits = digits.substr(2);
+            base = 2;
+        }
+        char* parsed_end = nullptr;
+        uint64_t value = std::strtoull(digits.c_str(), &parsed_end, base);
+        if (digits.empty() || *parsed_end != '\0') {
+            throw std::runtime_error("invalid integer in preprocessor expression: " +
+                                     text);
+        }
+        return {value, is_unsigned || value > static_cast<uint64_t>(INT64_MAX)};
+    }
+
+    static int64_t ParseCharacter(const std::string& text) {
+        size_t i = text.find('\'') + 1;
+        if (text[i] != '\\') {
+            return static_cast<unsigned char>(text[i]);
+        }
+        char escape = text[i + 1];
+        switch (escape) {
+            case 'n': return '\n';
+            case 't': return '\t';
+            case 'r': return '\r';
+            case 'a': return '\a';
+            case 'b': return '\b';
+            case 'f': return '\f';
+            case 'v': return '\v';
+            case 'x': return std::strtol(text.c_str() + i + 2, nullptr, 16);
+            default:
+                if (escape >= '0' && escape <= '7') {
+                    return std::strtol(text.c_str() + i + 1, nullptr, 8);
+                }
+                return static_cast<unsigned char>(escape);
+        }
+    }
+
+    const std::vector<Token>& tokens_;
+    size_t index_ = 0;
+};
+
+}  // namespace
+
+Preprocessor::Preprocessor(IncludeCache& cache) : cache_(cache) {
+    // The standard and target macros clang predefines for AArch64. The __GNUC__ and
+    // __clang__ families are left out, since headers would then use GNU extensions
+    // that mlcc does not parse.
+    const char* predefined[] = {
+        "__STDC__=1",
+        "__STDC_VERSION__=201710L",
+        "__STDC_HOSTED__=1",
+        "__mlcc__=1",
+        "__aarch64__=1",
+        "__AARCH64EL__=1",
+        "__ARM_64BIT_STATE=1",
+        "__LP64__=1",
+        "_LP64=1",
+        "__CHAR_BIT__=8",
+        "__ORDER_LITTLE_ENDIAN__=1234",
+        "__ORDER_BIG_ENDIAN__=4321",
+        "__BYTE_ORDER__=__ORDER_LITTLE_ENDIAN__",
+        "__SIZEOF_SHORT__=2",
+        "__SIZEOF_INT__=4",
+        "__SIZEOF_LONG__=8",
+        "__SIZEOF_LONG_LONG__=8",
+        "__SIZEOF_FLOAT__=4",
+        "__SIZEOF_DOUBLE__=8",
+        "__SIZEOF_POINTER__=8",
+        "__SIZEOF_SIZE_T__=8",
+        "__SIZEOF_PTRDIFF_T__=8",
+        "__SCHAR_MAX__=127",
+        "__SHRT_MAX__=32767",
+        "__INT_MAX__=2147483647",
+        "__LONG_MAX__=9223372036854775807L",
+        "__LONG_LONG_MAX__=9223372036854775807LL",
+        "__SIZE_TYPE__=long unsigned int",
+        "__PTRDIFF_TYPE__=long int",
+        "__INTPTR_TYPE__=long int",
+        "__UINTPTR_TYPE__=long unsigned int",
+        "__INTMAX_TYPE__=long int",
+        "__UINTMAX_TYPE__=long unsigned int",
+#ifdef __APPLE__
+        "__APPLE__=1",
+        "__MACH__=1",
+        "__arm64__=1",
+        "__WCHAR_TYPE__=int",
+#endif
+#ifdef __linux__
+        "__linux__=1",
+        "__linux=1",
+        "__unix__=1",
+        "__unix=1",
+        "__ELF__=1",
+        "__WCHAR_TYPE__=unsigned int",
+#endif
+    };
+    for (const char* definition : predefined) {
+        Define(definition);
+    }
+}
+
+void Preprocessor::AddIncludePath(const std::string& path) {
+    include_paths_.push_back(path);
+}
+
+bool Preprocessor::Define(const std::string& definition) {
+    std::string text = definition;
+    size_t equals = text.find('=');
+    if (equals == std::string::npos) {
+        text += " 1";
+    } else {
+        text[equals] = ' ';
+    }
+    std::vector<Token> tokens = Tokenize(text, &kCommandLine);
+    tokens.pop_back();
+    for (auto& token : tokens) {
+        token.at_line_start = false;
+    }
+
+    Token directive;
+    directive.file = &kCommandLine;
+    pending_.clear();
+    PushFront(std::move(tokens));
+    ++isolated_;
+    bool ok = true;
+    try {
+        HandleDefine(directive);
+    } catch (const std::runtime_error& error) {
+        error_ = error.what();
+        ok = false;
+    }
+    --isolated_;
+    pending_.clear();
+    return ok;
+}
+
+bool Preprocessor::Run(const std::string& filename, std::string& output) {
+    output.clear();
+    output.reserve(1 << 16);
+    output_ = &output;
+    output_file_ = nullptr;
+    output_line_ = 0;
+    output_at_line_start_ = true;
+    output_last_expanded_ = false;
+    frames_.clear();
+    pending_.clear();
+    isolated_ = 0;
+    conditionals_.clear();
+    error_.clear();
+    warnings_.clear();
+
+    try {
+        std::unique_ptr<IncludeCache::File> file = IncludeCache::Read(filename);
+        if (!file) {
+            error_ = "Cannot open source file: " + filename;
+            return false;
+        }
+        PushFile(file->path, file->tokens);
+
+        for (;;) {
+            Token token = NextToken();
+            if (token.kind == Kind::End) {
+                break;
+            }
+            if (token.at_line_start && token.Is("#")) {
+                HandleDirective(token);
+            } else if (token.kind != Kind::Identifier || !ExpandMacro(token)) {
+                Emit(token);
+            }
+        }
+        if (!output_at_line_start_) {
+            output += '\n';
+        }
+    } catch (const std::runtime_error& error) {
+        error_ = error.what();
+        return false;
+    }
+    return true;
+}
+
+const std::string& Preprocessor::GetError() const { return error_; }
+
+const std::vector<std::string>& Preprocessor::GetWarnings() const { return warnings_; }
+
+///////////////////////////////////////////////
+
+Token Preprocessor::NextToken() {
+    if (!pending_.empty()) {
+        Token token = std::move(pending_.back());
+        pending_.pop_back();
+        return token;
+    }
+    if (isolated_ > 0) {
+        return Token();
+    }
+    for (;;) {
+        Frame& frame = frames_.back();
+        const Token& token = (*frame.tokens)[frame.next];
+        if (token.kind == Kind::End) {
+            if (conditionals_.size() > frame.conditional_depth) {
+                Fail(conditionals_.back().directive,
+                     "unterminated conditional directive");
+            }
+            if (frames_.size() == 1) {
+                return token;
+            }
+            frames_.pop_back();
+            continue;
+        }
+        ++frame.next;
+        Token copy = token;
+        if (frame.file_name) {
+            copy.line += frame.line_delta;
+            copy.file = frame.file_name;
+        }
+        return copy;
+    }
+}
+
+const Token& Preprocessor::PeekToken() {
+    PushBack(NextToken());
+    return pending_.back();
+}
+
+void Preprocessor::PushBack(Token token) { pending_.push_back(std::move(token)); }
+
+void Preprocessor::PushFront(std::vector<Token> tokens) {
+    pending_.insert(pending_.end(), std::make_move_iterator(tokens.rbegin()),
+                    std::make_move_iterator(tokens.rend()));
+}
+
+bool Preprocessor::AtLineEnd() const {
+    if (!pending_.empty()) {
+        return pending_.back().kind == Kind::End || pending_.back().at_line_start;
+    }
+    if (isolated_ > 0) {
+        return true;
+    }
+    // Peeked in place rather than read and pushed back, so that the next line stays in
+    // its file: a directive may push an include frame or remap lines in between.
+    const Frame& frame = frames_.back();
+    const Token& token = (*frame.tokens)[frame.next];
+    return token.kind == Kind::End || token.at_line_start;
+}
+
+std::vector<Token> Preprocessor::ReadLine() {
+    std::vector<Token> tokens;
+    while (!AtLineEnd()) {
+        tokens.push_back(NextToken());
+    }
+    return tokens;
+}
+
+void Preprocessor::SkipLine() { ReadLine(); }
+
+///////////////////////////////////////////////
+
+void Preprocessor::HandleDirective(const Token& hash) {
+    if (AtLineEnd()) {
+        // The null directive.
+        return;
+    }
+    Token name = NextToken();
+    if (name.kind == Kind::Number) {
+        // A line marker left by an earlier preprocessor: # 12 "file".
+        PushBack(std::move(name));
+        HandleLine(hash);
+        return;
+    }
+
+    const std::string& directive = name.text;
+    if (directive == "define") {
+        HandleDefine(name);
+    } else if (directive == "undef") {
+        macros_.erase(ReadMacroName(name).text);
+        SkipLine();
+    } else if (directive == "include") {
+        HandleInclude(name);
+    } else if (directive == "if") {
+        bool included = EvaluateCondition(name);
+        conditionals_.push_back({name, Conditional::Context::Then, included});
+        if (!included) {
+            SkipConditional();
+        }
+    } else if (directive == "ifdef" || directive == "ifndef") {
+        Token macro = ReadMacroName(name);
+        SkipLine();
+        bool included = IsDefined(macro.text) == (directive == "ifdef");
+        conditionals_.push_back({name, Conditional::Context::Then, included});
+        if (!included) {
+            SkipConditional();
+        }
+    } else if (directive == "elif") {
+        if (conditionals_.empty()) {
+            Fail(name, "#elif without #if");
+        }
+        if (conditionals_.back().context == Conditional::Context::Else) {
+            Fail(name, "#elif after #else");
+        }
+        conditionals_.back().context = Conditional::Context::Elif;
+        if (conditionals_.back().included) {
+            SkipLine();
+            SkipConditional();
+        } else if (EvaluateCondition(name)) {
+            conditionals_.back().included = true;
+        } else {
+            SkipConditional();
+        }
+    } else if (directive == "else") {
+        if (conditionals_.empty()) {
+            Fail(name, "#else without #if");
+        }
+        if (conditionals_.back().context == Conditional::Context::Else) {
+            Fail(name, "#else after #else");
+        }
+        conditionals_.back().context = Conditional::Context::Else;
+        SkipLine();
+        if (conditionals_.back().included) {
+            SkipConditional();
+        }
+    } else if (directive == "endif") {
+        if (conditionals_.empty()) {
+            Fail(name, "#endif without #if");
+        }
+        conditionals_.pop_back();
+        SkipLine();
+    } else if (directive == "line") {
+        HandleLine(hash);
+    } else if (directive == "pragma") {
+        HandlePragma();
+    } else if (directive == "error" || directive == "warning") {
+        std::string message;
+        for (const auto& token : ReadLine()) {
+            if (!message.empty() && token.has_space) {
+                message += ' ';
+            }
+            message += token.text;
+        }
+        if (directive == "error") {
+            Fail(name, "#error " + message);
+        }
+        warnings_.push_back(*name.file + ":" + std::to_string(name.line) +
+                            ": warning: " + message);
+    } else {
+        Fail(name, "invalid preprocessing directive #" + directive);
+    }
+}
+
+Token Preprocessor::ReadMacroName(const Token& directive) {
+    if (AtLineEnd()) {
+        Fail(directive, "macro name missing");
+    }
+    Token name = NextToken();
+    if (name.kind != Kind::Identifier) {
+        Fail(name, "macro name must be an identifier");
+    }
+    return name;
+}
+
+Token Preprocessor::ReadDefineToken(const Token& name) {
+    if (AtLineEnd()) {
+        Fail(name, "missing ')' in macro parameter list");
+    }
+    return NextToken();
+}
+
+void Preprocessor::HandleDefine(const Token& directive) {
+    Token name = ReadMacroName(directive);
+    if (name.text == "defined") {
+        Fail(name, "'defined' cannot be used as a macro name");
+    }
+
+    Macro macro;
+    const Token* next = AtLineEnd() ? nullptr : &PeekToken();
+    // Only a parenthesis right after the name starts a parameter list.
+    if (next && next->Is("(") && !next->has_space) {
+        NextToken();
+        macro.function_like = true;
+        for (bool first = true;; first = false) {
+            Token param = ReadDefineToken(name);
+            if (first && param.Is(")")) {
+                break;
+            }
+            if (param.Is("...")) {
+                macro.variadic = true;
+                macro.params.push_back("__VA_ARGS__");
+            } else if (param.kind == Kind::Identifier) {
+                macro.params.push_back(param.text);
+            } else {
+                Fail(param, "invalid macro parameter: " + param.text);
+            }
+            Token separator = ReadDefineToken(name);
+            if (!macro.variadic && separator.Is("...")) {
+                // GNU named variadic parameter: args...
+                macro.variadic = true;
+                separator = ReadDefineToken(name);
+            }
+            if (separator.Is(")")) {
+                break;
+            }
+            if (macro.variadic || !separator.Is(",")) {
+                Fail(name, "expected ')' in macro parameter list");
+            }
+        }
+    }
+
+    macro.body = ReadLine();
+    if (!macro.body.empty() &&
+        (macro.body.front().Is("##") || macro.body.back().Is("##"))) {
+        Fail(name, "'##' cannot appear at either end of a macro expansion");
+    }
+    if (macro.function_like) {
+        for (size_t i = 0; i < macro.body.size(); ++i) {
+            if (!macro.body[i].Is("#")) {
+                continue;
+            }
+            const std::vector<std::string>& params = macro.params;
+            if (i + 1 == macro.body.size() ||
+                std::find(params.begin(), params.end(), macro.body[i + 1].text) ==
+                    params.end()) {
+                Fail(macro.body[i], "'#' is not followed by a macro parameter");
+            }
+        }
+    }
+    macros_[name.text] = std::move(macro);
+}
+
+void Preprocessor::HandleInclude(const Token& directive) {
+    std::string name;
+    bool quoted = false;
+    if (!ReadHeaderName(ReadLine(), name, quoted)) {
+        Fail(directive, "#include expects \"FILENAME\" or <FILENAME>");
+    }
+    std::string path = FindInclude(name, quoted);
+    if (path.empty()) {
+        Fail(directive, "'" + name + "' file not found");
+    }
+    IncludeFile(path, directive);
+}
+
+bool Preprocessor::ReadHeaderName(std::vector<Token> tokens, std::string& name,
+                                  bool& quoted) {
+    if (!tokens.empty() && tokens[0].kind != Kind::String && !tokens[0].Is("<")) {
+        tokens = ExpandTokens(std::move(tokens));
+    }
+
+    name.clear();
+    quoted = false;
+    if (!tokens.empty() && tokens[0].kind == Kind::String && tokens[0].text[0] == '"') {
+        name = tokens[0].text.substr(1, tokens[0].text.size() - 2);
+        quoted = true;
+        return true;
+    }
+    if (tokens.empty() || !tokens[0].Is("<")) {
+        return false;
+    }
+    for (size_t i = 1; i < tokens.size(); ++i) {
+        if (tokens[i].Is(">")) {
+            return true;
+        }
+        if (i > 1 && tokens[i].has_space) {
+            name += ' ';
+        }
+        name += tokens[i].text;
+    }
+    return false;
+}
+
+void Preprocessor::HandleLine(const Token& hash) {
+    std::vector<Token> tokens = ExpandTokens(ReadLine());
+    if (tokens.empty() || tokens[0].kind != Kind::Number ||
+        !std::all_of(tokens[0].text.begin(), tokens[0].text.end(), IsDigit)) {
+        Fail(hash, "#line directive requires a positive integer argument");
+    }
+
+    Frame& frame = frames_.back();
+    // The directive's own line before any earlier #line took effect.
+    int raw_line = hash.line - (frame.file_name ? frame.line_delta : 0);
+    frame.line_delta = std::stoi(tokens[0].text) - raw_line - 1;
+    if (tokens.size() > 1 && tokens[1].kind == Kind::String) {
+        const std::string& quoted = tokens[1].text;
+        std::string name;
+        for (size_t i = 1; i + 1 < quoted.size(); ++i) {
+            if (quoted[i] == '\\' && i + 2 < quoted.size()) {
+                ++i;
+            }
+            name += quoted[i];
+        }
+        line_file_names_.push_back(std::move(name));
+        frame.file_name = &line_file_names_.back();
+    } else if (!frame.file_name) {
+        frame.file_name = frame.path;
+    }
+}
+
+void Preprocessor::HandlePragma() {
+    std::vector<Token> tokens = ReadLine();
+    if (!tokens.empty() && tokens[0].Is("once")) {
+        pragma_once_.insert(CanonicalPath(*frames_.back().path));
+    }
+    // Other pragmas have no meaning for mlcc and are dropped.
+}
+
+void Preprocessor::PushFile(const std::string& path, const std::vector<Token>& tokens) {
+    Frame frame;
+    frame.path = &path;
+    frame.tokens = &tokens;
+    frame.directory = std::filesystem::path(path).parent_path().string();
+    frame.conditional_depth = conditionals_.size();
+    frames_.push_back(std::move(frame));
+}
+
+void Preprocessor::IncludeFile(const std::string& path, const Token& directive) {
+    if (!pragma_once_.empty() && pragma_once_.count(CanonicalPath(path))) {
+        return;
+    }
+    if (frames_.size() >= kMaxIncludeDepth) {
+        Fail(directive, "#include nested too deeply");
+    }
+    const IncludeCache::File* file = cache_.Load(path);
+    if (!file) {
+        Fail(directive, "cannot read '" + path + "'");
+    }
+    PushFile(file->path, file->tokens);
+}
+
+std::string Preprocessor::FindInclude(const std::string& name, bool quoted) const {
+    namespace fs = std::filesystem;
+    auto exists = [](const fs::path& path) {
+        std::error_code error;
+        return fs::is_regular_file(path, error);
+    };
+
+    if (fs::path(name).is_absolute()) {
+        return exists(name) ? name : "";
+    }
+    if (quoted) {
+        fs::path candidate =
+            (fs::path(frames_.back().directory) / name).lexically_normal();
+        if (exists(candidate)) {
+            return candidate.string();
+        }
+    }
+    for (const auto& directory : include_paths_) {
+        fs::path candidate = (fs::path(directory) / name).lexically_normal();
+        if (exists(candidate)) {
+            return candidate.string();
+        }
+    }
+    for (const char* directory : kSystemIncludePaths) {
+        fs::path candidate = fs::path(directory) / name;
+        if (exists(candidate)) {
+            return candidate.string();
+        }
+    }
+    return "";
+}
+
+void Preprocessor::SkipConditional() {
+    int depth = 0;
+    for (;;) {
+        // Running out of input fails inside NextToken, since the conditional is open.
+        Token hash = NextToken();
+        if (!hash.at_line_start || !hash.Is("#")) {
+            continue;
+        }
+        Token name = NextToken();
+        if (name.at_line_start || name.kind == Kind::End) {
+            PushBack(std::move(name));
+            continue;
+        }
+        if (name.Is("if") || name.Is("ifdef") || name.Is("ifndef")) {
+            ++depth;
+        } else if (name.Is("endif") && depth > 0) {
+            --depth;
+        } else if (depth == 0 &&
+                   (name.Is("elif") || name.Is("else") || name.Is("endif"))) {
+            PushBack(std::move(name));
+            PushBack(std::move(hash));
+            return;
+        }
+    }
+}
+
+///////////////////////////////////////////////
+
+bool Preprocessor::ExpandMacro(const Token& name) {
+    if (Contains(name.hideset, name.text)) {
+        return false;
+    }
+    if (name.text == "__FILE__" || name.text == "__LINE__") {
+        Token token = name;
+        bool is_file = name.text == "__FILE__";
+        token.kind = is_file ? Kind::String : Kind::Number;
+        token.text = is_file ? Quote(*name.file) : std::to_string(name.line);
+        token.at_line_start = false;
+        token.expanded = true;
+        PushBack(std::move(token));
+        return true;
+    }
+    auto it = macros_.find(name.text);
+    if (it == macros_.end()) {
+        return false;
+    }
+    const Macro& macro = it->second;
+
+    std::vector<Token> body;
+    HideSet hideset;
+    if (!macro.function_like) {
+        hideset = With(name.hideset, name.text);
+        body = Substitute(macro, {});
+    } else {
+        if (!PeekToken().Is("(")) {
+            return false;
+        }
+        NextToken();
+        Token rparen;
+        auto args = ReadArguments(name, macro, rparen);
+        hideset = With(Intersect(name.hideset, rparen.hideset), name.text);
+        body = Substitute(macro, args);
+    }
+
+    for (size_t i = 0; i < body.size(); ++i) {
+        Token& token = body[i];
+        token.hideset = Union(token.hideset, hideset);
+        token.file = name.file;
+        token.line = name.line;
+        token.at_line_start = false;
+        token.expanded = true;
+        if (i == 0) {
+            token.has_space = name.has_space;
+        }
+    }
+    PushFront(std::move(body));
+    return true;
+}
+
+std::vector<Token> Preprocessor::ExpandTokens(std::vector<Token> tokens) {
+    std::vector<Token> saved = std::move(pending_);
+    pending_.clear();
+    pending_.reserve(tokens.size() * 2);
+    PushFront(std::move(tokens));
+    ++isolated_;
+
+    std::vector<Token> expanded;
+    expanded.reserve(pending_.size());
+    for (;;) {
+        Token token = NextToken();
+        if (token.kind == Kind::End) {
+            break;
+        }
+        if (token.kind != Kind::Identifier || !ExpandMacro(token)) {
+            expanded.push_back(std::move(token));
+        }
+    }
+
+    --isolated_;
+    pending_ = std::move(saved);
+    return expanded;
+}
+
+std::vector<std::vector<Token>> Preprocessor::ReadArguments(const Token& name,
+                                                            const Macro& macro,
+                                                            Token& rparen) {
+    std::vector<std::vector<Token>> args(1);
+    int depth = 0;
+    for (;;) {
+        Token token = NextToken();
+        if (token.kind == Kind::End) {
+            Fail(name, "unterminated function-like macro invocation");
+        }
+        if (depth == 0 && token.Is(")")) {
+            rparen = std::move(token);
+            break;
+        }
+        // Commas of the variadic part belong to __VA_ARGS__.
+        if (depth == 0 && token.Is(",") &&
+            !(macro.variadic && args.size() == macro.params.size())) {
+            args.emplace_back();
+            continue;
+        }
+        if (token.Is("(")) {
+            ++depth;
+        } else if (token.Is(")")) {
+            --depth;
+        }
+        args.back().push_back(std::move(token));
+    }
+
+    size_t expected = macro.params.size();
+    if (expected == 0 && args.size() == 1 && args[0].empty()) {
+        args.clear();
+    }
+    if (macro.variadic && args.size() + 1 == expected) {
+        args.emplace_back();
+    }
+    if (args.size() != expected) {
+        Fail(name, "macro '" + name.text + "' requires " + std::to_string(expected) +
+                       " arguments, but " + std::to_string(args.size()) + " given");
+    }
+    return args;
+}
+
+std::vector<Token> Preprocessor::Substitute(const Macro& macro,
+                                            const std::vector<std::vector<Token>>& args) {
+    const std::vector<Token>& body = macro.body;
+    auto param_index = [&](const Token& token) -> int {
+        if (token.kind != Kind::Identifier) {
+            return -1;
+        }
+        auto it = std::find(macro.params.begin(), macro.params.end(), token.text);
+        return it == macro.params.end() ? -1
+                                        : static_cast<int>(it - macro.params.begin());
+    };
+    // Arguments are fully expanded before substitution, except next to # and ##.
+    std::vector<std::vector<Token>> expanded_args(args.size());
+    std::vector<bool> is_expanded(args.size(), false);
+    auto expanded_arg = [&](int index) -> const std::vector<Token>& {
+        if (!is_expanded[index]) {
+            expanded_args[index] = ExpandTokens(args[index]);
+            is_expanded[index] = true;
+        }
+        return expanded_args[index];
+    };
+    auto append = [](std::vector<Token>& out, const std::vector<Token>& tokens,
+                     bool has_space) {
+        size_t first = out.size();
+        out.insert(out.end(), tokens.begin(), tokens.end());
+        if (first < out.size()) {
+            out[first].has_space = has_space;
+        }
+    };
+
+    std::vector<Token> result;
+    result.reserve(body.size());
+    for (size_t i = 0; i < body.size();) {
+        const Token& token = body[i];
+        if (macro.function_like && token.Is("#")) {
+            result.push_back(Stringize(args[param_index(body[i + 1])], token));
+            result.back().has_space = token.has_space;
+            i += 2;
+            continue;
+        }
+        if (token.Is("##")) {
+            const Token& rhs = body[i + 1];
+            int index = param_index(rhs);
+            i += 2;
+            if (index < 0) {
+                if (result.empty()) {
+                    result.push_back(rhs);
+                } else {
+                    result.back() = Paste(result.back(), rhs);
+                }
+                continue;
+            }
+            const std::vector<Token>& arg = args[index];
+            // GNU extension: , ## __VA_ARGS__ drops the comma when there are no
+            // variadic arguments and pastes nothing otherwise.
+            bool is_va_args =
+                macro.variadic && index + 1 == static_cast<int>(macro.params.size());
+            if (is_va_args && !result.empty() && result.back().Is(",")) {
+                if (arg.empty()) {
+                    result.pop_back();
+                } else {
+                    append(result, arg, rhs.has_space);
+                }
+                continue;
+            }
+            if (arg.empty()) {
+                continue;
+            }
+            if (result.empty()) {
+                append(result, arg, rhs.has_space);
+            } else {
+                result.back() = Paste(result.back(), arg.front());
+                result.insert(result.end(), arg.begin() + 1, arg.end());
+            }
+            continue;
+        }
+
+        int index = param_index(token);
+        if (index < 0) {
+            result.push_back(token);
+            ++i;
+            continue;
+        }
+        bool before_paste = i + 1 < body.size() && body[i + 1].Is("##");
+        if (!before_paste) {
+            append(result, expanded_arg(index), token.has_space);
+            ++i;
+            continue;
+        }
+        if (!args[index].empty()) {
+            append(result, args[index], token.has_space);
+            ++i;
+            continue;
+        }
+        // An empty argument before ## leaves the right operand on its own.
+        const Token& rhs = body[i + 2];
+        int rhs_index = param_index(rhs);
+        if (rhs_index < 0) {
+            result.push_back(rhs);
+        } else {
+            append(result, args[rhs_index], rhs.has_space);
+        }
+        i += 3;
+    }
+    return result;
+}
+
+Token Preprocessor::Paste(const Token& lhs, const Token& rhs) const {
+    std::string text = lhs.text + rhs.text;
+    std::vector<Token> tokens = Tokenize(text, lhs.file);
+    if (tokens.size() != 2) {
+        Fail(lhs, "pasting \"" + lhs.text + "\" and \"" + rhs.text +
+                      "\" does not give a valid preprocessing token");
+    }
+    Token pasted = std::move(tokens[0]);
+    pasted.line = lhs.line;
+    pasted.at_line_start = false;
+    pasted.has_space = lhs.has_space;
+    pasted.expanded = true;
+    pasted.hideset = lhs.hideset;
+    return pasted;
+}
+
+Token Preprocessor::Stringize(const std::vector<Token>& tokens,
+                              const Token& where) const {
+    std::string text = "\"";
+    for (size_t i = 0; i < tokens.size(); ++i) {
+        if (i > 0 && tokens[i].has_space) {
+            text += ' ';
+        }
+        if (tokens[i].kind != Kind::String && tokens[i].kind != Kind::Character) {
+            text += tokens[i].text;
+            continue;
+        }
+        for (char c : tokens[i].text) {
+            if (c == '"' || c == '\\') {
+                text += '\\';
+            }
+            text += c;
+        }
+    }
+    text += '"';
+
+    Token string = where;
+    string.kind = Kind::String;
+    string.text = std::move(text);
+    string.hideset = nullptr;
+    return string;
+}
+
+///////////////////////////////////////////////
+
+bool Preprocessor::IsDefined(const std::string& name) const {
+    return macros_.count(name) || name == "__FILE__" || name == "__LINE__" ||
+           IsHasInclude(name);
+}
+
+size_t Preprocessor::ReplaceHasInclude(const Token& directive,
+                                       const std::vector<Token>& tokens, size_t index,
+                                       std::vector<Token>& replaced) {
+    const std::string& spelling = tokens[index].text;
+    size_t open = index + 1;
+    if (open >= tokens.size() || !tokens[open].Is("(")) {
+        Fail(directive, "missing '(' after '" + spelling + "'");
+    }
+    size_t close = open + 1;
+    for (int depth = 0; close < tokens.size(); ++close) {
+        if (tokens[close].Is("(")) {
+            ++depth;
+        } else if (tokens[close].Is(")") && depth-- == 0) {
+            break;
+        }
+    }
+    if (close == tokens.size()) {
+        Fail(directive, "missing ')' after '" + spelling + "'");
+    }
+
+    std::string name;
+    bool quoted = false;
+    std::vector<Token> argument(tokens.begin() + open + 1, tokens.begin() + close);
+    if (!ReadHeaderName(std::move(argument), name, quoted)) {
+        Fail(directive, "'" + spelling + "' expects \"FILENAME\" or <FILENAME>");
+    }
+    Token value = tokens[index];
+    value.kind = Kind::Number;
+    value.text = FindInclude(name, quoted).empty() ? "0" : "1";
+    replaced.push_back(std::move(value));
+    return close;
+}
+
+bool Preprocessor::EvaluateCondition(const Token& directive) {
+    std::vector<Token> tokens = ReadLine();
+
+    // defined X, defined(X) and __has_include(...) are replaced before expansion turns
+    // the names in them into macro bodies.
+    std::vector<Token> replaced;
+    for (size_t i = 0; i < tokens.size(); ++i) {
+        if (tokens[i].kind == Kind::Identifier && IsHasInclude(tokens[i].text)) {
+            i = ReplaceHasInclude(directive, tokens, i, replaced);
+            continue;
+        }
+        if (tokens[i].kind != Kind::Identifier || !tokens[i].Is("defined")) {
+            replaced.push_back(std::move(tokens[i]));
+            continue;
+        }
+        size_t name = i + 1;
+        bool parenthesized = name < tokens.size() && tokens[name].Is("(");
+        if (parenthesized) {
+            ++name;
+        }
+        if (name >= tokens.size() || tokens[name].kind != Kind::Identifier) {
+            Fail(directive, "macro name missing after 'defined'");
+        }
+        if (parenthesized && (name + 1 >= tokens.size() || !tokens[name + 1].Is(")"))) {
+            Fail(directive, "missing ')' after 'defined'");
+        }
+        Token value = tokens[i];
+        value.kind = Kind::Number;
+        value.text = IsDefined(tokens[name].text) ? "1" : "0";
+        replaced.push_back(std::move(value));
+        i = parenthesized ? name + 1 : name;
+    }
+
+    tokens = ExpandTokens(std::move(replaced));
+    if (tokens.empty()) {
+        Fail(directive, "#" + directive.text + " with no expression");
+    }
+    try {
+        return ConditionParser(tokens).Parse() != 0;
+    } catch (const std::runtime_error& error) {
+        Fail(directive, error.what());
+    }
+}
+
+///////////////////////////////////////////////
+
+void Preprocessor::Emit(const Token& token) {
+    std::string& out = *output_;
+    if (token.file != output_file_ || token.line > output_line_ + kMaxBlankLines) {
+        if (!output_at_line_start_) {
+            out += '\n';
+        }
+        out += "# ";
+        out += std::to_string(token.line);
+        out += ' ';
+        out += Quote(*token.file);
+        out += '\n';
+        output_file_ = token.file;
+        output_line_ = token.line;
+        output_at_line_start_ = true;
+    } else if (token.line > output_line_) {
+        out.append(token.line - output_line_, '\n');
+        output_line_ = token.line;
+        output_at_line_start_ = true;
+    }
+
+    if (!output_at_line_start_ &&
+        (token.has_space || ((token.expanded || output_last_expanded_) &&
+                             NeedsSeparation(out.back(), token.text.front())))) {
+        out += ' ';
+    }
+    out += token.text;
+    output_at_line_start_ = false;
+    output_last_expanded_ = token.expanded;
+}
+
+void Preprocessor::Fail(const Token& where, const std::string& message) const {
+    const std::string& file = where.file ? *where.file : kCommandLine;
+    throw std::runtime_error(file + ":" + std::to_string(where.line) + ": " + message);
+}
+
+///////////////////////////////////////////////
+
+const IncludeCache::File* IncludeCache::Load(const std::string& path) {
+    {
+        std::lock_guard lock(mutex_);
+        auto it = files_.find(path);
+        if (it != files_.end()) {
+            return it->second.get();
+        }
+    }
+    // Read without the lock so that other files load meanwhile. If another thread got
+    // there first, its copy is kept, since its tokens may already be in use.
+    std::unique_ptr<File> file = Read(path);
+    std::lock_guard lock(mutex_);
+    // Unreadable files are remembered too, as nullptr.
+    return files_.emplace(path, std::move(file)).first->second.get();
+}
+
+std::unique_ptr<IncludeCache::File> IncludeCache::Read(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+        return nullptr;
+    }
+    std::string text((std::istreambuf_iterator<char>(in)),
+                     std::istreambuf_iterator<char>());
+    if (in.bad()) {
+        return nullptr;
+    }
+    auto file = std::make_unique<File>();
+    file->path = path;
+    file->tokens = Tokenize(JoinContinuedLines(std::move(text)), &file->path);
+    return file;
+}
@@ -0,0 +1,34 @@
+#include "include/driver/profile_runtime.h"
+
+const char* const kDefaultProfileFile = "mlcc.profdata";
+
+const char* const kProfileRuntimeSource = R"(
+#include <stdio.h>
+#include <stdlib.h>
+
+void __mlcc_profile_dump(void);
+
+static FILE* profile_file;
+
+void __mlcc_profile_function(long id, long checksum, long counters) {
+    fprintf(profile_file, "function %ld %ld %ld\n", id, checksum, counters);
+}
+
+void __mlcc_profile_counter(unsigned long count) {
+    fprintf(profile_file, "%lu\n", count);
+}
+
+static void write_profile(void) {
+    const char* path = getenv("MLCC_PROFILE_FILE");
+    profile_file = fopen(path ? path : "mlcc.profdata", "a");
+    if (!profile_file) {
+        return;
+    }
+    __mlcc_profile_dump();
+    fclose(profile_file);
+}
+
+__attribute__((constructor)) static void register_profile_writer(void) {
+    atexit(write_profile);
+}
+)";
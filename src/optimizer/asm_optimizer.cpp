@@ -1,3 +1,49 @@
 #include "include/optimizer/asm_optimizer.h"
 
-void ASMOptimizer::Optimize(std::vector<std::shared_ptr<ASMInstruction>>& instructions) {}
\ No newline at end of file
+#include "include/asm/operands.h"
+
+void ASMOptimizer::Optimize(std::vector<ASMInstruction>& instructions) {
+    FoldExtendIntoLoad(instructions);
+}
+
+// "ldr wT, [m]; sxtw xD, wT" -> "ldrsw xD, [m]" and "ldr wT, [m]; mov wD, wT" ->
+// "ldr wD, [m]". wT is a scratch register from operand resolution, so it is dead
+// after the extension.
+void ASMOptimizer::FoldExtendIntoLoad(std::vector<ASMInstruction>& instructions) {
+    std::vector<ASMInstruction> result;
+    result.reserve(instructions.size());
+    for (size_t index = 0; index < instructions.size(); ++index) {
+        const auto* load = InstructionCast<LoadInstruction>(&instructions[index]);
+        const auto* extend = index + 1 < instructions.size()
+                                 ? InstructionCast<ExtendInstruction>(
+                                       &instructions[index + 1])
+                                 : nullptr;
+        if (!load || !extend) {
+            result.push_back(std::move(instructions[index]));
+            continue;
+        }
+
+        auto load_ops = load->GetOperands();
+        auto extend_ops = extend->GetOperands();
+        const auto* loaded = OperandCast<Register>(load_ops[0]);
+        const auto* address = OperandCast<MemoryOperand>(load_ops[1]);
+        const auto* dst = OperandCast<Register>(extend_ops[0]);
+        const auto* src = OperandCast<Register>(extend_ops[1]);
+        if (!loaded || !address || !dst || !src || *loaded != *src ||
+            src->GetSize() != ASMOperand::Size::Byte4 || src->IsFloatingPoint() ||
+            dst->GetSize() != ASMOperand::Size::Byte8 || dst->IsFloatingPoint() ||
+            dst->IsStackPointer()) {
+            result.push_back(std::move(instructions[index]));
+            continue;
+        }
+
+        if (extend->IsSigned()) {
+            result.push_back(LoadInstruction(*dst, *address, true));
+        } else {
+            auto dst_w = Register::Get("w" + dst->ToString().substr(1));
+            result.push_back(LoadInstruction(dst_w, *address));
+        }
+        ++index;
+    }
+    instructions = std::move(result);
+}
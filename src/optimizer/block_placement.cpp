@@ -0,0 +1,486 @@
+#include "include/optimizer/block_placement.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "include/optimizer/control_flow_utils.h"
+
+namespace cfg {
+
+namespace {
+
+using Op = TACInstruction::OpCode;
+
+constexpr size_t kExitBlock = 1;
+constexpr size_t kFirstBlock = 2;
+
+// Probabilities of the favoured successor, from Ball and Larus: the back edge of a
+// loop, the successor staying in the loop, the one that does not return and the one
+// that does not call.
+constexpr double kLoopBranchProbability = 0.88;
+constexpr double kLoopExitProbability = 0.8;
+constexpr double kReturnProbability = 0.72;
+constexpr double kCallProbability = 0.78;
+// Not calling a function declared cold.
+constexpr double kColdCallProbability = 0.95;
+// Of the outcome __builtin_expect names; it overrides the heuristics.
+constexpr double kExpectProbability = 0.9;
+
+constexpr int kMaxPropagationRounds = 128;
+constexpr double kMaxFrequency = 1e9;
+
+// Natural loops, by header, as the set of blocks each one contains.
+struct NaturalLoop {
+    size_t header;
+    std::vector<bool> body;
+    size_t size = 0;
+};
+
+struct LoopInfo {
+    std::vector<std::vector<bool>> back_edges;
+    std::vector<NaturalLoop> loops;
+};
+
+LoopInfo FindNaturalLoops(const ControlFlowGraph& cfg) {
+    size_t count = cfg.GetBlockCount();
+    LoopInfo info{.back_edges = std::vector(count, std::vector<bool>(count))};
+
+    enum class State { New, OnStack, Done };
+    std::vector<State> state(count, State::New);
+    std::vector<std::pair<size_t, std::vector<size_t>>> stack;
+    auto push = [&](size_t id) {
+        const auto& successors = cfg.GetSuccessors(id);
+        stack.emplace_back(id,
+                           std::vector<size_t>(successors.rbegin(), successors.rend()));
+        state[id] = State::OnStack;
+    };
+    push(kFirstBlock);
+    while (!stack.empty()) {
+        auto& [id, pending] = stack.back();
+        if (pending.empty()) {
+            state[id] = State::Done;
+            stack.pop_back();
+            continue;
+        }
+        size_t next = pending.back();
+        pending.pop_back();
+        if (state[next] == State::OnStack) {
+            info.back_edges[id][next] = true;
+        } else if (state[next] == State::New && next >= kFirstBlock) {
+            push(next);
+        }
+    }
+
+    for (size_t latch = kFirstBlock; latch < count; ++latch) {
+        for (size_t header = kFirstBlock; header < count; ++header) {
+            if (!info.back_edges[latch][header]) {
+                continue;
+            }
+            auto it = std::find_if(
+                info.loops.begin(), info.loops.end(),
+                [&](const auto& loop) { return loop.header == header; });
+            if (it == info.loops.end()) {
+                info.loops.push_back(
+                    {.header = header, .body = std::vector<bool>(count)});
+                it = std::prev(info.loops.end());
+                it->body[header] = true;
+            }
+            std::vector<size_t> worklist = {latch};
+            while (!worklist.empty()) {
+                size_t id = worklist.back();
+                worklist.pop_back();
+                if (id < kFirstBlock || it->body[id]) {
+                    continue;
+                }
+                it->body[id] = true;
+                const auto& predecessors = cfg.GetPredecessors(id);
+                worklist.insert(worklist.end(), predecessors.begin(), predecessors.end());
+            }
+        }
+    }
+    for (auto& loop : info.loops) {
+        loop.size = std::count(loop.body.begin(), loop.body.end(), true);
+    }
+    return info;
+}
+
+const NaturalLoop* FindInnermostLoop(const LoopInfo& info, size_t id) {
+    const NaturalLoop* innermost = nullptr;
+    for (const auto& loop : info.loops) {
+        if (loop.body[id] && (!innermost || loop.size < innermost->size)) {
+            innermost = &loop;
+        }
+    }
+    return innermost;
+}
+
+// Combines two independent estimates of the same branch (Dempster-Shafer).
+double Combine(double p, double q) { return p * q / (p * q + (1 - p) * (1 - q)); }
+
+bool Returns(const ControlFlowGraph& cfg, size_t id) {
+    const auto& instructions = cfg.GetBlock(id).instructions;
+    return id == kExitBlock ||
+           (!instructions.empty() && instructions.back().GetOp() == Op::Return);
+}
+
+bool Calls(const ControlFlowGraph& cfg, size_t id) {
+    const auto& instructions = cfg.GetBlock(id).instructions;
+    return std::any_of(instructions.begin(), instructions.end(),
+                       [](const auto& instr) { return instr.GetOp() == Op::Call; });
+}
+
+bool CallsCold(const ControlFlowGraph& cfg, size_t id,
+               const std::unordered_set<std::string>& cold_functions) {
+    const auto& instructions = cfg.GetBlock(id).instructions;
+    return std::any_of(instructions.begin(), instructions.end(), [&](const auto& instr) {
+        return instr.GetOp() == Op::Call &&
+               cold_functions.contains(instr.GetLhs().AsIdentifier());
+    });
+}
+
+// Probability that the conditional branch ending `id` jumps to `taken` rather than
+// falling through to `fallthrough`.
+double EstimateBranchProbability(const ControlFlowGraph& cfg, const LoopInfo& info,
+                                 size_t id, size_t taken, size_t fallthrough,
+                                 const std::unordered_set<std::string>& cold_functions) {
+    const auto& branch = cfg.GetBlock(id).instructions.back();
+    if (auto expected = branch.GetExpectedCondition()) {
+        bool jumps = *expected == (branch.GetOp() == Op::If);
+        return jumps ? kExpectProbability : 1 - kExpectProbability;
+    }
+
+    double probability = 0.5;
+    auto favour = [&](bool taken_side, bool fallthrough_side, double estimate) {
+        if (taken_side != fallthrough_side) {
+            probability = Combine(probability, taken_side ? estimate : 1 - estimate);
+        }
+    };
+
+    const auto& back_edges = info.back_edges[id];
+    favour(back_edges[taken], back_edges[fallthrough], kLoopBranchProbability);
+    if (const auto* loop = FindInnermostLoop(info, id)) {
+        favour(loop->body[taken], loop->body[fallthrough], kLoopExitProbability);
+    }
+    favour(!Returns(cfg, taken), !Returns(cfg, fallthrough), kReturnProbability);
+    favour(!Calls(cfg, taken), !Calls(cfg, fallthrough), kCallProbability);
+    favour(!CallsCold(cfg, taken, cold_functions),
+           !CallsCold(cfg, fallthrough, cold_functions), kColdCallProbability);
+    return probability;
+}
+
+}  // namespace
+
+void EstimateFrequencies(ControlFlowGraph& cfg,
+                         const std::unordered_set<std::string>& cold_functions) {
+    size_t count = cfg.GetBlockCount();
+    if (count <= kFirstBlock) {
+        return;
+    }
+    auto info = FindNaturalLoops(cfg);
+
+    std::vector<std::map<size_t, double>> probabilities(count);
+    for (size_t id = kFirstBlock; id < count; ++id) {
+        const auto& instr = cfg.GetBlock(id).instructions.back();
+        auto& edges = probabilities[id];
+        if (instr.GetOp() == Op::If || instr.GetOp() == Op::IfFalse) {
+            size_t taken = *cfg.FindBlockByLabel(instr.GetLabel());
+            size_t fallthrough = id + 1 < count ? id + 1 : kExitBlock;
+            double probability = EstimateBranchProbability(cfg, info, id, taken,
+                                                           fallthrough, cold_functions);
+            edges[taken] += probability;
+            edges[fallthrough] += 1 - probability;
+        } else if (instr.GetOp() == Op::JumpTable) {
+            const auto& targets = instr.GetTargets();
+            for (const auto& target : targets) {
+                edges[*cfg.FindBlockByLabel(target)] += 1.0 / targets.size();
+            }
+        } else {
+            for (size_t successor : cfg.GetSuccessors(id)) {
+                edges[successor] = 1;
+            }
+        }
+    }
+
+    // Gauss-Seidel iteration of freq(b) = sum over edges p->b of freq(p) * prob(p->b);
+    // loops converge geometrically with their back edge probability.
+    std::vector<double> frequencies(count);
+    for (int round = 0; round < kMaxPropagationRounds; ++round) {
+        bool changed = false;
+        for (size_t id = kFirstBlock; id < count; ++id) {
+            double frequency = id == kFirstBlock ? 1 : 0;
+            for (size_t predecessor : cfg.GetPredecessors(id)) {
+                if (predecessor >= kFirstBlock) {
+                    frequency +=
+                        frequencies[predecessor] * probabilities[predecessor][id];
+                }
+            }
+            frequency = std::min(frequency, kMaxFrequency);
+            changed |= std::abs(frequency - frequencies[id]) > 1e-9 * frequency;
+            frequencies[id] = frequency;
+        }
+        if (!changed) {
+            break;
+        }
+    }
+
+    for (size_t id = kFirstBlock; id < count; ++id) {
+        auto& block = cfg.GetBlock(id);
+        block.frequency = frequencies[id];
+        block.edge_frequencies.clear();
+        for (auto [successor, probability] : probabilities[id]) {
+            block.edge_frequencies[successor] = frequencies[id] * probability;
+        }
+    }
+}
+
+}  // namespace cfg
+
+namespace cfg::transforms {
+
+namespace {
+
+// Chains whose blocks all run less often than this per call go to the end.
+constexpr double kColdFrequency = 0.05;
+// Loop headers running at least this often per call start on a 16-byte boundary.
+constexpr double kHotLoopFrequency = 4;
+constexpr int kLoopAlignment = 4;
+// Instructions the cold chains need before they are worth moving out of the function.
+constexpr size_t kMinColdPartSize = 8;
+
+struct WeightedEdge {
+    double weight;
+    size_t from;
+    size_t to;
+};
+
+}  // namespace
+
+bool PlaceBlocks(ControlFlowGraph& cfg, const LayoutOptions& options) {
+    size_t count = cfg.GetBlockCount();
+    if (count <= kFirstBlock + 1) {
+        return false;
+    }
+    auto original = cfg.GetInstructions();
+
+    // Only edges that can become fallthroughs join chains; the first block stays first.
+    std::vector<WeightedEdge> edges;
+    for (size_t id = kFirstBlock; id < count; ++id) {
+        auto op = cfg.GetBlock(id).instructions.back().GetOp();
+        if (op == Op::Return || op == Op::JumpTable) {
+            continue;
+        }
+        for (auto [successor, weight] : cfg.GetBlock(id).edge_frequencies) {
+            if (successor > kFirstBlock) {
+                edges.push_back({.weight = weight, .from = id, .to = successor});
+            }
+        }
+    }
+    std::stable_sort(edges.begin(), edges.end(), [](const auto& lhs, const auto& rhs) {
+        return lhs.weight > rhs.weight;
+    });
+
+    // A chain is kept under the id of its first block.
+    std::vector<std::vector<size_t>> chains(count);
+    std::vector<size_t> chain_of(count);
+    for (size_t id = kFirstBlock; id < count; ++id) {
+        chains[id] = {id};
+        chain_of[id] = id;
+    }
+    for (const auto& edge : edges) {
+        size_t from = chain_of[edge.from];
+        size_t to = chain_of[edge.to];
+        if (from == to || chains[from].back() != edge.from || to != edge.to) {
+            continue;
+        }
+        for (size_t id : chains[to]) {
+            chain_of[id] = from;
+        }
+        chains[from].insert(chains[from].end(), chains[to].begin(), chains[to].end());
+        chains[to].clear();
+    }
+
+    // The first chain starts the function. The others follow the chain they are most
+    // strongly connected to, and rarely executed chains go last.
+    double entry_frequency = cfg.GetBlock(kFirstBlock).frequency;
+    auto is_hot = [&](size_t head) {
+        return std::any_of(chains[head].begin(), chains[head].end(), [&](size_t id) {
+            return cfg.GetBlock(id).frequency >= kColdFrequency * entry_frequency;
+        });
+    };
+    std::vector<size_t> order;
+    std::vector<size_t> position(count);
+    std::vector<bool> is_placed(count);
+    auto place = [&](size_t head) {
+        for (size_t id : chains[head]) {
+            position[id] = order.size();
+            order.push_back(id);
+            is_placed[id] = true;
+        }
+    };
+    place(kFirstBlock);
+    while (true) {
+        std::optional<size_t> best;
+        double best_weight = -1;
+        for (size_t head = kFirstBlock; head < count; ++head) {
+            if (chains[head].empty() || is_placed[head] || !is_hot(head)) {
+                continue;
+            }
+            double weight = 0;
+            for (size_t id : chains[head]) {
+                for (size_t from : cfg.GetPredecessors(id)) {
+                    if (from >= kFirstBlock && is_placed[from]) {
+                        weight += cfg.GetBlock(from).edge_frequencies[id];
+                    }
+                }
+            }
+            if (weight > best_weight) {
+                best = head;
+                best_weight = weight;
+            }
+        }
+        if (!best) {
+            break;
+        }
+        place(*best);
+    }
+    size_t hot_count = order.size();
+    for (size_t head = kFirstBlock; head < count; ++head) {
+        if (!chains[head].empty() && !is_placed[head]) {
+            place(head);
+        }
+    }
+
+    // Jump tables are not split: their entries are offsets within one section.
+    size_t cold_size = 0;
+    bool has_jump_table = false;
+    for (size_t index = 0; index < order.size(); ++index) {
+        const auto& instructions = cfg.GetBlock(order[index]).instructions;
+        has_jump_table |= instructions.back().GetOp() == Op::JumpTable;
+        if (index >= hot_count) {
+            cold_size += std::count_if(
+                instructions.begin(), instructions.end(),
+                [](const auto& instr) { return instr.GetOp() != Op::Label; });
+        }
+    }
+    bool split = options.split_cold && !has_jump_table && cold_size >= kMinColdPartSize;
+
+    size_t label_count = 0;
+    auto get_label = [&](size_t id) {
+        auto& block = cfg.GetBlock(id);
+        if (block.label.empty()) {
+            block.label = transforms::MakeLabel(cfg, "layout", label_count);
+            block.instructions.insert(block.instructions.begin(),
+                                      TACInstruction::Label(block.label));
+        }
+        return block.label;
+    };
+
+    // Falling off the end of the function returns, which stays true for a block that
+    // moves away from the end.
+    for (size_t index = 0; index < order.size(); ++index) {
+        size_t id = order[index];
+        std::optional<size_t> next;
+        if (index + 1 < order.size() && !(split && index + 1 == hot_count)) {
+            next = order[index + 1];
+        }
+        auto& instructions = cfg.GetBlock(id).instructions;
+        auto last = instructions.back();
+        size_t fallthrough = id + 1 < count ? id + 1 : kExitBlock;
+        auto jump_to_fallthrough = [&]() {
+            if (fallthrough == kExitBlock) {
+                return TACInstruction::Return();
+            }
+            return TACInstruction::GoTo(get_label(fallthrough));
+        };
+
+        if (last.GetOp() == Op::GoTo) {
+            if (cfg.FindBlockByLabel(last.GetLabel()) == next) {
+                instructions.pop_back();
+            }
+        } else if (last.GetOp() == Op::If || last.GetOp() == Op::IfFalse) {
+            if (fallthrough == next) {
+                continue;
+            }
+            if (cfg.FindBlockByLabel(last.GetLabel()) == next &&
+                fallthrough != kExitBlock) {
+                auto label = get_label(fallthrough);
+                auto expected = last.GetExpectedCondition();
+                instructions.back() =
+                    last.GetOp() == Op::If
+                        ? TACInstruction::IfFalse(label, last.GetLhs(), expected)
+                        : TACInstruction::If(label, last.GetLhs(), expected);
+            } else {
+                instructions.push_back(jump_to_fallthrough());
+            }
+        } else if (last.GetOp() != Op::Return && last.GetOp() != Op::JumpTable &&
+                   fallthrough != next) {
+            instructions.push_back(jump_to_fallthrough());
+        }
+    }
+
+    for (size_t id : order) {
+        auto& block = cfg.GetBlock(id);
+        const auto& predecessors = cfg.GetPredecessors(id);
+        bool is_loop_header =
+            std::any_of(predecessors.begin(), predecessors.end(), [&](size_t from) {
+                return from >= kFirstBlock && position[from] >= position[id];
+            });
+        if (options.align_loops && is_loop_header && !block.label.empty() &&
+            block.frequency >= kHotLoopFrequency * entry_frequency) {
+            block.instructions.front() =
+                TACInstruction::Label(block.label, kLoopAlignment);
+        }
+    }
+
+    // Conditional branches cannot reach into the other section, so those crossing over
+    // go through a jump placed at the end of their own part.
+    std::vector<TACInstruction> hot_jumps;
+    std::vector<TACInstruction> cold_jumps;
+    if (split) {
+        std::unordered_map<std::string, size_t> block_of;
+        for (size_t id : order) {
+            block_of[cfg.GetBlock(id).label] = id;
+        }
+        size_t jump_count = 0;
+        for (size_t id : order) {
+            bool is_cold = position[id] >= hot_count;
+            for (auto& instr : cfg.GetBlock(id).instructions) {
+                if ((instr.GetOp() != Op::If && instr.GetOp() != Op::IfFalse) ||
+                    (position[block_of.at(instr.GetLabel())] >= hot_count) == is_cold) {
+                    continue;
+                }
+                auto label = transforms::MakeLabel(cfg, "split", jump_count);
+                auto& jumps = is_cold ? cold_jumps : hot_jumps;
+                jumps.push_back(TACInstruction::Label(label));
+                jumps.push_back(TACInstruction::GoTo(instr.GetLabel()));
+                instr.SetLabel(label);
+            }
+        }
+        size_t first_cold = order[hot_count];
+        auto cold_label = get_label(first_cold);
+        cfg.GetBlock(first_cold).instructions.front() =
+            TACInstruction::ColdLabel(cold_label);
+    }
+
+    std::vector<TACInstruction> instructions;
+    for (size_t index = 0; index < order.size(); ++index) {
+        if (split && index == hot_count) {
+            instructions.insert(instructions.end(), hot_jumps.begin(), hot_jumps.end());
+        }
+        const auto& block = cfg.GetBlock(order[index]).instructions;
+        instructions.insert(instructions.end(), block.begin(), block.end());
+    }
+    instructions.insert(instructions.end(), cold_jumps.begin(), cold_jumps.end());
+    cfg.Clear();
+    cfg.BuildBlocks(instructions);
+    cfg.BuildEdges();
+    return instructions != original;
+}
+
+}  // namespace cfg::transforms
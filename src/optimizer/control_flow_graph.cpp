@@ -13,7 +13,8 @@ static const std::unordered_set<TACInstruction::OpCode> block_start_opcodes = {
 
 static const std::unordered_set<TACInstruction::OpCode> block_end_opcodes = {
     TACInstruction::OpCode::GoTo, TACInstruction::OpCode::If,
-    TACInstruction::OpCode::IfFalse, TACInstruction::OpCode::Return};
+    TACInstruction::OpCode::IfFalse, TACInstruction::OpCode::JumpTable,
+    TACInstruction::OpCode::Return};
 
 ControlFlowGraph::ControlFlowGraph() {}
 
@@ -37,7 +38,7 @@ void ControlFlowGraph::BuildBlocks(const std::vector<TACInstruction>& instructio
 
         if (block_start_opcodes.contains(op)) {
             current_block.label = instr.GetLabel();
-            label_to_block_[current_block.label] = current_block.id;
+            label_to_block_[instr.GetLabelName()] = current_block.id;
         }
 
         current_block.instructions.push_back(instr);
@@ -72,7 +73,7 @@ void ControlFlowGraph::BuildEdges() {
         auto& instr = blocks_[index].instructions[instr_index];
         auto op = instr.GetOp();
         if (op == TACInstruction::OpCode::GoTo) {
-            size_t next_index = label_to_block_[instr.GetLabel()];
+            size_t next_index = label_to_block_[instr.GetLabelName()];
             AddEdge(index, next_index);
         } else if (op == TACInstruction::OpCode::If ||
                    op == TACInstruction::OpCode::IfFalse) {
@@ -82,8 +83,12 @@ void ControlFlowGraph::BuildEdges() {
                 AddEdge(index, exit_index);
             }
 
-            size_t next_index = label_to_block_[instr.GetLabel()];
+            size_t next_index = label_to_block_[instr.GetLabelName()];
             AddEdge(index, next_index);
+        } else if (op == TACInstruction::OpCode::JumpTable) {
+            for (const auto& target : instr.GetTargets()) {
+                AddEdge(index, label_to_block_[target]);
+            }
         } else if (op == TACInstruction::OpCode::Return) {
             AddEdge(index, exit_index);
         } else {
@@ -102,7 +107,7 @@ Block& ControlFlowGraph::GetBlock(size_t id) { return blocks_[id]; }
 
 size_t ControlFlowGraph::GetBlockCount() const { return blocks_.size(); }
 
-std::optional<size_t> ControlFlowGraph::FindBlockByLabel(const std::string& label) const {
+std::optional<size_t> ControlFlowGraph::FindBlockByLabel(InternedString label) const {
     auto it = label_to_block_.find(label);
     if (it == label_to_block_.end()) {
         return std::nullopt;
@@ -1,9 +1,147 @@
 #include "include/optimizer/control_flow_utils.h"
 
+#include <algorithm>
+#include <string>
+#include <unordered_map>
 #include <unordered_set>
 
 namespace cfg::transforms {
 
+namespace {
+
+using Op = TACInstruction::OpCode;
+
+// Instructions copied onto one threaded edge from the blocks it skips.
+constexpr size_t kMaxThreadedInstructions = 4;
+
+// Identifiers whose truth value is known, mapped to that value.
+using KnownConditions = std::unordered_map<std::string, bool>;
+
+bool IsTrue(const NumericConstant& constant) {
+    return constant.IsFloatingPoint() ? constant.AsDouble() != 0.0
+                                      : constant.AsUInt64() != 0;
+}
+
+void UpdateKnownConditions(const TACInstruction& instr, KnownConditions& known) {
+    if (instr.GetOp() == Op::Call) {
+        known.clear();  // may write any static
+    }
+    if (instr.GetOp() == Op::Label || instr.GetOp() == Op::Function ||
+        instr.GetOp() == Op::StaticVariable || !instr.GetDst().IsIdentifier() ||
+        instr.GetDst().Empty()) {
+        return;
+    }
+    const auto& name = instr.GetDst().AsIdentifier();
+    if (instr.GetOp() == Op::Assign && instr.GetLhs().IsConstant()) {
+        known[name] = IsTrue(instr.GetLhs().AsConstant());
+    } else {
+        known.erase(name);
+    }
+}
+
+std::optional<bool> GetKnownCondition(const TACOperand& condition,
+                                      const KnownConditions& known) {
+    if (condition.IsConstant()) {
+        return IsTrue(condition.AsConstant());
+    }
+    auto it = known.find(condition.AsIdentifier());
+    if (it == known.end()) {
+        return std::nullopt;
+    }
+    return it->second;
+}
+
+struct ThreadedEdge {
+    size_t target;
+    std::vector<TACInstruction> copies;
+    bool jumps = false;  // the walk went through a jump or a resolved branch
+};
+
+// Follows an edge into `start` through blocks that only jump on, or that end in a
+// branch whose outcome is known on the edge, collecting their other instructions.
+// Blocks that fall through are only passed when a jump follows them or they hold
+// nothing but a label. Returns the edge unchanged when the walk runs into a cycle.
+ThreadedEdge ThreadEdge(const ControlFlowGraph& cfg, size_t start, KnownConditions known,
+                        size_t budget) {
+    ThreadedEdge edge{.target = start};
+    ThreadedEdge walked = edge;
+    std::unordered_set<size_t> visited;
+    size_t current = start;
+    while (current >= 2) {
+        if (!visited.insert(current).second) {
+            return {.target = start};
+        }
+        const auto& instructions = cfg.GetBlock(current).instructions;
+        size_t first = !instructions.empty() && instructions[0].GetOp() == Op::Label;
+        if (instructions.empty() || instructions.back().GetOp() == Op::Return ||
+            instructions.back().GetOp() == Op::JumpTable) {
+            break;
+        }
+        const auto& last = instructions.back();
+        bool falls_through = last.GetOp() != Op::GoTo && last.GetOp() != Op::If &&
+                             last.GetOp() != Op::IfFalse;
+        size_t end = instructions.size() - (falls_through ? 0 : 1);
+        if (walked.copies.size() + (end - std::min(first, end)) > budget) {
+            break;
+        }
+
+        auto next_known = known;
+        for (size_t index = first; index < end; ++index) {
+            UpdateKnownConditions(instructions[index], next_known);
+        }
+        std::optional<size_t> next;
+        if (falls_through) {
+            if (current + 1 < cfg.GetBlockCount()) {
+                next = current + 1;
+            }
+        } else if (last.GetOp() == Op::GoTo) {
+            next = cfg.FindBlockByLabel(last.GetLabel());
+        } else {
+            auto condition = GetKnownCondition(last.GetLhs(), next_known);
+            if (!condition) {
+                break;
+            }
+            if (*condition == (last.GetOp() == Op::If)) {
+                next = cfg.FindBlockByLabel(last.GetLabel());
+            } else if (current + 1 < cfg.GetBlockCount()) {
+                next = current + 1;
+            }
+        }
+        if (!next) {
+            break;
+        }
+
+        if (first < end) {
+            walked.copies.insert(walked.copies.end(), instructions.begin() + first,
+                                 instructions.begin() + end);
+        }
+        walked.target = *next;
+        walked.jumps |= !falls_through;
+        if (!falls_through || walked.copies.size() == edge.copies.size()) {
+            edge = walked;
+        }
+        known = std::move(next_known);
+        current = *next;
+    }
+    return edge;
+}
+
+}  // namespace
+
+std::string MakeLabel(const ControlFlowGraph& cfg, const std::string& kind,
+                      size_t& count) {
+    std::string prefix = "label_" + kind + "_";
+    if (cfg.GetBlockCount() > 2 && !cfg.GetBlock(2).instructions.empty() &&
+        cfg.GetBlock(2).instructions.front().GetOp() == Op::Function) {
+        prefix += cfg.GetBlock(2).instructions.front().GetLabel() + "_";
+    }
+    std::string label;
+    do {
+        label = prefix + std::to_string(count++);
+    } while (cfg.FindBlockByLabel(label));
+    return label;
+}
+
 void RemoveUnreachableBlocks(ControlFlowGraph& cfg) {
     cfg.MarkAliveBlocks();
     std::unordered_set<size_t> ids_to_remove;
@@ -54,7 +192,8 @@ void RemoveRedundantLabels(ControlFlowGraph& cfg) {
                                   .GetOp();
                     if (op != TACInstruction::OpCode::GoTo &&
                         op != TACInstruction::OpCode::If &&
-                        op != TACInstruction::OpCode::IfFalse) {
+                        op != TACInstruction::OpCode::IfFalse &&
+                        op != TACInstruction::OpCode::JumpTable) {
                         std::vector<TACInstruction> new_instructions;
                         for (size_t instr_index = 1;
                              instr_index < block.instructions.size(); ++instr_index) {
@@ -78,4 +217,83 @@ void RemoveEmptyBlocks(ControlFlowGraph& cfg) {
     cfg.RemoveBlocks(ids_to_remove);
 }
 
-}  // namespace cfg::transforms
\ No newline at end of file
+void ThreadJumps(ControlFlowGraph& cfg) {
+    size_t label_count = 0;
+    auto get_label = [&](size_t id) {
+        auto& block = cfg.GetBlock(id);
+        if (block.label.empty()) {
+            block.label = MakeLabel(cfg, "thread", label_count);
+            block.instructions.insert(block.instructions.begin(),
+                                      TACInstruction::Label(block.label));
+        }
+        return block.label;
+    };
+
+    bool changed = false;
+    for (size_t index = 2; index < cfg.GetBlockCount(); ++index) {
+        auto& instructions = cfg.GetBlock(index).instructions;
+        if (instructions.empty()) {
+            continue;
+        }
+        auto last = instructions.back();
+        auto op = last.GetOp();
+        KnownConditions known;
+        for (const auto& instr : instructions) {
+            UpdateKnownConditions(instr, known);
+        }
+
+        if (op == Op::If || op == Op::IfFalse || op == Op::JumpTable) {
+            // Nothing can be copied onto one edge of a conditional jump.
+            auto targets = op == Op::JumpTable ? last.GetTargets()
+                                               : std::vector{last.GetLabel()};
+            if (op != Op::JumpTable && last.GetLhs().IsIdentifier()) {
+                known[last.GetLhs().AsIdentifier()] = op == Op::If;
+            }
+            bool retargeted = false;
+            for (auto& target : targets) {
+                auto edge = ThreadEdge(cfg, *cfg.FindBlockByLabel(target), known, 0);
+                if (cfg.GetBlock(edge.target).label != target) {
+                    target = get_label(edge.target);
+                    retargeted = true;
+                }
+            }
+            if (retargeted) {
+                if (op == Op::JumpTable) {
+                    last.SetTargets(std::move(targets));
+                } else {
+                    last.SetLabel(targets.front());
+                }
+                cfg.GetBlock(index).instructions.back() = last;
+                changed = true;
+            }
+            continue;
+        }
+
+        if (op == Op::Return || (op != Op::GoTo && index + 1 >= cfg.GetBlockCount())) {
+            continue;
+        }
+        size_t target =
+            op == Op::GoTo ? *cfg.FindBlockByLabel(last.GetLabel()) : index + 1;
+        auto edge = ThreadEdge(cfg, target, known, kMaxThreadedInstructions);
+        if (edge.target == target || (op != Op::GoTo && !edge.jumps)) {
+            continue;
+        }
+        auto label = get_label(edge.target);
+        auto& block = cfg.GetBlock(index).instructions;
+        if (op == Op::GoTo) {
+            block.pop_back();
+        }
+        block.insert(block.end(), edge.copies.begin(), edge.copies.end());
+        block.push_back(TACInstruction::GoTo(label));
+        changed = true;
+    }
+
+    if (changed) {
+        auto instructions = cfg.GetInstructions();
+        cfg.Clear();
+        cfg.BuildBlocks(instructions);
+        cfg.BuildEdges();
+    }
+}
+
+}  // namespace cfg::transforms
@@ -0,0 +1,367 @@
+#include "include/optimizer/edge_profile.h"
+
+#include <algorithm>
+#include <fstream>
+#include <numeric>
+#include <optional>
+
+#include "include/optimizer/control_flow_utils.h"
+#include "include/types/primitive_type.h"
+
+bool ProfileData::Load(const std::string& path) {
+    std::ifstream in(path);
+    if (!in.is_open()) {
+        error_ = "cannot open profile data file " + path;
+        return false;
+    }
+
+    std::string keyword;
+    while (in >> keyword) {
+        uint64_t id = 0;
+        FunctionProfile profile;
+        size_t count = 0;
+        if (keyword != "function" || !(in >> id >> profile.checksum >> count)) {
+            error_ = "malformed profile data in " + path;
+            return false;
+        }
+        // The count is not trusted for allocation; a truncated record fails on read.
+        for (size_t index = 0; index < count; ++index) {
+            uint64_t counter = 0;
+            if (!(in >> counter)) {
+                error_ = "malformed profile data in " + path;
+                return false;
+            }
+            profile.counters.push_back(counter);
+        }
+
+        // A record from a rebuilt program replaces the counts of the old one.
+        auto [it, inserted] = functions_.try_emplace(id, profile);
+        auto& existing = it->second;
+        if (inserted) {
+            continue;
+        }
+        if (existing.checksum != profile.checksum ||
+            existing.counters.size() != profile.counters.size()) {
+            existing = std::move(profile);
+            continue;
+        }
+        for (size_t index = 0; index < count; ++index) {
+            existing.counters[index] += profile.counters[index];
+        }
+    }
+    return true;
+}
+
+const std::string& ProfileData::GetError() const { return error_; }
+
+const FunctionProfile* ProfileData::Find(const std::string& function) const {
+    auto it = functions_.find(cfg::GetProfileId(function));
+    return it == functions_.end() ? nullptr : &it->second;
+}
+
+namespace cfg {
+
+namespace {
+
+using Op = TACInstruction::OpCode;
+
+constexpr size_t kEntryBlock = 0;
+constexpr size_t kExitBlock = 1;
+constexpr size_t kFirstBlock = 2;
+
+// FNV-1a. Ids and checksums travel through signed longs in the runtime.
+constexpr uint64_t kHashBasis = 0xcbf29ce484222325;
+constexpr uint64_t kHashPrime = 0x100000001b3;
+constexpr uint64_t kHashMask = ~uint64_t{0} >> 1;
+
+uint64_t HashCombine(uint64_t hash, uint64_t value) {
+    for (int byte = 0; byte < 8; ++byte) {
+        hash = (hash ^ ((value >> (byte * 8)) & 0xff)) * kHashPrime;
+    }
+    return hash;
+}
+
+struct ProfileEdge {
+    size_t from;
+    size_t to;
+    double weight;
+    bool counted = true;
+};
+
+// Every edge of the graph plus the edge from the exit back to the entry, which closes
+// the flow and is never counted. Edges that are not counted form a maximum spanning
+// tree, so the counters end up on the rarely taken edges.
+std::vector<ProfileEdge> SelectCountedEdges(const ControlFlowGraph& cfg) {
+    size_t count = cfg.GetBlockCount();
+    std::vector<ProfileEdge> edges = {{.from = kExitBlock, .to = kEntryBlock}};
+    for (size_t from = 0; from < count; ++from) {
+        for (size_t to : cfg.GetSuccessors(from)) {
+            const auto& frequencies = cfg.GetBlock(from).edge_frequencies;
+            auto it = frequencies.find(to);
+            double weight = it != frequencies.end() ? it->second : 0;
+            if (from == kEntryBlock) {
+                weight = cfg.GetBlock(to).frequency;
+            }
+            edges.push_back({.from = from, .to = to, .weight = weight});
+        }
+    }
+
+    std::vector<size_t> order(edges.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin() + 1, order.end(), [&](size_t lhs, size_t rhs) {
+        return edges[lhs].weight > edges[rhs].weight;
+    });
+    std::vector<size_t> parent(count);
+    std::iota(parent.begin(), parent.end(), 0);
+    auto find = [&](size_t id) {
+        while (parent[id] != id) {
+            id = parent[id] = parent[parent[id]];
+        }
+        return id;
+    };
+    for (size_t index : order) {
+        size_t from = find(edges[index].from);
+        size_t to = find(edges[index].to);
+        if (from != to) {
+            parent[from] = to;
+            edges[index].counted = false;
+        }
+    }
+    return edges;
+}
+
+}  // namespace
+
+uint64_t GetProfileId(const std::string& function) {
+    uint64_t hash = kHashBasis;
+    for (char c : function) {
+        hash = (hash ^ static_cast<unsigned char>(c)) * kHashPrime;
+    }
+    return hash & kHashMask;
+}
+
+uint64_t ComputeChecksum(const ControlFlowGraph& cfg) {
+    uint64_t hash = HashCombine(kHashBasis, cfg.GetBlockCount());
+    for (size_t id = 0; id < cfg.GetBlockCount(); ++id) {
+        hash = HashCombine(hash, cfg.GetBlock(id).instructions.size());
+        for (size_t successor : cfg.GetSuccessors(id)) {
+            hash = HashCombine(hash, successor);
+        }
+    }
+    return hash & kHashMask;
+}
+
+std::vector<std::string> InstrumentEdges(ControlFlowGraph& cfg, SymbolTable& symbol_table,
+                                         const std::string& function) {
+    size_t count = cfg.GetBlockCount();
+    auto edges = SelectCountedEdges(cfg);
+
+    size_t label_count = 0;
+    auto make_label = [&]() {
+        return transforms::MakeLabel(cfg, "profile", label_count);
+    };
+    auto get_label = [&](size_t id) {
+        auto& block = cfg.GetBlock(id);
+        if (block.label.empty()) {
+            block.label = make_label();
+            block.instructions.insert(block.instructions.begin(),
+                                      TACInstruction::Label(block.label));
+        }
+        return block.label;
+    };
+
+    // A counter goes at the end of the source block if the edge is its only way out,
+    // at the start of the target if the edge is its only way in, and otherwise into a
+    // new block on the edge: right after a branch for its fallthrough, at the end of
+    // the function for a jump.
+    std::vector<std::vector<TACInstruction>> prologues(count);
+    std::vector<std::vector<TACInstruction>> epilogues(count);
+    std::vector<std::vector<TACInstruction>> fallthroughs(count);
+    std::vector<TACInstruction> trailer;
+    std::vector<std::string> counters;
+    for (const auto& edge : edges) {
+        if (!edge.counted) {
+            continue;
+        }
+        std::string name =
+            "profile.." + function + ".." + std::to_string(counters.size());
+        symbol_table.Register({
+            .name = name,
+            .original_name = name,
+            .linkage = SymbolInfo::LinkageKind::Internal,
+            .duration = SymbolInfo::StorageDuration::Static,
+            .init_state = SymbolInfo::InitialValue::Initial,
+            .init_constant = NumericConstant(0ul),
+            .type = PrimitiveType::GetUInt64(),
+        });
+        counters.push_back(name);
+        auto increment = TACInstruction::Binary(Op::Add, name, name,
+                                                TACOperand(NumericConstant(1ul)));
+
+        if (edge.from == kEntryBlock || cfg.GetSuccessors(edge.from).size() == 1) {
+            auto& block = edge.from == kEntryBlock ? prologues[edge.to]
+                                                   : epilogues[edge.from];
+            block.push_back(increment);
+            continue;
+        }
+        if (edge.to != kExitBlock && cfg.GetPredecessors(edge.to).size() == 1) {
+            prologues[edge.to].push_back(increment);
+            continue;
+        }
+
+        auto op = cfg.GetBlock(edge.from).instructions.back().GetOp();
+        size_t fallthrough = edge.from + 1 < count ? edge.from + 1 : kExitBlock;
+        if ((op == Op::If || op == Op::IfFalse) && edge.to == fallthrough) {
+            fallthroughs[edge.from].push_back(increment);
+            if (edge.to == kExitBlock) {
+                fallthroughs[edge.from].push_back(TACInstruction::Return());
+            }
+            continue;
+        }
+
+        std::string target = get_label(edge.to);
+        std::string split = make_label();
+        trailer.push_back(TACInstruction::Label(split));
+        trailer.push_back(increment);
+        trailer.push_back(TACInstruction::GoTo(target));
+        auto& last = cfg.GetBlock(edge.from).instructions.back();
+        if (op == Op::JumpTable) {
+            auto targets = last.GetTargets();
+            std::replace(targets.begin(), targets.end(), target, split);
+            last.SetTargets(std::move(targets));
+        } else {
+            last.SetLabel(split);
+        }
+    }
+
+    std::vector<TACInstruction> instructions;
+    for (size_t id = kFirstBlock; id < count; ++id) {
+        const auto& block = cfg.GetBlock(id).instructions;
+        auto first_op = block.front().GetOp();
+        auto last_op = block.back().GetOp();
+        size_t head = first_op == Op::Label || first_op == Op::Function ? 1 : 0;
+        size_t tail = block.size();
+        if (last_op == Op::GoTo || last_op == Op::If || last_op == Op::IfFalse ||
+            last_op == Op::Return || last_op == Op::JumpTable) {
+            tail = std::max(head, tail - 1);
+        }
+        instructions.insert(instructions.end(), block.begin(), block.begin() + head);
+        auto& prologue = prologues[id];
+        instructions.insert(instructions.end(), prologue.begin(), prologue.end());
+        instructions.insert(instructions.end(), block.begin() + head,
+                            block.begin() + tail);
+        auto& epilogue = epilogues[id];
+        instructions.insert(instructions.end(), epilogue.begin(), epilogue.end());
+        instructions.insert(instructions.end(), block.begin() + tail, block.end());
+        instructions.insert(instructions.end(), fallthroughs[id].begin(),
+                            fallthroughs[id].end());
+    }
+    if (!trailer.empty()) {
+        auto op = instructions.back().GetOp();
+        if (op != Op::GoTo && op != Op::Return && op != Op::JumpTable) {
+            instructions.push_back(TACInstruction::Return());
+        }
+        instructions.insert(instructions.end(), trailer.begin(), trailer.end());
+    }
+
+    cfg.Clear();
+    cfg.BuildBlocks(instructions);
+    cfg.BuildEdges();
+    return counters;
+}
+
+bool ApplyProfile(ControlFlowGraph& cfg, const FunctionProfile& profile) {
+    auto edges = SelectCountedEdges(cfg);
+    size_t counted = std::count_if(edges.begin(), edges.end(),
+                                   [](const auto& edge) { return edge.counted; });
+    if (profile.checksum != ComputeChecksum(cfg) || profile.counters.size() != counted) {
+        return false;
+    }
+
+    std::vector<std::optional<int64_t>> counts(edges.size());
+    size_t next_counter = 0;
+    for (size_t index = 0; index < edges.size(); ++index) {
+        if (edges[index].counted) {
+            counts[index] = static_cast<int64_t>(profile.counters[next_counter++]);
+        }
+    }
+
+    // Each uncounted edge closes the tree at some block whose other edges are known:
+    // its count is the difference between the flow into and out of that block.
+    size_t count = cfg.GetBlockCount();
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (size_t id = 0; id < count; ++id) {
+            size_t unknown = 0;
+            size_t unknown_count = 0;
+            int64_t balance = 0;  // known inflow minus known outflow
+            for (size_t index = 0; index < edges.size(); ++index) {
+                if (edges[index].from != id && edges[index].to != id) {
+                    continue;
+                }
+                if (edges[index].from == edges[index].to) {
+                    continue;  // counted, and in as often as out
+                }
+                if (!counts[index]) {
+                    unknown = index;
+                    ++unknown_count;
+                } else {
+                    balance += edges[index].to == id ? *counts[index] : -*counts[index];
+                }
+            }
+            if (unknown_count != 1) {
+                continue;
+            }
+            int64_t value = edges[unknown].to == id ? -balance : balance;
+            counts[unknown] = std::max<int64_t>(value, 0);
+            changed = true;
+        }
+    }
+
+    std::optional<int64_t> entry_count;
+    for (size_t index = 0; index < edges.size(); ++index) {
+        if (edges[index].from == kEntryBlock && edges[index].to == kFirstBlock) {
+            entry_count = counts[index];
+        }
+    }
+    if (!entry_count || *entry_count == 0) {
+        return false;
+    }
+
+    for (size_t id = 0; id < count; ++id) {
+        cfg.GetBlock(id).frequency = 0;
+        cfg.GetBlock(id).edge_frequencies.clear();
+    }
+    double scale = 1.0 / static_cast<double>(*entry_count);
+    for (size_t index = 1; index < edges.size(); ++index) {
+        double frequency = static_cast<double>(counts[index].value_or(0)) * scale;
+        cfg.GetBlock(edges[index].from).edge_frequencies[edges[index].to] = frequency;
+        cfg.GetBlock(edges[index].to).frequency += frequency;
+    }
+    return true;
+}
+
+std::vector<TACInstruction> MakeProfileDumpFunction(
+    const std::vector<InstrumentedFunction>& functions) {
+    auto constant = [](uint64_t value) {
+        return TACOperand(NumericConstant(static_cast<long>(value)));
+    };
+    std::vector<TACInstruction> instructions = {
+        TACInstruction::Function(kProfileDumpFunction, 0, true)};
+    for (const auto& function : functions) {
+        auto id = GetProfileId(function.name);
+        instructions.push_back(TACInstruction::Param(constant(id)));
+        instructions.push_back(TACInstruction::Param(constant(function.checksum)));
+        instructions.push_back(TACInstruction::Param(constant(function.counters.size())));
+        instructions.push_back(TACInstruction::Call("", "__mlcc_profile_function", 3));
+        for (const auto& counter : function.counters) {
+            instructions.push_back(TACInstruction::Param(counter));
+            instructions.push_back(TACInstruction::Call("", "__mlcc_profile_counter", 1));
+        }
+    }
+    instructions.push_back(TACInstruction::Return());
+    return instructions;
+}
+
+}  // namespace cfg
@@ -0,0 +1,314 @@
+#include "include/optimizer/inliner.h"
+
+#include <algorithm>
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "include/types/function_type.h"
+
+namespace {
+
+using Op = TACInstruction::OpCode;
+using Inlining = FunctionAttributes::Inlining;
+using Hotness = FunctionAttributes::Hotness;
+
+// Callee sizes in instructions, without labels, up to which calls are inlined.
+constexpr size_t kMaxHintSize = 48;
+constexpr size_t kMaxDefaultSize = 12;
+// Callers stop taking callees that are not always_inline at this size.
+constexpr size_t kMaxCallerSize = 600;
+
+using Function = std::vector<TACInstruction>;
+
+bool IsFunction(const Function& function) {
+    return !function.empty() && function.front().GetOp() == Op::Function;
+}
+
+const std::string& GetName(const Function& function) {
+    return function.front().GetDst().AsIdentifier();
+}
+
+size_t GetSize(const Function& function) {
+    return std::ranges::count_if(function, [](const auto& instr) {
+        return instr.GetOp() != Op::Label && instr.GetOp() != Op::Function;
+    });
+}
+
+std::unordered_set<std::string> GetCallees(const Function& function) {
+    std::unordered_set<std::string> callees;
+    for (const auto& instr : function) {
+        if (instr.GetOp() == Op::Call) {
+            callees.insert(instr.GetLhs().AsIdentifier());
+        }
+    }
+    return callees;
+}
+
+class Inliner {
+public:
+    Inliner(std::vector<Function>& functions, SymbolTable& symbol_table)
+        : functions_(functions), symbol_table_(symbol_table) {
+        for (size_t index = 0; index < functions_.size(); ++index) {
+            if (IsFunction(functions_[index])) {
+                definitions_[GetName(functions_[index])] = index;
+            }
+        }
+    }
+
+    bool Run() {
+        FindRecursiveFunctions();
+        bool changed = false;
+        for (size_t index : GetBottomUpOrder()) {
+            changed |= InlineInto(functions_[index]);
+        }
+        changed |= RemoveUnreferencedFunctions();
+        return changed;
+    }
+
+private:
+    // Functions that can reach themselves through calls to other definitions.
+    void FindRecursiveFunctions() {
+        for (const auto& [name, index] : definitions_) {
+            std::unordered_set<std::string> visited;
+            std::vector<std::string> pending(1, name);
+            while (!pending.empty()) {
+                auto current = std::move(pending.back());
+                pending.pop_back();
+                for (const auto& callee : GetCallees(functions_[definitions_[current]])) {
+                    if (callee == name) {
+                        recursive_.insert(name);
+                    }
+                    if (definitions_.contains(callee) && visited.insert(callee).second) {
+                        pending.push_back(callee);
+                    }
+                }
+            }
+        }
+    }
+
+    // Callees before callers, in the order of the translation unit otherwise.
+    std::vector<size_t> GetBottomUpOrder() const {
+        std::vector<size_t> order;
+        std::unordered_set<std::string> visited;
+        std::function<void(const std::string&)> visit = [&](const std::string& name) {
+            if (!visited.insert(name).second) {
+                return;
+            }
+            size_t index = definitions_.at(name);
+            for (const auto& instr : functions_[index]) {
+                if (instr.GetOp() == Op::Call &&
+                    definitions_.contains(instr.GetLhs().AsIdentifier())) {
+                    visit(instr.GetLhs().AsIdentifier());
+                }
+            }
+            order.push_back(index);
+        };
+        for (const auto& function : functions_) {
+            if (IsFunction(function)) {
+                visit(GetName(function));
+            }
+        }
+        return order;
+    }
+
+    const FunctionAttributes& GetAttributes(const std::string& name) {
+        static const FunctionAttributes kDefault;
+        auto* info = symbol_table_.FindByUniqueName(name);
+        return info ? info->attributes : kDefault;
+    }
+
+    bool ShouldInline(const std::string& caller, size_t caller_size,
+                      const std::string& callee, int num_args) {
+        auto it = definitions_.find(callee);
+        if (it == definitions_.end() || callee == caller || recursive_.contains(callee)) {
+            return false;
+        }
+        const auto& body = functions_[it->second];
+        if (body.front().GetLhs().AsConstant().AsInt64() != num_args) {
+            return false;
+        }
+
+        const auto& attributes = GetAttributes(callee);
+        if (attributes.inlining == Inlining::Always) {
+            return true;
+        }
+        if (attributes.inlining == Inlining::Never ||
+            attributes.hotness == Hotness::Cold ||
+            GetAttributes(caller).hotness == Hotness::Cold) {
+            return false;
+        }
+        size_t size = GetSize(body);
+        size_t limit =
+            attributes.inlining == Inlining::Hint ? kMaxHintSize : kMaxDefaultSize;
+        return size <= limit && caller_size + size <= kMaxCallerSize;
+    }
+
+    bool InlineInto(Function& caller) {
+        std::string name = GetName(caller);
+        bool changed = false;
+        Function result;
+        result.reserve(caller.size());
+        size_t size = GetSize(caller);
+        for (const auto& instr : caller) {
+            if (instr.GetOp() != Op::Call) {
+                result.push_back(instr);
+                continue;
+            }
+            const auto& callee = instr.GetLhs().AsIdentifier();
+            auto num_args = instr.GetRhs().AsConstant().AsInt64();
+            bool has_params =
+                static_cast<int64_t>(result.size()) >= num_args + 1 &&
+                std::all_of(result.end() - num_args, result.end(), [](const auto& param) {
+                    return param.GetOp() == Op::Param;
+                });
+            if (!has_params || !ShouldInline(name, size, callee, num_args)) {
+                result.push_back(instr);
+                continue;
+            }
+
+            std::vector<TACOperand> args;
+            for (auto it = result.end() - num_args; it != result.end(); ++it) {
+                args.push_back(it->GetLhs());
+            }
+            result.erase(result.end() - num_args, result.end());
+            auto body =
+                ExpandBody(functions_[definitions_[callee]], args, instr.GetDst());
+            size += GetSize(body);
+            result.insert(result.end(), body.begin(), body.end());
+            changed = true;
+        }
+        if (changed) {
+            caller = std::move(result);
+        }
+        return changed;
+    }
+
+    // The body of `callee` with its automatic variables and labels renamed apart, the
+    // incoming arguments replaced by `args` and returns turned into jumps to the end.
+    Function ExpandBody(const Function& callee, const std::vector<TACOperand>& args,
+                        const TACOperand& result) {
+        std::string site = std::to_string(site_count_++);
+        std::string suffix = "_inline_" + site;
+        std::string end_label = "label_inline_end_" + site;
+        std::unordered_map<std::string, std::string> renamed;
+        auto rename = [&](const TACOperand& operand) -> TACOperand {
+            if (!operand.IsIdentifier() || operand.Empty()) {
+                return operand;
+            }
+            const auto& name = operand.AsIdentifier();
+            if (name.starts_with("arg..")) {
+                return args[std::stoul(name.substr(5))];
+            }
+            auto* info = symbol_table_.FindByUniqueName(name);
+            if (!info || info->HasStaticDuration() ||
+                dynamic_cast<const FunctionType*>(info->type)) {
+                return operand;
+            }
+            auto [it, inserted] = renamed.try_emplace(name, name + "..inline" + site);
+            if (inserted) {
+                SymbolInfo copy = *info;
+                copy.name = it->second;
+                symbol_table_.Register(copy);
+            }
+            return TACOperand(it->second);
+        };
+
+        Function body;
+        bool jumps_to_end = false;
+        for (auto it = callee.begin() + 1; it != callee.end(); ++it) {
+            auto instr = *it;
+            switch (instr.GetOp()) {
+                case Op::Return:
+                    if (!instr.GetLhs().Empty() && !result.Empty()) {
+                        body.push_back(
+                            TACInstruction::Assign(result, rename(instr.GetLhs())));
+                    }
+                    if (it + 1 != callee.end()) {
+                        body.push_back(TACInstruction::GoTo(end_label));
+                        jumps_to_end = true;
+                    }
+                    continue;
+                case Op::Label:
+                case Op::GoTo:
+                case Op::If:
+                case Op::IfFalse:
+                    instr.SetLabel(instr.GetLabel() + suffix);
+                    break;
+                case Op::JumpTable: {
+                    auto targets = instr.GetTargets();
+                    for (auto& target : targets) {
+                        target += suffix;
+                    }
+                    instr.SetTargets(std::move(targets));
+                    break;
+                }
+                case Op::Call:
+                    instr.SetDst(rename(instr.GetDst()));
+                    body.push_back(std::move(instr));
+                    continue;
+                default:
+                    break;
+            }
+            instr.SetDst(rename(instr.GetDst()));
+            instr.SetLhs(rename(instr.GetLhs()));
+            instr.SetRhs(rename(instr.GetRhs()));
+            body.push_back(std::move(instr));
+        }
+        if (jumps_to_end) {
+            body.push_back(TACInstruction::Label(end_label));
+        }
+        return body;
+    }
+
+    // Internal functions nothing refers to any more, and those only they referred to.
+    bool RemoveUnreferencedFunctions() {
+        bool changed = false;
+        bool removed = true;
+        while (removed) {
+            std::unordered_map<std::string, std::unordered_set<std::string>> referrers;
+            for (const auto& function : functions_) {
+                std::string owner = IsFunction(function) ? GetName(function) : "";
+                for (const auto& instr : function) {
+                    for (const auto* operand : {&instr.GetLhs(), &instr.GetRhs()}) {
+                        if (operand->IsIdentifier() && !operand->Empty()) {
+                            referrers[operand->AsIdentifier()].insert(owner);
+                        }
+                    }
+                }
+            }
+            auto is_unreferenced = [&](const Function& function) {
+                if (!IsFunction(function)) {
+                    return false;
+                }
+                const auto& name = GetName(function);
+                auto* info = symbol_table_.FindByUniqueName(name);
+                if (!info || info->linkage != SymbolInfo::LinkageKind::Internal) {
+                    return false;
+                }
+                auto it = referrers.find(name);
+                return it == referrers.end() ||
+                       std::ranges::all_of(it->second, [&](const auto& owner) {
+                           return owner == name;
+                       });
+            };
+            removed = std::erase_if(functions_, is_unreferenced) > 0;
+            changed |= removed;
+        }
+        return changed;
+    }
+
+    std::vector<Function>& functions_;
+    SymbolTable& symbol_table_;
+    std::unordered_map<std::string, size_t> definitions_;
+    std::unordered_set<std::string> recursive_;
+    size_t site_count_ = 0;
+};
+
+}  // namespace
+
+bool InlineCalls(std::vector<std::vector<TACInstruction>>& functions,
+                 SymbolTable& symbol_table) {
+    return Inliner(functions, symbol_table).Run();
+}
@@ -0,0 +1,795 @@
+#include "include/optimizer/loop_transforms.h"
+
+#include <algorithm>
+#include <iterator>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "include/optimizer/value_range.h"
+#include "include/types/primitive_type.h"
+
+namespace cfg {
+
+namespace {
+
+constexpr size_t kExitBlock = 1;
+
+// The block a run of blocks from header to latch leaves for, if the run is a loop.
+std::optional<size_t> FindLoopExit(const ControlFlowGraph& cfg, size_t header,
+                                   size_t latch) {
+    const auto& entries = cfg.GetPredecessors(header);
+    if (entries != std::set<size_t>{header - 1, latch}) {
+        return std::nullopt;
+    }
+    auto is_inside = [&](size_t id) { return id >= header && id <= latch; };
+    std::optional<size_t> exit;
+    for (size_t index = header; index <= latch; ++index) {
+        if (index != header &&
+            !std::ranges::all_of(cfg.GetPredecessors(index), is_inside)) {
+            return std::nullopt;
+        }
+        for (size_t successor : cfg.GetSuccessors(index)) {
+            if (is_inside(successor) || successor == kExitBlock) {
+                continue;
+            }
+            if (exit && *exit != successor) {
+                return std::nullopt;
+            }
+            exit = successor;
+        }
+    }
+    return exit ? exit : latch + 1;
+}
+
+}  // namespace
+
+std::vector<Loop> FindLoops(const ControlFlowGraph& cfg) {
+    std::vector<Loop> loops;
+    for (size_t latch = 3; latch + 1 < cfg.GetBlockCount(); ++latch) {
+        const auto& instructions = cfg.GetBlock(latch).instructions;
+        if (instructions.empty() ||
+            (instructions.back().GetOp() != TACInstruction::OpCode::GoTo &&
+             instructions.back().GetOp() != TACInstruction::OpCode::If)) {
+            continue;
+        }
+        auto header = cfg.FindBlockByLabel(instructions.back().GetLabel());
+        if (!header || *header < 3 || *header > latch) {
+            continue;
+        }
+        if (auto exit = FindLoopExit(cfg, *header, latch)) {
+            loops.push_back({.preheader = *header - 1,
+                             .header = *header,
+                             .latch = latch,
+                             .exit = *exit});
+        }
+    }
+    return loops;
+}
+
+}  // namespace cfg
+
+///////////////////////////////////////////////
+
+namespace cfg::transforms {
+
+namespace {
+
+using Op = TACInstruction::OpCode;
+
+// Instructions a loop may grow to, counting every copy of its body.
+constexpr size_t kMaxUnrolledSize = 128;
+constexpr uint64_t kMaxFullUnrollTrips = 16;
+constexpr int64_t kMaxStep = int64_t{1} << 31;
+
+struct CountedLoop {
+    Loop loop;
+    std::string iv;
+    TypeRef type = nullptr;
+    Op op;  // iv op bound
+    TACOperand bound;
+    int64_t step;
+    std::optional<int64_t> initial;
+    std::optional<int64_t> constant_bound;
+    size_t size;
+};
+
+bool DefinesDst(const TACInstruction& instr) {
+    if (instr.GetOp() == Op::Function || instr.GetOp() == Op::StaticVariable) {
+        return false;
+    }
+    return instr.GetDst().IsIdentifier() && !instr.GetDst().Empty();
+}
+
+bool IsNamed(const TACOperand& operand, const std::string& name) {
+    return operand.IsIdentifier() && operand.AsIdentifier() == name;
+}
+
+bool IsAutomatic(const TACOperand& operand, SymbolTable& symbol_table) {
+    if (operand.IsConstant()) {
+        return true;
+    }
+    auto* info = symbol_table.FindByUniqueName(operand.AsName());
+    return info && !info->HasStaticDuration();
+}
+
+std::optional<int64_t> GetConstant(const TACOperand& operand,
+                                   const ValueRangeAnalysis& ranges) {
+    auto range = ranges.GetRange(operand);
+    if (!range || range->min != range->max) {
+        return std::nullopt;
+    }
+    return range->min;
+}
+
+bool IsOrdering(Op op) {
+    return op == Op::Less || op == Op::LessEqual || op == Op::Greater ||
+           op == Op::GreaterEqual;
+}
+
+Op SwapComparison(Op op) {
+    switch (op) {
+        case Op::Less:
+            return Op::Greater;
+        case Op::LessEqual:
+            return Op::GreaterEqual;
+        case Op::Greater:
+            return Op::Less;
+        default:
+            return Op::LessEqual;
+    }
+}
+
+template <typename T>
+bool Compare(Op op, T lhs, T rhs) {
+    switch (op) {
+        case Op::Less:
+            return lhs < rhs;
+        case Op::LessEqual:
+            return lhs <= rhs;
+        case Op::Greater:
+            return lhs > rhs;
+        default:
+            return lhs >= rhs;
+    }
+}
+
+// Values are kept the way ValueRange holds them: sign- or zero-extended to 64 bits
+// according to the type.
+int64_t Advance(int64_t value, int64_t step, const TypeRef& type) {
+    auto bits = static_cast<uint64_t>(value) + static_cast<uint64_t>(step);
+    if (type->Size() == 8) {
+        return static_cast<int64_t>(bits);
+    }
+    return type->IsSigned() ? int64_t{static_cast<int32_t>(bits)}
+                            : int64_t{static_cast<uint32_t>(bits)};
+}
+
+TACOperand MakeConstant(int64_t value, const TypeRef& type) {
+    NumericConstant constant(static_cast<long>(value));
+    constant.CastTo(type);
+    return TACOperand(constant);
+}
+
+std::unordered_set<std::string> CollectLabels(const ControlFlowGraph& cfg, size_t first,
+                                              size_t last) {
+    std::unordered_set<std::string> labels;
+    for (size_t index = first; index <= last; ++index) {
+        if (!cfg.GetBlock(index).label.empty()) {
+            labels.insert(cfg.GetBlock(index).label);
+        }
+    }
+    return labels;
+}
+
+void RenameLabels(TACInstruction& instr, const std::unordered_set<std::string>& labels,
+                  const std::string& suffix) {
+    auto rename = [&](const std::string& label) {
+        return labels.contains(label) ? label + suffix : label;
+    };
+    switch (instr.GetOp()) {
+        case Op::Label:
+        case Op::GoTo:
+        case Op::If:
+        case Op::IfFalse:
+            instr.SetLabel(rename(instr.GetLabel()));
+            break;
+        case Op::JumpTable: {
+            auto targets = instr.GetTargets();
+            std::ranges::transform(targets, targets.begin(), rename);
+            instr.SetTargets(std::move(targets));
+            break;
+        }
+        default:
+            break;
+    }
+}
+
+std::string AllocateTemporary(SymbolTable& symbol_table, TypeRef type,
+                              const std::string& prefix) {
+    std::string name;
+    for (size_t index = 0;; ++index) {
+        name = prefix + std::to_string(index);
+        if (!symbol_table.FindByUniqueName(name)) {
+            break;
+        }
+    }
+    symbol_table.Register({
+        .name = name,
+        .original_name = name,
+        .type = type,
+    });
+    return name;
+}
+
+// iv + c, c + iv or iv - c.
+std::optional<int64_t> GetStep(const TACInstruction& instr, const std::string& iv,
+                               const ValueRangeAnalysis& ranges) {
+    std::optional<int64_t> step;
+    if (instr.GetOp() == Op::Add && IsNamed(instr.GetLhs(), iv)) {
+        step = GetConstant(instr.GetRhs(), ranges);
+    } else if (instr.GetOp() == Op::Add && IsNamed(instr.GetRhs(), iv)) {
+        step = GetConstant(instr.GetLhs(), ranges);
+    } else if (instr.GetOp() == Op::Sub && IsNamed(instr.GetLhs(), iv)) {
+        step = GetConstant(instr.GetRhs(), ranges);
+        if (step && *step < kMaxStep && *step > -kMaxStep) {
+            step = -*step;
+        }
+    }
+    if (!step || *step == 0 || *step >= kMaxStep || *step <= -kMaxStep) {
+        return std::nullopt;
+    }
+    return step;
+}
+
+std::optional<CountedLoop> AnalyzeLoop(const ControlFlowGraph& cfg, const Loop& loop,
+                                       const ValueRangeAnalysis& ranges,
+                                       SymbolTable& symbol_table) {
+    const auto& header = cfg.GetBlock(loop.header).instructions;
+    if (cfg.GetBlock(loop.latch).instructions.back().GetOp() != Op::GoTo ||
+        header.size() != 3 || !IsOrdering(header[1].GetOp()) ||
+        header[2].GetOp() != Op::IfFalse || !(header[2].GetLhs() == header[1].GetDst()) ||
+        header[2].GetLabel() != cfg.GetBlock(loop.exit).label) {
+        return std::nullopt;
+    }
+
+    std::unordered_map<std::string, int> def_counts;
+    size_t size = 0;
+    for (size_t index = loop.header; index <= loop.latch; ++index) {
+        for (const auto& instr : cfg.GetBlock(index).instructions) {
+            ++size;
+            if (DefinesDst(instr)) {
+                ++def_counts[instr.GetDst().AsIdentifier()];
+            }
+        }
+    }
+    auto count_defs = [&](const TACOperand& operand) {
+        if (!operand.IsIdentifier()) {
+            return 0;
+        }
+        auto it = def_counts.find(operand.AsIdentifier());
+        return it == def_counts.end() ? 0 : it->second;
+    };
+
+    auto op = header[1].GetOp();
+    TACOperand iv_operand = header[1].GetLhs();
+    TACOperand bound = header[1].GetRhs();
+    if (count_defs(bound) != 0) {
+        std::swap(iv_operand, bound);
+        op = SwapComparison(op);
+    }
+    if (!iv_operand.IsIdentifier() || count_defs(iv_operand) != 1 ||
+        count_defs(bound) != 0 || !IsAutomatic(iv_operand, symbol_table) ||
+        !IsAutomatic(bound, symbol_table)) {
+        return std::nullopt;
+    }
+    const auto& iv = iv_operand.AsIdentifier();
+    auto type = ranges.GetType(iv_operand);
+    if (!type || !type->IsIntegral()) {
+        return std::nullopt;
+    }
+
+    // The only definition of iv has to sit in the latch, which every iteration runs.
+    const auto& latch = cfg.GetBlock(loop.latch).instructions;
+    auto def = std::ranges::find_if(latch, [&](const auto& instr) {
+        return DefinesDst(instr) && IsNamed(instr.GetDst(), iv);
+    });
+    if (def == latch.end()) {
+        return std::nullopt;
+    }
+    auto step = GetStep(*def, iv, ranges);
+    auto step_type = ranges.GetType(def->GetLhs());
+    if (!step && def->GetOp() == Op::Assign && def->GetLhs().IsIdentifier() &&
+        step_type && step_type->Size() == type->Size() &&
+        step_type->IsSigned() == type->IsSigned()) {
+        auto temp_def = std::find_if(
+            std::make_reverse_iterator(def), latch.rend(), [&](const auto& instr) {
+                return DefinesDst(instr) && instr.GetDst() == def->GetLhs();
+            });
+        if (temp_def != latch.rend()) {
+            step = GetStep(*temp_def, iv, ranges);
+        }
+    }
+    bool is_increasing = op == Op::Less || op == Op::LessEqual;
+    if (!step || (*step > 0) != is_increasing) {
+        return std::nullopt;
+    }
+
+    std::optional<int64_t> initial;
+    const auto& preheader = cfg.GetBlock(loop.preheader).instructions;
+    auto init = std::ranges::find_if(preheader.rbegin(), preheader.rend(),
+                                     [&](const auto& instr) {
+                                         return DefinesDst(instr) &&
+                                                IsNamed(instr.GetDst(), iv);
+                                     });
+    if (init != preheader.rend() && init->GetOp() == Op::Assign) {
+        initial = GetConstant(init->GetLhs(), ranges);
+    }
+
+    return CountedLoop{
+        .loop = loop,
+        .iv = iv,
+        .type = type,
+        .op = op,
+        .bound = bound,
+        .step = *step,
+        .initial = initial,
+        .constant_bound = GetConstant(bound, ranges),
+        .size = size,
+    };
+}
+
+std::optional<uint64_t> CountTrips(const CountedLoop& counted) {
+    if (!counted.initial || !counted.constant_bound) {
+        return std::nullopt;
+    }
+    int64_t value = *counted.initial;
+    int64_t bound = *counted.constant_bound;
+    for (uint64_t trips = 0; trips <= kMaxFullUnrollTrips; ++trips) {
+        bool taken = counted.type->IsSigned()
+                         ? Compare(counted.op, value, bound)
+                         : Compare(counted.op, static_cast<uint64_t>(value),
+                                   static_cast<uint64_t>(bound));
+        if (!taken) {
+            return trips;
+        }
+        value = Advance(value, counted.step, counted.type);
+    }
+    return std::nullopt;
+}
+
+// One iteration without the header test and the back edge. Labels get `suffix`, and
+// with a known iv value its uses are replaced by constants up to the step.
+std::vector<TACInstruction> CopyBody(const ControlFlowGraph& cfg,
+                                     const CountedLoop& counted,
+                                     const std::string& suffix,
+                                     std::optional<int64_t> iv_value) {
+    const auto& loop = counted.loop;
+    auto labels = CollectLabels(cfg, loop.header + 1, loop.latch);
+
+    std::vector<TACInstruction> body;
+    bool is_stepped = false;
+    for (size_t index = loop.header + 1; index <= loop.latch; ++index) {
+        const auto& instructions = cfg.GetBlock(index).instructions;
+        size_t count = instructions.size() - (index == loop.latch ? 1 : 0);
+        for (size_t instr_index = 0; instr_index < count; ++instr_index) {
+            auto instr = instructions[instr_index];
+            RenameLabels(instr, labels, suffix);
+            if (iv_value && !is_stepped && instr.GetOp() != Op::Call) {
+                auto value = MakeConstant(*iv_value, counted.type);
+                if (IsNamed(instr.GetLhs(), counted.iv)) {
+                    instr.SetLhs(value);
+                }
+                if (IsNamed(instr.GetRhs(), counted.iv)) {
+                    instr.SetRhs(value);
+                }
+            }
+            if (iv_value && DefinesDst(instr) && IsNamed(instr.GetDst(), counted.iv)) {
+                int64_t next = Advance(*iv_value, counted.step, counted.type);
+                instr = TACInstruction::Assign(instr.GetDst(),
+                                               MakeConstant(next, counted.type));
+                is_stepped = true;
+            }
+            body.push_back(std::move(instr));
+        }
+    }
+    return body;
+}
+
+std::vector<TACInstruction> UnrollFully(const ControlFlowGraph& cfg,
+                                        const CountedLoop& counted, uint64_t trips) {
+    std::vector<TACInstruction> region;
+    int64_t value = *counted.initial;
+    for (uint64_t trip = 0; trip < trips; ++trip) {
+        auto body = CopyBody(cfg, counted, "_u" + std::to_string(trip), value);
+        region.insert(region.end(), body.begin(), body.end());
+        value = Advance(value, counted.step, counted.type);
+    }
+    if (counted.loop.exit != counted.loop.latch + 1) {
+        region.push_back(TACInstruction::GoTo(cfg.GetBlock(counted.loop.exit).label));
+    }
+    return region;
+}
+
+// The main loop tests that `factor` more iterations would all pass the header test,
+// which for iv moving by step means iv op bound - (factor - 1) * step. 32-bit values
+// are compared in 64 bits, where neither side can wrap around.
+std::optional<std::vector<TACInstruction>> UnrollPartially(const ControlFlowGraph& cfg,
+                                                           const CountedLoop& counted,
+                                                           SymbolTable& symbol_table,
+                                                           int factor) {
+    bool is_wide = counted.type->Size() == 8;
+    if (is_wide && (!counted.type->IsSigned() || !counted.constant_bound)) {
+        return std::nullopt;
+    }
+
+    std::vector<TACInstruction> region;
+    int64_t distance = counted.step * (factor - 1);
+    auto long_type = PrimitiveType::GetInt64();
+    auto extend = [&](const TACOperand& operand) -> TACOperand {
+        if (is_wide) {
+            return operand;
+        }
+        auto wide = AllocateTemporary(symbol_table, long_type, "unroll..");
+        region.push_back(counted.type->IsSigned()
+                             ? TACInstruction::SignExtend(wide, operand)
+                             : TACInstruction::ZeroExtend(wide, operand));
+        return wide;
+    };
+
+    TACOperand limit("");
+    if (counted.constant_bound) {
+        int64_t value;
+        if (__builtin_sub_overflow(*counted.constant_bound, distance, &value)) {
+            return std::nullopt;
+        }
+        limit = TACOperand(NumericConstant(static_cast<long>(value)));
+    } else {
+        auto bound = extend(counted.bound);
+        limit = AllocateTemporary(symbol_table, long_type, "unroll..");
+        TACOperand offset(NumericConstant(static_cast<long>(distance)));
+        region.push_back(TACInstruction::Binary(Op::Sub, limit, bound, offset));
+    }
+
+    const auto& header_label = cfg.GetBlock(counted.loop.header).label;
+    std::string main_label = header_label + "_unrolled";
+    region.push_back(TACInstruction::Label(main_label));
+    auto iv = extend(counted.iv);
+    auto condition =
+        AllocateTemporary(symbol_table, PrimitiveType::GetInt32(), "unroll..");
+    region.push_back(TACInstruction::Binary(counted.op, condition, iv, limit));
+    region.push_back(TACInstruction::IfFalse(header_label, condition));
+    for (int copy = 0; copy < factor; ++copy) {
+        auto body = CopyBody(cfg, counted, "_u" + std::to_string(copy), std::nullopt);
+        region.insert(region.end(), body.begin(), body.end());
+    }
+    region.push_back(TACInstruction::GoTo(main_label));
+
+    for (size_t index = counted.loop.header; index <= counted.loop.latch; ++index) {
+        const auto& instructions = cfg.GetBlock(index).instructions;
+        region.insert(region.end(), instructions.begin(), instructions.end());
+    }
+    return region;
+}
+
+// Header instructions copied into the latch, not counting the label and the branch.
+constexpr size_t kMaxRotatedHeaderSize = 8;
+
+// The header stays in place as the guard in front of the loop, and the latch runs
+// another copy of its test that branches back to the first body block.
+std::optional<std::vector<TACInstruction>> RotateLoop(const ControlFlowGraph& cfg,
+                                                      const Loop& loop) {
+    const auto& header = cfg.GetBlock(loop.header).instructions;
+    const auto& latch = cfg.GetBlock(loop.latch).instructions;
+    if (latch.back().GetOp() != Op::GoTo || header.size() < 2 ||
+        header.size() - 2 > kMaxRotatedHeaderSize) {
+        return std::nullopt;
+    }
+    const auto& branch = header.back();
+    if ((branch.GetOp() != Op::If && branch.GetOp() != Op::IfFalse) ||
+        branch.GetLabel() != cfg.GetBlock(loop.exit).label) {
+        return std::nullopt;
+    }
+
+    std::vector<TACInstruction> region(header.begin(), header.end());
+    std::string body_label = cfg.GetBlock(loop.header + 1).label;
+    if (body_label.empty()) {
+        body_label = header.front().GetLabel() + "_body";
+        region.push_back(TACInstruction::Label(body_label));
+    }
+    for (size_t index = loop.header + 1; index < loop.latch; ++index) {
+        const auto& instructions = cfg.GetBlock(index).instructions;
+        region.insert(region.end(), instructions.begin(), instructions.end());
+    }
+    region.insert(region.end(), latch.begin(), latch.end() - 1);
+    region.insert(region.end(), header.begin() + 1, header.end() - 1);
+    auto expected = branch.GetExpectedCondition();
+    const auto& condition = branch.GetLhs();
+    region.push_back(branch.GetOp() == Op::IfFalse
+                         ? TACInstruction::If(body_label, condition, expected)
+                         : TACInstruction::IfFalse(body_label, condition, expected));
+    if (loop.exit != loop.latch + 1) {
+        region.push_back(TACInstruction::GoTo(branch.GetLabel()));
+    }
+    return region;
+}
+
+void ReplaceLoop(ControlFlowGraph& cfg, const Loop& loop,
+                 const std::vector<TACInstruction>& region) {
+    std::vector<TACInstruction> instructions;
+    for (size_t index = 0; index < cfg.GetBlockCount(); ++index) {
+        if (index == loop.header) {
+            instructions.insert(instructions.end(), region.begin(), region.end());
+        }
+        if (index < loop.header || index > loop.latch) {
+            const auto& block = cfg.GetBlock(index).instructions;
+            instructions.insert(instructions.end(), block.begin(), block.end());
+        }
+    }
+    cfg.Clear();
+    cfg.BuildBlocks(instructions);
+    cfg.BuildEdges();
+}
+
+bool IsInnermost(const Loop& loop, const std::vector<Loop>& loops) {
+    return std::ranges::none_of(loops, [&](const Loop& other) {
+        return other.header != loop.header && other.header >= loop.header &&
+               other.header <= loop.latch;
+    });
+}
+
+// Loop size, and instructions all unswitching in one function may add.
+constexpr size_t kMaxUnswitchedLoopSize = 64;
+constexpr size_t kMaxUnswitchGrowth = 256;
+
+// Writes to its destination and nothing else, and cannot trap.
+bool IsPure(Op op) {
+    static const std::unordered_set<Op> pure_ops = {
+        Op::Assign,             Op::SignExtend,         Op::ZeroExtend,
+        Op::Truncate,           Op::Add,                Op::Sub,
+        Op::Mul,                Op::Plus,               Op::Minus,
+        Op::Not,                Op::BinaryNot,          Op::Less,
+        Op::LessEqual,          Op::Greater,            Op::GreaterEqual,
+        Op::Equal,              Op::NotEqual,           Op::BitwiseAnd,
+        Op::BitwiseOr,          Op::BitwiseXor,         Op::LeftShift,
+        Op::RightShift,         Op::CountLeadingZeros,  Op::CountTrailingZeros,
+        Op::PopCount,           Op::ByteSwap};
+    return pure_ops.contains(op);
+}
+
+struct LoopDefinitions {
+    std::unordered_map<std::string, int> counts;
+    bool has_calls = false;
+    size_t size = 0;
+};
+
+LoopDefinitions CollectDefinitions(const ControlFlowGraph& cfg, const Loop& loop) {
+    LoopDefinitions defs;
+    for (size_t index = loop.header; index <= loop.latch; ++index) {
+        for (const auto& instr : cfg.GetBlock(index).instructions) {
+            ++defs.size;
+            defs.has_calls |= instr.GetOp() == Op::Call;
+            if (DefinesDst(instr)) {
+                ++defs.counts[instr.GetDst().AsIdentifier()];
+            }
+        }
+    }
+    return defs;
+}
+
+// Whether the operand holds the same value whenever `block[position]` runs. Nothing in
+// the loop may write it (nor call anything, for statics), or its only definition in the
+// loop is a pure instruction on invariant operands earlier in the block. Such
+// definitions are collected into `chain`.
+bool IsInvariant(const TACOperand& operand, const std::vector<TACInstruction>& block,
+                 size_t position, const LoopDefinitions& defs, SymbolTable& symbol_table,
+                 std::set<size_t>& chain) {
+    if (operand.IsConstant()) {
+        return true;
+    }
+    const auto& name = operand.AsIdentifier();
+    auto* info = symbol_table.FindByUniqueName(name);
+    if (!info) {
+        return false;
+    }
+    auto it = defs.counts.find(name);
+    if (it == defs.counts.end()) {
+        return !info->HasStaticDuration() || !defs.has_calls;
+    }
+    if (it->second != 1 || info->HasStaticDuration()) {
+        return false;
+    }
+
+    for (size_t index = position; index-- > 0;) {
+        const auto& instr = block[index];
+        if (!DefinesDst(instr) || !IsNamed(instr.GetDst(), name)) {
+            continue;
+        }
+        if (!IsPure(instr.GetOp())) {
+            return false;
+        }
+        chain.insert(index);
+        auto is_invariant = [&](const TACOperand& source) {
+            return source.Empty() ||
+                   IsInvariant(source, block, index, defs, symbol_table, chain);
+        };
+        return is_invariant(instr.GetLhs()) && is_invariant(instr.GetRhs());
+    }
+    return false;
+}
+
+// A copy of the loop for one outcome of the branch ending `branch_block`.
+void AppendLoopVersion(std::vector<TACInstruction>& region, const ControlFlowGraph& cfg,
+                       const Loop& loop, size_t branch_block, bool condition,
+                       const std::string& suffix) {
+    auto labels = CollectLabels(cfg, loop.header, loop.latch);
+    for (size_t index = loop.header; index <= loop.latch; ++index) {
+        const auto& instructions = cfg.GetBlock(index).instructions;
+        for (size_t instr_index = 0; instr_index < instructions.size(); ++instr_index) {
+            auto instr = instructions[instr_index];
+            RenameLabels(instr, labels, suffix);
+            if (index == branch_block && instr_index + 1 == instructions.size()) {
+                if ((instr.GetOp() == Op::If) != condition) {
+                    continue;
+                }
+                instr = TACInstruction::GoTo(instr.GetLabel());
+            }
+            region.push_back(std::move(instr));
+        }
+    }
+}
+
+// The invariant condition is computed once in front of the loop, into fresh
+// temporaries, and selects between a copy of the loop that always takes the branch and
+// one that never does.
+std::optional<std::vector<TACInstruction>> UnswitchLoop(const ControlFlowGraph& cfg,
+                                                        const Loop& loop,
+                                                        const LoopDefinitions& defs,
+                                                        SymbolTable& symbol_table) {
+    for (size_t index = loop.header; index < loop.latch; ++index) {
+        const auto& block = cfg.GetBlock(index).instructions;
+        const auto& branch = block.back();
+        std::set<size_t> chain;
+        if ((branch.GetOp() != Op::If && branch.GetOp() != Op::IfFalse) ||
+            branch.GetLhs().IsConstant() ||
+            !IsInvariant(branch.GetLhs(), block, block.size() - 1, defs, symbol_table,
+                         chain)) {
+            continue;
+        }
+
+        std::vector<TACInstruction> region;
+        std::unordered_map<std::string, std::string> renamed;
+        auto rename = [&](const TACOperand& operand) {
+            if (operand.IsIdentifier()) {
+                if (auto it = renamed.find(operand.AsIdentifier()); it != renamed.end()) {
+                    return TACOperand(it->second);
+                }
+            }
+            return operand;
+        };
+        for (size_t chain_index : chain) {
+            auto instr = block[chain_index];
+            std::string name = instr.GetDst().AsIdentifier();
+            auto type = symbol_table.FindByUniqueName(name)->type;
+            auto temp = AllocateTemporary(symbol_table, type, "unswitch..");
+            instr.SetLhs(rename(instr.GetLhs()));
+            instr.SetRhs(rename(instr.GetRhs()));
+            instr.SetDst(temp);
+            renamed[name] = temp;
+            region.push_back(std::move(instr));
+        }
+
+        const auto& header_label = cfg.GetBlock(loop.header).label;
+        std::string other_label = header_label + "_unswitched";
+        std::string exit_label = cfg.GetBlock(loop.exit).label;
+        bool has_exit_label = !exit_label.empty();
+        if (!has_exit_label) {
+            exit_label = header_label + "_exit";
+        }
+        region.push_back(TACInstruction::IfFalse(other_label, rename(branch.GetLhs()),
+                                                 branch.GetExpectedCondition()));
+        AppendLoopVersion(region, cfg, loop, index, true, "_t");
+        region.push_back(TACInstruction::GoTo(exit_label));
+        region.push_back(TACInstruction::Label(other_label));
+        AppendLoopVersion(region, cfg, loop, index, false, "_f");
+        if (loop.exit != loop.latch + 1) {
+            region.push_back(TACInstruction::GoTo(exit_label));
+        }
+        if (!has_exit_label) {
+            region.push_back(TACInstruction::Label(exit_label));
+        }
+        return region;
+    }
+    return std::nullopt;
+}
+
+}  // namespace
+
+bool UnrollLoops(ControlFlowGraph& cfg, SymbolTable& symbol_table, int factor) {
+    if (factor < 1) {
+        return false;
+    }
+
+    std::unordered_set<std::string> visited;
+    bool changed = false;
+    bool progress = true;
+    while (progress) {
+        progress = false;
+        auto instructions = cfg.GetInstructions();
+        ValueRangeAnalysis ranges(instructions, symbol_table);
+        auto loops = FindLoops(cfg);
+        for (const auto& loop : loops) {
+            const auto& header_label = cfg.GetBlock(loop.header).label;
+            if (!IsInnermost(loop, loops) || !visited.insert(header_label).second) {
+                continue;
+            }
+            auto counted = AnalyzeLoop(cfg, loop, ranges, symbol_table);
+            if (!counted) {
+                continue;
+            }
+
+            std::optional<std::vector<TACInstruction>> region;
+            auto trips = CountTrips(*counted);
+            if (trips && *trips * counted->size <= kMaxUnrolledSize) {
+                region = UnrollFully(cfg, *counted, *trips);
+            } else if (factor > 1 && counted->size * factor <= kMaxUnrolledSize &&
+                       (!trips || *trips >= static_cast<uint64_t>(factor))) {
+                region = UnrollPartially(cfg, *counted, symbol_table, factor);
+                visited.insert(header_label + "_unrolled");
+            }
+            if (!region) {
+                continue;
+            }
+            ReplaceLoop(cfg, loop, *region);
+            changed = progress = true;
+            break;
+        }
+    }
+    return changed;
+}
+
+bool RotateLoops(ControlFlowGraph& cfg) {
+    bool changed = false;
+    bool progress = true;
+    while (progress) {
+        progress = false;
+        for (const auto& loop : FindLoops(cfg)) {
+            if (auto region = RotateLoop(cfg, loop)) {
+                ReplaceLoop(cfg, loop, *region);
+                changed = progress = true;
+                break;
+            }
+        }
+    }
+    return changed;
+}
+
+bool UnswitchLoops(ControlFlowGraph& cfg, SymbolTable& symbol_table) {
+    size_t growth = 0;
+    bool changed = false;
+    bool progress = true;
+    while (progress) {
+        progress = false;
+        auto loops = FindLoops(cfg);
+        for (const auto& loop : loops) {
+            if (!IsInnermost(loop, loops)) {
+                continue;
+            }
+            auto defs = CollectDefinitions(cfg, loop);
+            if (defs.size > kMaxUnswitchedLoopSize ||
+                growth + defs.size > kMaxUnswitchGrowth) {
+                continue;
+            }
+            if (auto region = UnswitchLoop(cfg, loop, defs, symbol_table)) {
+                ReplaceLoop(cfg, loop, *region);
+                growth += defs.size;
+                changed = progress = true;
+                break;
+            }
+        }
+    }
+    return changed;
+}
+
+}  // namespace cfg::transforms
@@ -1,19 +1,88 @@
 #include "include/optimizer/tac_optimizer.h"
 
+#include <algorithm>
+#include <bit>
+#include <unordered_map>
 #include <unordered_set>
 
+#include "include/optimizer/block_placement.h"
 #include "include/optimizer/control_flow_utils.h"
+#include "include/optimizer/inliner.h"
+#include "include/optimizer/loop_transforms.h"
+
+TACOptimizer::TACOptimizer(SymbolTable& symbol_table) : symbol_table_(symbol_table) {}
+
 void TACOptimizer::Optimize(std::vector<std::vector<TACInstruction>>& instructions) {
+    if (inline_) {
+        InlineCalls(instructions, symbol_table_);
+    }
     cf_graphs_.resize(instructions.size());
+    Simplify(instructions);
+    if (UnswitchLoops(instructions)) {
+        Simplify(instructions);
+    }
+    bool changed = UnrollLoops(instructions);
+    changed |= RotateLoops(instructions);
+    if (changed) {
+        Simplify(instructions);
+    }
+    PlaceBlocks(instructions);
+    PlaceFunctions(instructions);
+}
+
+void TACOptimizer::SetUnrollFactor(int factor) { unroll_factor_ = factor; }
+
+void TACOptimizer::EnableInlining(bool enable) { inline_ = enable; }
+
+void TACOptimizer::EnableInstrumentation(bool enable) { instrument_ = enable; }
+
+void TACOptimizer::SetProfile(const ProfileData* profile) { profile_ = profile; }
+
+void TACOptimizer::Simplify(std::vector<std::vector<TACInstruction>>& instructions) {
     bool changed = true;
-    size_t step = 0;
     while (changed) {
         changed = false;
         changed |= FoldConstants(instructions);
+        changed |= EliminateRedundantExtensions(instructions);
         changed |= EliminateUnreachableCode(instructions);
     }
 }
 
+bool TACOptimizer::UnswitchLoops(
+    std::vector<std::vector<TACInstruction>>& instructions_list) {
+    bool changed = false;
+    for (size_t index = 0; index < instructions_list.size(); ++index) {
+        auto& instructions = instructions_list[index];
+        auto& cfg = cf_graphs_[index];
+        BuildControlFlowGraph(instructions, cfg);
+        if (cfg::transforms::UnswitchLoops(cfg, symbol_table_)) {
+            instructions = cfg.GetInstructions();
+            changed = true;
+        }
+    }
+    return changed;
+}
+
+// Runs once: the epilogue left behind a partially unrolled loop is a counted loop too.
+bool TACOptimizer::UnrollLoops(
+    std::vector<std::vector<TACInstruction>>& instructions_list) {
+    bool changed = false;
+    for (size_t index = 0; index < instructions_list.size(); ++index) {
+        auto& instructions = instructions_list[index];
+        if (instructions.empty() ||
+            instructions.front().GetOp() != TACInstruction::OpCode::Function) {
+            continue;
+        }
+        auto& cfg = cf_graphs_[index];
+        BuildControlFlowGraph(instructions, cfg);
+        if (cfg::transforms::UnrollLoops(cfg, symbol_table_, unroll_factor_)) {
+            instructions = cfg.GetInstructions();
+            changed = true;
+        }
+    }
+    return changed;
+}
+
 bool TACOptimizer::EliminateUnreachableCode(
     std::vector<std::vector<TACInstruction>>& instructions_list) {
     bool changed = false;
@@ -21,6 +90,7 @@ bool TACOptimizer::EliminateUnreachableCode(
         auto& instructions = instructions_list[index];
         auto& cfg = cf_graphs_[index];
         BuildControlFlowGraph(instructions, cfg);
+        cfg::transforms::ThreadJumps(cfg);
         cfg::transforms::RemoveUnreachableBlocks(cfg);
         cfg::transforms::RemoveRedundantGotos(cfg);
         cfg::transforms::RemoveRedundantLabels(cfg);
@@ -35,6 +105,102 @@ bool TACOptimizer::EliminateUnreachableCode(
     return changed;
 }
 
+// After unrolling, which matches loops still tested at the top.
+bool TACOptimizer::RotateLoops(
+    std::vector<std::vector<TACInstruction>>& instructions_list) {
+    bool changed = false;
+    for (size_t index = 0; index < instructions_list.size(); ++index) {
+        auto& instructions = instructions_list[index];
+        auto& cfg = cf_graphs_[index];
+        BuildControlFlowGraph(instructions, cfg);
+        if (cfg::transforms::RotateLoops(cfg)) {
+            instructions = cfg.GetInstructions();
+            changed = true;
+        }
+    }
+    return changed;
+}
+
+// Last: the simplifications above would undo the layout. Counters are placed and
+// read back on the same graphs, so a profile fits the build it came from as long as
+// the optimization options are the same.
+void TACOptimizer::PlaceBlocks(
+    std::vector<std::vector<TACInstruction>>& instructions_list) {
+    // Paths ending the program this way are error paths.
+    std::unordered_set<std::string> cold_functions = {"abort", "exit", "_Exit",
+                                                      "__assert_rtn", "__assert_fail"};
+    for (const auto& info : symbol_table_.GetAllSymbols()) {
+        if (info.attributes.hotness == FunctionAttributes::Hotness::Cold) {
+            cold_functions.insert(info.name);
+        }
+    }
+
+    std::vector<cfg::InstrumentedFunction> instrumented;
+    for (size_t index = 0; index < instructions_list.size(); ++index) {
+        auto& instructions = instructions_list[index];
+        if (instructions.empty() ||
+            instructions.front().GetOp() != TACInstruction::OpCode::Function) {
+            continue;
+        }
+        std::string name = instructions.front().GetDst().AsIdentifier();
+        auto& cfg = cf_graphs_[index];
+        BuildControlFlowGraph(instructions, cfg);
+        cfg::EstimateFrequencies(cfg, cold_functions);
+        if (instrument_) {
+            uint64_t checksum = cfg::ComputeChecksum(cfg);
+            auto counters = cfg::InstrumentEdges(cfg, symbol_table_, name);
+            instrumented.push_back({name, checksum, std::move(counters)});
+            instructions = cfg.GetInstructions();
+            continue;
+        }
+        if (const auto* profile = profile_ ? profile_->Find(name) : nullptr) {
+            cfg::ApplyProfile(cfg, *profile);
+        }
+        bool is_cold = GetHotness(instructions) == FunctionAttributes::Hotness::Cold;
+        if (cfg::transforms::PlaceBlocks(
+                cfg, {.align_loops = !is_cold, .split_cold = !is_cold})) {
+            instructions = cfg.GetInstructions();
+        }
+    }
+
+    if (instrument_) {
+        for (const auto& function : instrumented) {
+            for (const auto& counter : function.counters) {
+                instructions_list.push_back({TACInstruction::StaticVariable(
+                    counter, NumericConstant(0ul), false)});
+            }
+        }
+        instructions_list.push_back(cfg::MakeProfileDumpFunction(instrumented));
+    }
+}
+
+// Hot functions first and cold ones last, so the code that runs shares pages and
+// cache lines.
+void TACOptimizer::PlaceFunctions(std::vector<std::vector<TACInstruction>>& functions) {
+    auto rank = [&](const std::vector<TACInstruction>& function) {
+        switch (GetHotness(function)) {
+            case FunctionAttributes::Hotness::Hot:
+                return 0;
+            case FunctionAttributes::Hotness::Default:
+                return 1;
+            case FunctionAttributes::Hotness::Cold:
+                return 2;
+        }
+        return 1;
+    };
+    std::ranges::stable_sort(functions, {}, rank);
+}
+
+FunctionAttributes::Hotness TACOptimizer::GetHotness(
+    const std::vector<TACInstruction>& function) {
+    if (function.empty() ||
+        function.front().GetOp() != TACInstruction::OpCode::Function) {
+        return FunctionAttributes::Hotness::Default;
+    }
+    const auto* info = symbol_table_.FindByUniqueName(function.front().GetLabel());
+    return info ? info->attributes.hotness : FunctionAttributes::Hotness::Default;
+}
+
 void TACOptimizer::BuildControlFlowGraph(std::vector<TACInstruction>& instructions,
                                          cfg::ControlFlowGraph& cfg) {
     cfg.Clear();
@@ -53,8 +219,14 @@ static const std::unordered_set<TACInstruction::OpCode> binaryOps = {
     TACInstruction::OpCode::LeftShift,    TACInstruction::OpCode::RightShift};
 
 static const std::unordered_set<TACInstruction::OpCode> unaryOps = {
-    TACInstruction::OpCode::Plus, TACInstruction::OpCode::Minus,
-    TACInstruction::OpCode::Not, TACInstruction::OpCode::BinaryNot};
+    TACInstruction::OpCode::Plus,
+    TACInstruction::OpCode::Minus,
+    TACInstruction::OpCode::Not,
+    TACInstruction::OpCode::BinaryNot,
+    TACInstruction::OpCode::CountLeadingZeros,
+    TACInstruction::OpCode::CountTrailingZeros,
+    TACInstruction::OpCode::PopCount,
+    TACInstruction::OpCode::ByteSwap};
 
 bool TACOptimizer::FoldConstants(
     std::vector<std::vector<TACInstruction>>& function_instructions) {
@@ -71,11 +243,23 @@ bool TACOptimizer::FoldConstants(
                 changed |= TryFoldBinary(instruction, instr);
             } else if (unaryOps.contains(op)) {
                 changed |= TryFoldUnary(instruction, instr);
+            } else if (op == TACInstruction::OpCode::SignExtend ||
+                       op == TACInstruction::OpCode::ZeroExtend ||
+                       op == TACInstruction::OpCode::Truncate) {
+                changed |= TryFoldConversion(instruction, instr);
             } else if (op == TACInstruction::OpCode::If ||
                        op == TACInstruction::OpCode::IfFalse) {
                 if (!TryFoldCondition(instruction, instr, changed)) {
                     continue;
                 }
+            } else if (op == TACInstruction::OpCode::JumpTable &&
+                       IsConstant(instruction.GetLhs())) {
+                const auto& targets = instruction.GetTargets();
+                uint64_t index = instruction.GetLhs().AsConstant().AsUInt64();
+                if (index < targets.size()) {
+                    instr = TACInstruction::GoTo(targets[index]);
+                    changed = true;
+                }
             }
             new_instructions.push_back(instr);
         }
@@ -91,12 +275,28 @@ bool TACOptimizer::TryFoldBinary(const TACInstruction& in, TACInstruction& out)
         return false;
     }
 
-    long long lhs = in.GetLhs().AsConstant().AsInt64();
-    long long rhs = in.GetRhs().AsConstant().AsInt64();
-    long long result = EvaluateBinaryOp(in.GetOp(), lhs, rhs);
+    const auto& lhs = in.GetLhs().AsConstant();
+    const auto& rhs = in.GetRhs().AsConstant();
+    auto type = GetType(in.GetDst());
+    if (!type || !type->IsIntegral() || lhs.IsFloatingPoint() || rhs.IsFloatingPoint()) {
+        return false;
+    }
+
+    auto op = in.GetOp();
+    bool is_signed = lhs.IsSigned() && rhs.IsSigned();
+    if (op == TACInstruction::OpCode::Div || op == TACInstruction::OpCode::Mod) {
+        if (rhs.AsUInt64() == 0 || (is_signed && rhs.AsInt64() == -1)) {
+            return false;
+        }
+    }
 
-    out = TACInstruction::Assign(
-        in.GetDst(), TACOperand(NumericConstant(static_cast<long>(result))));
+    uint64_t bits = EvaluateBinaryOp(op, lhs.AsUInt64(), rhs.AsUInt64(), is_signed);
+    NumericConstant result = static_cast<unsigned long>(bits);
+    if (is_signed) {
+        result = NumericConstant(static_cast<long>(bits));
+    }
+    result.CastTo(type);
+    out = TACInstruction::Assign(in.GetDst(), TACOperand(result));
     return true;
 }
 
@@ -105,11 +305,39 @@ bool TACOptimizer::TryFoldUnary(const TACInstruction& in, TACInstruction& out) {
         return false;
     }
 
-    long long operand = in.GetLhs().AsConstant().AsInt64();
-    long long result = EvaluateUnaryOp(in.GetOp(), operand);
+    const auto& operand = in.GetLhs().AsConstant();
+    auto type = GetType(in.GetDst());
+    if (!type || !type->IsIntegral() || operand.IsFloatingPoint()) {
+        return false;
+    }
+
+    uint64_t bits = EvaluateUnaryOp(in.GetOp(), operand.AsUInt64(), type->Size() == 8);
+    NumericConstant result = operand.IsSigned()
+                                 ? NumericConstant(static_cast<long>(bits))
+                                 : NumericConstant(static_cast<unsigned long>(bits));
+    result.CastTo(type);
+    out = TACInstruction::Assign(in.GetDst(), TACOperand(result));
+    return true;
+}
+
+bool TACOptimizer::TryFoldConversion(const TACInstruction& in, TACInstruction& out) {
+    if (!IsConstant(in.GetLhs())) {
+        return false;
+    }
+
+    auto result = in.GetLhs().AsConstant();
+    auto type = GetType(in.GetDst());
+    if (!type || !type->IsIntegral() || result.IsFloatingPoint()) {
+        return false;
+    }
 
-    out = TACInstruction::Assign(
-        in.GetDst(), TACOperand(NumericConstant(static_cast<long>(result))));
+    if (in.GetOp() == TACInstruction::OpCode::ZeroExtend && !result.Is64Bit()) {
+        result = NumericConstant(static_cast<unsigned int>(result.AsUInt64()));
+    } else if (in.GetOp() == TACInstruction::OpCode::SignExtend && !result.Is64Bit()) {
+        result = NumericConstant(static_cast<int>(result.AsInt64()));
+    }
+    result.CastTo(type);
+    out = TACInstruction::Assign(in.GetDst(), TACOperand(result));
     return true;
 }
 
@@ -119,17 +347,19 @@ bool TACOptimizer::TryFoldCondition(const TACInstruction& in, TACInstruction& ou
         return true;
     }
 
-    long long condition = in.GetLhs().AsConstant().AsInt64();
+    const auto& constant = in.GetLhs().AsConstant();
+    bool condition = constant.IsFloatingPoint() ? constant.AsDouble() != 0.0
+                                                : constant.AsUInt64() != 0;
     changed = true;
 
     if (in.GetOp() == TACInstruction::OpCode::If) {
-        if (condition != 0) {
+        if (condition) {
             out = TACInstruction::GoTo(in.GetLabel());
             return true;
         }
         return false;
     } else {
-        if (condition == 0) {
+        if (!condition) {
             out = TACInstruction::GoTo(in.GetLabel());
             return true;
         }
@@ -137,10 +367,200 @@ bool TACOptimizer::TryFoldCondition(const TACInstruction& in, TACInstruction& ou
     }
 }
 
+bool TACOptimizer::EliminateRedundantExtensions(
+    std::vector<std::vector<TACInstruction>>& function_instructions) {
+    bool changed = false;
+    for (auto& instructions : function_instructions) {
+        if (instructions.empty() ||
+            instructions.front().GetOp() != TACInstruction::OpCode::Function) {
+            continue;
+        }
+
+        ValueRangeAnalysis ranges(instructions, symbol_table_);
+        std::vector<TACInstruction> new_instructions;
+        new_instructions.reserve(instructions.size());
+        for (const auto& instruction : instructions) {
+            auto instr = instruction;
+            changed |= TrySimplifyExtension(instruction, ranges, instr) ||
+                       TryNarrowComparison(instruction, ranges, instr);
+            new_instructions.push_back(std::move(instr));
+        }
+        instructions = std::move(new_instructions);
+        changed |= RemoveDeadDefinitions(instructions);
+    }
+    return changed;
+}
+
+// sext/zext/trunc pairs that cancel out, and sign extensions of values whose sign bit
+// is known to be clear (a zero extension is a plain 32-bit move on AArch64).
+bool TACOptimizer::TrySimplifyExtension(const TACInstruction& in,
+                                        const ValueRangeAnalysis& ranges,
+                                        TACInstruction& out) {
+    using Op = TACInstruction::OpCode;
+    auto op = in.GetOp();
+    if (op != Op::SignExtend && op != Op::ZeroExtend && op != Op::Truncate) {
+        return false;
+    }
+
+    const auto& src = in.GetLhs();
+    auto dst_type = GetType(in.GetDst());
+    if (!dst_type || !ranges.IsStable(src)) {
+        return false;
+    }
+
+    if (const auto* def = ranges.GetDefinition(src)) {
+        const auto& inner = def->GetLhs();
+        auto inner_type = inner.IsConstant() ? nullptr : GetType(inner);
+        bool same_width = inner_type && inner_type->Size() == dst_type->Size();
+        if (op == Op::Truncate &&
+            (def->GetOp() == Op::SignExtend || def->GetOp() == Op::ZeroExtend) &&
+            same_width && ranges.IsStable(inner)) {
+            out = TACInstruction::Assign(in.GetDst(), inner);
+            return true;
+        }
+
+        auto src_range = ValueRangeAnalysis::GetTypeRange(GetType(src));
+        auto inner_range = ranges.GetRange(inner);
+        if (op != Op::Truncate && def->GetOp() == Op::Truncate && same_width &&
+            ranges.IsStable(inner) && src_range && inner_range &&
+            inner_range->FitsIn(*src_range)) {
+            out = TACInstruction::Assign(in.GetDst(), inner);
+            return true;
+        }
+    }
+
+    auto range = ranges.GetRange(src);
+    if (op == Op::SignExtend && src.IsIdentifier() && range && range->IsNonNegative()) {
+        out = TACInstruction::ZeroExtend(in.GetDst(), src);
+        return true;
+    }
+    return false;
+}
+
+// "(long)a < (long)b" compares the same way as "a < b" when both sides were widened
+// with the same kind of extension, or one side is known to be a constant that fits
+// the narrow type.
+bool TACOptimizer::TryNarrowComparison(const TACInstruction& in,
+                                       const ValueRangeAnalysis& ranges,
+                                       TACInstruction& out) {
+    using Op = TACInstruction::OpCode;
+    auto op = in.GetOp();
+    if (op != Op::Less && op != Op::LessEqual && op != Op::Greater &&
+        op != Op::GreaterEqual && op != Op::Equal && op != Op::NotEqual) {
+        return false;
+    }
+
+    for (auto extend : {Op::SignExtend, Op::ZeroExtend}) {
+        auto narrow_lhs = GetNarrowOperand(in.GetLhs(), extend, ranges);
+        auto narrow_rhs = GetNarrowOperand(in.GetRhs(), extend, ranges);
+        if (!narrow_lhs && !narrow_rhs) {
+            continue;
+        }
+        auto type = GetType(narrow_lhs ? *narrow_lhs : *narrow_rhs);
+        auto type_range = ValueRangeAnalysis::GetTypeRange(type);
+        if (!type_range || type->Size() != 4) {
+            continue;
+        }
+
+        auto narrow_constant = [&](const TACOperand& wide) -> std::optional<TACOperand> {
+            auto range = ranges.GetRange(wide);
+            if (!range || range->min != range->max || !range->FitsIn(*type_range)) {
+                return std::nullopt;
+            }
+            NumericConstant constant(static_cast<long>(range->min));
+            constant.CastTo(type);
+            return TACOperand(constant);
+        };
+        if (!narrow_lhs) {
+            narrow_lhs = narrow_constant(in.GetLhs());
+        }
+        if (!narrow_rhs) {
+            narrow_rhs = narrow_constant(in.GetRhs());
+        }
+
+        auto other_type = narrow_rhs && narrow_rhs->IsIdentifier() ? GetType(*narrow_rhs)
+                                                                   : type;
+        if (!narrow_lhs || !narrow_rhs || !other_type || other_type->Size() != 4 ||
+            other_type->IsSigned() != type->IsSigned()) {
+            continue;
+        }
+        out = TACInstruction::Binary(op, in.GetDst(), *narrow_lhs, *narrow_rhs);
+        return true;
+    }
+    return false;
+}
+
+std::optional<TACOperand> TACOptimizer::GetNarrowOperand(
+    const TACOperand& operand, TACInstruction::OpCode extend,
+    const ValueRangeAnalysis& ranges) {
+    if (!ranges.IsStable(operand)) {
+        return std::nullopt;
+    }
+    const auto* def = ranges.GetDefinition(operand);
+    if (!def || def->GetOp() != extend || !def->GetLhs().IsIdentifier() ||
+        !ranges.IsStable(def->GetLhs())) {
+        return std::nullopt;
+    }
+    auto type = GetType(def->GetLhs());
+    bool is_signed = extend == TACInstruction::OpCode::SignExtend;
+    if (!type || type->IsSigned() != is_signed) {
+        return std::nullopt;
+    }
+    return def->GetLhs();
+}
+
+// Drops side-effect-free definitions of automatic variables nobody reads.
+bool TACOptimizer::RemoveDeadDefinitions(std::vector<TACInstruction>& instructions) {
+    using Op = TACInstruction::OpCode;
+    static const std::unordered_set<Op> pureOps = {
+        Op::Assign,             Op::SignExtend,         Op::ZeroExtend,
+        Op::Truncate,           Op::Add,                Op::Sub,
+        Op::Mul,                Op::Plus,               Op::Minus,
+        Op::Not,                Op::BinaryNot,          Op::Less,
+        Op::LessEqual,          Op::Greater,            Op::GreaterEqual,
+        Op::Equal,              Op::NotEqual,           Op::BitwiseAnd,
+        Op::BitwiseOr,          Op::BitwiseXor,         Op::CountLeadingZeros,
+        Op::CountTrailingZeros, Op::PopCount,           Op::ByteSwap};
+
+    std::unordered_map<std::string, int> use_counts;
+    for (const auto& instr : instructions) {
+        for (const auto* operand : {&instr.GetLhs(), &instr.GetRhs()}) {
+            if (operand->IsIdentifier() && !operand->Empty()) {
+                ++use_counts[operand->AsIdentifier()];
+            }
+        }
+    }
+
+    auto is_dead = [&](const TACInstruction& instr) {
+        if (!pureOps.contains(instr.GetOp()) || !instr.GetDst().IsIdentifier()) {
+            return false;
+        }
+        const auto& name = instr.GetDst().AsIdentifier();
+        auto* info = symbol_table_.FindByUniqueName(name);
+        return info && !info->HasStaticDuration() && !use_counts.contains(name);
+    };
+    return std::erase_if(instructions, is_dead) > 0;
+}
+
 bool TACOptimizer::IsConstant(const TACOperand& operand) { return operand.IsConstant(); }
 
-long long TACOptimizer::EvaluateBinaryOp(TACInstruction::OpCode op, long long lhs,
-                                         long long rhs) {
+TypeRef TACOptimizer::GetType(const TACOperand& operand) {
+    if (!operand.IsIdentifier() || operand.Empty()) {
+        return nullptr;
+    }
+    if (auto* info = symbol_table_.FindByUniqueName(operand.AsName())) {
+        return info->type;
+    }
+    return nullptr;
+}
+
+// Operands arrive sign- or zero-extended to 64 bits according to their own type, so
+// wrapping 64-bit arithmetic followed by a cast to the destination type gives the
+// same bits as the 32-bit operation would.
+uint64_t TACOptimizer::EvaluateBinaryOp(TACInstruction::OpCode op, uint64_t lhs,
+                                        uint64_t rhs, bool is_signed) {
+    auto slhs = static_cast<int64_t>(lhs);
+    auto srhs = static_cast<int64_t>(rhs);
     switch (op) {
         case TACInstruction::OpCode::Add:
             return lhs + rhs;
@@ -149,21 +569,21 @@ long long TACOptimizer::EvaluateBinaryOp(TACInstruction::OpCode op, long long lh
         case TACInstruction::OpCode::Mul:
             return lhs * rhs;
         case TACInstruction::OpCode::Div:
-            return rhs != 0 ? lhs / rhs : 0;
+            return is_signed ? static_cast<uint64_t>(slhs / srhs) : lhs / rhs;
         case TACInstruction::OpCode::Mod:
-            return rhs != 0 ? lhs % rhs : 0;
+            return is_signed ? static_cast<uint64_t>(slhs % srhs) : lhs % rhs;
         case TACInstruction::OpCode::Equal:
             return lhs == rhs ? 1 : 0;
         case TACInstruction::OpCode::NotEqual:
             return lhs != rhs ? 1 : 0;
         case TACInstruction::OpCode::Less:
-            return lhs < rhs ? 1 : 0;
+            return (is_signed ? slhs < srhs : lhs < rhs) ? 1 : 0;
         case TACInstruction::OpCode::LessEqual:
-            return lhs <= rhs ? 1 : 0;
+            return (is_signed ? slhs <= srhs : lhs <= rhs) ? 1 : 0;
         case TACInstruction::OpCode::Greater:
-            return lhs > rhs ? 1 : 0;
+            return (is_signed ? slhs > srhs : lhs > rhs) ? 1 : 0;
         case TACInstruction::OpCode::GreaterEqual:
-            return lhs >= rhs ? 1 : 0;
+            return (is_signed ? slhs >= srhs : lhs >= rhs) ? 1 : 0;
         case TACInstruction::OpCode::BitwiseAnd:
             return lhs & rhs;
         case TACInstruction::OpCode::BitwiseXor:
@@ -171,25 +591,40 @@ long long TACOptimizer::EvaluateBinaryOp(TACInstruction::OpCode op, long long lh
         case TACInstruction::OpCode::BitwiseOr:
             return lhs | rhs;
         case TACInstruction::OpCode::LeftShift:
-            return lhs << rhs;
+            return lhs << (rhs & 63);
         case TACInstruction::OpCode::RightShift:
-            return lhs >> rhs;
+            if (is_signed) {
+                return static_cast<uint64_t>(slhs >> (rhs & 63));
+            }
+            return lhs >> (rhs & 63);
         default:
             return 0;
     }
 }
 
-long long TACOptimizer::EvaluateUnaryOp(TACInstruction::OpCode op, long long operand) {
+// The bit operations count and swap within the width of the operand; a count of zero
+// bits in 0 is the width, as clz and rbit+clz give.
+uint64_t TACOptimizer::EvaluateUnaryOp(TACInstruction::OpCode op, uint64_t operand,
+                                       bool is_64_bit) {
+    auto narrow = static_cast<uint32_t>(operand);
     switch (op) {
         case TACInstruction::OpCode::Plus:
-            return +operand;
+            return operand;
         case TACInstruction::OpCode::Minus:
-            return -operand;
+            return 0 - operand;
         case TACInstruction::OpCode::Not:
             return operand ? 0 : 1;
         case TACInstruction::OpCode::BinaryNot:
             return ~operand;
+        case TACInstruction::OpCode::CountLeadingZeros:
+            return is_64_bit ? std::countl_zero(operand) : std::countl_zero(narrow);
+        case TACInstruction::OpCode::CountTrailingZeros:
+            return is_64_bit ? std::countr_zero(operand) : std::countr_zero(narrow);
+        case TACInstruction::OpCode::PopCount:
+            return is_64_bit ? std::popcount(operand) : std::popcount(narrow);
+        case TACInstruction::OpCode::ByteSwap:
+            return is_64_bit ? __builtin_bswap64(operand) : __builtin_bswap32(narrow);
         default:
             return operand;
     }
-}
\ No newline at end of file
+}
@@ -0,0 +1,225 @@
+#include "include/optimizer/value_range.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <limits>
+
+namespace {
+
+bool DefinesDst(const TACInstruction& instr) {
+    using Op = TACInstruction::OpCode;
+    if (instr.GetOp() == Op::Function || instr.GetOp() == Op::StaticVariable) {
+        return false;
+    }
+    return instr.GetDst().IsIdentifier() && !instr.GetDst().Empty();
+}
+
+bool IsComparison(TACInstruction::OpCode op) {
+    using Op = TACInstruction::OpCode;
+    return op == Op::Less || op == Op::LessEqual || op == Op::Greater ||
+           op == Op::GreaterEqual || op == Op::Equal || op == Op::NotEqual ||
+           op == Op::Not;
+}
+
+}  // namespace
+
+ValueRangeAnalysis::ValueRangeAnalysis(const std::vector<TACInstruction>& instructions,
+                                       SymbolTable& symbol_table)
+    : symbol_table_(symbol_table) {
+    for (const auto& instr : instructions) {
+        if (DefinesDst(instr)) {
+            const auto& name = instr.GetDst().AsIdentifier();
+            ++def_counts_[name];
+            definitions_[name] = &instr;
+        }
+        if (instr.GetOp() == TACInstruction::OpCode::Function) {
+            continue;
+        }
+        for (const auto* operand : {&instr.GetLhs(), &instr.GetRhs()}) {
+            if (operand->IsIdentifier() && !operand->Empty()) {
+                ++use_counts_[operand->AsIdentifier()];
+            }
+        }
+    }
+
+    for (const auto& instr : instructions) {
+        if (!DefinesDst(instr) || !IsStable(instr.GetDst())) {
+            continue;
+        }
+        auto type = GetType(instr.GetDst());
+        if (!type || !type->IsIntegral()) {
+            continue;
+        }
+        auto type_range = GetTypeRange(type);
+        auto range = ComputeRange(instr);
+        if (range && type_range && !range->FitsIn(*type_range)) {
+            range = type_range;
+        }
+        if (range && !type_range && !range->IsNonNegative()) {
+            range = std::nullopt;  // would wrap around in unsigned long
+        }
+        if (!range) {
+            range = type_range;
+        }
+        if (range) {
+            ranges_[instr.GetDst().AsIdentifier()] = *range;
+        }
+    }
+}
+
+std::optional<ValueRange> ValueRangeAnalysis::GetRange(const TACOperand& operand) const {
+    if (operand.IsConstant()) {
+        const auto& constant = operand.AsConstant();
+        if (constant.IsFloatingPoint()) {
+            return std::nullopt;
+        }
+        constexpr auto kMaxSigned =
+            static_cast<uint64_t>(std::numeric_limits<int64_t>::max());
+        if (!constant.IsSigned() && constant.AsUInt64() > kMaxSigned) {
+            return std::nullopt;
+        }
+        return ValueRange{constant.AsInt64(), constant.AsInt64()};
+    }
+    if (operand.Empty()) {
+        return std::nullopt;
+    }
+    if (auto it = ranges_.find(operand.AsIdentifier()); it != ranges_.end()) {
+        return it->second;
+    }
+    return GetTypeRange(GetType(operand));
+}
+
+TypeRef ValueRangeAnalysis::GetType(const TACOperand& operand) const {
+    if (!operand.IsIdentifier() || operand.Empty()) {
+        return nullptr;
+    }
+    if (auto* info = symbol_table_.FindByUniqueName(operand.AsName())) {
+        return info->type;
+    }
+    return nullptr;
+}
+
+const TACInstruction* ValueRangeAnalysis::GetDefinition(const TACOperand& operand) const {
+    if (!operand.IsIdentifier() || operand.Empty()) {
+        return nullptr;
+    }
+    const auto& name = operand.AsIdentifier();
+    auto it = def_counts_.find(name);
+    if (it == def_counts_.end() || it->second != 1) {
+        return nullptr;
+    }
+    return definitions_.at(name);
+}
+
+bool ValueRangeAnalysis::IsStable(const TACOperand& operand) const {
+    if (operand.IsConstant()) {
+        return true;
+    }
+    if (operand.Empty()) {
+        return false;
+    }
+    auto* info = symbol_table_.FindByUniqueName(operand.AsName());
+    if (!info || info->HasStaticDuration()) {
+        return false;
+    }
+    auto it = def_counts_.find(operand.AsIdentifier());
+    return it == def_counts_.end() || it->second <= 1;
+}
+
+int ValueRangeAnalysis::GetUseCount(const TACOperand& operand) const {
+    if (!operand.IsIdentifier() || operand.Empty()) {
+        return 0;
+    }
+    auto it = use_counts_.find(operand.AsIdentifier());
+    return it == use_counts_.end() ? 0 : it->second;
+}
+
+std::optional<ValueRange> ValueRangeAnalysis::GetTypeRange(const TypeRef& type) {
+    if (!type || !type->IsIntegral()) {
+        return std::nullopt;
+    }
+    if (type->Size() == 8) {
+        if (!type->IsSigned()) {
+            return std::nullopt;
+        }
+        return ValueRange{std::numeric_limits<int64_t>::min(),
+                          std::numeric_limits<int64_t>::max()};
+    }
+    if (type->IsSigned()) {
+        return ValueRange{std::numeric_limits<int32_t>::min(),
+                          std::numeric_limits<int32_t>::max()};
+    }
+    return ValueRange{0, std::numeric_limits<uint32_t>::max()};
+}
+
+std::optional<ValueRange> ValueRangeAnalysis::ComputeRange(
+    const TACInstruction& instr) const {
+    using Op = TACInstruction::OpCode;
+    if (IsComparison(instr.GetOp())) {
+        return ValueRange{0, 1};
+    }
+
+    auto lhs = GetRange(instr.GetLhs());
+    auto rhs = GetRange(instr.GetRhs());
+    switch (instr.GetOp()) {
+        case Op::Assign:
+        case Op::SignExtend:
+        case Op::Truncate:
+            return lhs;
+        case Op::ZeroExtend:
+            if (lhs && lhs->IsNonNegative()) {
+                return lhs;
+            }
+            return ValueRange{0, std::numeric_limits<uint32_t>::max()};
+        case Op::Add:
+        case Op::Sub: {
+            if (!lhs || !rhs) {
+                return std::nullopt;
+            }
+            bool is_add = instr.GetOp() == Op::Add;
+            ValueRange result;
+            bool overflow =
+                is_add ? __builtin_add_overflow(lhs->min, rhs->min, &result.min) ||
+                             __builtin_add_overflow(lhs->max, rhs->max, &result.max)
+                       : __builtin_sub_overflow(lhs->min, rhs->max, &result.min) ||
+                             __builtin_sub_overflow(lhs->max, rhs->min, &result.max);
+            if (overflow) {
+                return std::nullopt;
+            }
+            return result;
+        }
+        case Op::BitwiseAnd:
+            if (lhs && rhs && lhs->IsNonNegative() && rhs->IsNonNegative()) {
+                return ValueRange{0, std::min(lhs->max, rhs->max)};
+            }
+            if (lhs && lhs->IsNonNegative()) {
+                return ValueRange{0, lhs->max};
+            }
+            if (rhs && rhs->IsNonNegative()) {
+                return ValueRange{0, rhs->max};
+            }
+            return std::nullopt;
+        case Op::Mod: {
+            if (!instr.GetRhs().IsConstant() || !rhs || rhs->min == 0 ||
+                rhs->min == std::numeric_limits<int64_t>::min()) {
+                return std::nullopt;
+            }
+            int64_t bound = std::llabs(rhs->min) - 1;
+            if (lhs && lhs->IsNonNegative()) {
+                return ValueRange{0, bound};
+            }
+            return ValueRange{-bound, bound};
+        }
+        case Op::RightShift:
+            if (lhs && lhs->IsNonNegative()) {
+                return ValueRange{0, lhs->max};
+            }
+            return std::nullopt;
+        case Op::CountLeadingZeros:
+        case Op::CountTrailingZeros:
+        case Op::PopCount:
+            return ValueRange{0, 64};
+        default:
+            return std::nullopt;
+    }
+}
@@ -5,10 +5,10 @@
 #include "include/semantic/symbol_table.h"
 #include "include/semantic/type_checker.h"
 
-SemanticAnalyzer::SemanticAnalyzer(SymbolTable& symbol_table)
+SemanticAnalyzer::SemanticAnalyzer(SymbolTable& symbol_table, AstArena& arena)
     : symbol_table_(symbol_table),
       symbol_resolver_(symbol_table),
-      type_checker_(symbol_table),
+      type_checker_(symbol_table, arena),
       loop_analyzer_(symbol_table) {}
 
 SemanticAnalyzer::~SemanticAnalyzer() {}
@@ -0,0 +1,25 @@
+#include "include/semantic/builtins.h"
+
+#include <unordered_map>
+
+std::optional<Builtin> FindBuiltin(const std::string& name) {
+    static const std::unordered_map<std::string, Builtin> builtins = {
+        {"__builtin_expect", Builtin::Expect},
+        {"__builtin_clz", Builtin::CountLeadingZeros},
+        {"__builtin_clzl", Builtin::CountLeadingZerosLong},
+        {"__builtin_clzll", Builtin::CountLeadingZerosLong},
+        {"__builtin_ctz", Builtin::CountTrailingZeros},
+        {"__builtin_ctzl", Builtin::CountTrailingZerosLong},
+        {"__builtin_ctzll", Builtin::CountTrailingZerosLong},
+        {"__builtin_popcount", Builtin::PopCount},
+        {"__builtin_popcountl", Builtin::PopCountLong},
+        {"__builtin_popcountll", Builtin::PopCountLong},
+        {"__builtin_bswap32", Builtin::ByteSwap32},
+        {"__builtin_bswap64", Builtin::ByteSwap64},
+    };
+    auto it = builtins.find(name);
+    if (it == builtins.end()) {
+        return std::nullopt;
+    }
+    return it->second;
+}
@@ -86,35 +86,97 @@ void LoopAnalyzer::Visit(SelectionStatement* statement) {
 }
 
 void LoopAnalyzer::Visit(JumpStatement* statement) {
-    if (loop_ids_.empty()) {
+    if (statement->GetType() == JumpStatement::JumpType::Break) {
+        if (break_ids_.empty()) {
+            errors_.push_back("break statement outside of loop or switch");
+            return;
+        }
+        statement->SetLabel(break_ids_.top());
+        return;
+    }
+    if (continue_ids_.empty()) {
         errors_.push_back("jump statement outside of loop");
         return;
     }
-    statement->SetLabel(loop_ids_.top());
+    statement->SetLabel(continue_ids_.top());
 }
 
 void LoopAnalyzer::Visit(WhileStatement* statement) {
     std::string loop_id = GenerateLoopId();
     statement->SetLabel(loop_id);
-    loop_ids_.push(loop_id);
+    break_ids_.push(loop_id);
+    continue_ids_.push(loop_id);
 
     statement->GetCondition()->Accept(this);
     statement->GetBody()->Accept(this);
 
-    loop_ids_.pop();
+    break_ids_.pop();
+    continue_ids_.pop();
 }
 
 void LoopAnalyzer::Visit(ForStatement* statement) {
     std::string loop_id = GenerateLoopId();
     statement->SetLabel(loop_id);
-    loop_ids_.push(loop_id);
+    break_ids_.push(loop_id);
+    continue_ids_.push(loop_id);
 
     statement->GetInit()->Accept(this);
     statement->GetCondition()->Accept(this);
     statement->GetIncrement()->Accept(this);
     statement->GetBody()->Accept(this);
 
-    loop_ids_.pop();
+    break_ids_.pop();
+    continue_ids_.pop();
+}
+
+void LoopAnalyzer::Visit(SwitchStatement* statement) {
+    std::string switch_id = GenerateSwitchId();
+    statement->SetLabel(switch_id);
+    break_ids_.push(switch_id);
+    switches_.push(statement);
+
+    statement->GetExpression()->Accept(this);
+    statement->GetBody()->Accept(this);
+
+    switches_.pop();
+    break_ids_.pop();
+}
+
+void LoopAnalyzer::Visit(CaseStatement* statement) {
+    if (switches_.empty()) {
+        errors_.push_back("case label outside of switch");
+        return;
+    }
+    SwitchStatement* parent = switches_.top();
+    if (statement->HasValue()) {
+        for (const auto* other : parent->GetCases()) {
+            if (other->HasValue() &&
+                other->GetValue().AsUInt64() == statement->GetValue().AsUInt64()) {
+                errors_.push_back("duplicate case value " +
+                                  statement->GetValue().ToString());
+                break;
+            }
+        }
+    }
+    statement->SetLabel(parent->GetLabel() + "_case_" +
+                        std::to_string(parent->GetCases().size()));
+    parent->AddCase(statement);
+    statement->GetStatement()->Accept(this);
+}
+
+void LoopAnalyzer::Visit(DefaultStatement* statement) {
+    if (switches_.empty()) {
+        errors_.push_back("default label outside of switch");
+        return;
+    }
+    SwitchStatement* parent = switches_.top();
+    if (parent->HasDefault()) {
+        errors_.push_back("multiple default labels in one switch");
+        return;
+    }
+    statement->SetLabel(parent->GetLabel() + "_default");
+    parent->SetDefault(statement);
+    statement->GetStatement()->Accept(this);
 }
 
 void LoopAnalyzer::Visit(ParameterDeclaration* declaration) {
@@ -156,4 +218,8 @@ const std::vector<std::string>& LoopAnalyzer::GetErrors() const { return errors_
 
 std::string LoopAnalyzer::GenerateLoopId() {
     return "loop." + std::to_string(loop_id_counter_++);
+}
+
+std::string LoopAnalyzer::GenerateSwitchId() {
+    return "switch." + std::to_string(switch_id_counter_++);
 }
\ No newline at end of file
@@ -2,6 +2,7 @@
 
 #include "include/ast/declarations.h"
 #include "include/ast/expressions.h"
+#include "include/semantic/builtins.h"
 
 SymbolResolver::SymbolResolver(SymbolTable& symbol_table) : symbol_table_(symbol_table) {
     symbol_table_.EnterScope();
@@ -161,6 +162,20 @@ void SymbolResolver::Visit(ForStatement* statement) {
     symbol_table_.ExitScope();
 }
 
+void SymbolResolver::Visit(SwitchStatement* statement) {
+    statement->GetExpression()->Accept(this);
+    statement->GetBody()->Accept(this);
+}
+
+void SymbolResolver::Visit(CaseStatement* statement) {
+    statement->GetExpression()->Accept(this);
+    statement->GetStatement()->Accept(this);
+}
+
+void SymbolResolver::Visit(DefaultStatement* statement) {
+    statement->GetStatement()->Accept(this);
+}
+
 void SymbolResolver::Visit(ParameterDeclaration* declaration) {
     declaration->GetDeclarator()->Accept(this);
 }
@@ -172,11 +187,14 @@ void SymbolResolver::Visit(ParameterList* list) {
 }
 
 void SymbolResolver::Visit(FunctionCallExpression* expression) {
-    if (!dynamic_cast<IdExpression*>(expression->GetFunction())) {
+    auto* function = dynamic_cast<IdExpression*>(expression->GetFunction());
+    if (!function) {
         errors_.push_back("function call target is not an identifier");
         return;
     }
-    expression->GetFunction()->Accept(this);
+    if (!FindBuiltin(function->GetId())) {
+        function->Accept(this);
+    }
     if (expression->HasArguments()) {
         expression->GetArguments()->Accept(this);
     }
@@ -1,70 +1,82 @@
 #include "include/semantic/symbol_table.h"
 
-void SymbolTable::EnterScope() { scopes_.emplace_back(); }
+void SymbolTable::EnterScope() { scope_marks_.push_back(undo_stack_.size()); }
 
 void SymbolTable::ExitScope() {
-    if (!scopes_.empty()) {
-        scopes_.pop_back();
+    if (scope_marks_.empty()) {
+        return;
+    }
+    size_t mark = scope_marks_.back();
+    scope_marks_.pop_back();
+    while (undo_stack_.size() > mark) {
+        auto& shadowed = undo_stack_.back();
+        if (shadowed.previous) {
+            bindings_[shadowed.name] = *shadowed.previous;
+        } else {
+            bindings_.erase(shadowed.name);
+        }
+        undo_stack_.pop_back();
     }
 }
 
 bool SymbolTable::Declare(const std::string& original_name, const SymbolInfo& info) {
-    if (IsInCurrentScope(original_name)) {
+    InternedString name(original_name);
+    if (scope_marks_.empty() || IsInCurrentScope(name)) {
         return false;
     }
-    scopes_.back()[original_name] = info;
-    all_symbols_[info.name] = info;
+    Binding binding{.symbol = Store(info),
+                    .depth = static_cast<uint32_t>(scope_marks_.size())};
+    auto [it, inserted] = bindings_.try_emplace(name, binding);
+    undo_stack_.push_back(
+        {.name = name, .previous = inserted ? std::nullopt : std::optional(it->second)});
+    it->second = binding;
     return true;
 }
 
-void SymbolTable::Register(const SymbolInfo& info) { all_symbols_[info.name] = info; }
+void SymbolTable::Register(const SymbolInfo& info) { Store(info); }
 
-std::optional<SymbolInfo> SymbolTable::Lookup(const std::string& original_name) const {
-    for (auto it = scopes_.rbegin(); it != scopes_.rend(); ++it) {
-        auto found = it->find(original_name);
-        if (found != it->end()) {
-            return found->second;
-        }
+uint32_t SymbolTable::Store(const SymbolInfo& info) {
+    auto [it, inserted] = by_unique_name_.try_emplace(
+        InternedString(info.name), static_cast<uint32_t>(symbols_.size()));
+    if (inserted) {
+        symbols_.push_back(info);
+    } else {
+        symbols_[it->second] = info;
     }
-    return std::nullopt;
+    return it->second;
 }
 
-bool SymbolTable::IsInCurrentScope(const std::string& name) const {
-    if (scopes_.empty()) {
-        return false;
-    }
-    return scopes_.back().find(name) != scopes_.back().end();
+const SymbolInfo* SymbolTable::Lookup(InternedString original_name) const {
+    auto it = bindings_.find(original_name);
+    return it != bindings_.end() ? &symbols_[it->second.symbol] : nullptr;
+}
+
+bool SymbolTable::IsInCurrentScope(InternedString name) const {
+    auto it = bindings_.find(name);
+    return it != bindings_.end() && it->second.depth == scope_marks_.size();
 }
 
 std::string SymbolTable::GenerateUniqueName(const std::string& base) {
-    int count = name_counters_[base]++;
-    if (scopes_.size() == 1) {
+    int count = name_counters_[InternedString(base)]++;
+    if (scope_marks_.size() == 1) {
         return base;
     }
     return base + "." + std::to_string(count);
 }
 
-SymbolInfo* SymbolTable::FindByOriginalName(const std::string& original_name) {
-    for (auto it = scopes_.rbegin(); it != scopes_.rend(); ++it) {
-        if (it->contains(original_name)) {
-            return &((*it)[original_name]);
-        }
-    }
-    return nullptr;
+SymbolInfo* SymbolTable::FindByOriginalName(InternedString original_name) {
+    auto it = bindings_.find(original_name);
+    return it != bindings_.end() ? &symbols_[it->second.symbol] : nullptr;
 }
 
-SymbolInfo* SymbolTable::FindByUniqueName(const std::string& unique_name) {
-    if (all_symbols_.contains(unique_name)) {
-        return &all_symbols_[unique_name];
-    }
-    return nullptr;
+SymbolInfo* SymbolTable::FindByUniqueName(InternedString unique_name) {
+    auto it = by_unique_name_.find(unique_name);
+    return it != by_unique_name_.end() ? &symbols_[it->second] : nullptr;
 }
 
-bool SymbolTable::IsInFileScope() const { return scopes_.size() == 1; }
+bool SymbolTable::IsInFileScope() const { return scope_marks_.size() == 1; }
 
-const std::unordered_map<std::string, SymbolInfo>& SymbolTable::GetAllSymbols() const {
-    return all_symbols_;
-}
+const std::deque<SymbolInfo>& SymbolTable::GetAllSymbols() const { return symbols_; }
 
 std::string SymbolInfo::GetStringInitializer() const {
     if (init_state != InitialValue::Initial) {
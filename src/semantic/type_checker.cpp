@@ -1,15 +1,81 @@
 #include "include/semantic/type_checker.h"
 
+#include <algorithm>
 #include <memory>
 
 #include "include/ast/declarations.h"
 #include "include/ast/expressions.h"
+#include "include/semantic/builtins.h"
 #include "include/semantic/symbol_table.h"
 #include "include/types/function_type.h"
 #include "include/types/primitive_type.h"
 #include "include/types/type.h"
 
-TypeChecker::TypeChecker(SymbolTable& symbol_table) : symbol_table_(symbol_table) {}
+namespace {
+
+// Integer constant expressions built from literals with +, -, *, ~, &, |, ^ and <<,
+// evaluated modulo 2^64. Truncating the result to the switch type gives the same value
+// as evaluating in that type.
+std::optional<uint64_t> EvaluateConstantBits(Expression* expression) {
+    if (auto* primary = dynamic_cast<PrimaryExpression*>(expression)) {
+        const auto& value = primary->GetValue();
+        if (value.IsFloatingPoint()) {
+            return std::nullopt;
+        }
+        return value.IsSigned() ? static_cast<uint64_t>(value.AsInt64())
+                                : value.AsUInt64();
+    }
+    if (auto* unary = dynamic_cast<UnaryExpression*>(expression)) {
+        auto operand = EvaluateConstantBits(unary->GetExpression());
+        if (!operand) {
+            return std::nullopt;
+        }
+        switch (unary->GetOp()) {
+            case UnaryExpression::UnaryOperator::Minus:
+                return -*operand;
+            case UnaryExpression::UnaryOperator::Plus:
+                return *operand;
+            case UnaryExpression::UnaryOperator::BinaryNot:
+                return ~*operand;
+            default:
+                return std::nullopt;
+        }
+    }
+    if (auto* binary = dynamic_cast<BinaryExpression*>(expression)) {
+        auto lhs = EvaluateConstantBits(binary->GetLeftExpression());
+        auto rhs = EvaluateConstantBits(binary->GetRightExpression());
+        if (!lhs || !rhs) {
+            return std::nullopt;
+        }
+        switch (binary->GetOp()) {
+            case BinaryExpression::BinaryOperator::Plus:
+                return *lhs + *rhs;
+            case BinaryExpression::BinaryOperator::Minus:
+                return *lhs - *rhs;
+            case BinaryExpression::BinaryOperator::Mul:
+                return *lhs * *rhs;
+            case BinaryExpression::BinaryOperator::BitwiseAnd:
+                return *lhs & *rhs;
+            case BinaryExpression::BinaryOperator::BitwiseOr:
+                return *lhs | *rhs;
+            case BinaryExpression::BinaryOperator::BitwiseXor:
+                return *lhs ^ *rhs;
+            case BinaryExpression::BinaryOperator::LeftShift:
+                if (*rhs >= 64) {
+                    return std::nullopt;
+                }
+                return *lhs << *rhs;
+            default:
+                return std::nullopt;
+        }
+    }
+    return std::nullopt;
+}
+
+}  // namespace
+
+TypeChecker::TypeChecker(SymbolTable& symbol_table, AstArena& arena)
+    : symbol_table_(symbol_table), arena_(arena) {}
 
 TypeChecker::~TypeChecker() {}
 
@@ -33,7 +99,8 @@ void TypeChecker::Visit(FunctionDefinition* function) {
             dynamic_cast<FunctionDeclarator*>(function->GetDeclarator())) {
         if (!ProcessFunctionDeclaration(
                 func_declarator, function->GetReturnType(),
-                function->GetDeclarationSpecifiers()->GetStorageClass(), true)) {
+                function->GetDeclarationSpecifiers()->GetStorageClass(),
+                function->GetFunctionSpecifiers(), true)) {
             return;
         }
         if (func_declarator->HasParameters()) {
@@ -74,10 +141,12 @@ void TypeChecker::Visit(Declaration* declaration) {
 
     StorageClass storage_class =
         declaration->GetDeclarationSpecifiers()->GetStorageClass();
+    const auto& function_specifiers =
+        declaration->GetDeclarationSpecifiers()->GetFunctionSpecifiers();
 
     if (auto func_declarator = dynamic_cast<FunctionDeclarator*>(declarator)) {
         if (!ProcessFunctionDeclaration(func_declarator, type_spec, storage_class,
-                                        false)) {
+                                        function_specifiers, false)) {
             return;
         }
     } else if (auto id_declarator = dynamic_cast<IdentifierDeclarator*>(declarator)) {
@@ -87,6 +156,10 @@ void TypeChecker::Visit(Declaration* declaration) {
                         id_declarator->GetId() + "'");
             return;
         }
+        if (!function_specifiers.Empty()) {
+            ReportError("function specifier or attribute is not allowed on variable '" +
+                        info->original_name + "'");
+        }
         bool ok = in_file_scope_
                       ? ProcessFileScopeVariable(id_declarator, type, storage_class)
                       : ProcessBlockScopeVariable(id_declarator, type, storage_class);
@@ -146,6 +219,8 @@ void TypeChecker::Visit(UnaryExpression* expression) {
     switch (expression->GetOp()) {
         case UnaryExpression::UnaryOperator::Minus:
         case UnaryExpression::UnaryOperator::Plus:
+            expression->SetTypeRef(operand_type);
+            break;
         case UnaryExpression::UnaryOperator::BinaryNot:
             if (!operand_type->IsIntegral()) {
                 ReportError("unary operator requires integral operand");
@@ -393,6 +468,37 @@ void TypeChecker::Visit(ForStatement* statement) {
     statement->GetBody()->Accept(this);
 }
 
+void TypeChecker::Visit(SwitchStatement* statement) {
+    statement->GetExpression()->Accept(this);
+    TypeRef type = statement->GetExpression()->GetTypeRef();
+    if (type && !type->IsIntegral()) {
+        ReportError("switch quantity is not an integer");
+        type = nullptr;
+    }
+    switch_types_.push_back(type);
+    statement->GetBody()->Accept(this);
+    switch_types_.pop_back();
+}
+
+void TypeChecker::Visit(CaseStatement* statement) {
+    statement->GetExpression()->Accept(this);
+    if (!switch_types_.empty() && switch_types_.back()) {
+        auto bits = EvaluateConstantBits(statement->GetExpression());
+        if (!bits) {
+            ReportError("case label does not reduce to an integer constant");
+        } else {
+            NumericConstant value = static_cast<unsigned long>(*bits);
+            value.CastTo(switch_types_.back());
+            statement->SetValue(value);
+        }
+    }
+    statement->GetStatement()->Accept(this);
+}
+
+void TypeChecker::Visit(DefaultStatement* statement) {
+    statement->GetStatement()->Accept(this);
+}
+
 void TypeChecker::Visit(ParameterDeclaration* declaration) {
     StorageClass storage_class =
         declaration->GetDeclarationSpecifiers()->GetStorageClass();
@@ -417,6 +523,10 @@ void TypeChecker::Visit(ParameterDeclaration* declaration) {
             ReportError("storage class specifier is not allowed on parameter '" + name +
                         "'");
         }
+        if (!declaration->GetDeclarationSpecifiers()->GetFunctionSpecifiers().Empty()) {
+            ReportError("function specifier or attribute is not allowed on parameter '" +
+                        name + "'");
+        }
 
         SymbolInfo* info = symbol_table_.FindByUniqueName(name);
         if (!info) {
@@ -446,6 +556,12 @@ void TypeChecker::Visit(FunctionCallExpression* expression) {
         ReportError("function call has no function expression");
         return;
     }
+    if (auto* id = dynamic_cast<IdExpression*>(function_expression)) {
+        if (auto builtin = FindBuiltin(id->GetId())) {
+            CheckBuiltinCall(expression, *builtin);
+            return;
+        }
+    }
     function_expression->Accept(this);
 
     TypeRef function_type = function_expression->GetTypeRef();
@@ -454,7 +570,7 @@ void TypeChecker::Visit(FunctionCallExpression* expression) {
         return;
     }
 
-    FunctionType* func_type = dynamic_cast<FunctionType*>(function_type.get());
+    const auto* func_type = dynamic_cast<const FunctionType*>(function_type);
     if (!function_type) {
         ReportError("called expression is not a function");
         return;
@@ -498,6 +614,84 @@ void TypeChecker::Visit(FunctionCallExpression* expression) {
 
     expression->SetTypeRef(func_type->GetReturnType());
 }
+void TypeChecker::CheckBuiltinCall(FunctionCallExpression* expression, Builtin builtin) {
+    std::string name = static_cast<IdExpression*>(expression->GetFunction())->GetId();
+    size_t provided = 0;
+    if (expression->HasArguments() && expression->GetArguments()) {
+        provided = expression->GetArguments()->GetArguments().size();
+    }
+
+    switch (builtin) {
+        case Builtin::Expect: {
+            if (provided != 2) {
+                ReportError("'" + name + "' expects 2 arguments, but " +
+                            std::to_string(provided) + " were provided");
+                return;
+            }
+            auto& args = expression->GetArguments()->GetArguments();
+            for (size_t index = 0; index < provided; ++index) {
+                args[index]->Accept(this);
+                TypeRef arg_type = args[index]->GetTypeRef();
+                if (!arg_type || !arg_type->IsIntegral()) {
+                    ReportError("argument " + std::to_string(index) + " of '" + name +
+                                "' must be an integer");
+                    return;
+                }
+            }
+            auto expected = EvaluateConstantBits(args[1].get());
+            if (!expected) {
+                ReportError("argument 1 of '" + name + "' must be an integer constant");
+                return;
+            }
+            auto wrapped = WrapWithCast(std::move(args[0]), PrimitiveType::GetInt64());
+            if (!wrapped) {
+                return;
+            }
+            args[0] = std::move(wrapped);
+            // Folded so that the branch lowering can read it.
+            args[1] = MakeNode<PrimaryExpression>(arena_, static_cast<long>(*expected));
+            args[1]->SetTypeRef(PrimitiveType::GetInt64());
+            expression->SetTypeRef(PrimitiveType::GetInt64());
+            break;
+        }
+        case Builtin::CountLeadingZeros:
+        case Builtin::CountLeadingZerosLong:
+        case Builtin::CountTrailingZeros:
+        case Builtin::CountTrailingZerosLong:
+        case Builtin::PopCount:
+        case Builtin::PopCountLong:
+        case Builtin::ByteSwap32:
+        case Builtin::ByteSwap64: {
+            if (provided != 1) {
+                ReportError("'" + name + "' expects 1 argument, but " +
+                            std::to_string(provided) + " were provided");
+                return;
+            }
+            auto& arg = expression->GetArguments()->GetArguments()[0];
+            arg->Accept(this);
+            if (!arg->GetTypeRef() || !arg->GetTypeRef()->IsIntegral()) {
+                ReportError("argument 0 of '" + name + "' must be an integer");
+                return;
+            }
+            bool is_long = builtin == Builtin::CountLeadingZerosLong ||
+                           builtin == Builtin::CountTrailingZerosLong ||
+                           builtin == Builtin::PopCountLong ||
+                           builtin == Builtin::ByteSwap64;
+            TypeRef operand_type =
+                is_long ? PrimitiveType::GetUInt64() : PrimitiveType::GetUInt32();
+            auto wrapped = WrapWithCast(std::move(arg), operand_type);
+            if (!wrapped) {
+                return;
+            }
+            arg = std::move(wrapped);
+            bool is_swap =
+                builtin == Builtin::ByteSwap32 || builtin == Builtin::ByteSwap64;
+            expression->SetTypeRef(is_swap ? operand_type : PrimitiveType::GetInt32());
+            break;
+        }
+    }
+}
+
 void TypeChecker::Visit(ArgumentExpressionList* list) {
     for (auto& argument : list->GetArguments()) {
         argument->Accept(this);
@@ -567,7 +761,7 @@ std::unique_ptr<Expression> TypeChecker::WrapWithCast(
 
     if (!from_type->Equals(target_type)) {
         if (CanCast(from_type, target_type)) {
-            auto cast_expr = std::make_unique<CastExpression>(
+            auto cast_expr = MakeNode<CastExpression>(arena_, 
                 std::move(GetTypeSpecification(target_type)), std::move(expression));
 
             cast_expr->SetTypeRef(target_type);
@@ -628,15 +822,15 @@ std::unique_ptr<TypeSpecification> TypeChecker::GetTypeSpecification(TypeRef typ
         return nullptr;
     }
     if (type->Equals(PrimitiveType::GetInt32())) {
-        return std::make_unique<TypeSpecification>(TypeSpecification::Type::Int);
+        return MakeNode<TypeSpecification>(arena_, TypeSpecification::Type::Int);
     } else if (type->Equals(PrimitiveType::GetInt64())) {
-        return std::make_unique<TypeSpecification>(TypeSpecification::Type::Long);
+        return MakeNode<TypeSpecification>(arena_, TypeSpecification::Type::Long);
     } else if (type->Equals(PrimitiveType::GetUInt32())) {
-        return std::make_unique<TypeSpecification>(TypeSpecification::Type::UInt);
+        return MakeNode<TypeSpecification>(arena_, TypeSpecification::Type::UInt);
     } else if (type->Equals(PrimitiveType::GetUInt64())) {
-        return std::make_unique<TypeSpecification>(TypeSpecification::Type::ULong);
+        return MakeNode<TypeSpecification>(arena_, TypeSpecification::Type::ULong);
     } else if (type->Equals(PrimitiveType::GetDouble())) {
-        return std::make_unique<TypeSpecification>(TypeSpecification::Type::Double);
+        return MakeNode<TypeSpecification>(arena_, TypeSpecification::Type::Double);
     }
     return nullptr;
 }
@@ -682,13 +876,13 @@ TypeRef TypeChecker::ResolveFunctionType(Declarator* declarator,
             }
         }
     }
-    return std::make_shared<FunctionType>(return_type, std::move(param_types));
+    return FunctionType::Get(return_type, std::move(param_types));
 }
 
-bool TypeChecker::ProcessFunctionDeclaration(FunctionDeclarator* func_declarator,
-                                             TypeSpecification* return_type_spec,
-                                             StorageClass storage_class,
-                                             bool is_definition) {
+bool TypeChecker::ProcessFunctionDeclaration(
+    FunctionDeclarator* func_declarator, TypeSpecification* return_type_spec,
+    StorageClass storage_class, const FunctionSpecifierSet& specifiers,
+    bool is_definition) {
     TypeRef func_type = ResolveFunctionType(func_declarator, return_type_spec);
     if (!func_type) {
         return false;
@@ -725,12 +919,55 @@ bool TypeChecker::ProcessFunctionDeclaration(FunctionDeclarator* func_declarator
         info->linkage = new_linkage;
     }
 
+    if (!MergeFunctionAttributes(*info, specifiers)) {
+        return false;
+    }
+
     if (is_definition) {
         info->is_defined = true;
     }
     return true;
 }
 
+// A declaration may add attributes the earlier ones did not have, but not contradict
+// them.
+bool TypeChecker::MergeFunctionAttributes(SymbolInfo& info,
+                                          const FunctionSpecifierSet& specifiers) {
+    using Inlining = FunctionAttributes::Inlining;
+    using Hotness = FunctionAttributes::Hotness;
+    auto& attributes = info.attributes;
+
+    Inlining inlining = Inlining::Default;
+    if (specifiers.has_always_inline) {
+        inlining = Inlining::Always;
+    } else if (specifiers.has_noinline) {
+        inlining = Inlining::Never;
+    } else if (specifiers.has_inline) {
+        inlining = Inlining::Hint;
+    }
+    if ((inlining == Inlining::Always && attributes.inlining == Inlining::Never) ||
+        (inlining == Inlining::Never && attributes.inlining == Inlining::Always)) {
+        ReportError(
+            "conflicting 'always_inline' and 'noinline' attributes for function '" +
+            info.name + "'");
+        return false;
+    }
+    attributes.inlining = std::max(attributes.inlining, inlining);
+
+    Hotness hotness = specifiers.has_hot    ? Hotness::Hot
+                      : specifiers.has_cold ? Hotness::Cold
+                                            : Hotness::Default;
+    if (hotness != Hotness::Default) {
+        if (attributes.hotness != Hotness::Default && attributes.hotness != hotness) {
+            ReportError("conflicting 'hot' and 'cold' attributes for function '" +
+                        info.name + "'");
+            return false;
+        }
+        attributes.hotness = hotness;
+    }
+    return true;
+}
+
 bool TypeChecker::ProcessFileScopeVariable(IdentifierDeclarator* id_declarator,
                                            TypeRef declared_type,
                                            StorageClass storage_class) {
@@ -0,0 +1,59 @@
+#include "include/support/interned_string.h"
+
+#include <deque>
+#include <unordered_map>
+
+namespace {
+
+class StringTable {
+public:
+    static StringTable& Get() {
+        thread_local StringTable table;
+        return table;
+    }
+
+    uint32_t Intern(std::string_view spelling) {
+        auto it = ids_.find(spelling);
+        if (it != ids_.end()) {
+            return it->second;
+        }
+        auto id = static_cast<uint32_t>(spellings_.size());
+        spellings_.emplace_back(spelling);
+        ids_.emplace(spellings_.back(), id);
+        return id;
+    }
+
+    const std::string& GetSpelling(uint32_t id) const { return spellings_[id]; }
+
+private:
+    StringTable() { Intern(""); }
+
+    // A deque keeps spellings in place, so the views used as keys stay valid.
+    std::deque<std::string> spellings_;
+    std::unordered_map<std::string_view, uint32_t> ids_;
+};
+
+}  // namespace
+
+InternedString::InternedString(std::string_view spelling)
+    : id_(spelling.empty() ? 0 : StringTable::Get().Intern(spelling)) {}
+
+InternedString::InternedString(const std::string& spelling)
+    : InternedString(std::string_view(spelling)) {}
+
+InternedString::InternedString(const char* spelling)
+    : InternedString(std::string_view(spelling)) {}
+
+InternedString InternedString::FromId(uint32_t id) {
+    InternedString string;
+    string.id_ = id;
+    return string;
+}
+
+uint32_t InternedString::GetId() const { return id_; }
+
+bool InternedString::Empty() const { return id_ == 0; }
+
+const std::string& InternedString::Str() const {
+    return StringTable::Get().GetSpelling(id_);
+}
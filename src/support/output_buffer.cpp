@@ -0,0 +1,123 @@
+#include "include/support/output_buffer.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+namespace {
+
+constexpr char kDigitPairs[] =
+    "00010203040506070809"
+    "10111213141516171819"
+    "20212223242526272829"
+    "30313233343536373839"
+    "40414243444546474849"
+    "50515253545556575859"
+    "60616263646566676869"
+    "70717273747576777879"
+    "80818283848586878889"
+    "90919293949596979899";
+
+// Formats value backwards ending at end and returns the first digit.
+char* FormatUInt(uint64_t value, char* end) {
+    char* out = end;
+    while (value >= 100) {
+        size_t pair = (value % 100) * 2;
+        value /= 100;
+        out -= 2;
+        std::memcpy(out, kDigitPairs + pair, 2);
+    }
+    if (value >= 10) {
+        out -= 2;
+        std::memcpy(out, kDigitPairs + value * 2, 2);
+    } else {
+        *--out = static_cast<char>('0' + value);
+    }
+    return out;
+}
+
+}  // namespace
+
+OutputBuffer::OutputBuffer()
+    : data_(new char[kCapacity]), size_(0), fd_(-1), failed_(false) {}
+
+OutputBuffer::~OutputBuffer() { Close(); }
+
+bool OutputBuffer::Open(const std::string& filename) {
+    Close();
+    fd_ = ::open(filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    failed_ = fd_ < 0;
+    return !failed_;
+}
+
+bool OutputBuffer::Close() {
+    if (fd_ >= 0) {
+        Flush();
+        if (::close(fd_) != 0) {
+            failed_ = true;
+        }
+        fd_ = -1;
+    }
+    return !failed_;
+}
+
+void OutputBuffer::Flush() {
+    const char* data = data_.get();
+    size_t remaining = size_;
+    while (remaining > 0 && fd_ >= 0) {
+        ssize_t written = ::write(fd_, data, remaining);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            failed_ = true;
+            break;
+        }
+        data += written;
+        remaining -= static_cast<size_t>(written);
+    }
+    size_ = 0;
+}
+
+void OutputBuffer::Write(std::string_view text) {
+    if (text.size() > kCapacity) {
+        Flush();
+        size_t offset = 0;
+        while (offset < text.size()) {
+            size_t count = std::min(kCapacity, text.size() - offset);
+            std::memcpy(data_.get(), text.data() + offset, count);
+            size_ = count;
+            Flush();
+            offset += count;
+        }
+        return;
+    }
+    Reserve(text.size());
+    std::memcpy(data_.get() + size_, text.data(), text.size());
+    size_ += text.size();
+}
+
+void OutputBuffer::Write(char c) {
+    Reserve(1);
+    data_[size_++] = c;
+}
+
+void OutputBuffer::WriteInt(int64_t value) {
+    if (value < 0) {
+        Write('-');
+        // Negating in unsigned arithmetic keeps INT64_MIN representable.
+        WriteUInt(0 - static_cast<uint64_t>(value));
+    } else {
+        WriteUInt(static_cast<uint64_t>(value));
+    }
+}
+
+void OutputBuffer::WriteUInt(uint64_t value) {
+    char digits[20];
+    char* end = digits + sizeof(digits);
+    char* begin = FormatUInt(value, end);
+    Write(std::string_view(begin, static_cast<size_t>(end - begin)));
+}
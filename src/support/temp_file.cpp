@@ -0,0 +1,25 @@
+#include "include/support/temp_file.h"
+
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <stdexcept>
+
+TempFile::TempFile(const std::string& prefix, const std::string& suffix) {
+    path_ = (std::filesystem::temp_directory_path() / (prefix + "XXXXXX" + suffix))
+                .string();
+    int fd = mkstemps(path_.data(), static_cast<int>(suffix.size()));
+    if (fd < 0) {
+        throw std::runtime_error("Cannot create temporary file " + path_ + ": " +
+                                 std::strerror(errno));
+    }
+    close(fd);
+}
+
+TempFile::~TempFile() {
+    std::error_code error;
+    std::filesystem::remove(path_, error);
+}
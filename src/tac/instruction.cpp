@@ -2,37 +2,39 @@
 
 #include <sstream>
 #include <stdexcept>
-TACOperand::TACOperand(const std::string& identifier) : storage_(identifier) {}
 
-TACOperand::TACOperand(const NumericConstant& constant) : storage_(constant) {}
+#include "include/tac/operand_pool.h"
+TACOperand::TACOperand(const std::string& identifier)
+    : handle_(InternedString(identifier).GetId()) {}
 
-bool TACOperand::IsIdentifier() const {
-    return std::holds_alternative<std::string>(storage_);
-}
+TACOperand::TACOperand(const NumericConstant& constant)
+    : handle_(TACOperandPool::Get().InternConstant(constant) | kConstantBit) {}
 
-bool TACOperand::IsConstant() const {
-    return std::holds_alternative<NumericConstant>(storage_);
-}
+bool TACOperand::IsIdentifier() const { return (handle_ & kConstantBit) == 0; }
+
+bool TACOperand::IsConstant() const { return (handle_ & kConstantBit) != 0; }
 
-bool TACOperand::Empty() const {
+bool TACOperand::Empty() const { return handle_ == 0; }
+
+const std::string& TACOperand::AsIdentifier() const {
     if (!IsIdentifier()) {
-        return false;
+        throw std::runtime_error("TACOperand does not hold an identifier");
     }
-    return std::get<std::string>(storage_).empty();
+    return InternedString::FromId(handle_).Str();
 }
 
-const std::string& TACOperand::AsIdentifier() const {
+InternedString TACOperand::AsName() const {
     if (!IsIdentifier()) {
         throw std::runtime_error("TACOperand does not hold an identifier");
     }
-    return std::get<std::string>(storage_);
+    return InternedString::FromId(handle_);
 }
 
 const NumericConstant& TACOperand::AsConstant() const {
     if (!IsConstant()) {
         throw std::runtime_error("TACOperand does not hold a numeric constant");
     }
-    return std::get<NumericConstant>(storage_);
+    return TACOperandPool::Get().GetConstant(handle_ & ~kConstantBit);
 }
 
 std::string TACOperand::ToString() const {
@@ -42,28 +44,29 @@ std::string TACOperand::ToString() const {
     return AsConstant().ToString();
 }
 
+uint32_t TACOperand::GetHandle() const { return handle_; }
+
 bool TACOperand::operator==(const TACOperand& other) const {
-    if (IsIdentifier() != other.IsIdentifier()) {
-        return false;
-    }
-    if (IsIdentifier()) {
-        return AsIdentifier() == other.AsIdentifier();
-    }
-    return AsConstant().GetKind() == other.AsConstant().GetKind() &&
-           AsConstant().ToString() == other.AsConstant().ToString();
+    return handle_ == other.handle_;
 }
 
 TACInstruction::TACInstruction(OpCode op, TACOperand dst, TACOperand lhs, TACOperand rhs,
-                               std::string label)
+                               const std::string& label)
     : op_(op),
       dst_(std::move(dst)),
       lhs_(std::move(lhs)),
       rhs_(std::move(rhs)),
-      label_(std::move(label)) {}
+      label_(label) {}
 
-TACInstruction TACInstruction::Label(const std::string& label) {
-    return TACInstruction(OpCode::Label, TACOperand(""), TACOperand(""), TACOperand(""),
-                          label);
+TACInstruction TACInstruction::Label(const std::string& label, int alignment) {
+    TACOperand align = alignment > 0 ? TACOperand(NumericConstant(alignment))
+                                     : TACOperand("");
+    return TACInstruction(OpCode::Label, TACOperand(""), align, TACOperand(""), label);
+}
+
+TACInstruction TACInstruction::ColdLabel(const std::string& label) {
+    return TACInstruction(OpCode::Label, TACOperand(""), TACOperand(""),
+                          TACOperand(NumericConstant(1)), label);
 }
 
 TACInstruction TACInstruction::GoTo(const std::string& target) {
@@ -71,15 +74,26 @@ TACInstruction TACInstruction::GoTo(const std::string& target) {
                           target);
 }
 
-TACInstruction TACInstruction::If(const std::string& target,
-                                  const TACOperand& condition) {
-    return TACInstruction(OpCode::If, TACOperand(""), condition, TACOperand(""), target);
+TACInstruction TACInstruction::If(const std::string& target, const TACOperand& condition,
+                                  std::optional<bool> expected) {
+    TACOperand hint = expected ? TACOperand(NumericConstant(*expected ? 1 : 0))
+                               : TACOperand("");
+    return TACInstruction(OpCode::If, TACOperand(""), condition, hint, target);
 }
 
 TACInstruction TACInstruction::IfFalse(const std::string& target,
-                                       const TACOperand& condition) {
-    return TACInstruction(OpCode::IfFalse, TACOperand(""), condition, TACOperand(""),
-                          target);
+                                       const TACOperand& condition,
+                                       std::optional<bool> expected) {
+    TACOperand hint = expected ? TACOperand(NumericConstant(*expected ? 1 : 0))
+                               : TACOperand("");
+    return TACInstruction(OpCode::IfFalse, TACOperand(""), condition, hint, target);
+}
+
+TACInstruction TACInstruction::JumpTable(const TACOperand& index,
+                                         std::vector<std::string> targets) {
+    TACInstruction instr(OpCode::JumpTable, TACOperand(""), index, TACOperand(""), "");
+    instr.targets_ = TACOperandPool::Get().InternTargets(std::move(targets));
+    return instr;
 }
 
 TACInstruction TACInstruction::Function(const std::string& name, int param_count,
@@ -167,11 +181,40 @@ const TACOperand& TACInstruction::GetLhs() const { return lhs_; }
 
 const TACOperand& TACInstruction::GetRhs() const { return rhs_; }
 
-const std::string& TACInstruction::GetLabel() const { return label_; }
+const std::string& TACInstruction::GetLabel() const { return label_.Str(); }
+
+InternedString TACInstruction::GetLabelName() const { return label_; }
+
+const std::vector<std::string>& TACInstruction::GetTargets() const {
+    return TACOperandPool::Get().GetTargets(targets_);
+}
+
+std::optional<bool> TACInstruction::GetExpectedCondition() const {
+    if ((op_ != OpCode::If && op_ != OpCode::IfFalse) || !rhs_.IsConstant()) {
+        return std::nullopt;
+    }
+    return rhs_.AsConstant().AsUInt64() != 0;
+}
+
+bool TACInstruction::StartsColdPart() const {
+    return op_ == OpCode::Label && rhs_.IsConstant();
+}
+
+void TACInstruction::SetDst(const TACOperand& dst) { dst_ = dst; }
+
+void TACInstruction::SetLhs(const TACOperand& lhs) { lhs_ = lhs; }
+
+void TACInstruction::SetRhs(const TACOperand& rhs) { rhs_ = rhs; }
+
+void TACInstruction::SetLabel(const std::string& label) { label_ = label; }
+
+void TACInstruction::SetTargets(std::vector<std::string> targets) {
+    targets_ = TACOperandPool::Get().InternTargets(std::move(targets));
+}
 
 bool TACInstruction::operator==(const TACInstruction& other) const {
     return op_ == other.op_ && dst_ == other.dst_ && lhs_ == other.lhs_ &&
-           rhs_ == other.rhs_ && label_ == other.label_;
+           rhs_ == other.rhs_ && label_ == other.label_ && targets_ == other.targets_;
 }
 
 std::string TACInstruction::ToString() const {
@@ -225,6 +268,8 @@ std::string TACInstruction::ToString() const {
                 return "iffalse";
             case OpCode::GoTo:
                 return "goto";
+            case OpCode::JumpTable:
+                return "jump table";
             case OpCode::BitwiseAnd:
                 return "&";
             case OpCode::BitwiseXor:
@@ -253,16 +298,30 @@ std::string TACInstruction::ToString() const {
                 return "int to double";
             case OpCode::UIntToDouble:
                 return "uint to double";
+            case OpCode::CountLeadingZeros:
+                return "clz";
+            case OpCode::CountTrailingZeros:
+                return "ctz";
+            case OpCode::PopCount:
+                return "popcount";
+            case OpCode::ByteSwap:
+                return "bswap";
         }
         return "unknown";
     };
 
     switch (op_) {
         case OpCode::Label:
-            out << label_ << ":";
+            out << GetLabel() << ":";
+            if (lhs_.IsConstant()) {
+                out << " align " << lhs_.ToString();
+            }
+            if (rhs_.IsConstant()) {
+                out << " cold";
+            }
             break;
         case OpCode::Function:
-            out << "function " << label_ << " with " << lhs_.ToString() << " args";
+            out << "function " << GetLabel() << " with " << lhs_.ToString() << " args";
             break;
         case OpCode::StaticVariable:
             out << "static variable " << dst_.ToString() << " = " << lhs_.ToString()
@@ -315,16 +374,29 @@ std::string TACInstruction::ToString() const {
         case OpCode::DoubleToUInt:
         case OpCode::IntToDouble:
         case OpCode::UIntToDouble:
+        case OpCode::CountLeadingZeros:
+        case OpCode::CountTrailingZeros:
+        case OpCode::PopCount:
+        case OpCode::ByteSwap:
             out << dst_.ToString() << " = " << OpToStr(op_) << " " << lhs_.ToString();
             break;
         case OpCode::If:
-            out << "if " << lhs_.ToString() << " goto " << label_;
-            break;
         case OpCode::IfFalse:
-            out << "iffalse " << lhs_.ToString() << " goto " << label_;
+            out << (op_ == OpCode::If ? "if " : "iffalse ") << lhs_.ToString()
+                << " goto " << GetLabel();
+            if (rhs_.IsConstant()) {
+                out << " expect " << rhs_.ToString();
+            }
             break;
         case OpCode::GoTo:
-            out << "goto " << label_;
+            out << "goto " << GetLabel();
+            break;
+        case OpCode::JumpTable:
+            out << "goto " << lhs_.ToString() << " of [";
+            for (size_t index = 0; index < GetTargets().size(); ++index) {
+                out << (index == 0 ? "" : ", ") << GetTargets()[index];
+            }
+            out << "]";
             break;
     }
 
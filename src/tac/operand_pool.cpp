@@ -0,0 +1,89 @@
+#include "include/tac/operand_pool.h"
+
+#include <bit>
+#include <cassert>
+#include <functional>
+#include <stdexcept>
+
+namespace {
+
+thread_local TACOperandPool* current_pool = nullptr;
+
+}  // namespace
+
+TACOperandPool::Scope::Scope(TACOperandPool& pool)
+    : pool_(&pool), previous_(current_pool) {
+    current_pool = pool_;
+}
+
+TACOperandPool::Scope::~Scope() {
+    assert(current_pool == pool_ && "TACOperandPool scopes must end in reverse order");
+    current_pool = previous_;
+}
+
+TACOperandPool& TACOperandPool::Get() {
+    if (!current_pool) {
+        throw std::logic_error("TAC operand used without a TACOperandPool");
+    }
+    return *current_pool;
+}
+
+TACOperandPool::TACOperandPool() { Clear(); }
+
+void TACOperandPool::Clear() {
+    constants_.clear();
+    constant_ids_.clear();
+    targets_.clear();
+    target_ids_.clear();
+    InternTargets({});
+}
+
+uint32_t TACOperandPool::InternConstant(const NumericConstant& constant) {
+    const auto& storage = constant.GetStorage();
+    uint64_t bits = std::visit(
+        [](auto value) -> uint64_t {
+            if constexpr (std::is_same_v<decltype(value), double>) {
+                return std::bit_cast<uint64_t>(value);
+            } else {
+                return static_cast<uint64_t>(value);
+            }
+        },
+        storage);
+    auto [it, inserted] = constant_ids_.try_emplace(
+        {storage.index(), bits}, static_cast<uint32_t>(constants_.size()));
+    if (inserted) {
+        constants_.push_back(constant);
+    }
+    return it->second;
+}
+
+uint32_t TACOperandPool::InternTargets(std::vector<std::string> targets) {
+    auto [it, inserted] = target_ids_.try_emplace(
+        std::move(targets), static_cast<uint32_t>(targets_.size()));
+    if (inserted) {
+        targets_.push_back(&it->first);
+    }
+    return it->second;
+}
+
+const NumericConstant& TACOperandPool::GetConstant(uint32_t id) const {
+    return constants_[id];
+}
+
+const std::vector<std::string>& TACOperandPool::GetTargets(uint32_t id) const {
+    return *targets_[id];
+}
+
+size_t TACOperandPool::ConstantKeyHash::operator()(
+    const std::pair<size_t, uint64_t>& key) const {
+    return std::hash<uint64_t>{}(key.second) * 31 + key.first;
+}
+
+size_t TACOperandPool::TargetsHash::operator()(
+    const std::vector<std::string>& targets) const {
+    size_t hash = targets.size();
+    for (const auto& target : targets) {
+        hash = hash * 31 + std::hash<std::string>{}(target);
+    }
+    return hash;
+}
@@ -0,0 +1,158 @@
+#include "include/tac/switch_lowering.h"
+
+#include <algorithm>
+#include <limits>
+#include <optional>
+
+namespace {
+
+constexpr uint64_t kSignBias = uint64_t{1} << 63;
+
+constexpr size_t kMinJumpTableCases = 4;
+// Percentage of table entries that must hold a case; the rest go to the default.
+constexpr uint64_t kMinJumpTableDensity = 10;
+constexpr uint64_t kMaxJumpTableSize = 4096;
+
+// One bit per key of a 64-bit mask.
+constexpr uint64_t kBitTestWidth = 64;
+
+std::vector<std::string> CollectTargets(const std::vector<SwitchCase>& cases,
+                                        size_t first, size_t last) {
+    std::vector<std::string> targets;
+    for (size_t index = first; index <= last; ++index) {
+        if (std::find(targets.begin(), targets.end(), cases[index].target) ==
+            targets.end()) {
+            targets.push_back(cases[index].target);
+        }
+    }
+    return targets;
+}
+
+bool IsJumpTable(const std::vector<SwitchCase>& cases, size_t first, size_t last) {
+    uint64_t count = last - first + 1;
+    uint64_t span = cases[last].key - cases[first].key;
+    if (count < kMinJumpTableCases || span >= kMaxJumpTableSize) {
+        return false;
+    }
+    return count * 100 >= (span + 1) * kMinJumpTableDensity;
+}
+
+// A bit test costs a shift plus an and-and-branch per target, so it only pays off
+// against a compare per case when each target has a few cases on average.
+bool IsBitTest(const std::vector<SwitchCase>& cases, size_t first, size_t last) {
+    uint64_t count = last - first + 1;
+    uint64_t span = cases[last].key - cases[first].key;
+    if (span >= kBitTestWidth) {
+        return false;
+    }
+    switch (CollectTargets(cases, first, last).size()) {
+        case 1:
+            return count >= 3 && count != span + 1;  // no holes: a range is cheaper
+        case 2:
+            return count >= 5;
+        case 3:
+            return count >= 6;
+        default:
+            return false;
+    }
+}
+
+template <typename Predicate>
+std::optional<size_t> FindLongestRun(const std::vector<SwitchCase>& cases, size_t first,
+                                     Predicate is_valid) {
+    for (size_t last = cases.size(); last-- > first;) {
+        if (is_valid(cases, first, last)) {
+            return last;
+        }
+    }
+    return std::nullopt;
+}
+
+CaseCluster MakeJumpTable(const std::vector<SwitchCase>& cases, size_t first,
+                          size_t last, const std::string& default_target) {
+    CaseCluster cluster{.kind = CaseCluster::Kind::JumpTable,
+                        .low = cases[first].key,
+                        .high = cases[last].key};
+    cluster.targets.assign(cluster.high - cluster.low + 1, default_target);
+    for (size_t index = first; index <= last; ++index) {
+        cluster.targets[cases[index].key - cluster.low] = cases[index].target;
+    }
+    return cluster;
+}
+
+CaseCluster MakeBitTest(const std::vector<SwitchCase>& cases, size_t first,
+                        size_t last) {
+    CaseCluster cluster{.kind = CaseCluster::Kind::BitTest,
+                        .low = cases[first].key,
+                        .high = cases[last].key,
+                        .targets = CollectTargets(cases, first, last)};
+    cluster.masks.assign(cluster.targets.size(), 0);
+    for (size_t index = first; index <= last; ++index) {
+        auto it = std::find(cluster.targets.begin(), cluster.targets.end(),
+                            cases[index].target);
+        cluster.masks[it - cluster.targets.begin()] |=
+            uint64_t{1} << (cases[index].key - cluster.low);
+    }
+    return cluster;
+}
+
+}  // namespace
+
+uint64_t ToSwitchKey(const NumericConstant& value, const TypeRef& type) {
+    if (type->IsSigned()) {
+        return static_cast<uint64_t>(value.AsInt64()) ^ kSignBias;
+    }
+    return value.AsUInt64();
+}
+
+NumericConstant FromSwitchKey(uint64_t key, const TypeRef& type) {
+    NumericConstant value = type->IsSigned()
+                                ? NumericConstant(static_cast<long>(key ^ kSignBias))
+                                : NumericConstant(static_cast<unsigned long>(key));
+    value.CastTo(type);
+    return value;
+}
+
+std::pair<uint64_t, uint64_t> GetSwitchKeyRange(const TypeRef& type) {
+    if (type->IsLong()) {
+        return {0, std::numeric_limits<uint64_t>::max()};
+    }
+    if (type->IsSigned()) {
+        return {ToSwitchKey(std::numeric_limits<int>::min(), type),
+                ToSwitchKey(std::numeric_limits<int>::max(), type)};
+    }
+    return {0, std::numeric_limits<uint32_t>::max()};
+}
+
+std::vector<CaseCluster> ClusterSwitchCases(std::vector<SwitchCase> cases,
+                                            const std::string& default_target) {
+    std::sort(cases.begin(), cases.end(),
+              [](const auto& lhs, const auto& rhs) { return lhs.key < rhs.key; });
+
+    std::vector<CaseCluster> clusters;
+    size_t first = 0;
+    while (first < cases.size()) {
+        auto table_last = FindLongestRun(cases, first, IsJumpTable);
+        auto bit_test_last = FindLongestRun(cases, first, IsBitTest);
+        if (bit_test_last && (!table_last || *bit_test_last >= *table_last)) {
+            clusters.push_back(MakeBitTest(cases, first, *bit_test_last));
+            first = *bit_test_last + 1;
+        } else if (table_last) {
+            clusters.push_back(MakeJumpTable(cases, first, *table_last, default_target));
+            first = *table_last + 1;
+        } else {
+            size_t last = first;
+            while (last + 1 < cases.size() &&
+                   cases[last + 1].key == cases[last].key + 1 &&
+                   cases[last + 1].target == cases[first].target) {
+                ++last;
+            }
+            clusters.push_back({.kind = CaseCluster::Kind::Range,
+                                .low = cases[first].key,
+                                .high = cases[last].key,
+                                .targets = {cases[first].target}});
+            first = last + 1;
+        }
+    }
+    return clusters;
+}
@@ -4,8 +4,34 @@
 
 #include "include/ast/declarations.h"
 #include "include/ast/expressions.h"
+#include "include/semantic/builtins.h"
 #include "include/semantic/symbol_table.h"
 #include "include/types/numeric_constant.h"
+#include "include/types/primitive_type.h"
+
+namespace {
+
+// Up to this many clusters are tested one after another instead of by binary search.
+constexpr size_t kMaxLinearClusters = 3;
+
+// Consecutive labels like "case 1: case 2: stmt" mark the same statement, so dispatch
+// targets the innermost one and every case reaching it counts as one destination.
+std::string GetSwitchTarget(Statement* statement) {
+    std::string label;
+    while (true) {
+        if (auto* case_statement = dynamic_cast<CaseStatement*>(statement)) {
+            label = case_statement->GetLabel();
+            statement = case_statement->GetStatement();
+        } else if (auto* default_statement = dynamic_cast<DefaultStatement*>(statement)) {
+            label = default_statement->GetLabel();
+            statement = default_statement->GetStatement();
+        } else {
+            return label;
+        }
+    }
+}
+
+}  // namespace
 
 TACVisitor::TACVisitor(SymbolTable& symbol_table) : symbol_table_(symbol_table) {}
 
@@ -178,9 +204,7 @@ void TACVisitor::Visit(ConditionalExpression* expression) {
     std::string label_end = "label_end_" + label_id;
     std::string variable_name = AllocateTemporary(expression->GetTypeRef());
 
-    expression->GetCondition()->Accept(this);
-    TACOperand cond = GetTop();
-    instructions_.back().push_back(TACInstruction::IfFalse(label_else, cond));
+    EmitBranchOnBool(expression->GetCondition(), label_else, false);
 
     expression->GetLeftExpression()->Accept(this);
     TACOperand value = GetTop();
@@ -274,9 +298,7 @@ void TACVisitor::Visit(SelectionStatement* statement) {
     std::string label_else = "label_else_" + label_id;
     std::string label_end = "label_end_" + label_id;
 
-    statement->GetCondition()->Accept(this);
-    TACOperand cond = GetTop();
-    instructions_.back().push_back(TACInstruction::IfFalse(label_else, cond));
+    EmitBranchOnBool(statement->GetCondition(), label_else, false);
     statement->GetThenStatement()->Accept(this);
     instructions_.back().push_back(TACInstruction::GoTo(label_end));
     instructions_.back().push_back(TACInstruction::Label(label_else));
@@ -304,9 +326,7 @@ void TACVisitor::Visit(WhileStatement* statement) {
 
     if (statement->GetType() == WhileStatement::LoopType::While) {
         instructions_.back().push_back(TACInstruction::Label(label_continue));
-        statement->GetCondition()->Accept(this);
-        TACOperand cond = GetTop();
-        instructions_.back().push_back(TACInstruction::IfFalse(label_break, cond));
+        EmitBranchOnBool(statement->GetCondition(), label_break, false);
         statement->GetBody()->Accept(this);
         instructions_.back().push_back(TACInstruction::GoTo(label_continue));
         instructions_.back().push_back(TACInstruction::Label(label_break));
@@ -314,9 +334,7 @@ void TACVisitor::Visit(WhileStatement* statement) {
         instructions_.back().push_back(TACInstruction::Label(label_start));
         statement->GetBody()->Accept(this);
         instructions_.back().push_back(TACInstruction::Label(label_continue));
-        statement->GetCondition()->Accept(this);
-        TACOperand cond = GetTop();
-        instructions_.back().push_back(TACInstruction::If(label_start, cond));
+        EmitBranchOnBool(statement->GetCondition(), label_start, true);
         instructions_.back().push_back(TACInstruction::Label(label_break));
     }
 }
@@ -328,9 +346,7 @@ void TACVisitor::Visit(ForStatement* statement) {
 
     statement->GetInit()->Accept(this);
     instructions_.back().push_back(TACInstruction::Label(label_start));
-    statement->GetCondition()->Accept(this);
-    TACOperand cond = GetTop();
-    instructions_.back().push_back(TACInstruction::IfFalse(label_break, cond));
+    EmitBranchOnBool(statement->GetCondition(), label_break, false);
     statement->GetBody()->Accept(this);
     instructions_.back().push_back(TACInstruction::Label(label_continue));
     statement->GetIncrement()->Accept(this);
@@ -338,6 +354,53 @@ void TACVisitor::Visit(ForStatement* statement) {
     instructions_.back().push_back(TACInstruction::Label(label_break));
 }
 
+void TACVisitor::Visit(SwitchStatement* statement) {
+    std::string label_break = statement->GetLabel() + "_break";
+    TypeRef type = statement->GetExpression()->GetTypeRef();
+
+    statement->GetExpression()->Accept(this);
+    TACOperand value = GetTop();
+    if (value.IsConstant()) {
+        std::string copy = AllocateTemporary(type);
+        instructions_.back().push_back(TACInstruction::Assign(copy, value));
+        value = TACOperand(copy);
+    }
+
+    SwitchDispatch dispatch{
+        .value = value,
+        .type = type,
+        .index_type =
+            type->IsLong() ? PrimitiveType::GetUInt64() : PrimitiveType::GetUInt32(),
+        .default_target = statement->HasDefault()
+                              ? GetSwitchTarget(statement->GetDefault())
+                              : label_break,
+    };
+
+    std::vector<SwitchCase> cases;
+    for (auto* case_statement : statement->GetCases()) {
+        if (case_statement->HasValue()) {
+            cases.push_back({ToSwitchKey(case_statement->GetValue(), type),
+                             GetSwitchTarget(case_statement)});
+        }
+    }
+    auto clusters = ClusterSwitchCases(std::move(cases), dispatch.default_target);
+    auto [low, high] = GetSwitchKeyRange(type);
+    LowerCaseClusters(dispatch, clusters, 0, clusters.size(), low, high);
+
+    statement->GetBody()->Accept(this);
+    instructions_.back().push_back(TACInstruction::Label(label_break));
+}
+
+void TACVisitor::Visit(CaseStatement* statement) {
+    instructions_.back().push_back(TACInstruction::Label(statement->GetLabel()));
+    statement->GetStatement()->Accept(this);
+}
+
+void TACVisitor::Visit(DefaultStatement* statement) {
+    instructions_.back().push_back(TACInstruction::Label(statement->GetLabel()));
+    statement->GetStatement()->Accept(this);
+}
+
 void TACVisitor::Visit(FunctionDeclarator* declarator) {}
 
 void TACVisitor::Visit(IdentifierDeclarator* declarator) {
@@ -383,6 +446,10 @@ void TACVisitor::Visit(FunctionCallExpression* expression) {
 
     if (auto id_expr = dynamic_cast<IdExpression*>(function)) {
         function_name = id_expr->GetId();
+        if (auto builtin = FindBuiltin(function_name)) {
+            LowerBuiltinCall(expression, *builtin);
+            return;
+        }
     } else if (auto func_decl = dynamic_cast<FunctionDeclarator*>(function)) {
         function_name = func_decl->GetId();
     }
@@ -404,16 +471,195 @@ void TACVisitor::Visit(FunctionCallExpression* expression) {
     stack_.push(return_value);
 }
 
+void TACVisitor::LowerBuiltinCall(FunctionCallExpression* expression, Builtin builtin) {
+    const auto& args = expression->GetArguments()->GetArguments();
+    switch (builtin) {
+        case Builtin::Expect:
+            // Only branches use the expected value; see EmitBranchOnBool.
+            args[0]->Accept(this);
+            break;
+        case Builtin::CountLeadingZeros:
+        case Builtin::CountLeadingZerosLong:
+            LowerBitBuiltin(expression, TACInstruction::OpCode::CountLeadingZeros);
+            break;
+        case Builtin::CountTrailingZeros:
+        case Builtin::CountTrailingZerosLong:
+            LowerBitBuiltin(expression, TACInstruction::OpCode::CountTrailingZeros);
+            break;
+        case Builtin::PopCount:
+        case Builtin::PopCountLong:
+            LowerBitBuiltin(expression, TACInstruction::OpCode::PopCount);
+            break;
+        case Builtin::ByteSwap32:
+        case Builtin::ByteSwap64:
+            LowerBitBuiltin(expression, TACInstruction::OpCode::ByteSwap);
+            break;
+    }
+}
+
+// The operation works at the width of its operand; counts of a long are truncated to
+// the int the builtin returns.
+void TACVisitor::LowerBitBuiltin(FunctionCallExpression* expression,
+                                 TACInstruction::OpCode op) {
+    const auto& arg = expression->GetArguments()->GetArguments()[0];
+    arg->Accept(this);
+    auto src = GetTop();
+    TypeRef operand_type = arg->GetTypeRef();
+    TypeRef result_type = expression->GetTypeRef();
+    bool same_width = operand_type->Size() == result_type->Size();
+    std::string value = AllocateTemporary(same_width ? result_type : operand_type);
+    instructions_.back().push_back(TACInstruction::Unary(op, value, src));
+    if (same_width) {
+        stack_.push(value);
+        return;
+    }
+    std::string result = AllocateTemporary(result_type);
+    instructions_.back().push_back(TACInstruction::Truncate(result, value));
+    stack_.push(result);
+}
+
 void TACVisitor::Visit(ArgumentExpressionList* list) {
     const auto& arguments = list->GetArguments();
 
+    // Evaluate every argument before the first Param so that the params of a nested
+    // call are not interleaved with ours.
+    std::vector<TACOperand> values;
+    values.reserve(arguments.size());
     for (size_t index = 0; index < arguments.size(); ++index) {
         arguments[index]->Accept(this);
-        TACOperand src = GetTop();
+        values.push_back(GetTop());
+    }
+    for (const auto& src : values) {
         instructions_.back().push_back(TACInstruction::Param(src));
     }
 }
 
+// Dispatches a value known to lie in the key range [low, high] over
+// clusters[first, last). Every path ends in a jump, to the default if nothing matches.
+void TACVisitor::LowerCaseClusters(const SwitchDispatch& dispatch,
+                                   const std::vector<CaseCluster>& clusters, size_t first,
+                                   size_t last, uint64_t low, uint64_t high) {
+    if (last - first <= kMaxLinearClusters) {
+        for (size_t index = first; index < last; ++index) {
+            bool is_last = index + 1 == last;
+            LowerCaseCluster(dispatch, clusters[index], low, high,
+                             is_last ? dispatch.default_target : "");
+            if (clusters[index].low <= low) {
+                low = clusters[index].high + 1;
+            }
+        }
+        instructions_.back().push_back(TACInstruction::GoTo(dispatch.default_target));
+        return;
+    }
+
+    size_t middle = first + (last - first) / 2;
+    uint64_t pivot = clusters[middle].low;
+    std::string label_low = "label_switch_low_" + GetUniqueLabelId();
+    TACOperand cond = EmitSwitchCompare(TACInstruction::OpCode::Less, dispatch.value,
+                                        FromSwitchKey(pivot, dispatch.type));
+    instructions_.back().push_back(TACInstruction::If(label_low, cond));
+    LowerCaseClusters(dispatch, clusters, middle, last, pivot, high);
+    instructions_.back().push_back(TACInstruction::Label(label_low));
+    LowerCaseClusters(dispatch, clusters, first, middle, low, pivot - 1);
+}
+
+// Jumps to the cluster's target for a matching value and otherwise falls through, or
+// goes to miss_target if one is given. Range checks that [low, high] makes redundant are
+// left out.
+void TACVisitor::LowerCaseCluster(const SwitchDispatch& dispatch,
+                                  const CaseCluster& cluster, uint64_t low,
+                                  uint64_t high, const std::string& miss_target) {
+    using Op = TACInstruction::OpCode;
+    auto& instructions = instructions_.back();
+    bool in_range = cluster.low <= low && cluster.high >= high;
+    auto to_index = [&](uint64_t key) {
+        NumericConstant index = static_cast<unsigned long>(key);
+        index.CastTo(dispatch.index_type);
+        return index;
+    };
+
+    if (cluster.kind == CaseCluster::Kind::Range) {
+        const auto& target = cluster.targets.front();
+        if (in_range) {
+            instructions.push_back(TACInstruction::GoTo(target));
+            return;
+        }
+        TACOperand cond("");
+        if (cluster.low == cluster.high) {
+            cond = EmitSwitchCompare(Op::Equal, dispatch.value,
+                                     FromSwitchKey(cluster.low, dispatch.type));
+        } else if (cluster.low <= low) {
+            cond = EmitSwitchCompare(Op::LessEqual, dispatch.value,
+                                     FromSwitchKey(cluster.high, dispatch.type));
+        } else if (cluster.high >= high) {
+            cond = EmitSwitchCompare(Op::GreaterEqual, dispatch.value,
+                                     FromSwitchKey(cluster.low, dispatch.type));
+        } else {
+            TACOperand offset = EmitSwitchOffset(dispatch, cluster.low);
+            cond = EmitSwitchCompare(Op::LessEqual, offset,
+                                     to_index(cluster.high - cluster.low));
+        }
+        instructions.push_back(TACInstruction::If(target, cond));
+        return;
+    }
+
+    std::string label_miss;
+    TACOperand index = EmitSwitchOffset(dispatch, cluster.low);
+    if (!in_range) {
+        label_miss = miss_target.empty() ? "label_switch_miss_" + GetUniqueLabelId()
+                                         : miss_target;
+        TACOperand cond =
+            EmitSwitchCompare(Op::Greater, index, to_index(cluster.high - cluster.low));
+        instructions.push_back(TACInstruction::If(label_miss, cond));
+    }
+    if (!dispatch.type->IsLong()) {
+        std::string wide_index = AllocateTemporary(PrimitiveType::GetUInt64());
+        instructions.push_back(TACInstruction::ZeroExtend(wide_index, index));
+        index = TACOperand(wide_index);
+    }
+
+    if (cluster.kind == CaseCluster::Kind::JumpTable) {
+        instructions.push_back(TACInstruction::JumpTable(index, cluster.targets));
+    } else {
+        std::string bit = AllocateTemporary(PrimitiveType::GetUInt64());
+        instructions.push_back(TACInstruction::Binary(
+            Op::LeftShift, bit, TACOperand(NumericConstant(1ul)), index));
+        for (size_t target = 0; target < cluster.targets.size(); ++target) {
+            std::string test = AllocateTemporary(PrimitiveType::GetUInt64());
+            instructions.push_back(TACInstruction::Binary(
+                Op::BitwiseAnd, test, bit,
+                TACOperand(NumericConstant(
+                    static_cast<unsigned long>(cluster.masks[target])))));
+            instructions.push_back(TACInstruction::If(cluster.targets[target], test));
+        }
+        instructions.push_back(TACInstruction::GoTo(dispatch.default_target));
+    }
+
+    if (!label_miss.empty() && miss_target.empty()) {
+        instructions.push_back(TACInstruction::Label(label_miss));
+    }
+}
+
+// value - key as an unsigned index, so one unsigned comparison checks both bounds.
+TACOperand TACVisitor::EmitSwitchOffset(const SwitchDispatch& dispatch, uint64_t key) {
+    NumericConstant low = FromSwitchKey(key, dispatch.type);
+    if (!dispatch.type->IsSigned() && low.AsUInt64() == 0) {
+        return dispatch.value;
+    }
+    std::string offset = AllocateTemporary(dispatch.index_type);
+    instructions_.back().push_back(TACInstruction::Binary(
+        TACInstruction::OpCode::Sub, offset, dispatch.value, TACOperand(low)));
+    return TACOperand(offset);
+}
+
+TACOperand TACVisitor::EmitSwitchCompare(TACInstruction::OpCode op, const TACOperand& lhs,
+                                         const NumericConstant& rhs) {
+    std::string cond = AllocateTemporary(PrimitiveType::GetInt32());
+    instructions_.back().push_back(
+        TACInstruction::Binary(op, cond, lhs, TACOperand(rhs)));
+    return TACOperand(cond);
+}
+
 std::string TACVisitor::AllocateTemporary(TypeRef type) {
     std::string name = GetTemporaryName();
     symbol_table_.Register({
@@ -440,20 +686,74 @@ TACOperand TACVisitor::GetTop() {
     return value;
 }
 
+// Jumps to target when the truth value of the condition equals jump_if and falls
+// through otherwise. &&, || and ! only steer the branches and produce no value.
+void TACVisitor::EmitBranchOnBool(Expression* condition, const std::string& target,
+                                  bool jump_if, std::optional<bool> expected) {
+    if (auto* unary = dynamic_cast<UnaryExpression*>(condition);
+        unary && unary->GetOp() == UnaryExpression::UnaryOperator::Not) {
+        if (expected) {
+            expected = !*expected;
+        }
+        EmitBranchOnBool(unary->GetExpression(), target, !jump_if, expected);
+        return;
+    }
+
+    // __builtin_expect(value, c) expects value == c, so the value is expected to be
+    // true if c is not 0. The cast to long around the value keeps whether it is zero.
+    if (auto* call = dynamic_cast<FunctionCallExpression*>(condition)) {
+        auto* id = dynamic_cast<IdExpression*>(call->GetFunction());
+        if (id && FindBuiltin(id->GetId()) == Builtin::Expect) {
+            const auto& args = call->GetArguments()->GetArguments();
+            Expression* value = args[0].get();
+            if (auto* cast = dynamic_cast<CastExpression*>(value);
+                cast && cast->GetExpression()->GetTypeRef()->IsIntegral()) {
+                value = cast->GetExpression();
+            }
+            auto* constant = static_cast<PrimaryExpression*>(args[1].get());
+            bool hint = constant->GetValue().AsUInt64() != 0;
+            EmitBranchOnBool(value, target, jump_if, hint);
+            return;
+        }
+    }
+
+    auto* binary = dynamic_cast<BinaryExpression*>(condition);
+    bool is_and = binary && binary->GetOp() == BinaryExpression::BinaryOperator::And;
+    bool is_or = binary && binary->GetOp() == BinaryExpression::BinaryOperator::Or;
+    if (!is_and && !is_or) {
+        condition->Accept(this);
+        TACOperand cond = GetTop();
+        instructions_.back().push_back(
+            jump_if ? TACInstruction::If(target, cond, expected)
+                    : TACInstruction::IfFalse(target, cond, expected));
+        return;
+    }
+
+    // Both operands of `a && b` are expected to be true when the whole is, and both of
+    // `a || b` to be false.
+    if (expected && *expected != is_and) {
+        expected.reset();
+    }
+    // `a && b` is false as soon as a is, `a || b` true as soon as a is. Otherwise the
+    // result is that of b.
+    if (is_or == jump_if) {
+        EmitBranchOnBool(binary->GetLeftExpression(), target, jump_if, expected);
+        EmitBranchOnBool(binary->GetRightExpression(), target, jump_if, expected);
+        return;
+    }
+    std::string label_skip = "label_skip_" + GetUniqueLabelId();
+    EmitBranchOnBool(binary->GetLeftExpression(), label_skip, is_or, expected);
+    EmitBranchOnBool(binary->GetRightExpression(), target, jump_if, expected);
+    instructions_.back().push_back(TACInstruction::Label(label_skip));
+}
+
 void TACVisitor::ProcessBinaryOr(BinaryExpression* expression) {
     std::string label_id = GetUniqueLabelId();
     std::string label_true = "label_true_" + label_id;
     std::string label_end = "label_end_" + label_id;
     std::string variable_name = AllocateTemporary(expression->GetTypeRef());
 
-    expression->GetLeftExpression()->Accept(this);
-    TACOperand lhs = GetTop();
-    instructions_.back().push_back(TACInstruction::If(label_true, lhs));
-
-    expression->GetRightExpression()->Accept(this);
-    TACOperand rhs = GetTop();
-    instructions_.back().push_back(TACInstruction::If(label_true, rhs));
-
+    EmitBranchOnBool(expression, label_true, true);
     instructions_.back().push_back(
         TACInstruction::Assign(variable_name, TACOperand(NumericConstant(0))));
     instructions_.back().push_back(TACInstruction::GoTo(label_end));
@@ -471,14 +771,7 @@ void TACVisitor::ProcessBinaryAnd(BinaryExpression* expression) {
     std::string label_end = "label_end_" + label_id;
     std::string variable_name = AllocateTemporary(expression->GetTypeRef());
 
-    expression->GetLeftExpression()->Accept(this);
-    TACOperand lhs = GetTop();
-    instructions_.back().push_back(TACInstruction::IfFalse(label_false, lhs));
-
-    expression->GetRightExpression()->Accept(this);
-    TACOperand rhs = GetTop();
-    instructions_.back().push_back(TACInstruction::IfFalse(label_false, rhs));
-
+    EmitBranchOnBool(expression, label_false, false);
     instructions_.back().push_back(
         TACInstruction::Assign(variable_name, TACOperand(NumericConstant(1))));
     instructions_.back().push_back(TACInstruction::GoTo(label_end));
@@ -513,7 +806,7 @@ void PrintTACInstructions(std::ostream& out,
 }
 
 void TACVisitor::AddStaticVariables() {
-    for (const auto& [name, info] : symbol_table_.GetAllSymbols()) {
+    for (const auto& info : symbol_table_.GetAllSymbols()) {
         if (!info.HasStaticDuration()) {
             continue;
         }
@@ -527,6 +820,6 @@ void TACVisitor::AddStaticVariables() {
             (info.init_state == SymbolInfo::InitialValue::Initial) ? *info.init_constant
                                                                    : NumericConstant(0);
         instructions_.emplace_back().push_back(
-            TACInstruction::StaticVariable(name, initializer, is_global));
+            TACInstruction::StaticVariable(info.name, initializer, is_global));
     }
 }
@@ -1,7 +1,26 @@
 #include "include/types/function_type.h"
 
+#include <map>
+#include <memory>
+#include <mutex>
 #include <sstream>
 
+TypeRef FunctionType::Get(TypeRef return_type, std::vector<TypeRef> param_types) {
+    // Function types are only built for declarations, so one lock for all translation
+    // units costs little.
+    static std::mutex mutex;
+    static std::map<std::vector<TypeRef>, std::unique_ptr<FunctionType>> instances;
+
+    std::vector<TypeRef> key(1, return_type);
+    key.insert(key.end(), param_types.begin(), param_types.end());
+    std::lock_guard lock(mutex);
+    auto& instance = instances[std::move(key)];
+    if (!instance) {
+        instance.reset(new FunctionType(return_type, std::move(param_types)));
+    }
+    return instance.get();
+}
+
 FunctionType::FunctionType(TypeRef return_type, std::vector<TypeRef> param_types)
     : Type(Type::Kind::Function),
       return_type_(std::move(return_type)),
@@ -24,31 +43,3 @@ std::string FunctionType::ToString() const {
         oss << "void";
     return oss.str();
 }
-
-bool FunctionType::Equals(const TypeRef& other) const {
-    if (!other) {
-        return false;
-    }
-    if (this == other.get()) {
-        return true;
-    }
-
-    auto func = std::dynamic_pointer_cast<FunctionType>(other);
-    if (!func) {
-        return false;
-    }
-    if (param_types_.size() != func->param_types_.size()) {
-        return false;
-    }
-
-    if (!return_type_->Equals(func->return_type_)) {
-        return false;
-    }
-
-    for (size_t idx = 0; idx < param_types_.size(); ++idx) {
-        if (!param_types_[idx]->Equals(func->param_types_[idx])) {
-            return false;
-        }
-    }
-    return true;
-}
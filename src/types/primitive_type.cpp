@@ -1,7 +1,5 @@
 #include "include/types/primitive_type.h"
 
-#include <mutex>
-
 PrimitiveType::PrimitiveType(Tag tag) : Type(Type::Kind::Primitive), tag_(tag) {}
 
 PrimitiveType::Tag PrimitiveType::GetTag() const { return tag_; }
@@ -49,33 +47,13 @@ std::string PrimitiveType::ToString() const {
     return "primitive";
 }
 
-bool PrimitiveType::Equals(const TypeRef& other) const {
-    if (!other) {
-        return false;
-    }
-    if (this == other.get()) {
-        return true;
-    }
-
-    auto ptr = std::dynamic_pointer_cast<PrimitiveType>(other);
-    if (!ptr) {
-        return false;
-    }
-    return ptr->tag_ == tag_;
-}
-
 //////////////////////////////////////////////////
 
-// to do: как-то количество по-другому считать
-TypeRef& PrimitiveType::GetInstance(Tag tag) {
-    static TypeRef instances[5] = {nullptr, nullptr, nullptr, nullptr, nullptr};
-    static std::once_flag flags[5] = {std::once_flag(), std::once_flag(),
-                                      std::once_flag(), std::once_flag(),
-                                      std::once_flag()};
-    int idx = static_cast<int>(tag);
-    std::call_once(flags[idx],
-                   [&]() { instances[idx] = std::make_shared<PrimitiveType>(tag); });
-    return instances[idx];
+TypeRef PrimitiveType::GetInstance(Tag tag) {
+    static const PrimitiveType instances[] = {
+        PrimitiveType(Tag::Int32), PrimitiveType(Tag::Int64), PrimitiveType(Tag::UInt32),
+        PrimitiveType(Tag::UInt64), PrimitiveType(Tag::Double)};
+    return &instances[static_cast<int>(tag)];
 }
 
 TypeRef PrimitiveType::GetInt32() { return GetInstance(Tag::Int32); }
@@ -256,6 +256,34 @@ void PrintVisitor::Visit(ForStatement* statement) {
     number_of_tabs_--;
 }
 
+void PrintVisitor::Visit(SwitchStatement* statement) {
+    PrintTabs();
+    stream_ << "SwitchStatement: switch (";
+    statement->GetExpression()->Accept(this);
+    stream_ << ")" << std::endl;
+    number_of_tabs_++;
+    statement->GetBody()->Accept(this);
+    number_of_tabs_--;
+}
+
+void PrintVisitor::Visit(CaseStatement* statement) {
+    PrintTabs();
+    stream_ << "CaseStatement: case ";
+    statement->GetExpression()->Accept(this);
+    stream_ << ":" << std::endl;
+    number_of_tabs_++;
+    statement->GetStatement()->Accept(this);
+    number_of_tabs_--;
+}
+
+void PrintVisitor::Visit(DefaultStatement* statement) {
+    PrintTabs();
+    stream_ << "DefaultStatement: default:" << std::endl;
+    number_of_tabs_++;
+    statement->GetStatement()->Accept(this);
+    number_of_tabs_--;
+}
+
 void PrintVisitor::Visit(ParameterDeclaration* declaration) {
     declaration->GetType()->Accept(this);
     stream_ << " ";